@@ -23,7 +23,9 @@
 #include <jni.h>
 
 #include <mutex>
+#include <vector>
 #include <cstdlib>
+#include <cstring>
 #include <cstdint>
 #include <cstdbool>
 
@@ -36,6 +38,22 @@ static mutex db_mutex;
 static CryptoDB *db = nullptr;
 static cryptodb_options_t db_options;
 
+/**
+ * Zeroes the whole capacity of the value buffer, so the plaintext of the
+ * last value doesn't stay in the thread-local buffer
+ */
+template <typename Container>
+static void wipe_value(Container &val)
+{
+    val.resize(val.capacity());
+
+    volatile uint8_t *p = (volatile uint8_t *)val.data();
+    for (size_t i = 0; i < val.size(); ++i)
+        p[i] = 0;
+
+    val.clear();
+}
+
 static bool is_dboptions_initialized(void)
 {
     return db_options.block_size &&
@@ -248,31 +266,104 @@ Java_com_yahniukov_cryptodb_CryptoDB_putDouble(
     return result;
 }
 
+extern "C" JNIEXPORT jint JNICALL
+Java_com_yahniukov_cryptodb_CryptoDB_putInt64(
+        JNIEnv* env,
+        jclass thiz,
+        jstring key,
+        jlong val) {
+    char *key_p = (char *)env->GetStringUTFChars(key, 0);
+
+    // Keys are written with the terminating zero, see putString()
+    jint result = (jint)db->Put(string_view(key_p, strlen(key_p) + 1), (int64_t)val);
+
+    env->ReleaseStringUTFChars(key, key_p);
+
+    return result;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_yahniukov_cryptodb_CryptoDB_putUInt64(
+        JNIEnv* env,
+        jclass thiz,
+        jstring key,
+        jlong val) {
+    char *key_p = (char *)env->GetStringUTFChars(key, 0);
+
+    // Java has no unsigned long, the bits are the same
+    jint result = (jint)db->Put(string_view(key_p, strlen(key_p) + 1), (uint64_t)val);
+
+    env->ReleaseStringUTFChars(key, key_p);
+
+    return result;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_yahniukov_cryptodb_CryptoDB_putBlob(
+        JNIEnv* env,
+        jclass thiz,
+        jstring key,
+        jbyteArray val) {
+    char *key_p = (char *)env->GetStringUTFChars(key, 0);
+    jbyte *val_p = env->GetByteArrayElements(val, 0);
+
+    // Keys are written with the terminating zero, see putString()
+    jint result = (jint)db->Put(string_view(key_p, strlen(key_p) + 1),
+                                (const void *)val_p,
+                                (size_t)env->GetArrayLength(val));
+
+    env->ReleaseStringUTFChars(key, key_p);
+    // Nothing to copy back
+    env->ReleaseByteArrayElements(val, val_p, JNI_ABORT);
+
+    return result;
+}
+
 extern "C" JNIEXPORT jstring JNICALL
 Java_com_yahniukov_cryptodb_CryptoDB_getString(
         JNIEnv* env,
         jclass thiz,
-        jstring key,
-        jint expected_max_length) {
-    string *val = nullptr;
+        jstring key) {
+    // Reused between calls, grows only when a value doesn't fit.
+    // It's wiped before return, only the capacity is kept.
+    static thread_local string val;
 
     char *key_p = (char *)env->GetStringUTFChars(key, 0);
 
-    int err = db->GetString(string(key_p),
-                            (int)expected_max_length,
-                            &val);
+    // Keys are written with the terminating zero, see putString()
+    int err = db->Get(string_view(key_p, strlen(key_p) + 1), val);
 
     env->ReleaseStringUTFChars(key, key_p);
 
-    if (err != CRYPTODB_SUCCESS || val == nullptr) {
-        if (val != nullptr)
-            delete val;
-        return env->NewStringUTF("");
-    }
+    jstring result = env->NewStringUTF(err == CRYPTODB_SUCCESS ? val.c_str() : "");
 
-    jstring result = env->NewStringUTF((*val).c_str());
+    // A value of another type may be read into the buffer as well
+    wipe_value(val);
 
-    delete val;
+    return result;
+}
+
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_com_yahniukov_cryptodb_CryptoDB_getBlob(
+        JNIEnv* env,
+        jclass thiz,
+        jstring key) {
+    // Reused between calls, see getString()
+    static thread_local vector<uint8_t> val;
+
+    char *key_p = (char *)env->GetStringUTFChars(key, 0);
+
+    int err = db->Get(string_view(key_p, strlen(key_p) + 1), val);
+
+    env->ReleaseStringUTFChars(key, key_p);
+
+    jbyteArray result = nullptr;
+    if (err == CRYPTODB_SUCCESS)
+        result = env->NewByteArray((jint)val.size());
+    if (result != nullptr)
+        env->SetByteArrayRegion(result, 0, (jint)val.size(), (const jbyte *)val.data());
+
+    wipe_value(val);
 
     return result;
 }
@@ -329,6 +420,51 @@ Java_com_yahniukov_cryptodb_CryptoDB_getDouble(
     return result;
 }
 
+extern "C" JNIEXPORT jint JNICALL
+Java_com_yahniukov_cryptodb_CryptoDB_getInt64(
+        JNIEnv* env,
+        jclass thiz,
+        jstring key,
+        jlongArray val) {
+    int64_t value = 0;
+
+    char *key_p = (char *)env->GetStringUTFChars(key, 0);
+
+    // Any 64-bit value is valid, so the error is returned separately
+    int err = db->Get(string_view(key_p, strlen(key_p) + 1), value);
+
+    env->ReleaseStringUTFChars(key, key_p);
+
+    if (err == CRYPTODB_SUCCESS) {
+        jlong result = (jlong)value;
+        env->SetLongArrayRegion(val, 0, 1, &result);
+    }
+
+    return (jint)err;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_yahniukov_cryptodb_CryptoDB_getUInt64(
+        JNIEnv* env,
+        jclass thiz,
+        jstring key,
+        jlongArray val) {
+    uint64_t value = 0;
+
+    char *key_p = (char *)env->GetStringUTFChars(key, 0);
+
+    int err = db->Get(string_view(key_p, strlen(key_p) + 1), value);
+
+    env->ReleaseStringUTFChars(key, key_p);
+
+    if (err == CRYPTODB_SUCCESS) {
+        jlong result = (jlong)value;
+        env->SetLongArrayRegion(val, 0, 1, &result);
+    }
+
+    return (jint)err;
+}
+
 extern "C" JNIEXPORT jint JNICALL
 Java_com_yahniukov_cryptodb_CryptoDB_delete(
         JNIEnv* env,
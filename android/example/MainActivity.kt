@@ -97,9 +97,7 @@ class MainActivity : AppCompatActivity() {
             return
         }
 
-        var getStringResult: CryptoDB.GetStringResult = CryptoDB.GetString(
-            "test_string",
-            "test_string_val".length * 2)
+        var getStringResult: CryptoDB.GetStringResult = CryptoDB.GetString("test_string")
         if (getStringResult.err != CryptoDB.Error.OK ||
             getStringResult.`val` != "test_string_val") {
             tv?.setText(String.format("ERROR: GetString(): %s : %s",
@@ -146,9 +144,7 @@ class MainActivity : AppCompatActivity() {
             return
         }
 
-        getStringResult = CryptoDB.GetString(
-            "test_string",
-            "test_string_val".length)
+        getStringResult = CryptoDB.GetString("test_string")
         getIntegerResult = CryptoDB.GetInteger("test_int")
         getDoubleResult = CryptoDB.GetDouble("test_double")
 
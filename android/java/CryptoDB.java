@@ -57,9 +57,15 @@ public final class CryptoDB {
     private static native int putString(String key, String val);
     private static native int putInteger(String key, int val);
     private static native int putDouble(String key, double val);
-    private static native String getString(String key, int expected_max_length);
+    private static native int putInt64(String key, long val);
+    private static native int putUInt64(String key, long val);
+    private static native int putBlob(String key, byte[] val);
+    private static native String getString(String key);
+    private static native byte[] getBlob(String key);
     private static native int getInteger(String key);
     private static native double getDouble(String key);
+    private static native int getInt64(String key, long[] val);
+    private static native int getUInt64(String key, long[] val);
     private static native int delete(String key);
 
     public enum Error
@@ -154,6 +160,18 @@ public final class CryptoDB {
         public double val;
     }
 
+    public static class GetInt64Result
+    {
+        public Error err;
+        public long val;
+    }
+
+    public static class GetBlobResult
+    {
+        public Error err;
+        public byte[] val;
+    }
+
     public static long GetUniqDataMaxLen()
     {
         if (CRYPTODB_UNIQ_DATA_MAX_LEN == 0)
@@ -238,11 +256,36 @@ public final class CryptoDB {
         return nativeErrToJavaErr(putDouble(key, val));
     }
 
+    public static Error PutInt64(String key,
+                                 long val)
+    {
+        return nativeErrToJavaErr(putInt64(key, val));
+    }
+
+    // "val" is unsigned, e.g. see Long.toUnsignedString()
+    public static Error PutUInt64(String key,
+                                  long val)
+    {
+        return nativeErrToJavaErr(putUInt64(key, val));
+    }
+
+    public static Error PutBlob(String key,
+                                byte[] val)
+    {
+        return nativeErrToJavaErr(putBlob(key, val));
+    }
+
+    // "expected_max_length" isn't needed anymore, values of any length are read
     public static GetStringResult GetString(String key,
                                             int expected_max_length)
+    {
+        return GetString(key);
+    }
+
+    public static GetStringResult GetString(String key)
     {
         GetStringResult result = new GetStringResult();
-        result.val = getString(key, expected_max_length);
+        result.val = getString(key);
         if (result.val.isEmpty())
             result.err = Error.Fail;
         else
@@ -272,6 +315,37 @@ public final class CryptoDB {
         return result;
     }
 
+    public static GetInt64Result GetInt64(String key)
+    {
+        long[] val = new long[1];
+        GetInt64Result result = new GetInt64Result();
+        result.err = nativeErrToJavaErr(getInt64(key, val));
+        result.val = val[0];
+        return result;
+    }
+
+    // "val" of the result is unsigned, e.g. see Long.toUnsignedString()
+    public static GetInt64Result GetUInt64(String key)
+    {
+        long[] val = new long[1];
+        GetInt64Result result = new GetInt64Result();
+        result.err = nativeErrToJavaErr(getUInt64(key, val));
+        result.val = val[0];
+        return result;
+    }
+
+    // Unlike GetString(), an empty value is read as well
+    public static GetBlobResult GetBlob(String key)
+    {
+        GetBlobResult result = new GetBlobResult();
+        result.val = getBlob(key);
+        if (result.val == null)
+            result.err = Error.Fail;
+        else
+            result.err = Error.OK;
+        return result;
+    }
+
     public static Error Delete(String key)
     {
         return nativeErrToJavaErr(delete(key));
@@ -20,37 +20,152 @@
  *
 */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include <cJSON.h>
 #include <scprng.h>
 #include <leveldb/c.h>
-#include <mbedtls/aes.h>
 #include <mbedtls/sha3.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/platform_util.h>
 
 #include <cryptodb.h>
+#include <cryptodb_aes.h>
+#include <cryptodb_filter.h>
+#include <cryptodb_lz4.h>
+#include <cryptodb_pool.h>
+#include <cryptodb_readahead.h>
+#include <cryptodb_sync.h>
+#include <cryptodb_writer.h>
 
 #define CRYPTODB_AES_BLOCK_LEN (16)
 
+/**
+ * Value record format. Plaintext of every value is:
+ *
+ *   [format: 1 byte][type: 1 byte][payload length: varint][payload]
+ *
+ * and zero padding up to CRYPTODB_AES_BLOCK_LEN. Payload is the string
+ * without terminating null, int32_t or IEEE 754 double, both little-endian.
+ * If the original key is kept in the value (see "keep_original_keys" in
+ * cryptodb_options_t), the format is CRYPTODB_RECORD_FORMAT_V1_KEY and
+ * the payload is followed by [key length: varint][key].
+ * Legacy records are minified JSON, so they always start with '{'.
+ *
+ * If "compression" is set (see cryptodb_options_t), records of at least
+ * CRYPTODB_COMPRESSION_MIN_LEN bytes are compressed before encryption and
+ * stored as:
+ *
+ *   [format: 1 byte][codec: 1 byte][record length: varint]
+ *   [compressed length: varint][compressed record]
+ *
+ * where codec is cryptodb_compression_t and the record is a V1 or V1_KEY
+ * record. It's done only if it saves "compression_min_saving" percent.
+ */
+#define CRYPTODB_RECORD_FORMAT_JSON       ('{')
+#define CRYPTODB_RECORD_FORMAT_V1         (0x01)
+#define CRYPTODB_RECORD_FORMAT_V1_KEY     (0x02)
+#define CRYPTODB_RECORD_FORMAT_COMPRESSED (0x03)
+#define CRYPTODB_VARINT_MAX_LEN           (10)
+#define CRYPTODB_RECORD_HEADER_MAX_LEN    (2 + CRYPTODB_VARINT_MAX_LEN)
+#define CRYPTODB_COMPRESSION_HEADER_MAX_LEN (2 + 2 * CRYPTODB_VARINT_MAX_LEN)
+#define CRYPTODB_COMPRESSION_MIN_LEN      (64)
+#define CRYPTODB_COMPRESSION_MAX_RATIO    (255) // of LZ4, bounds the record length
+
+/**
+ * AES-256-GCM value (see CRYPTODB_CIPHER_AES_256_GCM) is:
+ *
+ *   [marker: 1 byte][nonce: 12 bytes][encrypted record][tag: 16 bytes]
+ *
+ * The record isn't padded, except one zero byte if the value length would
+ * be multiple of CRYPTODB_AES_BLOCK_LEN: AES-256-CBC values always are, so
+ * the cipher is known from the value length. The database key (as it's
+ * stored) is the additional authenticated data, so the value can't be
+ * moved to another key.
+ */
+#define CRYPTODB_VALUE_GCM_MARKER     (0xa7)
+#define CRYPTODB_VALUE_GCM_HEADER_LEN (1 + CRYPTODB_AES_GCM_IV_LEN)
+#define CRYPTODB_VALUE_GCM_OVERHEAD   (CRYPTODB_VALUE_GCM_HEADER_LEN + CRYPTODB_AES_GCM_TAG_LEN)
+
 #define CRYPTODB_UNUSED(var) ((void)var)
 
 /**
  * PRIVATE API
  */
 
+typedef struct {
+    uint8_t encryption_key[32];
+    uint8_t encryption_iv[16];
+    // Key schedules are expanded once per key. They are never moved after
+    // expansion, so _cryptodb_aes_cbc() only reads them and the same
+    // context can be used from many threads at once.
+    _cryptodb_aes_t aes;
+    // Key of the key tokens, see cryptodb_key_mode_t. Expanded only
+    // in the token key modes.
+    _cryptodb_aes_t token_aes;
+} _cryptodb_keys_t;
+
+typedef struct {
+    _cryptodb_keys_t keys[2]; // indexed by "encrypt_decrypt", see cryptodb_user_kdf
+    uint64_t epoch;
+    cryptodb_user_kdf_epoch kdf_epoch;
+    pthread_rwlock_t lock; // taken only if kdf_epoch != NULL
+    // AES-256-GCM nonce of every value is the random base XORed
+    // with the counter, so nonces never repeat within the handler
+    uint8_t nonce_base[CRYPTODB_AES_GCM_IV_LEN];
+    uint64_t nonce_counter;
+} _cryptodb_keystore_t;
+
+/**
+ * Comparator of the databases created by older versions. It gives the same
+ * order as the LevelDB built-in bytewise comparator that is used now, but
+ * its name is stored in the database, so such databases can be opened only
+ * with it (see _cryptodb_open()) until cryptodb_migrate() is done.
+ */
 static void _cryptodb_comparator_destroy(void *arg)
 {
     CRYPTODB_UNUSED(arg);
 }
 
+static inline uint64_t _cryptodb_load_be64(const char *in)
+{
+    uint64_t v = 0;
+
+    memcpy(&v, in, sizeof(uint64_t));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    return v;
+#else
+    return __builtin_bswap64(v);
+#endif
+}
+
 static int _cryptodb_comparator_compare(void *arg,
                                        const char *a, size_t alen,
                                        const char *b, size_t blen)
 {
     CRYPTODB_UNUSED(arg);
+
+    // Key tokens (see cryptodb_key_mode_t) are compared by 64-bit
+    // words, the order is the same as memcmp() gives
+    if (alen == blen && (alen == 16 || alen == 32))
+    {
+        for (size_t i = 0; i < alen; i += sizeof(uint64_t))
+        {
+            uint64_t x = _cryptodb_load_be64(a + i), y = _cryptodb_load_be64(b + i);
+            if (x != y)
+                return x < y ? -1 : +1;
+        }
+        return 0;
+    }
+
     int n = (alen < blen) ? alen : blen;
     int r = memcmp(a, b, n);
     if (r == 0)
@@ -79,94 +194,505 @@ static inline int _leveldb_err_to_cryptodb_err(char *err)
         return CRYPTODB_ERR_FAIL;
 }
 
-static char * _cryptodb_val_to_json(cryptodb_val_t valtype, void *val)
+static inline bool _leveldb_err_is_comparator_mismatch(const char *err)
 {
-    char *cjson = NULL;
-    cJSON *json = cJSON_CreateObject();
-    if (json == NULL)
+    return strstr(err, "does not match existing comparator") != NULL;
+}
+
+/**
+ * LevelDB options that are common for opening, destroying and
+ * migrating the database. Returns NULL if there is no memory.
+ */
+static leveldb_options_t *_cryptodb_dboptions_create(const cryptodb_options_t *options)
+{
+    leveldb_options_t *dboptions = leveldb_options_create();
+    if (dboptions == NULL)
         return NULL;
 
+    leveldb_options_set_info_log(dboptions, NULL);
+    leveldb_options_set_paranoid_checks(dboptions, 1);
+    leveldb_options_set_create_if_missing(dboptions, 1);
+    leveldb_options_set_compression(dboptions, leveldb_no_compression);
+
+    leveldb_options_set_block_size(dboptions,
+                                   options ?
+                                   options->block_size :
+                                   CRYPTODB_OPT_DEFAULT_BLOCK_SIZE);
+    leveldb_options_set_max_open_files(dboptions,
+                                       options ?
+                                       options->max_open_files :
+                                       CRYPTODB_OPT_DEFAULT_MAX_FILES);
+    leveldb_options_set_max_file_size(dboptions,
+                                      options ?
+                                      options->max_file_size :
+                                      CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE);
+    leveldb_options_set_write_buffer_size(dboptions,
+                                          options ?
+                                          options->write_buffer_size :
+                                          CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE);
+    leveldb_options_set_block_restart_interval(dboptions,
+                                               options ?
+                                               options->block_restart_interval :
+                                               CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT);
+
+    return dboptions;
+}
+
+/**
+ * Caller's buffer of cryptodb_get_buf(). The value of any type is written
+ * only if it fits into "cap" bytes, "len" and "valtype" are set anyway.
+ */
+typedef struct {
+    size_t cap;
+    size_t len;
+    cryptodb_val_t valtype;
+} _cryptodb_val_buf_t;
+
+/**
+ * Sets the value of "valtype" that takes "len" bytes to the caller's
+ * buffer and checks that it fits
+ */
+static int _cryptodb_val_buf_fit(_cryptodb_val_buf_t *vbuf,
+                                 cryptodb_val_t valtype, size_t len)
+{
+    vbuf->valtype = valtype;
+    vbuf->len = len;
+
+    return len > vbuf->cap ? CRYPTODB_ERR_BUFFER_TOO_SMALL : CRYPTODB_SUCCESS;
+}
+
+/**
+ * Legacy JSON record decoding. The record is parsed only once and the
+ * value is written straight into "val". If "vbuf" isn't NULL, the value
+ * of any type is written, see _cryptodb_val_buf_t. See cryptodb_get() for
+ * return values.
+ */
+static int _cryptodb_json_record_to_val(const char *cjson, size_t cjson_len,
+                                        cryptodb_val_t valtype, void *val,
+                                        _cryptodb_val_buf_t *vbuf)
+{
+    int val_int = 0;
+    double val_double = 0;
+    int result = CRYPTODB_SUCCESS;
+    const char *type_str = NULL;
+    cJSON *json = NULL, *json_val = NULL;
+    cryptodb_val_t cvaltype = CRYPTODB_VAL_UNKNOWN;
+
+    // JSON is null-terminated before the padding
+    if (memchr(cjson, '\0', cjson_len) == NULL)
+        return CRYPTODB_ERR_FAIL;
+
+    json = cJSON_Parse(cjson);
+    if (json == NULL)
+        return CRYPTODB_ERR_FAIL;
+
+    type_str = cJSON_GetStringValue(cJSON_GetObjectItem(json, "type"));
+    json_val = cJSON_GetObjectItem(json, "val");
+    if (type_str == NULL || json_val == NULL)
+        cvaltype = CRYPTODB_VAL_UNKNOWN;
+    else if (!strcmp(type_str, "string") && cJSON_IsString(json_val))
+        cvaltype = CRYPTODB_VAL_STRING;
+    else if (!strcmp(type_str, "int") && cJSON_IsNumber(json_val))
+        cvaltype = CRYPTODB_VAL_NUM_INT;
+    else if (!strcmp(type_str, "double") && cJSON_IsNumber(json_val))
+        cvaltype = CRYPTODB_VAL_NUM_DOUBLE;
+
+    switch (cvaltype)
+    {
+    default:
+        result = CRYPTODB_ERR_FAIL;
+        break;
+    case CRYPTODB_VAL_STRING:
+    case CRYPTODB_VAL_NUM_INT:
+    case CRYPTODB_VAL_NUM_DOUBLE:
+        if (vbuf)
+        {
+            valtype = cvaltype;
+            result = _cryptodb_val_buf_fit(vbuf, cvaltype,
+                                           cvaltype == CRYPTODB_VAL_STRING ?
+                                           strlen(cJSON_GetStringValue(json_val)) + 1 :
+                                           cvaltype == CRYPTODB_VAL_NUM_INT ?
+                                           sizeof(int) : sizeof(double));
+        }
+        if (result != CRYPTODB_SUCCESS)
+            break;
+        if (cvaltype != valtype)
+            result = (int)cvaltype;
+        else if (cvaltype == CRYPTODB_VAL_STRING)
+            strcpy((char *)val, cJSON_GetStringValue(json_val));
+        else if (cvaltype == CRYPTODB_VAL_NUM_INT)
+        {
+            val_int = (int)cJSON_GetNumberValue(json_val);
+            memcpy(val, &val_int, sizeof(int));
+        }
+        else
+        {
+            val_double = cJSON_GetNumberValue(json_val);
+            memcpy(val, &val_double, sizeof(double));
+        }
+        break;
+    }
+
+    cJSON_Delete(json);
+
+    return result;
+}
+
+static size_t _cryptodb_varint_encode(uint64_t v, uint8_t *out)
+{
+    size_t len = 0;
+
+    while (v >= 0x80)
+    {
+        out[len++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[len++] = (uint8_t)v;
+
+    return len;
+}
+
+static size_t _cryptodb_varint_decode(const uint8_t *in, size_t inlen, uint64_t *v)
+{
+    uint64_t result = 0;
+
+    for (size_t i = 0; i < inlen && i < CRYPTODB_VARINT_MAX_LEN; ++i)
+    {
+        result |= (uint64_t)(in[i] & 0x7f) << (7 * i);
+        if (!(in[i] & 0x80))
+        {
+            *v = result;
+            return i + 1;
+        }
+    }
+
+    return 0; // truncated or too long
+}
+
+static void _cryptodb_store_le(uint8_t *out, uint64_t v, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+        out[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t _cryptodb_load_le(const uint8_t *in, size_t len)
+{
+    uint64_t v = 0;
+
+    for (size_t i = 0; i < len; ++i)
+        v |= (uint64_t)in[i] << (8 * i);
+
+    return v;
+}
+
+/**
+ * Returns payload length of the value or 0 if "valtype" isn't supported
+ */
+static size_t _cryptodb_record_payload_len(cryptodb_val_t valtype, const void *val)
+{
     switch (valtype)
     {
     default:
-        return NULL;
+        return 0;
+    case CRYPTODB_VAL_STRING:
+        return strlen((const char *)val);
+    case CRYPTODB_VAL_NUM_INT:
+        return sizeof(int32_t);
+    case CRYPTODB_VAL_NUM_DOUBLE:
+        return sizeof(double);
+    case CRYPTODB_VAL_NUM_INT64:
+    case CRYPTODB_VAL_NUM_UINT64:
+        return sizeof(uint64_t);
+    case CRYPTODB_VAL_BLOB:
+        return ((const cryptodb_blob_t *)val)->len;
+    }
+}
+
+/**
+ * Writes the record into "out" that should have at least
+ * CRYPTODB_RECORD_HEADER_MAX_LEN + payload_len bytes, and
+ * CRYPTODB_VARINT_MAX_LEN + keylen bytes more if "key" isn't NULL.
+ * Returns the record length.
+ */
+static size_t _cryptodb_record_encode(cryptodb_val_t valtype, const void *val,
+                                      size_t payload_len,
+                                      const char *key, size_t keylen,
+                                      uint8_t *out)
+{
+    size_t len = 0;
+    uint64_t bits = 0;
+
+    out[len++] = key ? CRYPTODB_RECORD_FORMAT_V1_KEY : CRYPTODB_RECORD_FORMAT_V1;
+    out[len++] = (uint8_t)valtype;
+    len += _cryptodb_varint_encode(payload_len, out + len);
+
+    switch (valtype)
+    {
+    default:
+        break;
     case CRYPTODB_VAL_STRING:
-        cJSON_AddStringToObject(json, "type", "string");
-        cJSON_AddStringToObject(json, "val", (const char *)val);
+        memcpy(out + len, val, payload_len);
+        break;
+    case CRYPTODB_VAL_BLOB:
+        if (payload_len)
+            memcpy(out + len, ((const cryptodb_blob_t *)val)->data, payload_len);
         break;
     case CRYPTODB_VAL_NUM_INT:
-        cJSON_AddStringToObject(json, "type", "int");
-        cJSON_AddNumberToObject(json, "val", (double)*((int *)val));
+        _cryptodb_store_le(out + len, (uint32_t)*((const int32_t *)val), sizeof(int32_t));
         break;
     case CRYPTODB_VAL_NUM_DOUBLE:
-        cJSON_AddStringToObject(json, "type", "double");
-        cJSON_AddNumberToObject(json, "val", *((double *)val));
+        memcpy(&bits, val, sizeof(double));
+        _cryptodb_store_le(out + len, bits, sizeof(double));
+        break;
+    case CRYPTODB_VAL_NUM_INT64:
+    case CRYPTODB_VAL_NUM_UINT64:
+        memcpy(&bits, val, sizeof(uint64_t));
+        _cryptodb_store_le(out + len, bits, sizeof(uint64_t));
         break;
     }
+    len += payload_len;
 
-    cjson = cJSON_Print(json);
-    cJSON_Delete(json);
-    if (cjson == NULL)
-        return cjson;
-
-    cJSON_Minify(cjson);
+    if (key)
+    {
+        len += _cryptodb_varint_encode(keylen, out + len);
+        memcpy(out + len, key, keylen);
+        len += keylen;
+    }
 
-    return cjson;
+    return len;
 }
 
-static cryptodb_val_t _cryptodb_json_to_valtype(char *cjson, size_t *vallen)
+/**
+ * Parses the record header. On success returns the value type and sets
+ * "payload", "payload_len", "key" and "keylen" (NULL and 0 if the record
+ * has no key), otherwise returns CRYPTODB_VAL_UNKNOWN.
+ */
+static cryptodb_val_t _cryptodb_record_decode(const uint8_t *rec, size_t reclen,
+                                              const uint8_t **payload,
+                                              size_t *payload_len,
+                                              const uint8_t **key,
+                                              size_t *keylen)
 {
-    cryptodb_val_t result = CRYPTODB_VAL_UNKNOWN;
+    size_t used = 0, key_used = 0, end = 0;
+    uint64_t len = 0, klen = 0;
+    cryptodb_val_t valtype = CRYPTODB_VAL_UNKNOWN;
+
+    if (reclen < 3 ||
+        (rec[0] != CRYPTODB_RECORD_FORMAT_V1 && rec[0] != CRYPTODB_RECORD_FORMAT_V1_KEY))
+        return CRYPTODB_VAL_UNKNOWN;
+
+    valtype = (cryptodb_val_t)rec[1];
+    used = _cryptodb_varint_decode(rec + 2, reclen - 2, &len);
+    if (!used || len > reclen - 2 - used)
+        return CRYPTODB_VAL_UNKNOWN;
 
-    cJSON *json = cJSON_Parse((const char *)cjson);
-    if (json == NULL                       ||
-        !cJSON_HasObjectItem(json, "type") ||
-        !cJSON_HasObjectItem(json, "val"))
+    switch (valtype)
     {
-        if (json)
-            cJSON_Delete(json);
+    default:
         return CRYPTODB_VAL_UNKNOWN;
+    case CRYPTODB_VAL_STRING:
+    case CRYPTODB_VAL_BLOB:
+        break;
+    case CRYPTODB_VAL_NUM_INT:
+        if (len != sizeof(int32_t))
+            return CRYPTODB_VAL_UNKNOWN;
+        break;
+    case CRYPTODB_VAL_NUM_DOUBLE:
+        if (len != sizeof(double))
+            return CRYPTODB_VAL_UNKNOWN;
+        break;
+    case CRYPTODB_VAL_NUM_INT64:
+    case CRYPTODB_VAL_NUM_UINT64:
+        if (len != sizeof(uint64_t))
+            return CRYPTODB_VAL_UNKNOWN;
+        break;
+    }
+
+    *payload = rec + 2 + used;
+    *payload_len = (size_t)len;
+    *key = NULL;
+    *keylen = 0;
+
+    if (rec[0] == CRYPTODB_RECORD_FORMAT_V1_KEY)
+    {
+        end = 2 + used + (size_t)len;
+        key_used = _cryptodb_varint_decode(rec + end, reclen - end, &klen);
+        if (!key_used || !klen || klen > reclen - end - key_used)
+            return CRYPTODB_VAL_UNKNOWN;
+        *key = rec + end + key_used;
+        *keylen = (size_t)klen;
     }
 
-    char *type_str = cJSON_GetStringValue(cJSON_GetObjectItem(json, "type"));
-    if      (!strcmp(type_str, "string"))
+    return valtype;
+}
+
+/**
+ * Copies the payload of the decoded record into "val". A string or blob
+ * payload may be moved within the record itself.
+ */
+static int _cryptodb_payload_to_val(cryptodb_val_t valtype,
+                                    const uint8_t *payload, size_t payload_len,
+                                    void *val)
+{
+    uint64_t bits = 0;
+    int32_t val_int = 0;
+
+    switch (valtype)
     {
-        *vallen = strlen(cJSON_GetStringValue(cJSON_GetObjectItem(json, "val"))) + 1;
-        result = CRYPTODB_VAL_STRING;
+    default:
+        return CRYPTODB_ERR_FAIL;
+    case CRYPTODB_VAL_STRING:
+        memmove(val, payload, payload_len);
+        ((char *)val)[payload_len] = '\0';
+        break;
+    case CRYPTODB_VAL_BLOB:
+        if (payload_len)
+            memmove(val, payload, payload_len);
+        break;
+    case CRYPTODB_VAL_NUM_INT:
+        val_int = (int32_t)(uint32_t)_cryptodb_load_le(payload, sizeof(int32_t));
+        memcpy(val, &val_int, sizeof(int32_t));
+        break;
+    case CRYPTODB_VAL_NUM_DOUBLE:
+        bits = _cryptodb_load_le(payload, sizeof(double));
+        memcpy(val, &bits, sizeof(double));
+        break;
+    case CRYPTODB_VAL_NUM_INT64:
+    case CRYPTODB_VAL_NUM_UINT64:
+        bits = _cryptodb_load_le(payload, sizeof(uint64_t));
+        memcpy(val, &bits, sizeof(uint64_t));
+        break;
     }
-    else if (!strcmp(type_str, "int"))
+
+    return CRYPTODB_SUCCESS;
+}
+
+/**
+ * Copies the record value into "val", see cryptodb_get() for return values.
+ * If the record keeps its original key, it must be "key". If "vbuf" isn't
+ * NULL, the value of any type is copied, see _cryptodb_val_buf_t.
+ */
+static int _cryptodb_record_to_val(const uint8_t *rec, size_t reclen,
+                                   const char *key, size_t keylen,
+                                   cryptodb_val_t valtype, void *val,
+                                   _cryptodb_val_buf_t *vbuf)
+{
+    int result = CRYPTODB_SUCCESS;
+    size_t payload_len = 0, rkeylen = 0;
+    const uint8_t *payload = NULL, *rkey = NULL;
+    cryptodb_val_t cvaltype = CRYPTODB_VAL_UNKNOWN;
+
+    cvaltype = _cryptodb_record_decode(rec, reclen, &payload, &payload_len, &rkey, &rkeylen);
+    if (cvaltype == CRYPTODB_VAL_UNKNOWN)
+        return CRYPTODB_ERR_FAIL;
+    if (rkey && (rkeylen != keylen || memcmp(rkey, key, keylen)))
+        return CRYPTODB_ERR_INTEGRITY_FAIL;
+    if (vbuf)
     {
-        *vallen = sizeof(int);
-        result = CRYPTODB_VAL_NUM_INT;
+        valtype = cvaltype;
+        result = _cryptodb_val_buf_fit(vbuf, cvaltype,
+                                       cvaltype == CRYPTODB_VAL_STRING ?
+                                       payload_len + 1 : payload_len);
+        if (result != CRYPTODB_SUCCESS)
+            return result;
     }
-    else if (!strcmp(type_str, "double"))
+    if (cvaltype != valtype)
+        return (int)cvaltype;
+
+    return _cryptodb_payload_to_val(cvaltype, payload, payload_len, val);
+}
+
+/**
+ * Replaces the record in "rec" by the compressed record if it saves at
+ * least "min_saving" percent, the rest of the record is zeroed. "tmp"
+ * should have "reclen" bytes. Returns the new record length.
+ */
+static size_t _cryptodb_record_compress(cryptodb_compression_t compression,
+                                        unsigned int min_saving,
+                                        uint8_t *rec, size_t reclen,
+                                        uint8_t *tmp)
+{
+    size_t len = 0, max_len = 0, header_len = 0;
+
+    if (compression == CRYPTODB_COMPRESSION_NONE || reclen < CRYPTODB_COMPRESSION_MIN_LEN)
+        return reclen;
+
+    // The compressed length isn't known yet, so the header takes the most
+    max_len = reclen - reclen * min_saving / 100;
+    if (max_len <= CRYPTODB_COMPRESSION_HEADER_MAX_LEN)
+        return reclen;
+
+    switch (compression)
     {
-        *vallen = sizeof(double);
-        result = CRYPTODB_VAL_NUM_DOUBLE;
+    default:
+        return reclen;
+    case CRYPTODB_COMPRESSION_LZ4:
+        len = _cryptodb_lz4_compress(rec, reclen, tmp,
+                                     max_len - CRYPTODB_COMPRESSION_HEADER_MAX_LEN);
+        break;
     }
+    if (!len)
+        return reclen;
 
-    cJSON_Delete(json);
+    rec[header_len++] = CRYPTODB_RECORD_FORMAT_COMPRESSED;
+    rec[header_len++] = (uint8_t)compression;
+    header_len += _cryptodb_varint_encode(reclen, rec + header_len);
+    header_len += _cryptodb_varint_encode(len, rec + header_len);
+    memcpy(rec + header_len, tmp, len);
+    memset(rec + header_len + len, 0, reclen - header_len - len);
 
-    return result;
+    return header_len + len;
+}
+
+/**
+ * Parses the header of the compressed record. Returns the record length
+ * and sets "data" and "data_len" to the compressed record, or returns 0
+ * if the header is corrupted.
+ */
+static size_t _cryptodb_record_uncompressed_len(const uint8_t *rec, size_t reclen,
+                                                const uint8_t **data,
+                                                size_t *data_len)
+{
+    size_t used = 0, data_used = 0;
+    uint64_t len = 0, clen = 0;
+
+    if (reclen < 4 || rec[0] != CRYPTODB_RECORD_FORMAT_COMPRESSED)
+        return 0;
+
+    used = _cryptodb_varint_decode(rec + 2, reclen - 2, &len);
+    if (!used)
+        return 0;
+    data_used = _cryptodb_varint_decode(rec + 2 + used, reclen - 2 - used, &clen);
+    if (!data_used || !clen || clen > reclen - 2 - used - data_used ||
+        !len || len / CRYPTODB_COMPRESSION_MAX_RATIO > clen)
+        return 0;
+
+    *data = rec + 2 + used + data_used;
+    *data_len = (size_t)clen;
+
+    return (size_t)len;
 }
 
-static int _cryptodb_json_to_val(char *cjson, void *val)
+/**
+ * Decompresses the compressed record into "out" of "out_len" bytes,
+ * see _cryptodb_record_uncompressed_len(). Returns false if it's corrupted.
+ */
+static bool _cryptodb_record_uncompress(const uint8_t *rec,
+                                        const uint8_t *data, size_t data_len,
+                                        uint8_t *out, size_t out_len)
 {
-    cJSON *json = cJSON_Parse((const char *)cjson);
-    if (json == NULL                       ||
-        !cJSON_HasObjectItem(json, "type") ||
-        !cJSON_HasObjectItem(json, "val"))
+    switch ((cryptodb_compression_t)rec[1])
     {
-        if (json)
-            cJSON_Delete(json);
-        return CRYPTODB_ERR_FAIL;
+    default:
+        return false;
+    case CRYPTODB_COMPRESSION_LZ4:
+        if (!_cryptodb_lz4_decompress(data, data_len, out, out_len))
+            return false;
+        break;
     }
-    if (cJSON_IsString(cJSON_GetObjectItem(json, "val")))
-        strcpy((char *)val, cJSON_GetStringValue(cJSON_GetObjectItem(json, "val")));
-    else
-        *((double *)val) = cJSON_GetNumberValue(cJSON_GetObjectItem(json, "val"));
-    cJSON_Delete(json);
-    return CRYPTODB_ERR_OK;
+
+    // Only V1 records are compressed
+    return out[0] == CRYPTODB_RECORD_FORMAT_V1 || out[0] == CRYPTODB_RECORD_FORMAT_V1_KEY;
 }
 
 static int _cryptodb_get_encryption_key_iv(cryptodb_t *cryptodb,
@@ -214,686 +740,3380 @@ static int _cryptodb_get_encryption_key_iv(cryptodb_t *cryptodb,
     return CRYPTODB_SUCCESS;
 }
 
-static int _cryptodb_aes_256_cbc(char *in, char *out, size_t size,
-                                 bool encrypt_decrypt,
-                                 uint8_t encryption_key[32],
-                                 uint8_t encryption_iv[16])
+static int _cryptodb_keys_expand(cryptodb_t *cryptodb,
+                                 _cryptodb_keys_t *keys)
 {
-    uint8_t iv[16] = {0};
-    mbedtls_aes_context ctx;
+    // Key of the key tokens is the encryption of this label with the
+    // encryption key and IV, so tokens have nothing in common with
+    // AES-256-CBC encrypted keys
+    static const uint8_t label[32 + 1] = "cryptodb key token derivation v1";
+    uint8_t iv[16] = {0}, token_key[32] = {0};
     int result = CRYPTODB_SUCCESS;
 
-    mbedtls_aes_init(&ctx);
+    result = _cryptodb_aes_setkey(&keys->aes, keys->encryption_key);
+    if (result != CRYPTODB_SUCCESS ||
+        cryptodb->disable_keys_encryption ||
+        cryptodb->key_mode == CRYPTODB_KEY_MODE_AES_256_CBC)
+        return result;
 
-    if (encrypt_decrypt)
-        result = mbedtls_aes_setkey_enc(&ctx,
-                 (const unsigned char *)encryption_key,
-                                        256);
-    else
-        result = mbedtls_aes_setkey_dec(&ctx,
-                 (const unsigned char *)encryption_key,
-                                        256);
-    if (result)
-    {
-        mbedtls_aes_free(&ctx);
-        if (encrypt_decrypt)
-            return CRYPTODB_ERR_ENCRYPTION_FAIL;
-        else
-            return CRYPTODB_ERR_DECRYPTION_FAIL;
-    }
+    memcpy(iv, keys->encryption_iv, 16);
+    result = _cryptodb_aes_cbc(&keys->aes, true, sizeof(token_key), iv, label, token_key);
+    if (result == CRYPTODB_SUCCESS)
+        result = _cryptodb_aes_setkey(&keys->token_aes, token_key);
 
-    memcpy(iv, encryption_iv, 16);
+    mbedtls_platform_zeroize(iv, sizeof(iv));
+    mbedtls_platform_zeroize(token_key, sizeof(token_key));
 
-    result = mbedtls_aes_crypt_cbc(&ctx,
-                                   encrypt_decrypt ?
-                                   MBEDTLS_AES_ENCRYPT :
-                                   MBEDTLS_AES_DECRYPT,
-                                   size,
-                  (unsigned char *)iv,
-            (const unsigned char *)in,
-                  (unsigned char *)out);
+    return result;
+}
 
-    mbedtls_aes_free(&ctx);
+/**
+ * Derives both key sets into "keys", indexed like _cryptodb_keystore_t.keys.
+ * On failure "keys" are partially derived and shouldn't be used.
+ */
+static int _cryptodb_keystore_derive(cryptodb_t *cryptodb,
+                                     _cryptodb_keys_t keys[2])
+{
+    int result = CRYPTODB_SUCCESS;
+    _cryptodb_keys_t *dec = &keys[0], *enc = &keys[1];
 
-    if (result)
+    if (cryptodb->user_kdf == NULL)
     {
-        if (encrypt_decrypt)
-            return CRYPTODB_ERR_ENCRYPTION_FAIL;
+        // Default KDF doesn't depend on "encrypt_decrypt", derive once
+        result = _cryptodb_get_encryption_key_iv(cryptodb,
+                                                 true,
+                                                 enc->encryption_key,
+                                                 enc->encryption_iv);
+        if (result != CRYPTODB_SUCCESS)
+            return result;
+        memcpy(dec->encryption_key, enc->encryption_key, 32);
+        memcpy(dec->encryption_iv, enc->encryption_iv, 16);
+    }
+    else
+    {
+        result = cryptodb->user_kdf(cryptodb,
+                                    true,
+                                    enc->encryption_key,
+                                    enc->encryption_iv,
+                                    cryptodb->kdf_user_data);
+        if (result != CRYPTODB_SUCCESS)
+            return result;
+
+        result = cryptodb->user_kdf(cryptodb,
+                                    false,
+                                    dec->encryption_key,
+                                    dec->encryption_iv,
+                                    cryptodb->kdf_user_data);
+        if (result != CRYPTODB_SUCCESS)
+            return result;
+    }
+
+    result = _cryptodb_keys_expand(cryptodb, enc);
+    if (result != CRYPTODB_SUCCESS)
+        return result;
+
+    return _cryptodb_keys_expand(cryptodb, dec);
+}
+
+static void _cryptodb_keystore_destroy(_cryptodb_keystore_t *keystore)
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        _cryptodb_aes_free(&keystore->keys[i].aes);
+        _cryptodb_aes_free(&keystore->keys[i].token_aes);
+    }
+    if (keystore->kdf_epoch)
+        pthread_rwlock_destroy(&keystore->lock);
+    mbedtls_platform_zeroize(keystore, sizeof(_cryptodb_keystore_t));
+    free(keystore);
+}
+
+static int _cryptodb_nonce_base_create(uint8_t nonce_base[CRYPTODB_AES_GCM_IV_LEN])
+{
+    int result = CRYPTODB_SUCCESS;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+
+    if (mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
+                              (const unsigned char *)"cryptodb", 8) ||
+        mbedtls_ctr_drbg_random(&ctr_drbg, nonce_base, CRYPTODB_AES_GCM_IV_LEN))
+        result = CRYPTODB_ERR_ENCRYPTION_FAIL;
+
+    mbedtls_ctr_drbg_free(&ctr_drbg);
+    mbedtls_entropy_free(&entropy);
+
+    return result;
+}
+
+static void _cryptodb_nonce_next(cryptodb_t *cryptodb,
+                                 uint8_t nonce[CRYPTODB_AES_GCM_IV_LEN])
+{
+    _cryptodb_keystore_t *keystore = (_cryptodb_keystore_t *)cryptodb->keystore;
+    uint64_t counter = __atomic_fetch_add(&keystore->nonce_counter, 1, __ATOMIC_RELAXED);
+
+    memcpy(nonce, keystore->nonce_base, CRYPTODB_AES_GCM_IV_LEN);
+    for (int i = CRYPTODB_AES_GCM_IV_LEN - 8; i < CRYPTODB_AES_GCM_IV_LEN; ++i, counter >>= 8)
+        nonce[i] ^= (uint8_t)counter;
+}
+
+static int _cryptodb_keystore_create(cryptodb_t *cryptodb,
+                                     cryptodb_user_kdf_epoch kdf_epoch)
+{
+    int result = CRYPTODB_SUCCESS;
+    _cryptodb_keystore_t *keystore = NULL;
+
+    keystore = (_cryptodb_keystore_t *)calloc(1, sizeof(_cryptodb_keystore_t));
+    if (keystore == NULL)
+        return CRYPTODB_ERR_ALLOCATE_MEM;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        _cryptodb_aes_init(&keystore->keys[i].aes);
+        _cryptodb_aes_init(&keystore->keys[i].token_aes);
+    }
+
+    if (kdf_epoch)
+    {
+        if (pthread_rwlock_init(&keystore->lock, NULL))
+        {
+            free(keystore);
+            return CRYPTODB_ERR_FAIL;
+        }
+        keystore->kdf_epoch = kdf_epoch;
+        keystore->epoch = kdf_epoch(cryptodb, cryptodb->kdf_user_data);
+    }
+
+    result = _cryptodb_keystore_derive(cryptodb, keystore->keys);
+    if (result == CRYPTODB_SUCCESS && cryptodb->value_cipher == CRYPTODB_CIPHER_AES_256_GCM)
+        result = _cryptodb_nonce_base_create(keystore->nonce_base);
+    if (result != CRYPTODB_SUCCESS)
+    {
+        _cryptodb_keystore_destroy(keystore);
+        return result;
+    }
+
+    cryptodb->keystore = keystore;
+
+    return CRYPTODB_SUCCESS;
+}
+
+/**
+ * Returns cached keys for the operation. Every successful call
+ * should be paired with _cryptodb_keys_release().
+ */
+static int _cryptodb_keys_acquire(cryptodb_t *cryptodb,
+                                  bool encrypt_decrypt,
+                                  _cryptodb_keys_t **keys)
+{
+    uint64_t epoch = 0;
+    int result = CRYPTODB_SUCCESS;
+    _cryptodb_keystore_t *keystore = (_cryptodb_keystore_t *)cryptodb->keystore;
+    _cryptodb_keys_t derived[2];
+
+    if (keystore->kdf_epoch)
+    {
+        epoch = keystore->kdf_epoch(cryptodb, cryptodb->kdf_user_data);
+
+        pthread_rwlock_rdlock(&keystore->lock);
+        if (epoch != keystore->epoch)
+        {
+            pthread_rwlock_unlock(&keystore->lock);
+            pthread_rwlock_wrlock(&keystore->lock);
+            if (epoch != keystore->epoch)
+            {
+                // Derive aside, so a failed KDF or key expansion leaves
+                // the current keys untouched. The contexts hold no pointers
+                // to themselves, so they can be copied.
+                for (int i = 0; i < 2; ++i)
+                {
+                    _cryptodb_aes_init(&derived[i].aes);
+                    _cryptodb_aes_init(&derived[i].token_aes);
+                }
+                result = _cryptodb_keystore_derive(cryptodb, derived);
+                if (result == CRYPTODB_SUCCESS)
+                {
+                    memcpy(keystore->keys, derived, sizeof(derived));
+                    keystore->epoch = epoch;
+                }
+                for (int i = 0; i < 2; ++i)
+                {
+                    _cryptodb_aes_free(&derived[i].aes);
+                    _cryptodb_aes_free(&derived[i].token_aes);
+                }
+                mbedtls_platform_zeroize(derived, sizeof(derived));
+            }
+            pthread_rwlock_unlock(&keystore->lock);
+            if (result != CRYPTODB_SUCCESS)
+                return result;
+            pthread_rwlock_rdlock(&keystore->lock);
+        }
+    }
+
+    *keys = &keystore->keys[encrypt_decrypt ? 1 : 0];
+
+    return CRYPTODB_SUCCESS;
+}
+
+static void _cryptodb_keys_release(cryptodb_t *cryptodb)
+{
+    _cryptodb_keystore_t *keystore = (_cryptodb_keystore_t *)cryptodb->keystore;
+
+    if (keystore->kdf_epoch)
+        pthread_rwlock_unlock(&keystore->lock);
+}
+
+static int _cryptodb_aes_256_cbc(char *in, char *out, size_t size,
+                                 bool encrypt_decrypt,
+                                 _cryptodb_keys_t *keys)
+{
+    uint8_t iv[16] = {0};
+    int result = CRYPTODB_SUCCESS;
+
+    memcpy(iv, keys->encryption_iv, 16);
+
+    result = _cryptodb_aes_cbc(&keys->aes,
+                               encrypt_decrypt,
+                               size,
+                               iv,
+                               (const uint8_t *)in,
+                               (uint8_t *)out);
+
+    return result;
+}
+
+typedef struct {
+    const _cryptodb_aes_t *aes;
+    uint8_t iv[16];
+    char *buf;
+    size_t size;
+    int result;
+} _cryptodb_decrypt_task_t;
+
+static void _cryptodb_decrypt_task(void *arg)
+{
+    _cryptodb_decrypt_task_t *task = (_cryptodb_decrypt_task_t *)arg;
+
+    task->result = _cryptodb_aes_cbc(task->aes,
+                                     false,
+                                     task->size,
+                                     task->iv,
+                                     (const uint8_t *)task->buf,
+                                     (uint8_t *)task->buf);
+}
+
+/**
+ * In-place decryption of a value. CBC decryption of every block depends only
+ * on the block and the previous ciphertext block, so large values are split
+ * into chunks that are decrypted by the worker threads at once.
+ */
+static int _cryptodb_aes_256_cbc_decrypt(cryptodb_t *cryptodb,
+                                         char *buf, size_t size,
+                                         _cryptodb_keys_t *keys)
+{
+    size_t tasks_count = 0, blocks = size / CRYPTODB_AES_BLOCK_LEN, chunk = 0;
+    _cryptodb_decrypt_task_t tasks[CRYPTODB_OPT_MAX_WORKER_THREADS + 1];
+
+    if (cryptodb->pool == NULL || size < cryptodb->parallel_decrypt_threshold)
+        return _cryptodb_aes_256_cbc(buf, buf, size, false, keys);
+
+    chunk = _cryptodb_pool_threads((_cryptodb_pool_t *)cryptodb->pool) + 1;
+    chunk = (blocks + chunk - 1) / chunk;
+
+    // IV of every chunk is the last ciphertext block of the previous one,
+    // copy them all before anything is decrypted in place
+    for (size_t start = 0; start < blocks; start += chunk)
+    {
+        _cryptodb_decrypt_task_t *task = &tasks[tasks_count++];
+
+        task->aes = &keys->aes;
+        task->buf = buf + start * CRYPTODB_AES_BLOCK_LEN;
+        task->size = (blocks - start < chunk ? blocks - start : chunk) * CRYPTODB_AES_BLOCK_LEN;
+        task->result = CRYPTODB_SUCCESS;
+        if (start)
+            memcpy(task->iv, task->buf - CRYPTODB_AES_BLOCK_LEN, 16);
+        else
+            memcpy(task->iv, keys->encryption_iv, 16);
+    }
+
+    _cryptodb_pool_run((_cryptodb_pool_t *)cryptodb->pool,
+                       _cryptodb_decrypt_task,
+                       tasks,
+                       sizeof(_cryptodb_decrypt_task_t),
+                       tasks_count);
+
+    for (size_t i = 0; i < tasks_count; ++i)
+        if (tasks[i].result != CRYPTODB_SUCCESS)
+            return tasks[i].result;
+
+    return CRYPTODB_SUCCESS;
+}
+
+typedef struct {
+    const _cryptodb_aes_t *aes;
+    const uint8_t *iv;
+    size_t block;
+    char *buf;
+    size_t size;
+    int result;
+} _cryptodb_gcm_task_t;
+
+static void _cryptodb_gcm_task(void *arg)
+{
+    _cryptodb_gcm_task_t *task = (_cryptodb_gcm_task_t *)arg;
+
+    task->result = _cryptodb_aes_gcm_crypt(task->aes,
+                                           task->iv,
+                                           task->block,
+                                           task->size,
+                                           (const uint8_t *)task->buf,
+                                           (uint8_t *)task->buf);
+}
+
+/**
+ * In-place AES-256-GCM encryption/decryption of a value. On decryption the
+ * tag is checked first. Blocks of GCM are independent, so large values
+ * are split into chunks that are processed by the worker threads at once.
+ */
+static int _cryptodb_aes_256_gcm(cryptodb_t *cryptodb,
+                                 bool encrypt_decrypt,
+                                 char *buf, size_t size,
+                                 const uint8_t iv[CRYPTODB_AES_GCM_IV_LEN],
+                                 const char *add, size_t add_len,
+                                 uint8_t tag[CRYPTODB_AES_GCM_TAG_LEN],
+                                 _cryptodb_keys_t *keys)
+{
+    int result = CRYPTODB_SUCCESS;
+    size_t tasks_count = 0, blocks = 0, chunk = 0;
+    _cryptodb_gcm_task_t tasks[CRYPTODB_OPT_MAX_WORKER_THREADS + 1];
+
+    if (!encrypt_decrypt)
+    {
+        result = _cryptodb_aes_gcm_tag(&keys->aes, false, iv,
+                                       (const uint8_t *)add, add_len,
+                                       (const uint8_t *)buf, size, tag);
+        if (result != CRYPTODB_SUCCESS)
+            return result;
+    }
+
+    if (cryptodb->pool == NULL || size < cryptodb->parallel_decrypt_threshold)
+    {
+        result = _cryptodb_aes_gcm_crypt(&keys->aes, iv, 0, size,
+                                         (const uint8_t *)buf, (uint8_t *)buf);
+    }
+    else
+    {
+        blocks = (size + CRYPTODB_AES_BLOCK_LEN - 1) / CRYPTODB_AES_BLOCK_LEN;
+        chunk = _cryptodb_pool_threads((_cryptodb_pool_t *)cryptodb->pool) + 1;
+        chunk = (blocks + chunk - 1) / chunk;
+
+        for (size_t start = 0; start < blocks; start += chunk)
+        {
+            _cryptodb_gcm_task_t *task = &tasks[tasks_count++];
+            size_t offset = start * CRYPTODB_AES_BLOCK_LEN;
+
+            task->aes = &keys->aes;
+            task->iv = iv;
+            task->block = start;
+            task->buf = buf + offset;
+            task->size = (size - offset < chunk * CRYPTODB_AES_BLOCK_LEN) ?
+                         size - offset : chunk * CRYPTODB_AES_BLOCK_LEN;
+            task->result = CRYPTODB_SUCCESS;
+        }
+
+        _cryptodb_pool_run((_cryptodb_pool_t *)cryptodb->pool,
+                           _cryptodb_gcm_task,
+                           tasks,
+                           sizeof(_cryptodb_gcm_task_t),
+                           tasks_count);
+
+        for (size_t i = 0; i < tasks_count && result == CRYPTODB_SUCCESS; ++i)
+            result = tasks[i].result;
+    }
+
+    if (result == CRYPTODB_SUCCESS && encrypt_decrypt)
+        result = _cryptodb_aes_gcm_tag(&keys->aes, true, iv,
+                                       (const uint8_t *)add, add_len,
+                                       (const uint8_t *)buf, size, tag);
+
+    return result;
+}
+
+static inline void _cryptodb_stats_add(uint64_t *counter, uint64_t n)
+{
+    __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+}
+
+static inline void _cryptodb_stats_inc(uint64_t *counter)
+{
+    _cryptodb_stats_add(counter, 1);
+}
+
+/**
+ * Returns zeroed buffer of "len" bytes. It's the caller's "scratch" stack
+ * buffer if it's big enough, so keys and records up to CRYPTODB_SCRATCH_LEN
+ * don't touch the heap. Every call should be paired with _cryptodb_scratch_free().
+ */
+static char * _cryptodb_scratch_alloc(cryptodb_t *cryptodb,
+                                      char scratch[CRYPTODB_SCRATCH_LEN],
+                                      size_t len)
+{
+    if (len <= CRYPTODB_SCRATCH_LEN)
+    {
+        memset(scratch, 0, len);
+        return scratch;
+    }
+
+    _cryptodb_stats_inc(&((cryptodb_stats_t *)cryptodb->stats)->heap_allocs);
+
+    return (char *)calloc(len, sizeof(char));
+}
+
+static void _cryptodb_scratch_free(char *buf,
+                                   char scratch[CRYPTODB_SCRATCH_LEN],
+                                   size_t len)
+{
+    if (buf == NULL)
+        return;
+
+    mbedtls_platform_zeroize(buf, len);
+    if (buf != scratch)
+        free(buf);
+}
+
+/**
+ * Length of the encrypted database key (or its token, see cryptodb_key_mode_t)
+ */
+static size_t _cryptodb_encrypt_key_len(cryptodb_t *cryptodb, size_t keylen)
+{
+    switch (cryptodb->key_mode)
+    {
+    default:
+        return (keylen + CRYPTODB_AES_BLOCK_LEN - 1) / CRYPTODB_AES_BLOCK_LEN * CRYPTODB_AES_BLOCK_LEN;
+    case CRYPTODB_KEY_MODE_TOKEN_128:
+        return CRYPTODB_AES_CMAC_LEN;
+    case CRYPTODB_KEY_MODE_TOKEN_256:
+        return 2 * CRYPTODB_AES_CMAC_LEN;
+    }
+}
+
+/**
+ * Encrypts database key (or makes its token, see cryptodb_key_mode_t)
+ * into zeroed "out" of _cryptodb_encrypt_key_len() bytes
+ */
+static int _cryptodb_encrypt_key_to(cryptodb_t *cryptodb,
+                                    _cryptodb_keys_t *keys,
+                                    const char *key, size_t keylen,
+                                    char *out, size_t len)
+{
+    // CRYPTODB_KEY_MODE_TOKEN_256 halves are CMACs of the key prefixed
+    // with different blocks
+    static const uint8_t token_prefix[2][16] = { { 0x01 }, { 0x02 } };
+    int result = CRYPTODB_SUCCESS;
+
+    switch (cryptodb->key_mode)
+    {
+    default:
+        memcpy(out, key, keylen);
+        result = _cryptodb_aes_256_cbc(out, out, len, true, keys);
+        break;
+    case CRYPTODB_KEY_MODE_TOKEN_128:
+        result = _cryptodb_aes_cmac(&keys->token_aes, NULL,
+                                    (const uint8_t *)key, keylen,
+                                    (uint8_t *)out);
+        break;
+    case CRYPTODB_KEY_MODE_TOKEN_256:
+        result = _cryptodb_aes_cmac(&keys->token_aes, token_prefix[0],
+                                    (const uint8_t *)key, keylen,
+                                    (uint8_t *)out);
+        if (result == CRYPTODB_SUCCESS)
+            result = _cryptodb_aes_cmac(&keys->token_aes, token_prefix[1],
+                                        (const uint8_t *)key, keylen,
+                                        (uint8_t *)out + CRYPTODB_AES_CMAC_LEN);
+        break;
+    }
+
+    return result;
+}
+
+/**
+ * Encrypts database key (or makes its token, see cryptodb_key_mode_t)
+ * into a buffer from _cryptodb_scratch_alloc()
+ */
+static int _cryptodb_encrypt_key(cryptodb_t *cryptodb,
+                                 _cryptodb_keys_t *keys,
+                                 const char *key, size_t keylen,
+                                 char scratch[CRYPTODB_SCRATCH_LEN],
+                                 char **encrypt_key,
+                                 size_t *encrypt_key_len)
+{
+    size_t len = _cryptodb_encrypt_key_len(cryptodb, keylen);
+
+    *encrypt_key = _cryptodb_scratch_alloc(cryptodb, scratch, len);
+    if (*encrypt_key == NULL)
+        return CRYPTODB_ERR_ALLOCATE_MEM;
+    *encrypt_key_len = len;
+
+    return _cryptodb_encrypt_key_to(cryptodb, keys, key, keylen, *encrypt_key, len);
+}
+
+/**
+ * Decrypts database value "str" in place. "dbkey" is the database key
+ * of the value. On success "decrypt" points to the record within "str".
+ */
+static int _cryptodb_value_decrypt(cryptodb_t *cryptodb,
+                                   _cryptodb_keys_t *keys,
+                                   char *str, size_t vallen,
+                                   const char *dbkey, size_t dbkeylen,
+                                   char **decrypt, size_t *decrypt_len)
+{
+    if (vallen % CRYPTODB_AES_BLOCK_LEN != 0)
+    {
+        // See CRYPTODB_VALUE_GCM_MARKER
+        *decrypt = str + CRYPTODB_VALUE_GCM_HEADER_LEN;
+        *decrypt_len = vallen > CRYPTODB_VALUE_GCM_OVERHEAD ?
+                       vallen - CRYPTODB_VALUE_GCM_OVERHEAD : 0;
+        if (!*decrypt_len || (uint8_t)str[0] != CRYPTODB_VALUE_GCM_MARKER)
+            return CRYPTODB_ERR_FAIL;
+        return _cryptodb_aes_256_gcm(cryptodb, false,
+                                     *decrypt, *decrypt_len,
+                                     (const uint8_t *)str + 1,
+                                     dbkey, dbkeylen,
+                                     (uint8_t *)*decrypt + *decrypt_len,
+                                     keys);
+    }
+
+    *decrypt = str;
+    *decrypt_len = vallen;
+    return _cryptodb_aes_256_cbc_decrypt(cryptodb, *decrypt, *decrypt_len, keys);
+}
+
+/**
+ * Decrypts database value "str" in place and decodes it into "val".
+ * "dbkey" is the database key of the value. "vbuf" is NULL unless it's
+ * cryptodb_get_buf(). See cryptodb_get() for return values.
+ */
+static int _cryptodb_value_to_val(cryptodb_t *cryptodb,
+                                  _cryptodb_keys_t *keys,
+                                  char *str, size_t vallen,
+                                  const char *dbkey, size_t dbkeylen,
+                                  const char *key, size_t keylen,
+                                  cryptodb_val_t valtype, void *val,
+                                  _cryptodb_val_buf_t *vbuf)
+{
+    int result = CRYPTODB_SUCCESS;
+    char *decrypt = NULL, *rec = NULL;
+    char scratch[CRYPTODB_SCRATCH_LEN];
+    size_t decrypt_len = 0, rec_len = 0, data_len = 0;
+    const uint8_t *data = NULL;
+
+    result = _cryptodb_value_decrypt(cryptodb, keys, str, vallen,
+                                     dbkey, dbkeylen,
+                                     &decrypt, &decrypt_len);
+    if (result != CRYPTODB_ERR_OK)
+        return result;
+
+    if ((uint8_t)decrypt[0] == CRYPTODB_RECORD_FORMAT_V1 ||
+        (uint8_t)decrypt[0] == CRYPTODB_RECORD_FORMAT_V1_KEY)
+        return _cryptodb_record_to_val((const uint8_t *)decrypt, decrypt_len,
+                                       key, keylen, valtype, val, vbuf);
+    else if ((uint8_t)decrypt[0] == CRYPTODB_RECORD_FORMAT_COMPRESSED)
+    {
+        rec_len = _cryptodb_record_uncompressed_len((const uint8_t *)decrypt, decrypt_len,
+                                                    &data, &data_len);
+        if (!rec_len)
+            return CRYPTODB_ERR_FAIL;
+        rec = _cryptodb_scratch_alloc(cryptodb, scratch, rec_len);
+        if (rec == NULL)
+            return CRYPTODB_ERR_ALLOCATE_MEM;
+        if (_cryptodb_record_uncompress((const uint8_t *)decrypt, data, data_len,
+                                        (uint8_t *)rec, rec_len))
+            result = _cryptodb_record_to_val((const uint8_t *)rec, rec_len,
+                                             key, keylen, valtype, val, vbuf);
+        else
+            result = CRYPTODB_ERR_FAIL;
+        _cryptodb_scratch_free(rec, scratch, rec_len);
+        return result;
+    }
+    else if (decrypt[0] == CRYPTODB_RECORD_FORMAT_JSON)
+        return _cryptodb_json_record_to_val(decrypt, decrypt_len, valtype, val, vbuf);
+    else
+        return CRYPTODB_ERR_FAIL;
+}
+
+/**
+ * Value of cryptodb_multi_get() entry that was read from the database
+ */
+typedef struct {
+    const char *dbkey;
+    size_t dbkeylen;
+    char *str; // LevelDB value, NULL if the entry already has its result
+    size_t vallen;
+} _cryptodb_multi_get_value_t;
+
+typedef struct {
+    cryptodb_t *cryptodb;
+    _cryptodb_keys_t *keys;
+    cryptodb_get_item_t *items;
+    _cryptodb_multi_get_value_t *values;
+    size_t first;
+    size_t last;
+} _cryptodb_multi_get_task_t;
+
+/**
+ * cryptodb_multi_get() reads values until they take this size, then
+ * decodes them in tasks of at least CRYPTODB_MULTI_GET_TASK_LEN
+ */
+#define CRYPTODB_MULTI_GET_WINDOW_LEN (256 * 1024)
+#define CRYPTODB_MULTI_GET_TASK_LEN   (16 * 1024)
+
+static void _cryptodb_multi_get_task(void *arg)
+{
+    _cryptodb_multi_get_task_t *task = (_cryptodb_multi_get_task_t *)arg;
+
+    for (size_t i = task->first; i < task->last; ++i)
+    {
+        _cryptodb_multi_get_value_t *value = &task->values[i];
+        cryptodb_get_item_t *item = &task->items[i];
+
+        if (value->str == NULL)
+            continue;
+
+        item->result = _cryptodb_value_to_val(task->cryptodb, task->keys,
+                                              value->str, value->vallen,
+                                              value->dbkey, value->dbkeylen,
+                                              item->key, item->keylen,
+                                              item->valtype, item->val, NULL);
+
+        mbedtls_platform_zeroize(value->str, value->vallen);
+        leveldb_free(value->str);
+        value->str = NULL;
+    }
+}
+
+/**
+ * Bounds and direction of cryptodb_iterator_t, see cryptodb_iterator_options_t.
+ * A prefix is turned into the bounds [prefix, successor of prefix).
+ */
+typedef struct {
+    char *lower; // inclusive, NULL if unbounded
+    size_t lower_len;
+    char *upper; // exclusive, NULL if unbounded
+    size_t upper_len;
+    bool reverse;
+} _cryptodb_iterator_range_t;
+
+static inline int _cryptodb_key_compare(const char *a, size_t alen,
+                                        const char *b, size_t blen)
+{
+    return _cryptodb_comparator_compare(NULL, a, alen, b, blen);
+}
+
+/**
+ * Returns range of the iterator options, NULL if the options don't
+ * have bounds and direction or on error ("result" is set then)
+ */
+static _cryptodb_iterator_range_t * _cryptodb_iterator_range_create(cryptodb_iterator_options_t *options,
+                                                                   int *result)
+{
+    size_t upper_len = 0;
+    const char *lower = NULL, *upper = NULL;
+    size_t lower_len = 0, prefix_len = 0;
+    _cryptodb_iterator_range_t *range = NULL;
+
+    *result = CRYPTODB_SUCCESS;
+    if (options == NULL)
+        return NULL;
+
+    if (options->lower_bound && options->lower_bound_len)
+    {
+        lower = options->lower_bound;
+        lower_len = options->lower_bound_len;
+    }
+    if (options->upper_bound && options->upper_bound_len)
+    {
+        upper = options->upper_bound;
+        upper_len = options->upper_bound_len;
+    }
+    if (options->prefix && options->prefix_len)
+        prefix_len = options->prefix_len;
+    if (lower == NULL && upper == NULL && !prefix_len && !options->reverse)
+        return NULL;
+
+    // Room for the prefix as the lower bound and its successor as the upper one
+    range = (_cryptodb_iterator_range_t *)calloc(1, sizeof(_cryptodb_iterator_range_t) +
+                                                    lower_len + upper_len + 2 * prefix_len);
+    if (range == NULL)
+    {
+        *result = CRYPTODB_ERR_ALLOCATE_MEM;
+        return NULL;
+    }
+    range->reverse = options->reverse != 0;
+    range->lower = (char *)(range + 1);
+    range->upper = range->lower + lower_len + prefix_len;
+
+    if (prefix_len)
+    {
+        // The successor is the shortest key that is greater than all keys
+        // with the prefix, there is none if the prefix is all 0xff
+        memcpy(range->upper, options->prefix, prefix_len);
+        upper_len = prefix_len;
+        while (upper_len && (uint8_t)range->upper[upper_len - 1] == 0xff)
+            --upper_len;
+        if (upper_len)
+            range->upper[upper_len - 1] = (char)((uint8_t)range->upper[upper_len - 1] + 1);
+
+        // The narrower of the bounds is taken
+        if (lower == NULL ||
+            _cryptodb_key_compare(lower, lower_len, options->prefix, prefix_len) < 0)
+        {
+            lower = options->prefix;
+            lower_len = prefix_len;
+        }
+        if (upper == NULL ||
+            (upper_len && _cryptodb_key_compare(range->upper, upper_len, upper,
+                                                options->upper_bound_len) < 0))
+            upper = range->upper;
+        else
+            upper_len = options->upper_bound_len;
+    }
+
+    if (lower)
+    {
+        memcpy(range->lower, lower, lower_len);
+        range->lower_len = lower_len;
+    }
+    else
+        range->lower = NULL;
+    if (upper && upper_len)
+    {
+        memmove(range->upper, upper, upper_len);
+        range->upper_len = upper_len;
+    }
+    else
+        range->upper = NULL;
+
+    return range;
+}
+
+/**
+ * Checks that the database key is within the bounds of "range"
+ */
+static bool _cryptodb_iterator_range_contains(_cryptodb_iterator_range_t *range,
+                                              const char *dbkey, size_t dbkeylen)
+{
+    if (range->lower &&
+        _cryptodb_key_compare(dbkey, dbkeylen, range->lower, range->lower_len) < 0)
+        return false;
+    if (range->upper &&
+        _cryptodb_key_compare(dbkey, dbkeylen, range->upper, range->upper_len) >= 0)
+        return false;
+    return true;
+}
+
+/**
+ * Positions LevelDB iterator at the last entry that is less than "key"
+ * (or equal to it if "inclusive")
+ */
+static void _cryptodb_iterator_seek_before(leveldb_iterator_t *it,
+                                           const char *key, size_t keylen,
+                                           bool inclusive)
+{
+    const char *dbkey = NULL;
+    size_t dbkeylen = 0;
+
+    leveldb_iter_seek(it, key, keylen);
+    if (!leveldb_iter_valid(it))
+    {
+        leveldb_iter_seek_to_last(it);
+        return;
+    }
+    if (inclusive)
+    {
+        dbkey = leveldb_iter_key(it, &dbkeylen);
+        if (!_cryptodb_key_compare(dbkey, dbkeylen, key, keylen))
+            return;
+    }
+    leveldb_iter_prev(it);
+}
+
+/**
+ * Positions LevelDB iterator at the first entry of the range in the
+ * direction of the iteration, starting from "key" if it isn't NULL
+ */
+static void _cryptodb_iterator_position(cryptodb_iterator_t *iterator,
+                                        const char *key, size_t keylen)
+{
+    leveldb_iterator_t *it = (leveldb_iterator_t *)iterator->it;
+    _cryptodb_iterator_range_t *range = (_cryptodb_iterator_range_t *)iterator->range;
+
+    if (range == NULL || !range->reverse)
+    {
+        if (range && range->lower &&
+            (key == NULL || _cryptodb_key_compare(key, keylen, range->lower, range->lower_len) < 0))
+        {
+            key = range->lower;
+            keylen = range->lower_len;
+        }
+        if (key)
+            leveldb_iter_seek(it, key, keylen);
+        else
+            leveldb_iter_seek_to_first(it);
+        return;
+    }
+
+    if (key && (range->upper == NULL ||
+                _cryptodb_key_compare(key, keylen, range->upper, range->upper_len) < 0))
+        _cryptodb_iterator_seek_before(it, key, keylen, true);
+    else if (range->upper)
+        _cryptodb_iterator_seek_before(it, range->upper, range->upper_len, false);
+    else
+        leveldb_iter_seek_to_last(it);
+}
+
+/**
+ * Entry of cryptodb_iterator_t, "buf" keeps its decrypted key and value
+ */
+typedef struct {
+    cryptodb_entry_t entry;
+    char *buf;
+    size_t buf_len;
+} _cryptodb_iterator_slot_t;
+
+/**
+ * Recovers the key of the database entry into "key" of at least "dbkeylen"
+ * bytes, see cryptodb_entry_t. "keylen" is 0 if the key can't be recovered.
+ */
+static int _cryptodb_decrypt_key(cryptodb_t *cryptodb,
+                                 _cryptodb_keys_t *keys,
+                                 const char *dbkey, size_t dbkeylen,
+                                 char *key, size_t *keylen)
+{
+    int result = CRYPTODB_SUCCESS;
+
+    *keylen = 0;
+
+    if (cryptodb->disable_keys_encryption)
+    {
+        memcpy(key, dbkey, dbkeylen);
+        *keylen = dbkeylen;
+        return CRYPTODB_SUCCESS;
+    }
+    // Key tokens can't be decrypted
+    if (cryptodb->key_mode != CRYPTODB_KEY_MODE_AES_256_CBC)
+        return CRYPTODB_SUCCESS;
+    if (!dbkeylen || dbkeylen % CRYPTODB_AES_BLOCK_LEN != 0)
+        return CRYPTODB_ERR_FAIL;
+
+    memcpy(key, dbkey, dbkeylen);
+    result = _cryptodb_aes_256_cbc(key, key, dbkeylen, false, keys);
+    if (result == CRYPTODB_SUCCESS)
+        *keylen = dbkeylen;
+
+    return result;
+}
+
+/**
+ * Checks that original key "key" of the record belongs to the database key
+ */
+static int _cryptodb_check_key(cryptodb_t *cryptodb,
+                               _cryptodb_keys_t *keys,
+                               const char *dbkey, size_t dbkeylen,
+                               const char *key, size_t keylen)
+{
+    int result = CRYPTODB_SUCCESS;
+    char scratch_key[CRYPTODB_SCRATCH_LEN];
+    char *encrypt_key = NULL;
+    size_t encrypt_key_len = 0;
+
+    if (cryptodb->disable_keys_encryption)
+        return (keylen == dbkeylen && !memcmp(key, dbkey, dbkeylen)) ?
+               CRYPTODB_SUCCESS : CRYPTODB_ERR_INTEGRITY_FAIL;
+
+    result = _cryptodb_encrypt_key(cryptodb, keys, key, keylen,
+                                   scratch_key,
+                                   &encrypt_key,
+                                   &encrypt_key_len);
+    if (result == CRYPTODB_SUCCESS &&
+        (encrypt_key_len != dbkeylen || memcmp(encrypt_key, dbkey, dbkeylen)))
+        result = CRYPTODB_ERR_INTEGRITY_FAIL;
+    _cryptodb_scratch_free(encrypt_key, scratch_key, encrypt_key_len);
+
+    return result;
+}
+
+/**
+ * Decompresses the compressed record "rec" into a new buffer of the slot
+ * that has room for the key after the record, see _cryptodb_iterator_fill().
+ * "vallen" is set to the record length.
+ */
+static int _cryptodb_entry_uncompress(cryptodb_t *cryptodb,
+                                      _cryptodb_iterator_slot_t *slot,
+                                      const char *rec, size_t reclen,
+                                      size_t dbkeylen,
+                                      size_t *vallen)
+{
+    char *buf = NULL;
+    const uint8_t *data = NULL;
+    size_t len = 0, data_len = 0;
+
+    len = _cryptodb_record_uncompressed_len((const uint8_t *)rec, reclen, &data, &data_len);
+    if (!len)
+        return CRYPTODB_ERR_FAIL;
+
+    buf = (char *)calloc(len + dbkeylen + 2, sizeof(char));
+    _cryptodb_stats_inc(&((cryptodb_stats_t *)cryptodb->stats)->heap_allocs);
+    if (buf == NULL)
+        return CRYPTODB_ERR_ALLOCATE_MEM;
+    if (!_cryptodb_record_uncompress((const uint8_t *)rec, data, data_len, (uint8_t *)buf, len))
+    {
+        mbedtls_platform_zeroize(buf, len);
+        free(buf);
+        return CRYPTODB_ERR_FAIL;
+    }
+
+    mbedtls_platform_zeroize(slot->buf, slot->buf_len);
+    free(slot->buf);
+    slot->buf = buf;
+    slot->buf_len = len + dbkeylen + 2;
+    *vallen = len;
+
+    return CRYPTODB_SUCCESS;
+}
+
+/**
+ * Decrypts the database entry into "slot->entry". The string or blob value
+ * is moved to the beginning of "slot->buf" and the key is put after it.
+ */
+static int _cryptodb_entry_decode(cryptodb_t *cryptodb,
+                                  _cryptodb_keys_t *keys,
+                                  const char *dbkey, size_t dbkeylen,
+                                  _cryptodb_iterator_slot_t *slot,
+                                  size_t vallen)
+{
+    int result = CRYPTODB_SUCCESS;
+    cryptodb_entry_t *entry = &slot->entry;
+    char *decrypt = NULL, *key = NULL;
+    size_t decrypt_len = 0, payload_len = 0, rkeylen = 0;
+    const uint8_t *payload = NULL, *rkey = NULL;
+
+    result = _cryptodb_value_decrypt(cryptodb, keys, slot->buf, vallen,
+                                     dbkey, dbkeylen,
+                                     &decrypt, &decrypt_len);
+    if (result != CRYPTODB_SUCCESS)
+        return result;
+
+    // The compressed record may be longer than the value, so it gets
+    // a new buffer
+    if ((uint8_t)decrypt[0] == CRYPTODB_RECORD_FORMAT_COMPRESSED)
+    {
+        result = _cryptodb_entry_uncompress(cryptodb, slot, decrypt, decrypt_len,
+                                            dbkeylen, &vallen);
+        if (result != CRYPTODB_SUCCESS)
+            return result;
+        decrypt = slot->buf;
+        decrypt_len = vallen;
+    }
+
+    key = slot->buf + vallen + 1;
+    result = _cryptodb_decrypt_key(cryptodb, keys, dbkey, dbkeylen, key, &entry->keylen);
+    if (result != CRYPTODB_SUCCESS)
+        return result;
+    if (entry->keylen)
+        entry->key = key;
+
+    if (decrypt[0] == CRYPTODB_RECORD_FORMAT_JSON)
+    {
+        // Legacy records are parsed once to find out the type
+        result = _cryptodb_json_record_to_val(decrypt, decrypt_len, CRYPTODB_VAL_UNKNOWN, NULL, NULL);
+        if (result < 0)
+            return result;
+        entry->valtype = (cryptodb_val_t)result;
+        switch (entry->valtype)
+        {
+        default:
+            return CRYPTODB_ERR_FAIL;
+        case CRYPTODB_VAL_STRING:
+            // Written only after the record is parsed
+            entry->str = slot->buf;
+            result = _cryptodb_json_record_to_val(decrypt, decrypt_len, entry->valtype, slot->buf, NULL);
+            entry->str_len = strlen(entry->str);
+            return result;
+        case CRYPTODB_VAL_NUM_INT:
+            return _cryptodb_json_record_to_val(decrypt, decrypt_len, entry->valtype, &entry->integer, NULL);
+        case CRYPTODB_VAL_NUM_DOUBLE:
+            return _cryptodb_json_record_to_val(decrypt, decrypt_len, entry->valtype, &entry->number, NULL);
+        }
+    }
+
+    entry->valtype = _cryptodb_record_decode((const uint8_t *)decrypt, decrypt_len,
+                                             &payload, &payload_len,
+                                             &rkey, &rkeylen);
+    switch (entry->valtype)
+    {
+    default:
+        return CRYPTODB_ERR_FAIL;
+    case CRYPTODB_VAL_STRING:
+        entry->str = slot->buf;
+        entry->str_len = payload_len;
+        result = _cryptodb_payload_to_val(entry->valtype, payload, payload_len, slot->buf);
+        break;
+    case CRYPTODB_VAL_BLOB:
+        entry->str = slot->buf;
+        entry->str_len = payload_len;
+        result = _cryptodb_payload_to_val(entry->valtype, payload, payload_len, slot->buf);
+        break;
+    case CRYPTODB_VAL_NUM_INT:
+        result = _cryptodb_payload_to_val(entry->valtype, payload, payload_len, &entry->integer);
+        break;
+    case CRYPTODB_VAL_NUM_DOUBLE:
+        result = _cryptodb_payload_to_val(entry->valtype, payload, payload_len, &entry->number);
+        break;
+    case CRYPTODB_VAL_NUM_INT64:
+        result = _cryptodb_payload_to_val(entry->valtype, payload, payload_len, &entry->integer64);
+        break;
+    case CRYPTODB_VAL_NUM_UINT64:
+        result = _cryptodb_payload_to_val(entry->valtype, payload, payload_len, &entry->uinteger64);
+        break;
+    }
+    if (result != CRYPTODB_SUCCESS || rkey == NULL)
+        return result;
+
+    // The original key that the record keeps is after the payload,
+    // so it's moved back behind the string or blob value
+    result = _cryptodb_check_key(cryptodb, keys, dbkey, dbkeylen,
+                                 (const char *)rkey, rkeylen);
+    if (result != CRYPTODB_SUCCESS)
+        return result;
+    key = entry->valtype == CRYPTODB_VAL_STRING || entry->valtype == CRYPTODB_VAL_BLOB ?
+          slot->buf + payload_len + 1 : slot->buf;
+    memmove(key, rkey, rkeylen);
+    key[rkeylen] = '\0';
+    entry->key = key;
+    entry->keylen = rkeylen;
+
+    return CRYPTODB_SUCCESS;
+}
+
+/**
+ * Fill function of the iterator read-ahead stage, see _cryptodb_readahead_fill_t
+ */
+static bool _cryptodb_iterator_fill(void *arg, void *slot)
+{
+    int result = CRYPTODB_SUCCESS;
+    const char *dbkey = NULL, *value = NULL;
+    size_t dbkeylen = 0, vallen = 0;
+    _cryptodb_keys_t *keys = NULL;
+    cryptodb_iterator_t *iterator = (cryptodb_iterator_t *)arg;
+    cryptodb_t *cryptodb = iterator->cryptodb;
+    _cryptodb_iterator_slot_t *s = (_cryptodb_iterator_slot_t *)slot;
+    _cryptodb_iterator_range_t *range = (_cryptodb_iterator_range_t *)iterator->range;
+
+    // LevelDB error is checked by cryptodb_iterator_status()
+    if (!leveldb_iter_valid(iterator->it))
+        return false;
+
+    // Entries are ordered, so the first entry out of the bounds ends
+    // the iteration and isn't decrypted
+    dbkey = leveldb_iter_key(iterator->it, &dbkeylen);
+    if (range && !_cryptodb_iterator_range_contains(range, dbkey, dbkeylen))
+        return false;
+    value = leveldb_iter_value(iterator->it, &vallen);
+
+    // The value is decrypted in place and followed by its terminating zero,
+    // then there is room for the key and its terminating zero
+    s->buf_len = vallen + dbkeylen + 2;
+    s->buf = (char *)calloc(s->buf_len, sizeof(char));
+    _cryptodb_stats_inc(&((cryptodb_stats_t *)cryptodb->stats)->heap_allocs);
+    if (s->buf == NULL)
+    {
+        s->buf_len = 0;
+        s->entry.result = CRYPTODB_ERR_ALLOCATE_MEM;
+    }
+    else if (!vallen)
+        s->entry.result = CRYPTODB_ERR_FAIL;
+    else
+    {
+        memcpy(s->buf, value, vallen);
+        s->entry.result = _cryptodb_keys_acquire(cryptodb, false, &keys);
+        if (s->entry.result == CRYPTODB_SUCCESS)
+        {
+            s->entry.result = _cryptodb_entry_decode(cryptodb, keys, dbkey, dbkeylen, s, vallen);
+            _cryptodb_keys_release(cryptodb);
+        }
+    }
+
+    if (s->entry.result == CRYPTODB_SUCCESS)
+        _cryptodb_stats_inc(&((cryptodb_stats_t *)cryptodb->stats)->gets);
+    else
+    {
+        // Only "result" is set for a failed entry
+        result = s->entry.result;
+        memset(&s->entry, 0, sizeof(cryptodb_entry_t));
+        s->entry.result = result;
+        s->entry.valtype = CRYPTODB_VAL_UNKNOWN;
+    }
+
+    if (range && range->reverse)
+        leveldb_iter_prev(iterator->it);
+    else
+        leveldb_iter_next(iterator->it);
+
+    return true;
+}
+
+/**
+ * Clear function of the iterator read-ahead stage, see _cryptodb_readahead_clear_t
+ */
+static void _cryptodb_iterator_clear(void *arg, void *slot)
+{
+    _cryptodb_iterator_slot_t *s = (_cryptodb_iterator_slot_t *)slot;
+
+    CRYPTODB_UNUSED(arg);
+
+    if (s->buf)
+    {
+        mbedtls_platform_zeroize(s->buf, s->buf_len);
+        free(s->buf);
+    }
+    memset(s, 0, sizeof(_cryptodb_iterator_slot_t));
+}
+
+/**
+ * Should be called after every successful write to the database
+ * (not to a batch) with CRYPTODB_DURABILITY_SYNC or
+ * CRYPTODB_DURABILITY_PERIODIC. Group commit writes go through
+ * _cryptodb_sync_commit() instead.
+ */
+static void _cryptodb_written(cryptodb_t *cryptodb)
+{
+    if (cryptodb->syncer == NULL)
+    {
+        // CRYPTODB_DURABILITY_SYNC, the write was synced itself
+        _cryptodb_stats_inc(&((cryptodb_stats_t *)cryptodb->stats)->syncs);
+        return;
+    }
+
+    _cryptodb_sync_written((_cryptodb_sync_t *)cryptodb->syncer);
+}
+
+/**
+ * Writes "batch" of "puts" and "deletes" operations to the database
+ * with one write, returns when it's durable according to "durability"
+ * in cryptodb_options_t
+ */
+static int _cryptodb_write_batch(cryptodb_t *cryptodb,
+                                 leveldb_writebatch_t *batch,
+                                 size_t puts, size_t deletes)
+{
+    char *err = NULL;
+    int result = CRYPTODB_SUCCESS;
+
+    if (cryptodb->durability == CRYPTODB_DURABILITY_GROUP_COMMIT)
+    {
+        result = _cryptodb_sync_commit((_cryptodb_sync_t *)cryptodb->syncer, batch);
+    }
+    else
+    {
+        leveldb_write(cryptodb->db, cryptodb->woptions, batch, &err);
+        if (err)
+        {
+            result = _leveldb_err_to_cryptodb_err(err);
+            leveldb_free(err);
+        }
+        if (result == CRYPTODB_SUCCESS)
+            _cryptodb_written(cryptodb);
+    }
+    if (result != CRYPTODB_SUCCESS)
+        return result;
+
+    _cryptodb_stats_add(&((cryptodb_stats_t *)cryptodb->stats)->puts, puts);
+    _cryptodb_stats_add(&((cryptodb_stats_t *)cryptodb->stats)->deletes, deletes);
+
+    return CRYPTODB_SUCCESS;
+}
+
+/**
+ * Puts the entry to the database, or deletes it if "val" is NULL.
+ * Returns when the write is durable according to "durability" in
+ * cryptodb_options_t.
+ */
+static int _cryptodb_write(cryptodb_t *cryptodb,
+                           const char *key, size_t keylen,
+                           const char *val, size_t vallen)
+{
+    char *err = NULL;
+    int result = CRYPTODB_SUCCESS;
+    leveldb_writebatch_t *batch = NULL;
+
+    // Group commit writes batches only, see _cryptodb_sync_commit()
+    if (cryptodb->durability == CRYPTODB_DURABILITY_GROUP_COMMIT)
+    {
+        batch = leveldb_writebatch_create();
+        if (batch == NULL)
+            return CRYPTODB_ERR_ALLOCATE_MEM;
+        if (val)
+            leveldb_writebatch_put(batch, key, keylen, val, vallen);
+        else
+            leveldb_writebatch_delete(batch, key, keylen);
+        result = _cryptodb_sync_commit((_cryptodb_sync_t *)cryptodb->syncer, batch);
+        leveldb_writebatch_destroy(batch);
+        return result;
+    }
+
+    if (val)
+        leveldb_put(cryptodb->db, cryptodb->woptions, key, keylen, val, vallen, &err);
+    else
+        leveldb_delete(cryptodb->db, cryptodb->woptions, key, keylen, &err);
+    if (err)
+    {
+        result = _leveldb_err_to_cryptodb_err(err);
+        leveldb_free(err);
+    }
+    if (result == CRYPTODB_SUCCESS)
+        _cryptodb_written(cryptodb);
+
+    return result;
+}
+
+/**
+ * Commit function of the asynchronous writer, see _cryptodb_writer_commit_t
+ */
+static int _cryptodb_writer_commit(void *arg,
+                                   leveldb_writebatch_t *batch,
+                                   size_t puts, size_t deletes)
+{
+    return _cryptodb_write_batch((cryptodb_t *)arg, batch, puts, deletes);
+}
+
+/**
+ * Checks whether "<path><suffix>" folder holds a database, see cryptodb_bulk_begin()
+ */
+static int _cryptodb_db_exists(const char *path, size_t path_len,
+                               const char *suffix, bool *exists)
+{
+    FILE *current = NULL;
+    size_t suffix_len = strlen(suffix);
+    char *current_path = (char *)malloc(path_len + suffix_len + sizeof("/CURRENT"));
+
+    if (current_path == NULL)
+        return CRYPTODB_ERR_ALLOCATE_MEM;
+    memcpy(current_path, path, path_len);
+    memcpy(current_path + path_len, suffix, suffix_len);
+    memcpy(current_path + path_len + suffix_len, "/CURRENT", sizeof("/CURRENT"));
+
+    current = fopen(current_path, "rb");
+    free(current_path);
+    *exists = current != NULL;
+    if (current)
+        fclose(current);
+
+    return CRYPTODB_SUCCESS;
+}
+
+/**
+ * Finishes or reverts the swap of cryptodb_migrate() interrupted by a crash,
+ * when the database folder is missing. "<path>.legacy" appears only after
+ * "<path>.migrate" was completely written, so the migrated database takes
+ * the place if it's there, otherwise the original one is moved back.
+ */
+static int _cryptodb_migrate_recover(const char *path)
+{
+    int result = CRYPTODB_SUCCESS;
+
+    bool exists = false;
+    size_t path_len = strlen(path);
+    char *db_path = NULL, *new_path = NULL, *old_path = NULL;
+
+    while (path_len > 1 && (path[path_len - 1] == '/' || path[path_len - 1] == '\\'))
+        --path_len;
+
+    result = _cryptodb_db_exists(path, path_len, "", &exists);
+    if (result != CRYPTODB_SUCCESS || exists)
+        return result;
+    result = _cryptodb_db_exists(path, path_len, ".legacy", &exists);
+    if (result != CRYPTODB_SUCCESS || !exists)
+        return result;
+
+    db_path = (char *)malloc(path_len + 1);
+    new_path = (char *)malloc(path_len + sizeof(".migrate"));
+    old_path = (char *)malloc(path_len + sizeof(".legacy"));
+    if (!db_path || !new_path || !old_path)
+    {
+        result = CRYPTODB_ERR_ALLOCATE_MEM;
+        goto exit;
+    }
+    memcpy(db_path, path, path_len);
+    db_path[path_len] = '\0';
+    memcpy(new_path, path, path_len);
+    memcpy(new_path + path_len, ".migrate", sizeof(".migrate"));
+    memcpy(old_path, path, path_len);
+    memcpy(old_path + path_len, ".legacy", sizeof(".legacy"));
+
+    result = _cryptodb_db_exists(path, path_len, ".migrate", &exists);
+    if (result != CRYPTODB_SUCCESS)
+        goto exit;
+    if (exists)
+    {
+        if (rename(new_path, db_path))
+            result = CRYPTODB_ERR_FAIL;
+        else
+            cryptodb_destroy(old_path, NULL);
+    }
+    else if (rename(old_path, db_path))
+        result = CRYPTODB_ERR_FAIL;
+
+exit:
+    free(db_path);
+    free(new_path);
+    free(old_path);
+
+    return result;
+}
+
+static int _cryptodb_open(const char *path,
+                          uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN],
+                          size_t uniq_data_len,
+                          cryptodb_options_t *options,
+                          cryptodb_user_kdf user_kdf,
+                          void *kdf_user_data,
+                          cryptodb_t *cryptodb,
+                          bool use_keys_instead_of_uniq_data)
+{
+    int result = CRYPTODB_SUCCESS;
+
+    char *err = NULL;
+    leveldb_t *db = NULL;
+    leveldb_env_t *env = NULL;
+    leveldb_cache_t *cache = NULL;
+    leveldb_comparator_t *cmp = NULL;
+    _cryptodb_filter_t *filter = NULL;
+    leveldb_options_t *dboptions = NULL;
+    leveldb_readoptions_t *roptions = NULL;
+    leveldb_writeoptions_t *woptions = NULL;
+
+    if (path == NULL || cryptodb == NULL || uniq_data == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+    if (!strlen(path) || !uniq_data_len)
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+    if (options && options->worker_threads > CRYPTODB_OPT_MAX_WORKER_THREADS)
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+    if (options && (unsigned int)options->value_cipher >= CRYPTODB_CIPHER_UNKNOWN)
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+    if (options && (unsigned int)options->key_mode >= CRYPTODB_KEY_MODE_UNKNOWN)
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+    if (options && (unsigned int)options->durability >= CRYPTODB_DURABILITY_UNKNOWN)
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+    if (options && options->bloom_bits_per_key < 0)
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+    if (options && ((unsigned int)options->compression >= CRYPTODB_COMPRESSION_UNKNOWN ||
+                    options->compression_min_saving >= 100))
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+
+    cryptodb_close(cryptodb);
+
+    // The database is created if it's missing, so it's put back first
+    result = _cryptodb_migrate_recover(path);
+    if (result != CRYPTODB_SUCCESS)
+        return result;
+
+    dboptions = _cryptodb_dboptions_create(options);
+    roptions  = leveldb_readoptions_create();
+    env       = leveldb_create_default_env();
+    woptions  = leveldb_writeoptions_create();
+    cache     = leveldb_cache_create_lru(options ?
+                                options->cache_capacity :
+                                CRYPTODB_OPT_DEFAULT_CACHE_SIZE);
+    if (options && options->bloom_bits_per_key)
+        filter = _cryptodb_filter_create(options->bloom_bits_per_key);
+    if (!dboptions || !roptions || !env || !woptions || !cache ||
+        (options && options->bloom_bits_per_key && !filter))
+    {
+        if (env)
+            leveldb_env_destroy(env);
+        if (cache)
+            leveldb_cache_destroy(cache);
+        _cryptodb_filter_destroy(filter);
+        if (dboptions)
+            leveldb_options_destroy(dboptions);
+        if (roptions)
+            leveldb_readoptions_destroy(roptions);
+        if (woptions)
+            leveldb_writeoptions_destroy(woptions);
+        return CRYPTODB_ERR_ALLOCATE_MEM;
+    }
+
+    leveldb_options_set_env(dboptions, env);
+    leveldb_options_set_cache(dboptions, cache);
+    if (filter)
+        leveldb_options_set_filter_policy(dboptions, _cryptodb_filter_policy(filter));
+
+    // With other durability policies the log is synced by the sync scheduler
+    leveldb_writeoptions_set_sync(woptions,
+                                  !options ||
+                                  options->durability == CRYPTODB_DURABILITY_SYNC);
+    leveldb_readoptions_set_fill_cache(roptions, 1);
+    leveldb_readoptions_set_verify_checksums(roptions, 1);
+
+    // LevelDB built-in bytewise comparator is used, so keys are compared
+    // without calls through the C API. Databases created by older versions
+    // store the name of the callback comparator and are opened with it.
+    db = leveldb_open(dboptions, path, &err);
+    if (db == NULL && err && _leveldb_err_is_comparator_mismatch(err))
+    {
+        leveldb_free(err);
+        err = NULL;
+        cmp = leveldb_comparator_create(NULL,
+                                        _cryptodb_comparator_destroy,
+                                        _cryptodb_comparator_compare,
+                                        _cryptodb_comparator_name);
+        if (cmp == NULL)
+            result = CRYPTODB_ERR_ALLOCATE_MEM;
+        else
+        {
+            leveldb_options_set_comparator(dboptions, cmp);
+            db = leveldb_open(dboptions, path, &err);
+        }
+    }
+    if ((db == NULL) || err)
+    {
+        if (err)
+        {
+            result = _leveldb_err_to_cryptodb_err(err);
+            leveldb_free(err);
+        }
+        if (result == CRYPTODB_ERR_OK && !db)
+            result = CRYPTODB_ERR_FAIL;
+        if (result != CRYPTODB_ERR_OK)
+        {
+            if (db)
+                leveldb_close(db);
+            leveldb_env_destroy(env);
+            leveldb_cache_destroy(cache);
+            if (cmp)
+                leveldb_comparator_destroy(cmp);
+            _cryptodb_filter_destroy(filter);
+            leveldb_options_destroy(dboptions);
+            leveldb_readoptions_destroy(roptions);
+            leveldb_writeoptions_destroy(woptions);
+            return result;
+        }
+    }
+
+    cryptodb->db = db;
+    cryptodb->env = env;
+    cryptodb->cmp = cmp;
+    cryptodb->filter = filter;
+    cryptodb->cache = cache;
+    cryptodb->options = dboptions;
+    cryptodb->roptions = roptions;
+    cryptodb->woptions = woptions;
+    cryptodb->user_kdf = user_kdf;
+    cryptodb->kdf_user_data = kdf_user_data;
+    cryptodb->uniq_data_len = uniq_data_len;
+    cryptodb->use_keys_instead_of_uniq_data = use_keys_instead_of_uniq_data;
+    cryptodb->disable_keys_encryption = options ?
+                                        options->disable_keys_encryption : 0;
+    cryptodb->value_cipher = options ?
+                             options->value_cipher : CRYPTODB_CIPHER_AES_256_CBC;
+    cryptodb->key_mode = options ?
+                         options->key_mode : CRYPTODB_KEY_MODE_AES_256_CBC;
+    cryptodb->keep_original_keys = options &&
+                                   options->keep_original_keys &&
+                                   !options->disable_keys_encryption &&
+                                   options->key_mode != CRYPTODB_KEY_MODE_AES_256_CBC;
+    cryptodb->durability = options ?
+                           options->durability : CRYPTODB_DURABILITY_SYNC;
+    cryptodb->compression = options ?
+                            options->compression : CRYPTODB_COMPRESSION_NONE;
+    cryptodb->compression_min_saving = (options && options->compression_min_saving) ?
+                                       options->compression_min_saving :
+                                       CRYPTODB_OPT_DEFAULT_COMPRESSION_MIN_SAVING;
+    memcpy(cryptodb->uniq_data, uniq_data, uniq_data_len);
+
+    cryptodb->stats = calloc(1, sizeof(cryptodb_stats_t));
+    if (cryptodb->stats == NULL)
+    {
+        cryptodb_close(cryptodb);
+        return CRYPTODB_ERR_ALLOCATE_MEM;
+    }
+
+    cryptodb->parallel_decrypt_threshold = (options && options->parallel_decrypt_threshold) ?
+                                           options->parallel_decrypt_threshold :
+                                           CRYPTODB_OPT_DEFAULT_PAR_DEC_THRESHOLD;
+    if (options && options->worker_threads)
+    {
+        cryptodb->pool = _cryptodb_pool_create(options->worker_threads);
+        if (cryptodb->pool == NULL)
+        {
+            cryptodb_close(cryptodb);
+            return CRYPTODB_ERR_FAIL;
+        }
+    }
+
+    if (cryptodb->durability != CRYPTODB_DURABILITY_SYNC)
+    {
+        cryptodb->syncer = _cryptodb_sync_create(db, cryptodb->durability,
+                                                 options->sync_period_ms ?
+                                                 options->sync_period_ms :
+                                                 CRYPTODB_OPT_DEFAULT_SYNC_PERIOD_MS,
+                                                 &((cryptodb_stats_t *)cryptodb->stats)->syncs);
+        if (cryptodb->syncer == NULL)
+        {
+            cryptodb_close(cryptodb);
+            return CRYPTODB_ERR_FAIL;
+        }
+    }
+
+    cryptodb->writer = _cryptodb_writer_create((options && options->async_queue_len) ?
+                                               options->async_queue_len :
+                                               CRYPTODB_OPT_DEFAULT_ASYNC_QUEUE_LEN,
+                                               _cryptodb_writer_commit,
+                                               cryptodb);
+    if (cryptodb->writer == NULL)
+    {
+        cryptodb_close(cryptodb);
+        return CRYPTODB_ERR_ALLOCATE_MEM;
+    }
+
+    result = _cryptodb_keystore_create(cryptodb,
+                                       options ?
+                                       options->kdf_epoch : NULL);
+    if (result != CRYPTODB_SUCCESS)
+        cryptodb_close(cryptodb);
+
+    return result;
+}
+
+/**
+ * Encrypts the entry and writes it to the database, or only adds it
+ * to "batch" if it isn't NULL
+ */
+static int _cryptodb_put(cryptodb_t *cryptodb,
+                         leveldb_writebatch_t *batch,
+                         const char* key, size_t keylen,
+                         cryptodb_val_t valtype, void *val)
+{
+    _cryptodb_keys_t *keys = NULL;
+    int result = CRYPTODB_SUCCESS;
+    const char *dbkey = key;
+    size_t dbkeylen = keylen;
+    char *encrypt = NULL, *encrypt_key = NULL;
+    char scratch[CRYPTODB_SCRATCH_LEN], scratch_key[CRYPTODB_SCRATCH_LEN];
+    char scratch_compress[CRYPTODB_SCRATCH_LEN], *compress = NULL;
+    size_t payload_len = 0, encrypt_len = 0, encrypt_max_len = 0, encrypt_key_len = 0;
+    size_t compress_len = 0;
+    uint8_t *rec = NULL;
+    bool gcm = false;
+
+    if (cryptodb == NULL || key == NULL || val == NULL ||
+        cryptodb->db == NULL || cryptodb->woptions == NULL ||
+        cryptodb->keystore == NULL || cryptodb->stats == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+    if (!keylen)
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+
+    switch (valtype)
+    {
+    default:
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+    case CRYPTODB_VAL_BLOB:
+        if (((const cryptodb_blob_t *)val)->data == NULL && ((const cryptodb_blob_t *)val)->len)
+            return CRYPTODB_ERR_NULL_POINTER;
+        payload_len = _cryptodb_record_payload_len(valtype, val);
+        break;
+    case CRYPTODB_VAL_STRING:
+    case CRYPTODB_VAL_NUM_INT:
+    case CRYPTODB_VAL_NUM_DOUBLE:
+    case CRYPTODB_VAL_NUM_INT64:
+    case CRYPTODB_VAL_NUM_UINT64:
+        payload_len = _cryptodb_record_payload_len(valtype, val);
+        break;
+    }
+
+    gcm = cryptodb->value_cipher == CRYPTODB_CIPHER_AES_256_GCM;
+
+    encrypt_max_len = CRYPTODB_RECORD_HEADER_MAX_LEN + payload_len;
+    if (cryptodb->keep_original_keys)
+        encrypt_max_len += CRYPTODB_VARINT_MAX_LEN + keylen;
+    if (gcm)
+        encrypt_max_len += CRYPTODB_VALUE_GCM_OVERHEAD + 1;
+    while (!gcm && encrypt_max_len % CRYPTODB_AES_BLOCK_LEN != 0)
+        ++encrypt_max_len;
+
+    encrypt = _cryptodb_scratch_alloc(cryptodb, scratch, encrypt_max_len);
+    if (encrypt == NULL)
+        return CRYPTODB_ERR_ALLOCATE_MEM;
+
+    rec = (uint8_t *)encrypt + (gcm ? CRYPTODB_VALUE_GCM_HEADER_LEN : 0);
+    encrypt_len = _cryptodb_record_encode(valtype, val, payload_len,
+                                          cryptodb->keep_original_keys ? key : NULL, keylen,
+                                          rec);
+
+    // Compressed before encryption, ciphertext doesn't compress
+    if (cryptodb->compression != CRYPTODB_COMPRESSION_NONE &&
+        encrypt_len >= CRYPTODB_COMPRESSION_MIN_LEN)
+    {
+        compress_len = encrypt_len;
+        compress = _cryptodb_scratch_alloc(cryptodb, scratch_compress, compress_len);
+        if (compress == NULL)
+        {
+            _cryptodb_scratch_free(encrypt, scratch, encrypt_max_len);
+            return CRYPTODB_ERR_ALLOCATE_MEM;
+        }
+        encrypt_len = _cryptodb_record_compress(cryptodb->compression,
+                                                cryptodb->compression_min_saving,
+                                                rec, encrypt_len,
+                                                (uint8_t *)compress);
+        _cryptodb_scratch_free(compress, scratch_compress, compress_len);
+    }
+
+    if (gcm)
+    {
+        // See CRYPTODB_VALUE_GCM_MARKER
+        if ((encrypt_len + CRYPTODB_VALUE_GCM_OVERHEAD) % CRYPTODB_AES_BLOCK_LEN == 0)
+            ++encrypt_len;
+    }
+    else
+    {
+        while (encrypt_len % CRYPTODB_AES_BLOCK_LEN != 0)
+            ++encrypt_len;
+    }
+
+    result = _cryptodb_keys_acquire(cryptodb, true, &keys);
+    if (result == CRYPTODB_ERR_OK)
+    {
+        if (!cryptodb->disable_keys_encryption)
+        {
+            result = _cryptodb_encrypt_key(cryptodb, keys, key, keylen,
+                                           scratch_key,
+                                           &encrypt_key,
+                                           &encrypt_key_len);
+            dbkey = encrypt_key;
+            dbkeylen = encrypt_key_len;
+        }
+        if (result == CRYPTODB_ERR_OK && gcm)
+        {
+            encrypt[0] = (char)CRYPTODB_VALUE_GCM_MARKER;
+            _cryptodb_nonce_next(cryptodb, (uint8_t *)encrypt + 1);
+            result = _cryptodb_aes_256_gcm(cryptodb, true,
+                                           encrypt + CRYPTODB_VALUE_GCM_HEADER_LEN,
+                                           encrypt_len,
+                                           (const uint8_t *)encrypt + 1,
+                                           dbkey, dbkeylen,
+                                           (uint8_t *)encrypt + CRYPTODB_VALUE_GCM_HEADER_LEN +
+                                           encrypt_len,
+                                           keys);
+            encrypt_len += CRYPTODB_VALUE_GCM_OVERHEAD;
+        }
+        else if (result == CRYPTODB_ERR_OK)
+        {
+            result = _cryptodb_aes_256_cbc(encrypt, encrypt,
+                                           encrypt_len,
+                                           true,
+                                           keys);
+        }
+        _cryptodb_keys_release(cryptodb);
+    }
+
+    if (result == CRYPTODB_ERR_OK && batch)
+    {
+        // The batch keeps its own copy of the entry
+        leveldb_writebatch_put(batch,
+                               dbkey, dbkeylen,
+                               (const char *)encrypt,
+                               encrypt_len);
+    }
+    else if (result == CRYPTODB_ERR_OK)
+    {
+        result = _cryptodb_write(cryptodb,
+                                 dbkey, dbkeylen,
+                                 (const char *)encrypt,
+                                 encrypt_len);
+    }
+
+    _cryptodb_scratch_free(encrypt, scratch, encrypt_max_len);
+    _cryptodb_scratch_free(encrypt_key, scratch_key, encrypt_key_len);
+
+    if (result == CRYPTODB_ERR_OK && batch == NULL)
+        _cryptodb_stats_inc(&((cryptodb_stats_t *)cryptodb->stats)->puts);
+
+    return result;
+}
+
+/**
+ * Deletes the entry from the database, or only adds the deletion
+ * to "batch" if it isn't NULL
+ */
+static int _cryptodb_delete(cryptodb_t *cryptodb,
+                            leveldb_writebatch_t *batch,
+                            const char* key, size_t keylen)
+{
+    size_t encrypt_key_len = 0;
+    _cryptodb_keys_t *keys = NULL;
+    int result = CRYPTODB_SUCCESS;
+    const char *dbkey = key;
+    size_t dbkeylen = keylen;
+    char scratch_key[CRYPTODB_SCRATCH_LEN];
+    char *encrypt_key = NULL;
+
+    if (cryptodb == NULL     || key == NULL ||
+        cryptodb->db == NULL || cryptodb->woptions == NULL ||
+        cryptodb->keystore == NULL || cryptodb->stats == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+    if (!keylen)
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+
+    if (!cryptodb->disable_keys_encryption)
+    {
+        result = _cryptodb_keys_acquire(cryptodb, true, &keys);
+        if (result != CRYPTODB_ERR_OK)
+            return result;
+
+        result = _cryptodb_encrypt_key(cryptodb, keys, key, keylen,
+                                       scratch_key,
+                                       &encrypt_key,
+                                       &encrypt_key_len);
+        _cryptodb_keys_release(cryptodb);
+        dbkey = encrypt_key;
+        dbkeylen = encrypt_key_len;
+    }
+
+    if (result == CRYPTODB_ERR_OK && batch)
+    {
+        leveldb_writebatch_delete(batch, dbkey, dbkeylen);
+    }
+    else if (result == CRYPTODB_ERR_OK)
+    {
+        result = _cryptodb_write(cryptodb, dbkey, dbkeylen, NULL, 0);
+    }
+
+    _cryptodb_scratch_free(encrypt_key, scratch_key, encrypt_key_len);
+
+    if (result == CRYPTODB_ERR_OK && batch == NULL)
+        _cryptodb_stats_inc(&((cryptodb_stats_t *)cryptodb->stats)->deletes);
+
+    return result;
+}
+
+/**
+ * Encrypts put (if "put" is true) or delete operation and queues it to
+ * the asynchronous writer
+ */
+static int _cryptodb_submit(cryptodb_t *cryptodb, bool put,
+                            const char* key, size_t keylen,
+                            cryptodb_val_t valtype, void *val,
+                            cryptodb_write_cb cb, void *user_data)
+{
+    int result = CRYPTODB_SUCCESS;
+    leveldb_writebatch_t *op = NULL;
+
+    if (cryptodb == NULL || cryptodb->writer == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+
+    op = leveldb_writebatch_create();
+    if (op == NULL)
+        return CRYPTODB_ERR_ALLOCATE_MEM;
+
+    if (put)
+        result = _cryptodb_put(cryptodb, op, key, keylen, valtype, val);
+    else
+        result = _cryptodb_delete(cryptodb, op, key, keylen);
+    if (result == CRYPTODB_SUCCESS)
+        result = _cryptodb_writer_submit((_cryptodb_writer_t *)cryptodb->writer,
+                                         op, put, cb, user_data);
+    if (result != CRYPTODB_SUCCESS)
+        leveldb_writebatch_destroy(op);
+
+    return result;
+}
+
+/**
+ * @brief      cryptodb_get() with specified read options, e.g. of
+ *             a snapshot (see cryptodb_snapshot_get()). "vbuf" is NULL
+ *             unless it's cryptodb_get_buf().
+ */
+static int _cryptodb_get(cryptodb_t *cryptodb,
+                         const leveldb_readoptions_t *roptions,
+                         const char* key, size_t keylen,
+                         cryptodb_val_t valtype, void *val,
+                         _cryptodb_val_buf_t *vbuf)
+{
+    _cryptodb_keys_t *keys = NULL;
+    int result = CRYPTODB_SUCCESS;
+    const char *dbkey = key;
+    size_t dbkeylen = keylen;
+    char scratch_key[CRYPTODB_SCRATCH_LEN];
+    size_t vallen = 0, encrypt_key_len = 0;
+    char *err = NULL, *str = NULL, *encrypt_key = NULL;
+
+    if (cryptodb == NULL || key == NULL || (val == NULL && vbuf == NULL) ||
+        cryptodb->db == NULL || roptions == NULL ||
+        cryptodb->keystore == NULL || cryptodb->stats == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+    // Blob length isn't known in advance, it's read with cryptodb_get_buf()
+    if (!keylen || (vbuf == NULL && valtype == CRYPTODB_VAL_BLOB))
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+
+    result = _cryptodb_keys_acquire(cryptodb, false, &keys);
+    if (result != CRYPTODB_ERR_OK)
+        return result;
+
+    if (!cryptodb->disable_keys_encryption)
+    {
+        result = _cryptodb_encrypt_key(cryptodb, keys, key, keylen,
+                                       scratch_key,
+                                       &encrypt_key,
+                                       &encrypt_key_len);
+        if (result != CRYPTODB_ERR_OK)
+        {
+            _cryptodb_keys_release(cryptodb);
+            _cryptodb_scratch_free(encrypt_key, scratch_key, encrypt_key_len);
+            return result;
+        }
+        dbkey = encrypt_key;
+        dbkeylen = encrypt_key_len;
+    }
+
+    // LevelDB C API always returns the value in a heap buffer, it isn't
+    // counted in cryptodb_stats_t::heap_allocs
+    str = leveldb_get(cryptodb->db,
+                      roptions,
+                      dbkey, dbkeylen,
+                      &vallen, &err);
+    if ((str == NULL) || err)
+    {
+        if (err)
+        {
+            result = _leveldb_err_to_cryptodb_err(err);
+            leveldb_free(err);
+        }
+        if (result == CRYPTODB_ERR_OK && !str)
+            result = CRYPTODB_ERR_FAIL;
+        if (result != CRYPTODB_ERR_OK && str)
+            leveldb_free(str);
+    }
+    if (result == CRYPTODB_ERR_OK && !vallen)
+    {
+        leveldb_free(str);
+        result = CRYPTODB_ERR_FAIL;
+    }
+    if (result != CRYPTODB_ERR_OK)
+    {
+        _cryptodb_keys_release(cryptodb);
+        _cryptodb_scratch_free(encrypt_key, scratch_key, encrypt_key_len);
+        return result;
+    }
+
+    // The buffer returned by LevelDB is ours, decrypt in place and
+    // decode straight into the caller's "val"
+    result = _cryptodb_value_to_val(cryptodb, keys, str, vallen,
+                                    dbkey, dbkeylen, key, keylen,
+                                    valtype, val, vbuf);
+    _cryptodb_keys_release(cryptodb);
+    _cryptodb_scratch_free(encrypt_key, scratch_key, encrypt_key_len);
+
+    mbedtls_platform_zeroize(str, vallen);
+    leveldb_free(str);
+
+    if (result == CRYPTODB_ERR_OK)
+        _cryptodb_stats_inc(&((cryptodb_stats_t *)cryptodb->stats)->gets);
+
+    return result;
+}
+
+/**
+ * @brief      cryptodb_get_buf() with specified read options, see _cryptodb_get()
+ */
+static int _cryptodb_get_buf(cryptodb_t *cryptodb,
+                             const leveldb_readoptions_t *roptions,
+                             const char* key, size_t keylen,
+                             void *buf, size_t buf_cap,
+                             size_t *out_len, cryptodb_val_t *type)
+{
+    int result = CRYPTODB_SUCCESS;
+    _cryptodb_val_buf_t vbuf = { buf_cap, 0, CRYPTODB_VAL_UNKNOWN };
+
+    if (out_len == NULL || (buf == NULL && buf_cap))
+        return CRYPTODB_ERR_NULL_POINTER;
+
+    result = _cryptodb_get(cryptodb, roptions, key, keylen,
+                           CRYPTODB_VAL_UNKNOWN, buf, &vbuf);
+    if (result != CRYPTODB_SUCCESS && result != CRYPTODB_ERR_BUFFER_TOO_SMALL)
+    {
+        vbuf.len = 0;
+        vbuf.valtype = CRYPTODB_VAL_UNKNOWN;
+    }
+
+    *out_len = vbuf.len;
+    if (type)
+        *type = vbuf.valtype;
+
+    return result;
+}
+
+/**
+ * @brief      cryptodb_multi_get() from specified snapshot. If "snapshot"
+ *             is NULL, the entries are read from a new snapshot.
+ */
+static int _cryptodb_multi_get(cryptodb_t *cryptodb,
+                               const leveldb_snapshot_t *snapshot,
+                               cryptodb_get_item_t *items,
+                               size_t count)
+{
+    char *err = NULL;
+    size_t gets = 0, tasks_count = 0, total = 0, done = 0;
+    _cryptodb_keys_t *keys = NULL;
+    int result = CRYPTODB_SUCCESS;
+    char scratch_keys[CRYPTODB_SCRATCH_LEN];
+    char *encrypt_keys = NULL, *encrypt_key = NULL;
+    size_t encrypt_keys_len = 0, encrypt_key_len = 0;
+    leveldb_readoptions_t *roptions = NULL;
+    const leveldb_snapshot_t *own_snapshot = NULL;
+    _cryptodb_multi_get_value_t *values = NULL;
+    _cryptodb_multi_get_task_t tasks[CRYPTODB_OPT_MAX_WORKER_THREADS + 1];
+
+    if (cryptodb == NULL || items == NULL ||
+        cryptodb->db == NULL || cryptodb->roptions == NULL ||
+        cryptodb->keystore == NULL || cryptodb->stats == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+    if (!count)
+        return CRYPTODB_SUCCESS;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (items[i].key == NULL || items[i].val == NULL)
+            items[i].result = CRYPTODB_ERR_NULL_POINTER;
+        else if (!items[i].keylen || items[i].valtype == CRYPTODB_VAL_BLOB)
+            items[i].result = CRYPTODB_ERR_WRONG_ARGUMENT;
         else
-            return CRYPTODB_ERR_DECRYPTION_FAIL;
+            items[i].result = CRYPTODB_SUCCESS;
+
+        if (items[i].result == CRYPTODB_SUCCESS && !cryptodb->disable_keys_encryption)
+            encrypt_keys_len += _cryptodb_encrypt_key_len(cryptodb, items[i].keylen);
+    }
+
+    values = (_cryptodb_multi_get_value_t *)calloc(count, sizeof(_cryptodb_multi_get_value_t));
+    _cryptodb_stats_inc(&((cryptodb_stats_t *)cryptodb->stats)->heap_allocs);
+    roptions = leveldb_readoptions_create();
+    if (encrypt_keys_len)
+        encrypt_keys = _cryptodb_scratch_alloc(cryptodb, scratch_keys, encrypt_keys_len);
+    if (values == NULL || roptions == NULL || (encrypt_keys_len && encrypt_keys == NULL))
+    {
+        free(values);
+        if (roptions)
+            leveldb_readoptions_destroy(roptions);
+        _cryptodb_scratch_free(encrypt_keys, scratch_keys, encrypt_keys_len);
+        return CRYPTODB_ERR_ALLOCATE_MEM;
+    }
+
+    result = _cryptodb_keys_acquire(cryptodb, false, &keys);
+    if (result != CRYPTODB_ERR_OK)
+    {
+        free(values);
+        leveldb_readoptions_destroy(roptions);
+        _cryptodb_scratch_free(encrypt_keys, scratch_keys, encrypt_keys_len);
+        return result;
+    }
+
+    // Encrypt all keys into one buffer, then read all values from
+    // one snapshot
+    encrypt_key = encrypt_keys;
+    for (size_t i = 0; i < count; ++i)
+    {
+        values[i].dbkey = items[i].key;
+        values[i].dbkeylen = items[i].keylen;
+        if (items[i].result != CRYPTODB_SUCCESS || cryptodb->disable_keys_encryption)
+            continue;
+
+        encrypt_key_len = _cryptodb_encrypt_key_len(cryptodb, items[i].keylen);
+        items[i].result = _cryptodb_encrypt_key_to(cryptodb, keys,
+                                                   items[i].key, items[i].keylen,
+                                                   encrypt_key, encrypt_key_len);
+        values[i].dbkey = encrypt_key;
+        values[i].dbkeylen = encrypt_key_len;
+        encrypt_key += encrypt_key_len;
+    }
+
+    if (snapshot == NULL)
+    {
+        own_snapshot = leveldb_create_snapshot(cryptodb->db);
+        snapshot = own_snapshot;
+    }
+    leveldb_readoptions_set_fill_cache(roptions, 1);
+    leveldb_readoptions_set_verify_checksums(roptions, 1);
+    leveldb_readoptions_set_snapshot(roptions, snapshot);
+
+    // Values are read and decoded by windows, so they are still in the
+    // CPU cache when they are decoded
+    for (size_t first = 0, last = 0; first < count; first = last)
+    {
+        total = 0;
+        for (last = first; last < count && total < CRYPTODB_MULTI_GET_WINDOW_LEN; ++last)
+        {
+            if (items[last].result != CRYPTODB_SUCCESS)
+                continue;
+
+            values[last].str = leveldb_get(cryptodb->db, roptions,
+                                           values[last].dbkey, values[last].dbkeylen,
+                                           &values[last].vallen, &err);
+            if (err)
+            {
+                items[last].result = _leveldb_err_to_cryptodb_err(err);
+                leveldb_free(err);
+                err = NULL;
+            }
+            if (items[last].result == CRYPTODB_ERR_OK && (!values[last].str || !values[last].vallen))
+                items[last].result = CRYPTODB_ERR_FAIL;
+            if (items[last].result != CRYPTODB_ERR_OK && values[last].str)
+            {
+                leveldb_free(values[last].str);
+                values[last].str = NULL;
+            }
+            if (values[last].str)
+                total += values[last].vallen;
+        }
+
+        // Split the window into tasks with about the same size of values
+        tasks_count = _cryptodb_pool_threads((_cryptodb_pool_t *)cryptodb->pool) + 1;
+        if (tasks_count > total / CRYPTODB_MULTI_GET_TASK_LEN)
+            tasks_count = total / CRYPTODB_MULTI_GET_TASK_LEN;
+        if (!tasks_count)
+            tasks_count = 1;
+        done = 0;
+        for (size_t t = 0, i = first; t < tasks_count; ++t)
+        {
+            tasks[t].cryptodb = cryptodb;
+            tasks[t].keys = keys;
+            tasks[t].items = items;
+            tasks[t].values = values;
+            tasks[t].first = i;
+            while (i < last && (t == tasks_count - 1 || done < total / tasks_count * (t + 1)))
+            {
+                if (values[i].str)
+                    done += values[i].vallen;
+                ++i;
+            }
+            tasks[t].last = i;
+        }
+
+        _cryptodb_pool_run((_cryptodb_pool_t *)cryptodb->pool,
+                           _cryptodb_multi_get_task,
+                           tasks,
+                           sizeof(_cryptodb_multi_get_task_t),
+                           tasks_count);
+    }
+
+    if (own_snapshot)
+        leveldb_release_snapshot(cryptodb->db, own_snapshot);
+    leveldb_readoptions_destroy(roptions);
+
+    _cryptodb_keys_release(cryptodb);
+    _cryptodb_scratch_free(encrypt_keys, scratch_keys, encrypt_keys_len);
+    free(values);
+
+    for (size_t i = 0; i < count; ++i)
+        if (items[i].result == CRYPTODB_ERR_OK)
+            ++gets;
+    _cryptodb_stats_add(&((cryptodb_stats_t *)cryptodb->stats)->gets, gets);
+
+    return CRYPTODB_SUCCESS;
+}
+
+#define CRYPTODB_MIGRATE_BATCH_LEN (4 * 1024 * 1024)
+
+/**
+ * Copies all entries of "src" to "dst" as they are, by write batches of
+ * about CRYPTODB_MIGRATE_BATCH_LEN bytes. Only the last batch is synced.
+ */
+static int _cryptodb_migrate_copy(leveldb_t *src, leveldb_t *dst)
+{
+    int result = CRYPTODB_SUCCESS;
+
+    char *err = NULL;
+    size_t batch_len = 0;
+    leveldb_iterator_t *it = NULL;
+    leveldb_writebatch_t *batch = NULL;
+    leveldb_readoptions_t *roptions = NULL;
+    leveldb_writeoptions_t *woptions = NULL;
+
+    roptions = leveldb_readoptions_create();
+    woptions = leveldb_writeoptions_create();
+    batch    = leveldb_writebatch_create();
+    if (!roptions || !woptions || !batch)
+    {
+        result = CRYPTODB_ERR_ALLOCATE_MEM;
+        goto exit;
+    }
+    leveldb_readoptions_set_fill_cache(roptions, 0);
+    leveldb_readoptions_set_verify_checksums(roptions, 1);
+
+    it = leveldb_create_iterator(src, roptions);
+    if (it == NULL)
+    {
+        result = CRYPTODB_ERR_ALLOCATE_MEM;
+        goto exit;
+    }
+
+    for (leveldb_iter_seek_to_first(it); leveldb_iter_valid(it); leveldb_iter_next(it))
+    {
+        size_t keylen = 0, vallen = 0;
+        const char *key = leveldb_iter_key(it, &keylen);
+        const char *val = leveldb_iter_value(it, &vallen);
+
+        leveldb_writebatch_put(batch, key, keylen, val, vallen);
+        batch_len += keylen + vallen;
+        if (batch_len >= CRYPTODB_MIGRATE_BATCH_LEN)
+        {
+            leveldb_writeoptions_set_sync(woptions, 0);
+            leveldb_write(dst, woptions, batch, &err);
+            if (err)
+                break;
+            leveldb_writebatch_clear(batch);
+            batch_len = 0;
+        }
+    }
+    if (err == NULL)
+        leveldb_iter_get_error(it, &err);
+    if (err == NULL)
+    {
+        leveldb_writeoptions_set_sync(woptions, 1);
+        leveldb_write(dst, woptions, batch, &err);
+    }
+    if (err)
+    {
+        result = _leveldb_err_to_cryptodb_err(err);
+        if (result == CRYPTODB_ERR_OK)
+            result = CRYPTODB_ERR_FAIL;
+        leveldb_free(err);
+    }
+
+exit:
+    if (it)
+        leveldb_iter_destroy(it);
+    if (batch)
+        leveldb_writebatch_destroy(batch);
+    if (roptions)
+        leveldb_readoptions_destroy(roptions);
+    if (woptions)
+        leveldb_writeoptions_destroy(woptions);
+
+    return result;
+}
+
+/**
+ * Bulk-load sessions, see cryptodb_bulk_begin(). Entries are copied one
+ * after another into one buffer: _cryptodb_bulk_entry_t header, value
+ * (NULL-terminated for strings) and key, aligned to 8 bytes.
+ */
+#define CRYPTODB_BULK_WINDOW_LEN (4 * 1024 * 1024)
+#define CRYPTODB_BULK_TASK_LEN   (256 * 1024)
+#define CRYPTODB_BULK_MAX_TASKS  (CRYPTODB_BULK_WINDOW_LEN / CRYPTODB_BULK_TASK_LEN + 2)
+#define CRYPTODB_BULK_ALIGN(len) (((len) + 7) & ~(size_t)7)
+
+typedef struct {
+    size_t keylen;
+    size_t vallen;
+    cryptodb_val_t valtype;
+} _cryptodb_bulk_entry_t;
+
+#define CRYPTODB_BULK_ENTRY_HEADER_LEN CRYPTODB_BULK_ALIGN(sizeof(_cryptodb_bulk_entry_t))
+
+typedef struct {
+    uint8_t *buf; // Buffered entries
+    size_t len;
+    size_t capacity;
+    size_t count;
+    char *path; // Database folder
+    char *staging_path; // "<path>.bulk"
+} _cryptodb_bulk_state_t;
+
+typedef struct {
+    cryptodb_t *cryptodb;
+    const uint8_t *begin;
+    const uint8_t *end;
+    leveldb_writebatch_t *batch;
+    size_t puts;
+    int result;
+} _cryptodb_bulk_task_t;
+
+static void _cryptodb_bulk_task(void *arg)
+{
+    _cryptodb_bulk_task_t *task = (_cryptodb_bulk_task_t *)arg;
+    const uint8_t *entry = task->begin;
+
+    while (entry < task->end && task->result == CRYPTODB_SUCCESS)
+    {
+        _cryptodb_bulk_entry_t header;
+        uint8_t *val = (uint8_t *)entry + CRYPTODB_BULK_ENTRY_HEADER_LEN;
+        cryptodb_blob_t blob;
+
+        memcpy(&header, entry, sizeof(_cryptodb_bulk_entry_t));
+        blob.data = val;
+        blob.len = header.vallen;
+        task->result = _cryptodb_put(task->cryptodb, task->batch,
+                                     (const char *)val + header.vallen, header.keylen,
+                                     header.valtype,
+                                     header.valtype == CRYPTODB_VAL_BLOB ? (void *)&blob : val);
+        if (task->result == CRYPTODB_SUCCESS)
+            ++task->puts;
+        entry += CRYPTODB_BULK_ALIGN(CRYPTODB_BULK_ENTRY_HEADER_LEN + header.vallen + header.keylen);
+    }
+}
+
+/**
+ * Encrypts the buffered entries by the worker pool and the calling thread,
+ * and writes them in the order they were added
+ */
+static int _cryptodb_bulk_flush(cryptodb_bulk_t *bulk)
+{
+    int result = CRYPTODB_SUCCESS;
+
+    char *err = NULL;
+    size_t tasks_count = 0;
+    const uint8_t *entry = NULL, *end = NULL;
+    _cryptodb_bulk_task_t tasks[CRYPTODB_BULK_MAX_TASKS];
+    _cryptodb_bulk_state_t *state = (_cryptodb_bulk_state_t *)bulk->state;
+
+    if (!state->count)
+        return CRYPTODB_SUCCESS;
+
+    // Split the window into tasks of about CRYPTODB_BULK_TASK_LEN bytes
+    memset(tasks, 0, sizeof(tasks));
+    entry = state->buf;
+    end = state->buf + state->len;
+    while (entry < end)
+    {
+        _cryptodb_bulk_task_t *task = &tasks[tasks_count++];
+
+        task->cryptodb = &bulk->cryptodb;
+        task->begin = entry;
+        while (entry < end &&
+               (tasks_count == CRYPTODB_BULK_MAX_TASKS ||
+                (size_t)(entry - task->begin) < CRYPTODB_BULK_TASK_LEN))
+        {
+            _cryptodb_bulk_entry_t header;
+
+            memcpy(&header, entry, sizeof(_cryptodb_bulk_entry_t));
+            entry += CRYPTODB_BULK_ALIGN(CRYPTODB_BULK_ENTRY_HEADER_LEN + header.vallen + header.keylen);
+        }
+        task->end = entry;
+        task->batch = leveldb_writebatch_create();
+        if (task->batch == NULL)
+            result = CRYPTODB_ERR_ALLOCATE_MEM;
+    }
+
+    if (result == CRYPTODB_SUCCESS)
+        _cryptodb_pool_run((_cryptodb_pool_t *)bulk->cryptodb.pool,
+                           _cryptodb_bulk_task,
+                           tasks,
+                           sizeof(_cryptodb_bulk_task_t),
+                           tasks_count);
+
+    for (size_t t = 0; t < tasks_count; ++t)
+    {
+        if (result == CRYPTODB_SUCCESS)
+            result = tasks[t].result;
+        if (result == CRYPTODB_SUCCESS)
+        {
+            leveldb_write(bulk->cryptodb.db, bulk->cryptodb.woptions, tasks[t].batch, &err);
+            if (err)
+            {
+                result = _leveldb_err_to_cryptodb_err(err);
+                if (result == CRYPTODB_ERR_OK)
+                    result = CRYPTODB_ERR_FAIL;
+                leveldb_free(err);
+                err = NULL;
+            }
+        }
+        if (result == CRYPTODB_SUCCESS)
+        {
+            bulk->puts += tasks[t].puts;
+            _cryptodb_stats_add(&((cryptodb_stats_t *)bulk->cryptodb.stats)->puts, tasks[t].puts);
+        }
+        if (tasks[t].batch)
+            leveldb_writebatch_destroy(tasks[t].batch);
+    }
+
+    mbedtls_platform_zeroize(state->buf, state->len);
+    state->len = 0;
+    state->count = 0;
+
+    return result;
+}
+
+/**
+ * Syncs the folder that contains "path", so its rename survives a crash.
+ * Some file systems can't sync folders, it's not an error then.
+ */
+static void _cryptodb_sync_parent_dir(const char *path)
+{
+    int fd = -1;
+    size_t dir_len = 0;
+    char *dir_path = NULL;
+    const char *sep = strrchr(path, '/');
+
+    if (sep == NULL)
+    {
+        path = ".";
+        dir_len = 1;
+    }
+    else
+        dir_len = sep == path ? 1 : (size_t)(sep - path);
+
+    dir_path = (char *)malloc(dir_len + 1);
+    if (dir_path == NULL)
+        return;
+    memcpy(dir_path, path, dir_len);
+    dir_path[dir_len] = '\0';
+
+    fd = open(dir_path, O_RDONLY);
+    free(dir_path);
+    if (fd < 0)
+        return;
+    (void)fsync(fd);
+    close(fd);
+}
+
+/**
+ * Closes the staging database, discards it unless it was moved to the
+ * database folder, and frees the session
+ */
+static void _cryptodb_bulk_end(cryptodb_bulk_t *bulk, bool discard)
+{
+    _cryptodb_bulk_state_t *state = (_cryptodb_bulk_state_t *)bulk->state;
+
+    cryptodb_close(&bulk->cryptodb);
+    if (state)
+    {
+        if (discard && state->staging_path)
+            cryptodb_destroy(state->staging_path, NULL);
+        if (state->buf)
+        {
+            mbedtls_platform_zeroize(state->buf, state->len);
+            free(state->buf);
+        }
+        free(state->path);
+        free(state->staging_path);
+        free(state);
+    }
+    memset(bulk, 0, sizeof(cryptodb_bulk_t));
+}
+
+/**
+ * PUBLIC API
+ */
+
+const char * cryptodb_err_to_str(cryptodb_err_t err)
+{
+    switch (err)
+    {
+    default:
+        break;
+    case CRYPTODB_ERR_OK:
+        return "Success";
+    case CRYPTODB_ERR_NULL_POINTER:
+        return "NULL pointer";
+    case CRYPTODB_ERR_ALLOCATE_MEM:
+        return "Failed to allocate enough memory";
+    case CRYPTODB_ERR_WRONG_ARGUMENT:
+        return "Wrong argument was provided";
+    case CRYPTODB_ERR_ENCRYPTION_FAIL:
+        return "Encryption operation was failed";
+    case CRYPTODB_ERR_DECRYPTION_FAIL:
+        return "Decryption operation was failed";
+    case CRYPTODB_ERR_INTEGRITY_FAIL:
+        return "Integrity check was failed";
+    case CRYPTODB_ERR_BUFFER_TOO_SMALL:
+        return "Buffer is too small for the value";
+    case CRYPTODB_ERR_MOVE_FAIL:
+        return "Failed to move the database folder";
+    case CRYPTODB_ERR_FAIL:
+        return "Fail";
+    }
+
+    return "Unknown error";
+}
+
+const char * cryptodb_val_to_str(cryptodb_val_t val)
+{
+    switch (val)
+    {
+    default:
+        break;
+    case CRYPTODB_VAL_STRING:
+        return "String";
+    case CRYPTODB_VAL_NUM_INT:
+        return "Integer number";
+    case CRYPTODB_VAL_NUM_DOUBLE:
+        return "Double-precision floating-point number";
+    case CRYPTODB_VAL_BLOB:
+        return "Binary data";
+    case CRYPTODB_VAL_NUM_INT64:
+        return "64-bit integer number";
+    case CRYPTODB_VAL_NUM_UINT64:
+        return "64-bit unsigned integer number";
+    }
+
+    return "Unknown value type";
+}
+
+int cryptodb_open(const char *path,
+                  uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN],
+                  size_t uniq_data_len,
+                  cryptodb_options_t *options,
+                  cryptodb_user_kdf user_kdf,
+                  void *kdf_user_data,
+                  cryptodb_t *cryptodb)
+{
+    return _cryptodb_open(path, uniq_data, uniq_data_len, options,
+                          user_kdf, kdf_user_data, cryptodb, false);
+}
+
+int cryptodb_open_with_keys(const char *path,
+                            uint8_t encryption_key[32],
+                            uint8_t encryption_iv[16],
+                            cryptodb_options_t *options,
+                            cryptodb_t *cryptodb)
+{
+    int result = CRYPTODB_SUCCESS;
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN];
+
+    if (encryption_key == NULL || encryption_iv == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+
+    memset(uniq_data, 0, CRYPTODB_UNIQ_DATA_MAX_LEN);
+    memcpy(uniq_data, encryption_key, 32);
+    memcpy(uniq_data + 32, encryption_iv, 16);
+
+    result = _cryptodb_open(path, uniq_data, 48, options, NULL, NULL, cryptodb, true);
+
+    mbedtls_platform_zeroize(uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN);
+
+    return result;
+}
+
+void cryptodb_close(cryptodb_t *cryptodb)
+{
+    if (cryptodb)
+    {
+        // Writes the queued operations, so should be destroyed first
+        if (cryptodb->writer)
+        {
+            _cryptodb_writer_destroy(cryptodb->writer);
+            cryptodb->writer = NULL;
+        }
+        // Syncs the last writes, so should be destroyed before the database
+        if (cryptodb->syncer)
+        {
+            _cryptodb_sync_destroy(cryptodb->syncer);
+            cryptodb->syncer = NULL;
+        }
+        if (cryptodb->db)
+        {
+            leveldb_close(cryptodb->db);
+            cryptodb->db = NULL;
+        }
+        if (cryptodb->env)
+        {
+            leveldb_env_destroy(cryptodb->env);
+            cryptodb->env = NULL;
+        }
+        if (cryptodb->cmp)
+        {
+            leveldb_comparator_destroy(cryptodb->cmp);
+            cryptodb->cmp = NULL;
+        }
+        if (cryptodb->filter)
+        {
+            _cryptodb_filter_destroy(cryptodb->filter);
+            cryptodb->filter = NULL;
+        }
+        if (cryptodb->cache)
+        {
+            leveldb_cache_destroy(cryptodb->cache);
+            cryptodb->cache = NULL;
+        }
+        if (cryptodb->options)
+        {
+            leveldb_options_destroy(cryptodb->options);
+            cryptodb->options = NULL;
+        }
+        if (cryptodb->roptions)
+        {
+            leveldb_readoptions_destroy(cryptodb->roptions);
+            cryptodb->roptions = NULL;
+        }
+        if (cryptodb->woptions)
+        {
+            leveldb_writeoptions_destroy(cryptodb->woptions);
+            cryptodb->woptions = NULL;
+        }
+        if (cryptodb->keystore)
+        {
+            _cryptodb_keystore_destroy(cryptodb->keystore);
+            cryptodb->keystore = NULL;
+        }
+        if (cryptodb->stats)
+        {
+            free(cryptodb->stats);
+            cryptodb->stats = NULL;
+        }
+        if (cryptodb->pool)
+        {
+            _cryptodb_pool_destroy(cryptodb->pool);
+            cryptodb->pool = NULL;
+        }
+        cryptodb->parallel_decrypt_threshold = 0;
+        cryptodb->value_cipher = CRYPTODB_CIPHER_AES_256_CBC;
+        cryptodb->key_mode = CRYPTODB_KEY_MODE_AES_256_CBC;
+        cryptodb->keep_original_keys = 0;
+        cryptodb->durability = CRYPTODB_DURABILITY_SYNC;
+        cryptodb->compression = CRYPTODB_COMPRESSION_NONE;
+        cryptodb->compression_min_saving = 0;
+        cryptodb->uniq_data_len = 0;
+        memset(cryptodb->uniq_data, 0, CRYPTODB_UNIQ_DATA_MAX_LEN);
     }
+}
+
+int cryptodb_put(cryptodb_t *cryptodb,
+                 const char* key, size_t keylen,
+                 cryptodb_val_t valtype, void *val)
+{
+    return _cryptodb_put(cryptodb, NULL, key, keylen, valtype, val);
+}
+
+inline int cryptodb_put_string(cryptodb_t *cryptodb,
+                               const char* key, size_t keylen, const char *val)
+{
+    return cryptodb_put(cryptodb, key, keylen, CRYPTODB_VAL_STRING, (void *)val);
+}
+
+inline int cryptodb_put_integer(cryptodb_t *cryptodb,
+                                const char* key, size_t keylen, int val)
+{
+    return cryptodb_put(cryptodb, key, keylen, CRYPTODB_VAL_NUM_INT, (void *)&val);
+}
+
+inline int cryptodb_put_double(cryptodb_t *cryptodb,
+                               const char* key, size_t keylen, double val)
+{
+    return cryptodb_put(cryptodb, key, keylen, CRYPTODB_VAL_NUM_DOUBLE, (void *)&val);
+}
+
+inline int cryptodb_put_int64(cryptodb_t *cryptodb,
+                              const char* key, size_t keylen, int64_t val)
+{
+    return cryptodb_put(cryptodb, key, keylen, CRYPTODB_VAL_NUM_INT64, (void *)&val);
+}
+
+inline int cryptodb_put_uint64(cryptodb_t *cryptodb,
+                               const char* key, size_t keylen, uint64_t val)
+{
+    return cryptodb_put(cryptodb, key, keylen, CRYPTODB_VAL_NUM_UINT64, (void *)&val);
+}
+
+inline int cryptodb_put_blob(cryptodb_t *cryptodb,
+                             const char* key, size_t keylen,
+                             const void *data, size_t len)
+{
+    cryptodb_blob_t blob = { data, len };
+
+    return cryptodb_put(cryptodb, key, keylen, CRYPTODB_VAL_BLOB, (void *)&blob);
+}
+
+int cryptodb_get(cryptodb_t *cryptodb,
+                 const char* key, size_t keylen,
+                 cryptodb_val_t valtype, void *val)
+{
+    if (cryptodb == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+
+    return _cryptodb_get(cryptodb, cryptodb->roptions, key, keylen, valtype, val, NULL);
+}
+
+inline int cryptodb_get_int64(cryptodb_t *cryptodb,
+                              const char* key, size_t keylen, int64_t *val)
+{
+    return cryptodb_get(cryptodb, key, keylen, CRYPTODB_VAL_NUM_INT64, (void *)val);
+}
+
+inline int cryptodb_get_uint64(cryptodb_t *cryptodb,
+                               const char* key, size_t keylen, uint64_t *val)
+{
+    return cryptodb_get(cryptodb, key, keylen, CRYPTODB_VAL_NUM_UINT64, (void *)val);
+}
+
+int cryptodb_get_buf(cryptodb_t *cryptodb,
+                     const char* key, size_t keylen,
+                     void *buf, size_t buf_cap,
+                     size_t *out_len, cryptodb_val_t *type)
+{
+    if (cryptodb == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+
+    return _cryptodb_get_buf(cryptodb, cryptodb->roptions, key, keylen,
+                             buf, buf_cap, out_len, type);
+}
+
+int cryptodb_multi_get(cryptodb_t *cryptodb,
+                       cryptodb_get_item_t *items,
+                       size_t count)
+{
+    return _cryptodb_multi_get(cryptodb, NULL, items, count);
+}
+
+int cryptodb_snapshot_create(cryptodb_t *cryptodb,
+                             cryptodb_snapshot_t *snapshot)
+{
+    leveldb_readoptions_t *roptions = NULL;
+
+    if (cryptodb == NULL || snapshot == NULL || cryptodb->db == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+
+    memset(snapshot, 0, sizeof(cryptodb_snapshot_t));
+
+    roptions = leveldb_readoptions_create();
+    if (roptions == NULL)
+        return CRYPTODB_ERR_ALLOCATE_MEM;
+
+    snapshot->cryptodb = cryptodb;
+    snapshot->snapshot = (void *)leveldb_create_snapshot(cryptodb->db);
+    snapshot->roptions = roptions;
+
+    leveldb_readoptions_set_fill_cache(roptions, 1);
+    leveldb_readoptions_set_verify_checksums(roptions, 1);
+    leveldb_readoptions_set_snapshot(roptions, (const leveldb_snapshot_t *)snapshot->snapshot);
 
     return CRYPTODB_SUCCESS;
 }
 
-static int _cryptodb_open(const char *path,
-                          uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN],
-                          size_t uniq_data_len,
-                          cryptodb_options_t *options,
-                          cryptodb_user_kdf user_kdf,
-                          void *kdf_user_data,
-                          cryptodb_t *cryptodb,
-                          bool use_keys_instead_of_uniq_data)
+void cryptodb_snapshot_release(cryptodb_snapshot_t *snapshot)
 {
-    int result = CRYPTODB_SUCCESS;
+    if (snapshot == NULL)
+        return;
 
-    char *err = NULL;
-    leveldb_t *db = NULL;
-    leveldb_env_t *env = NULL;
-    leveldb_cache_t *cache = NULL;
-    leveldb_comparator_t *cmp = NULL;
-    leveldb_options_t *dboptions = NULL;
+    if (snapshot->roptions)
+    {
+        leveldb_readoptions_destroy(snapshot->roptions);
+        snapshot->roptions = NULL;
+    }
+    if (snapshot->snapshot && snapshot->cryptodb && snapshot->cryptodb->db)
+        leveldb_release_snapshot(snapshot->cryptodb->db,
+                                 (const leveldb_snapshot_t *)snapshot->snapshot);
+    snapshot->snapshot = NULL;
+    snapshot->cryptodb = NULL;
+}
+
+int cryptodb_snapshot_get(cryptodb_snapshot_t *snapshot,
+                          const char* key, size_t keylen,
+                          cryptodb_val_t valtype, void *val)
+{
+    if (snapshot == NULL || snapshot->cryptodb == NULL || snapshot->snapshot == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+
+    return _cryptodb_get(snapshot->cryptodb, snapshot->roptions, key, keylen, valtype, val, NULL);
+}
+
+int cryptodb_snapshot_get_buf(cryptodb_snapshot_t *snapshot,
+                              const char* key, size_t keylen,
+                              void *buf, size_t buf_cap,
+                              size_t *out_len, cryptodb_val_t *type)
+{
+    if (snapshot == NULL || snapshot->cryptodb == NULL || snapshot->snapshot == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+
+    return _cryptodb_get_buf(snapshot->cryptodb, snapshot->roptions, key, keylen,
+                             buf, buf_cap, out_len, type);
+}
+
+int cryptodb_snapshot_multi_get(cryptodb_snapshot_t *snapshot,
+                                cryptodb_get_item_t *items,
+                                size_t count)
+{
+    if (snapshot == NULL || snapshot->cryptodb == NULL || snapshot->snapshot == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+
+    return _cryptodb_multi_get(snapshot->cryptodb,
+                               (const leveldb_snapshot_t *)snapshot->snapshot,
+                               items, count);
+}
+
+int cryptodb_iterator_create(cryptodb_t *cryptodb,
+                             cryptodb_iterator_options_t *options,
+                             cryptodb_iterator_t *iterator)
+{
+    int result = CRYPTODB_SUCCESS;
     leveldb_readoptions_t *roptions = NULL;
-    leveldb_writeoptions_t *woptions = NULL;
 
-    if (path == NULL || cryptodb == NULL || uniq_data == NULL)
+    if (cryptodb == NULL || iterator == NULL ||
+        cryptodb->db == NULL || cryptodb->keystore == NULL ||
+        cryptodb->stats == NULL)
         return CRYPTODB_ERR_NULL_POINTER;
-    if (!strlen(path) || !uniq_data_len)
+
+    // Encrypted keys (and key tokens) aren't in the order of the keys
+    if (options && !cryptodb->disable_keys_encryption &&
+        ((options->lower_bound && options->lower_bound_len) ||
+         (options->upper_bound && options->upper_bound_len) ||
+         (options->prefix && options->prefix_len)))
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+    if (options && options->snapshot &&
+        (options->snapshot->cryptodb != cryptodb || options->snapshot->snapshot == NULL))
         return CRYPTODB_ERR_WRONG_ARGUMENT;
 
-    cryptodb_close(cryptodb);
+    memset(iterator, 0, sizeof(cryptodb_iterator_t));
 
-    dboptions = leveldb_options_create();
-    roptions  = leveldb_readoptions_create();
-    env       = leveldb_create_default_env();
-    woptions  = leveldb_writeoptions_create();
-    cmp       = leveldb_comparator_create(NULL,
-                                _cryptodb_comparator_destroy,
-                                _cryptodb_comparator_compare,
-                                _cryptodb_comparator_name);
-    cache     = leveldb_cache_create_lru(options ?
-                                options->cache_capacity :
-                                CRYPTODB_OPT_DEFAULT_CACHE_SIZE);
-    if (!dboptions || !roptions || !env || !woptions || !cache || !cmp)
+    iterator->range = _cryptodb_iterator_range_create(options, &result);
+    if (result != CRYPTODB_SUCCESS)
+        return result;
+
+    roptions = leveldb_readoptions_create();
+    if (roptions == NULL)
     {
-        if (env)
-            leveldb_env_destroy(env);
-        if (cache)
-            leveldb_cache_destroy(cache);
-        if (cmp)
-            leveldb_comparator_destroy(cmp);
-        if (dboptions)
-            leveldb_options_destroy(dboptions);
-        if (roptions)
-            leveldb_readoptions_destroy(roptions);
-        if (woptions)
-            leveldb_writeoptions_destroy(woptions);
+        free(iterator->range);
+        iterator->range = NULL;
         return CRYPTODB_ERR_ALLOCATE_MEM;
     }
+    leveldb_readoptions_set_fill_cache(roptions, options && options->fill_cache);
+    leveldb_readoptions_set_verify_checksums(roptions, 1);
+    if (options && options->snapshot)
+        leveldb_readoptions_set_snapshot(roptions,
+                                         (const leveldb_snapshot_t *)options->snapshot->snapshot);
 
-    leveldb_options_set_env(dboptions, env);
-    leveldb_options_set_cache(dboptions, cache);
-    leveldb_options_set_info_log(dboptions, NULL);
-    leveldb_options_set_comparator(dboptions, cmp);
-    leveldb_options_set_paranoid_checks(dboptions, 1);
-    leveldb_options_set_create_if_missing(dboptions, 1);
-    leveldb_options_set_compression(dboptions, leveldb_no_compression);
+    iterator->cryptodb = cryptodb;
+    iterator->roptions = roptions;
+    iterator->it = leveldb_create_iterator(cryptodb->db, roptions);
+    iterator->readahead = _cryptodb_readahead_create(options ? options->read_ahead : 0,
+                                                     sizeof(_cryptodb_iterator_slot_t),
+                                                     _cryptodb_iterator_fill,
+                                                     _cryptodb_iterator_clear,
+                                                     iterator);
+    if (iterator->it == NULL || iterator->readahead == NULL)
+    {
+        cryptodb_iterator_destroy(iterator);
+        return CRYPTODB_ERR_ALLOCATE_MEM;
+    }
 
-    leveldb_options_set_block_size(dboptions,
-                                   options ?
-                                   options->block_size :
-                                   CRYPTODB_OPT_DEFAULT_BLOCK_SIZE);
-    leveldb_options_set_max_open_files(dboptions,
-                                       options ?
-                                       options->max_open_files :
-                                       CRYPTODB_OPT_DEFAULT_MAX_FILES);
-    leveldb_options_set_max_file_size(dboptions,
-                                      options ?
-                                      options->max_file_size :
-                                      CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE);
-    leveldb_options_set_write_buffer_size(dboptions,
-                                          options ?
-                                          options->write_buffer_size :
-                                          CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE);
-    leveldb_options_set_block_restart_interval(dboptions,
-                                               options ?
-                                               options->block_restart_interval :
-                                               CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT);
+    return CRYPTODB_SUCCESS;
+}
+
+void cryptodb_iterator_destroy(cryptodb_iterator_t *iterator)
+{
+    if (iterator == NULL)
+        return;
+
+    // Uses the LevelDB iterator, so should be destroyed first
+    if (iterator->readahead)
+    {
+        _cryptodb_readahead_destroy(iterator->readahead);
+        iterator->readahead = NULL;
+    }
+    if (iterator->it)
+    {
+        leveldb_iter_destroy(iterator->it);
+        iterator->it = NULL;
+    }
+    if (iterator->roptions)
+    {
+        leveldb_readoptions_destroy(iterator->roptions);
+        iterator->roptions = NULL;
+    }
+    if (iterator->range)
+    {
+        free(iterator->range);
+        iterator->range = NULL;
+    }
+    iterator->entry = NULL;
+    iterator->cryptodb = NULL;
+}
+
+void cryptodb_iterator_seek_to_first(cryptodb_iterator_t *iterator)
+{
+    if (iterator == NULL || iterator->it == NULL || iterator->readahead == NULL)
+        return;
+
+    // The read-ahead thread is stopped before the LevelDB iterator is moved
+    _cryptodb_readahead_reset(iterator->readahead);
+    _cryptodb_iterator_position(iterator, NULL, 0);
+    iterator->entry = _cryptodb_readahead_next(iterator->readahead);
+}
+
+int cryptodb_iterator_seek(cryptodb_iterator_t *iterator,
+                           const char *key, size_t keylen)
+{
+    if (iterator == NULL || key == NULL ||
+        iterator->it == NULL || iterator->readahead == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+    if (!keylen || !iterator->cryptodb->disable_keys_encryption)
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+
+    _cryptodb_readahead_reset(iterator->readahead);
+    _cryptodb_iterator_position(iterator, key, keylen);
+    iterator->entry = _cryptodb_readahead_next(iterator->readahead);
+
+    return CRYPTODB_SUCCESS;
+}
+
+bool cryptodb_iterator_valid(cryptodb_iterator_t *iterator)
+{
+    return iterator != NULL && iterator->entry != NULL;
+}
+
+void cryptodb_iterator_next(cryptodb_iterator_t *iterator)
+{
+    if (iterator == NULL || iterator->entry == NULL)
+        return;
+
+    iterator->entry = _cryptodb_readahead_next(iterator->readahead);
+}
+
+const cryptodb_entry_t * cryptodb_iterator_entry(cryptodb_iterator_t *iterator)
+{
+    if (iterator == NULL || iterator->entry == NULL)
+        return NULL;
 
-    leveldb_writeoptions_set_sync(woptions, 1);
-    leveldb_readoptions_set_fill_cache(roptions, 1);
-    leveldb_readoptions_set_verify_checksums(roptions, 1);
+    return &((_cryptodb_iterator_slot_t *)iterator->entry)->entry;
+}
 
-    db = leveldb_open(dboptions, path, &err);
-    if ((db == NULL) || err)
+int cryptodb_iterator_status(cryptodb_iterator_t *iterator)
+{
+    char *err = NULL;
+    int result = CRYPTODB_SUCCESS;
+
+    if (iterator == NULL || iterator->it == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+    // While the iterator is valid the read-ahead thread may use the
+    // LevelDB iterator, and there is no error anyway
+    if (iterator->entry != NULL)
+        return CRYPTODB_SUCCESS;
+
+    leveldb_iter_get_error(iterator->it, &err);
+    if (err)
     {
-        if (err)
-        {
-            result = _leveldb_err_to_cryptodb_err(err);
-            leveldb_free(err);
-        }
-        if (result == CRYPTODB_ERR_OK && !db)
-            result = CRYPTODB_ERR_FAIL;
-        if (result != CRYPTODB_ERR_OK)
-        {
-            if (db)
-                leveldb_close(db);
-            leveldb_env_destroy(env);
-            leveldb_cache_destroy(cache);
-            leveldb_comparator_destroy(cmp);
-            leveldb_options_destroy(dboptions);
-            leveldb_readoptions_destroy(roptions);
-            leveldb_writeoptions_destroy(woptions);
-        }
+        result = _leveldb_err_to_cryptodb_err(err);
+        leveldb_free(err);
     }
 
-    cryptodb->db = db;
-    cryptodb->env = env;
-    cryptodb->cmp = cmp;
-    cryptodb->cache = cache;
-    cryptodb->options = dboptions;
-    cryptodb->roptions = roptions;
-    cryptodb->woptions = woptions;
-    cryptodb->user_kdf = user_kdf;
-    cryptodb->kdf_user_data = kdf_user_data;
-    cryptodb->uniq_data_len = uniq_data_len;
-    cryptodb->use_keys_instead_of_uniq_data = use_keys_instead_of_uniq_data;
-    cryptodb->disable_keys_encryption = options ?
-                                        options->disable_keys_encryption : 0;
-    memcpy(cryptodb->uniq_data, uniq_data, uniq_data_len);
+    return result;
+}
 
-    return result; 
+int cryptodb_delete(cryptodb_t *cryptodb,
+                    const char* key, size_t keylen)
+{
+    return _cryptodb_delete(cryptodb, NULL, key, keylen);
 }
 
-/**
- * PUBLIC API
- */
+int cryptodb_batch_create(cryptodb_t *cryptodb,
+                          cryptodb_batch_t *batch)
+{
+    if (cryptodb == NULL || batch == NULL || cryptodb->db == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
 
-const char * cryptodb_err_to_str(cryptodb_err_t err)
+    memset(batch, 0, sizeof(cryptodb_batch_t));
+
+    batch->batch = leveldb_writebatch_create();
+    if (batch->batch == NULL)
+        return CRYPTODB_ERR_ALLOCATE_MEM;
+    batch->cryptodb = cryptodb;
+
+    return CRYPTODB_SUCCESS;
+}
+
+void cryptodb_batch_destroy(cryptodb_batch_t *batch)
 {
-    switch (err)
+    if (batch)
     {
-    default:
-        break;
-    case CRYPTODB_ERR_OK:
-        return "Success";
-    case CRYPTODB_ERR_NULL_POINTER:
-        return "NULL pointer";
-    case CRYPTODB_ERR_ALLOCATE_MEM:
-        return "Failed to allocate enough memory";
-    case CRYPTODB_ERR_WRONG_ARGUMENT:
-        return "Wrong argument was provided";
-    case CRYPTODB_ERR_ENCRYPTION_FAIL:
-        return "Encryption operation was failed";
-    case CRYPTODB_ERR_DECRYPTION_FAIL:
-        return "Decryption operation was failed";
-    case CRYPTODB_ERR_FAIL:
-        return "Fail";
+        if (batch->batch)
+            leveldb_writebatch_destroy(batch->batch);
+        memset(batch, 0, sizeof(cryptodb_batch_t));
     }
+}
 
-    return "Unknown error";
+int cryptodb_batch_put(cryptodb_batch_t *batch,
+                       const char* key, size_t keylen,
+                       cryptodb_val_t valtype, void *val)
+{
+    int result = CRYPTODB_SUCCESS;
+
+    if (batch == NULL || batch->batch == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+
+    result = _cryptodb_put(batch->cryptodb, batch->batch, key, keylen, valtype, val);
+    if (result == CRYPTODB_SUCCESS)
+        ++batch->puts;
+
+    return result;
 }
 
-const char * cryptodb_val_to_str(cryptodb_val_t val)
+inline int cryptodb_batch_put_string(cryptodb_batch_t *batch,
+                                     const char* key, size_t keylen, const char *val)
 {
-    switch (val)
-    {
-    default:
-        break;
-    case CRYPTODB_VAL_STRING:
-        return "String";
-    case CRYPTODB_VAL_NUM_INT:
-        return "Integer number";
-    case CRYPTODB_VAL_NUM_DOUBLE:
-        return "Double-precision floating-point number";
-    }
+    return cryptodb_batch_put(batch, key, keylen, CRYPTODB_VAL_STRING, (void *)val);
+}
 
-    return "Unknown value type";
+inline int cryptodb_batch_put_integer(cryptodb_batch_t *batch,
+                                      const char* key, size_t keylen, int val)
+{
+    return cryptodb_batch_put(batch, key, keylen, CRYPTODB_VAL_NUM_INT, (void *)&val);
 }
 
-int cryptodb_open(const char *path,
-                  uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN],
-                  size_t uniq_data_len,
-                  cryptodb_options_t *options,
-                  cryptodb_user_kdf user_kdf,
-                  void *kdf_user_data,
-                  cryptodb_t *cryptodb)
+inline int cryptodb_batch_put_double(cryptodb_batch_t *batch,
+                                     const char* key, size_t keylen, double val)
 {
-    return _cryptodb_open(path, uniq_data, uniq_data_len, options,
-                          user_kdf, kdf_user_data, cryptodb, false);
+    return cryptodb_batch_put(batch, key, keylen, CRYPTODB_VAL_NUM_DOUBLE, (void *)&val);
 }
 
-int cryptodb_open_with_keys(const char *path,
-                            uint8_t encryption_key[32],
-                            uint8_t encryption_iv[16],
-                            cryptodb_options_t *options,
-                            cryptodb_t *cryptodb)
+inline int cryptodb_batch_put_int64(cryptodb_batch_t *batch,
+                                    const char* key, size_t keylen, int64_t val)
 {
-    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN];
+    return cryptodb_batch_put(batch, key, keylen, CRYPTODB_VAL_NUM_INT64, (void *)&val);
+}
 
-    if (encryption_key == NULL || encryption_iv == NULL)
+inline int cryptodb_batch_put_uint64(cryptodb_batch_t *batch,
+                                     const char* key, size_t keylen, uint64_t val)
+{
+    return cryptodb_batch_put(batch, key, keylen, CRYPTODB_VAL_NUM_UINT64, (void *)&val);
+}
+
+inline int cryptodb_batch_put_blob(cryptodb_batch_t *batch,
+                                   const char* key, size_t keylen,
+                                   const void *data, size_t len)
+{
+    cryptodb_blob_t blob = { data, len };
+
+    return cryptodb_batch_put(batch, key, keylen, CRYPTODB_VAL_BLOB, (void *)&blob);
+}
+
+int cryptodb_batch_delete(cryptodb_batch_t *batch,
+                          const char* key, size_t keylen)
+{
+    int result = CRYPTODB_SUCCESS;
+
+    if (batch == NULL || batch->batch == NULL)
         return CRYPTODB_ERR_NULL_POINTER;
 
-    memset(uniq_data, 0, CRYPTODB_UNIQ_DATA_MAX_LEN);
-    memcpy(uniq_data, encryption_key, 32);
-    memcpy(uniq_data + 32, encryption_iv, 16);
+    result = _cryptodb_delete(batch->cryptodb, batch->batch, key, keylen);
+    if (result == CRYPTODB_SUCCESS)
+        ++batch->deletes;
 
-    return _cryptodb_open(path, uniq_data, 48, options, NULL, NULL, cryptodb, true);
+    return result;
 }
 
-void cryptodb_close(cryptodb_t *cryptodb)
+void cryptodb_batch_clear(cryptodb_batch_t *batch)
 {
-    if (cryptodb)
+    if (batch && batch->batch)
     {
-        if (cryptodb->db)
-        {
-            leveldb_close(cryptodb->db);
-            cryptodb->db = NULL;
-        }
-        if (cryptodb->env)
-        {
-            leveldb_env_destroy(cryptodb->env);
-            cryptodb->env = NULL;
-        }
-        if (cryptodb->cmp)
-        {
-            leveldb_comparator_destroy(cryptodb->cmp);
-            cryptodb->cmp = NULL;
-        }
-        if (cryptodb->cache)
-        {
-            leveldb_cache_destroy(cryptodb->cache);
-            cryptodb->cache = NULL;
-        }
-        if (cryptodb->options)
-        {
-            leveldb_options_destroy(cryptodb->options);
-            cryptodb->options = NULL;
-        }
-        if (cryptodb->roptions)
-        {
-            leveldb_readoptions_destroy(cryptodb->roptions);
-            cryptodb->roptions = NULL;
-        }
-        if (cryptodb->woptions)
-        {
-            leveldb_writeoptions_destroy(cryptodb->woptions);
-            cryptodb->woptions = NULL;
-        }
-        cryptodb->uniq_data_len = 0;
-        memset(cryptodb->uniq_data, 0, CRYPTODB_UNIQ_DATA_MAX_LEN);
+        leveldb_writebatch_clear(batch->batch);
+        batch->puts = 0;
+        batch->deletes = 0;
     }
 }
 
-int cryptodb_put(cryptodb_t *cryptodb,
-                 const char* key, size_t keylen,
-                 cryptodb_val_t valtype, void *val)
+int cryptodb_batch_commit(cryptodb_batch_t *batch)
 {
-    uint8_t encryption_key[32] = {0}, encryption_iv[16] = {0};
-    int result = CRYPTODB_SUCCESS, encrypt_len = 0, encrypt_key_len = 0;
-    char *err = NULL, *cjson = NULL, *encrypt = NULL, *encrypt_key = NULL;
+    int result = CRYPTODB_SUCCESS;
+    cryptodb_t *cryptodb = NULL;
 
-    if (cryptodb == NULL || key == NULL || val == NULL ||
-        cryptodb->db == NULL || cryptodb->woptions == NULL)
+    if (batch == NULL || batch->batch == NULL || batch->cryptodb == NULL)
         return CRYPTODB_ERR_NULL_POINTER;
-    if (!keylen)
-        return CRYPTODB_ERR_WRONG_ARGUMENT;
 
-    switch (valtype)
-    {
-    default:
+    cryptodb = batch->cryptodb;
+    if (cryptodb->db == NULL || cryptodb->woptions == NULL || cryptodb->stats == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+
+    if (!batch->puts && !batch->deletes)
+        return CRYPTODB_SUCCESS;
+
+    result = _cryptodb_write_batch(cryptodb, batch->batch, batch->puts, batch->deletes);
+    if (result != CRYPTODB_SUCCESS)
+        return result;
+
+    cryptodb_batch_clear(batch);
+
+    return CRYPTODB_SUCCESS;
+}
+
+int cryptodb_bulk_begin(const char *path,
+                        uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN],
+                        size_t uniq_data_len,
+                        cryptodb_options_t *options,
+                        cryptodb_user_kdf user_kdf,
+                        void *kdf_user_data,
+                        cryptodb_bulk_t *bulk)
+{
+    int result = CRYPTODB_SUCCESS;
+
+    FILE *current = NULL;
+    size_t path_len = 0;
+    char *current_path = NULL;
+    cryptodb_options_t bulk_options;
+    _cryptodb_bulk_state_t *state = NULL;
+
+    if (path == NULL || uniq_data == NULL || bulk == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+    path_len = strlen(path);
+    while (path_len > 1 && (path[path_len - 1] == '/' || path[path_len - 1] == '\\'))
+        --path_len;
+    if (!path_len || !uniq_data_len)
         return CRYPTODB_ERR_WRONG_ARGUMENT;
-    case CRYPTODB_VAL_STRING:
-    case CRYPTODB_VAL_NUM_INT:
-    case CRYPTODB_VAL_NUM_DOUBLE:
-        cjson = _cryptodb_val_to_json(valtype, val);
-        if (cjson == NULL)
-            return CRYPTODB_ERR_FAIL;
-        break;
-    }
 
-    if (cryptodb->user_kdf)
-        result = cryptodb->user_kdf(cryptodb,
-                                    true,
-                                    encryption_key,
-                                    encryption_iv,
-                                    cryptodb->kdf_user_data);
+    memset(bulk, 0, sizeof(cryptodb_bulk_t));
+
+    if (options)
+        memcpy(&bulk_options, options, sizeof(cryptodb_options_t));
     else
-        result = _cryptodb_get_encryption_key_iv(cryptodb,
-                                                 true,
-                                                 encryption_key,
-                                                 encryption_iv);
-    if (result != CRYPTODB_ERR_OK)
     {
-        cJSON_free(cjson);
-        return result;
+        memset(&bulk_options, 0, sizeof(cryptodb_options_t));
+        bulk_options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+        bulk_options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+        bulk_options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+        bulk_options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+        bulk_options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+        bulk_options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
     }
+    if (bulk_options.write_buffer_size < CRYPTODB_BULK_WR_BUF_SIZE)
+        bulk_options.write_buffer_size = CRYPTODB_BULK_WR_BUF_SIZE;
+    if (bulk_options.max_file_size < CRYPTODB_BULK_MAX_FILE_SIZE)
+        bulk_options.max_file_size = CRYPTODB_BULK_MAX_FILE_SIZE;
+    // Plain synced writes don't start a sync scheduler for the staging
+    // database. They are made unsynced once it's opened, see below, and
+    // cryptodb_bulk_commit() syncs the session with its last write.
+    bulk_options.durability = CRYPTODB_DURABILITY_SYNC;
 
-    encrypt_len = strlen((const char *)cjson) + 1;
-    while (encrypt_len % CRYPTODB_AES_BLOCK_LEN != 0)
-        ++encrypt_len;
+    state = (_cryptodb_bulk_state_t *)calloc(1, sizeof(_cryptodb_bulk_state_t));
+    if (state == NULL)
+        return CRYPTODB_ERR_ALLOCATE_MEM;
+    bulk->state = state;
 
-    encrypt = (char *)calloc(encrypt_len, sizeof(char));
-    if (encrypt == NULL)
+    state->path = (char *)malloc(path_len + 1);
+    state->staging_path = (char *)malloc(path_len + sizeof(".bulk"));
+    current_path = (char *)malloc(path_len + sizeof("/CURRENT"));
+    if (!state->path || !state->staging_path || !current_path)
     {
-        cJSON_free(cjson);
+        free(current_path);
+        _cryptodb_bulk_end(bulk, false);
         return CRYPTODB_ERR_ALLOCATE_MEM;
     }
-    memcpy(encrypt, cjson, strlen((const char *)cjson) + 1);
-    cJSON_free(cjson);
+    memcpy(state->path, path, path_len);
+    state->path[path_len] = '\0';
+    memcpy(state->staging_path, path, path_len);
+    memcpy(state->staging_path + path_len, ".bulk", sizeof(".bulk"));
+    memcpy(current_path, path, path_len);
+    memcpy(current_path + path_len, "/CURRENT", sizeof("/CURRENT"));
 
-    result = _cryptodb_aes_256_cbc(encrypt, encrypt,
-                                   encrypt_len,
-                                   true,
-                                   encryption_key,
-                                   encryption_iv);
-    if (result != CRYPTODB_ERR_OK)
+    // Only a new database can be loaded
+    current = fopen(current_path, "rb");
+    free(current_path);
+    if (current)
+    {
+        fclose(current);
+        _cryptodb_bulk_end(bulk, false);
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+    }
+
+    // Leftover of an interrupted load
+    result = cryptodb_destroy(state->staging_path, NULL);
+    if (result == CRYPTODB_SUCCESS)
+        result = _cryptodb_open(state->staging_path, uniq_data, uniq_data_len, &bulk_options,
+                                user_kdf, kdf_user_data, &bulk->cryptodb, false);
+    if (result != CRYPTODB_SUCCESS)
+    {
+        _cryptodb_bulk_end(bulk, true);
         return result;
+    }
+    leveldb_writeoptions_set_sync((leveldb_writeoptions_t *)bulk->cryptodb.woptions, 0);
 
-    if (!cryptodb->disable_keys_encryption)
+    return CRYPTODB_SUCCESS;
+}
+
+int cryptodb_bulk_put(cryptodb_bulk_t *bulk,
+                      const char* key, size_t keylen,
+                      cryptodb_val_t valtype, void *val)
+{
+    uint8_t *entry = NULL;
+    size_t vallen = 0, entry_len = 0;
+    const void *data = val;
+    _cryptodb_bulk_entry_t header;
+    _cryptodb_bulk_state_t *state = NULL;
+
+    if (bulk == NULL || bulk->state == NULL || bulk->cryptodb.db == NULL ||
+        key == NULL || val == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+    if (!keylen)
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+
+    switch (valtype)
+    {
+    default:
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+    case CRYPTODB_VAL_STRING:
+        vallen = _cryptodb_record_payload_len(valtype, val) + 1;
+        break;
+    case CRYPTODB_VAL_NUM_INT:
+    case CRYPTODB_VAL_NUM_DOUBLE:
+    case CRYPTODB_VAL_NUM_INT64:
+    case CRYPTODB_VAL_NUM_UINT64:
+        vallen = _cryptodb_record_payload_len(valtype, val);
+        break;
+    case CRYPTODB_VAL_BLOB:
+        // The blob data is buffered, not the cryptodb_blob_t
+        data = ((const cryptodb_blob_t *)val)->data;
+        vallen = ((const cryptodb_blob_t *)val)->len;
+        if (data == NULL && vallen)
+            return CRYPTODB_ERR_NULL_POINTER;
+        break;
+    }
+
+    state = (_cryptodb_bulk_state_t *)bulk->state;
+    entry_len = CRYPTODB_BULK_ALIGN(CRYPTODB_BULK_ENTRY_HEADER_LEN + vallen + keylen);
+    if (state->len + entry_len > state->capacity)
     {
-        encrypt_key_len = keylen;
-        while (encrypt_key_len % CRYPTODB_AES_BLOCK_LEN != 0)
-            ++encrypt_key_len;
+        // Not realloc(), the old buffer should be zeroed
+        size_t capacity = state->len + entry_len;
+        uint8_t *buf = NULL;
 
-        encrypt_key = (char *)calloc(encrypt_key_len, sizeof(char));
-        if (encrypt_key == NULL)
-        {
-            free(encrypt);
+        if (capacity < CRYPTODB_BULK_WINDOW_LEN)
+            capacity = CRYPTODB_BULK_WINDOW_LEN;
+        buf = (uint8_t *)malloc(capacity);
+        if (buf == NULL)
             return CRYPTODB_ERR_ALLOCATE_MEM;
-        }
-        memcpy(encrypt_key, key, keylen);
-
-        result = _cryptodb_aes_256_cbc(encrypt_key,
-                                       encrypt_key,
-                                       encrypt_key_len,
-                                       true,
-                                       encryption_key,
-                                       encryption_iv);
-        if (result != CRYPTODB_ERR_OK)
+        _cryptodb_stats_inc(&((cryptodb_stats_t *)bulk->cryptodb.stats)->heap_allocs);
+        if (state->buf)
         {
-            free(encrypt);
-            free(encrypt_key);
-            return result;
+            memcpy(buf, state->buf, state->len);
+            mbedtls_platform_zeroize(state->buf, state->len);
+            free(state->buf);
         }
+        state->buf = buf;
+        state->capacity = capacity;
     }
 
-    leveldb_put(cryptodb->db,
-                cryptodb->woptions,
-                cryptodb->disable_keys_encryption ?
-                key : encrypt_key,
-                cryptodb->disable_keys_encryption ?
-                keylen : encrypt_key_len,
-                (const char *)encrypt,
-                (size_t)encrypt_len,
-                &err);
-    free(encrypt);
-    if (!cryptodb->disable_keys_encryption)
-        free(encrypt_key);
-    if (err)
-    {
-        result = _leveldb_err_to_cryptodb_err(err);
-        leveldb_free(err);
-    }
+    entry = state->buf + state->len;
+    memset(&header, 0, sizeof(_cryptodb_bulk_entry_t));
+    header.keylen = keylen;
+    header.vallen = vallen;
+    header.valtype = valtype;
+    memset(entry, 0, entry_len);
+    memcpy(entry, &header, sizeof(_cryptodb_bulk_entry_t));
+    if (vallen)
+        memcpy(entry + CRYPTODB_BULK_ENTRY_HEADER_LEN, data, vallen);
+    memcpy(entry + CRYPTODB_BULK_ENTRY_HEADER_LEN + vallen, key, keylen);
+    state->len += entry_len;
+    ++state->count;
+
+    if (state->len >= CRYPTODB_BULK_WINDOW_LEN)
+        return _cryptodb_bulk_flush(bulk);
+
+    return CRYPTODB_SUCCESS;
+}
+
+inline int cryptodb_bulk_put_string(cryptodb_bulk_t *bulk,
+                                    const char* key, size_t keylen, const char *val)
+{
+    return cryptodb_bulk_put(bulk, key, keylen, CRYPTODB_VAL_STRING, (void *)val);
+}
+
+inline int cryptodb_bulk_put_integer(cryptodb_bulk_t *bulk,
+                                     const char* key, size_t keylen, int val)
+{
+    return cryptodb_bulk_put(bulk, key, keylen, CRYPTODB_VAL_NUM_INT, (void *)&val);
+}
 
-    return result;
+inline int cryptodb_bulk_put_double(cryptodb_bulk_t *bulk,
+                                    const char* key, size_t keylen, double val)
+{
+    return cryptodb_bulk_put(bulk, key, keylen, CRYPTODB_VAL_NUM_DOUBLE, (void *)&val);
 }
 
-inline int cryptodb_put_string(cryptodb_t *cryptodb,
-                               const char* key, size_t keylen, const char *val)
+inline int cryptodb_bulk_put_int64(cryptodb_bulk_t *bulk,
+                                   const char* key, size_t keylen, int64_t val)
 {
-    return cryptodb_put(cryptodb, key, keylen, CRYPTODB_VAL_STRING, (void *)val);
+    return cryptodb_bulk_put(bulk, key, keylen, CRYPTODB_VAL_NUM_INT64, (void *)&val);
 }
 
-inline int cryptodb_put_integer(cryptodb_t *cryptodb,
-                                const char* key, size_t keylen, int val)
+inline int cryptodb_bulk_put_uint64(cryptodb_bulk_t *bulk,
+                                    const char* key, size_t keylen, uint64_t val)
 {
-    return cryptodb_put(cryptodb, key, keylen, CRYPTODB_VAL_NUM_INT, (void *)&val);
+    return cryptodb_bulk_put(bulk, key, keylen, CRYPTODB_VAL_NUM_UINT64, (void *)&val);
 }
 
-inline int cryptodb_put_double(cryptodb_t *cryptodb,
-                               const char* key, size_t keylen, double val)
+inline int cryptodb_bulk_put_blob(cryptodb_bulk_t *bulk,
+                                  const char* key, size_t keylen,
+                                  const void *data, size_t len)
 {
-    return cryptodb_put(cryptodb, key, keylen, CRYPTODB_VAL_NUM_DOUBLE, (void *)&val);
+    cryptodb_blob_t blob = { data, len };
+
+    return cryptodb_bulk_put(bulk, key, keylen, CRYPTODB_VAL_BLOB, (void *)&blob);
 }
 
-int cryptodb_get(cryptodb_t *cryptodb,
-                 const char* key, size_t keylen,
-                 cryptodb_val_t valtype, void *val)
+int cryptodb_bulk_commit(cryptodb_bulk_t *bulk)
 {
-    int val_int = 0;
-    char *val_str = NULL;
-    double val_double = 0;
+    int result = CRYPTODB_SUCCESS;
 
-    void *cval = NULL;
-    size_t vallen = 0, cvallen = 0;
-    cryptodb_val_t cvaltype = CRYPTODB_VAL_UNKNOWN;
-    uint8_t encryption_key[32] = {0}, encryption_iv[16] = {0};
-    int result = CRYPTODB_SUCCESS, decrypt_len = 0, encrypt_key_len = 0;
-    char *err = NULL, *str = NULL, *decrypt = NULL, *encrypt_key = NULL;
+    char *err = NULL;
+    leveldb_writebatch_t *batch = NULL;
+    _cryptodb_bulk_state_t *state = NULL;
 
-    if (cryptodb == NULL || key == NULL || val == NULL ||
-        cryptodb->db == NULL || cryptodb->roptions == NULL)
+    if (bulk == NULL || bulk->state == NULL)
         return CRYPTODB_ERR_NULL_POINTER;
-    if (!keylen)
-        return CRYPTODB_ERR_WRONG_ARGUMENT;
 
-    if (cryptodb->user_kdf)
-        result = cryptodb->user_kdf(cryptodb,
-                                    false,
-                                    encryption_key,
-                                    encryption_iv,
-                                    cryptodb->kdf_user_data);
-    else
-        result = _cryptodb_get_encryption_key_iv(cryptodb,
-                                                 false,
-                                                 encryption_key,
-                                                 encryption_iv);
-    if (result != CRYPTODB_ERR_OK)
-        return result;
+    state = (_cryptodb_bulk_state_t *)bulk->state;
 
-    if (!cryptodb->disable_keys_encryption)
+    // Closed if the staging database is synced, but wasn't moved
+    if (bulk->cryptodb.db == NULL)
+        goto move;
+
+    result = _cryptodb_bulk_flush(bulk);
+    if (result == CRYPTODB_SUCCESS)
     {
-        encrypt_key_len = keylen;
-        while (encrypt_key_len % CRYPTODB_AES_BLOCK_LEN != 0)
-            ++encrypt_key_len;
+        leveldb_compact_range(bulk->cryptodb.db, NULL, 0, NULL, 0);
 
-        encrypt_key = (char *)calloc(encrypt_key_len, sizeof(char));
-        if (encrypt_key == NULL)
-            return CRYPTODB_ERR_ALLOCATE_MEM;
-        memcpy(encrypt_key, key, keylen);
-
-        result = _cryptodb_aes_256_cbc(encrypt_key,
-                                       encrypt_key,
-                                       encrypt_key_len,
-                                       true,
-                                       encryption_key,
-                                       encryption_iv);
-        if (result != CRYPTODB_ERR_OK)
+        // The only synced write of the session
+        batch = leveldb_writebatch_create();
+        if (batch == NULL)
+            result = CRYPTODB_ERR_ALLOCATE_MEM;
+        else
         {
-            free(encrypt_key);
-            return result;
+            leveldb_writeoptions_set_sync((leveldb_writeoptions_t *)bulk->cryptodb.woptions, 1);
+            leveldb_write(bulk->cryptodb.db, bulk->cryptodb.woptions, batch, &err);
+            leveldb_writebatch_destroy(batch);
         }
-    }
-
-    str = leveldb_get(cryptodb->db,
-                      cryptodb->roptions,
-                      cryptodb->disable_keys_encryption ?
-                      key : encrypt_key,
-                      cryptodb->disable_keys_encryption ?
-                      keylen : encrypt_key_len,
-                      &vallen, &err);
-    if (!cryptodb->disable_keys_encryption)
-        free(encrypt_key);
-    if ((str == NULL) || err)
-    {
         if (err)
         {
             result = _leveldb_err_to_cryptodb_err(err);
+            if (result == CRYPTODB_ERR_OK)
+                result = CRYPTODB_ERR_FAIL;
             leveldb_free(err);
         }
-        if (result == CRYPTODB_ERR_OK && !str)
-            result = CRYPTODB_ERR_FAIL;
-        if (result != CRYPTODB_ERR_OK && str)
-            leveldb_free(str);
-    }
-    if (result != CRYPTODB_ERR_OK)
-        return result;
-    if (!vallen)
-    {
-        leveldb_free(str);
-        return CRYPTODB_ERR_FAIL;
-    }
-
-    decrypt_len = vallen;
-    if (decrypt_len % CRYPTODB_AES_BLOCK_LEN != 0)
-    {
-        leveldb_free(str);
-        return CRYPTODB_ERR_FAIL;
-    }
-    decrypt = (char *)calloc(decrypt_len, sizeof(char));
-    if (decrypt == NULL)
-    {
-        leveldb_free(str);
-        return CRYPTODB_ERR_ALLOCATE_MEM;
     }
 
-    result = _cryptodb_aes_256_cbc(str,
-                                   decrypt,
-                                   decrypt_len,
-                                   false,
-                                   encryption_key,
-                                   encryption_iv);
-    leveldb_free(str);
-    if (result != CRYPTODB_ERR_OK)
+    cryptodb_close(&bulk->cryptodb);
+    if (result != CRYPTODB_SUCCESS)
     {
-        free(decrypt);
+        _cryptodb_bulk_end(bulk, true);
         return result;
     }
 
-    cvaltype = _cryptodb_json_to_valtype(decrypt, &cvallen);
-    if (cvaltype == CRYPTODB_VAL_UNKNOWN || !cvallen)
-    {
-        free(decrypt);
-        return CRYPTODB_ERR_FAIL;
-    }
-    if (cvaltype != valtype)
-    {
-        free(decrypt);
-        return (int)cvaltype;
-    }
-    if (cvaltype == CRYPTODB_VAL_STRING)
-    {
-        val_str = (char *)calloc(cvallen, sizeof(char));
-        if (val_str == NULL)
-        {
-            free(decrypt);
-            return CRYPTODB_ERR_ALLOCATE_MEM;
-        }
-    }
+move:
+    // The session and the staging database are kept for a retry
+    if (rename(state->staging_path, state->path))
+        return CRYPTODB_ERR_MOVE_FAIL;
+    _cryptodb_sync_parent_dir(state->path);
 
-    switch (cvaltype)
-    {
-    default:
-        free(decrypt);
-        return CRYPTODB_ERR_FAIL;
-    case CRYPTODB_VAL_STRING:
-        result = _cryptodb_json_to_val(decrypt, (void *)val_str);
-        if (result != CRYPTODB_ERR_OK)
-        {
-            free(val_str);
-            free(decrypt);
-            return result;
-        }
-        cval = (void *)val_str;
-        break;
-    case CRYPTODB_VAL_NUM_INT:
-        result = _cryptodb_json_to_val(decrypt, (void *)&val_double);
-        if (result != CRYPTODB_ERR_OK)
-        {
-            free(decrypt);
-            return result;
-        }
-        val_int = (int)val_double;
-        cval = (void *)&val_int;
-        break;
-    case CRYPTODB_VAL_NUM_DOUBLE:
-        result = _cryptodb_json_to_val(decrypt, (void *)&val_double);
-        if (result != CRYPTODB_ERR_OK)
-        {
-            free(decrypt);
-            return result;
-        }
-        cval = (void *)&val_double;
-        break;
-    }
+    _cryptodb_bulk_end(bulk, false);
+
+    return CRYPTODB_SUCCESS;
+}
+
+void cryptodb_bulk_abort(cryptodb_bulk_t *bulk)
+{
+    if (bulk && bulk->state)
+        _cryptodb_bulk_end(bulk, true);
+}
 
-    memcpy(val, cval, cvallen);
+int cryptodb_put_async(cryptodb_t *cryptodb,
+                       const char* key, size_t keylen,
+                       cryptodb_val_t valtype, void *val,
+                       cryptodb_write_cb cb, void *user_data)
+{
+    return _cryptodb_submit(cryptodb, true, key, keylen, valtype, val, cb, user_data);
+}
 
-    free(decrypt);
-    if (val_str)
-        free(val_str);
+inline int cryptodb_put_string_async(cryptodb_t *cryptodb,
+                                     const char* key, size_t keylen,
+                                     const char *val,
+                                     cryptodb_write_cb cb, void *user_data)
+{
+    return cryptodb_put_async(cryptodb, key, keylen, CRYPTODB_VAL_STRING, (void *)val,
+                              cb, user_data);
+}
 
-    return result;
+inline int cryptodb_put_integer_async(cryptodb_t *cryptodb,
+                                      const char* key, size_t keylen,
+                                      int val,
+                                      cryptodb_write_cb cb, void *user_data)
+{
+    return cryptodb_put_async(cryptodb, key, keylen, CRYPTODB_VAL_NUM_INT, (void *)&val,
+                              cb, user_data);
 }
 
-int cryptodb_delete(cryptodb_t *cryptodb,
-                    const char* key, size_t keylen)
+inline int cryptodb_put_double_async(cryptodb_t *cryptodb,
+                                     const char* key, size_t keylen,
+                                     double val,
+                                     cryptodb_write_cb cb, void *user_data)
 {
-    char *err = NULL, *encrypt_key = NULL;
-    int result = CRYPTODB_SUCCESS, encrypt_key_len = 0;
-    uint8_t encryption_key[32] = {0}, encryption_iv[16] = {0};
+    return cryptodb_put_async(cryptodb, key, keylen, CRYPTODB_VAL_NUM_DOUBLE, (void *)&val,
+                              cb, user_data);
+}
 
-    if (cryptodb == NULL     || key == NULL ||
-        cryptodb->db == NULL || cryptodb->woptions == NULL)
+inline int cryptodb_put_int64_async(cryptodb_t *cryptodb,
+                                    const char* key, size_t keylen,
+                                    int64_t val,
+                                    cryptodb_write_cb cb, void *user_data)
+{
+    return cryptodb_put_async(cryptodb, key, keylen, CRYPTODB_VAL_NUM_INT64, (void *)&val,
+                              cb, user_data);
+}
+
+inline int cryptodb_put_uint64_async(cryptodb_t *cryptodb,
+                                     const char* key, size_t keylen,
+                                     uint64_t val,
+                                     cryptodb_write_cb cb, void *user_data)
+{
+    return cryptodb_put_async(cryptodb, key, keylen, CRYPTODB_VAL_NUM_UINT64, (void *)&val,
+                              cb, user_data);
+}
+
+inline int cryptodb_put_blob_async(cryptodb_t *cryptodb,
+                                   const char* key, size_t keylen,
+                                   const void *data, size_t len,
+                                   cryptodb_write_cb cb, void *user_data)
+{
+    cryptodb_blob_t blob = { data, len };
+
+    return cryptodb_put_async(cryptodb, key, keylen, CRYPTODB_VAL_BLOB, (void *)&blob,
+                              cb, user_data);
+}
+
+int cryptodb_delete_async(cryptodb_t *cryptodb,
+                          const char* key, size_t keylen,
+                          cryptodb_write_cb cb, void *user_data)
+{
+    return _cryptodb_submit(cryptodb, false, key, keylen, CRYPTODB_VAL_UNKNOWN, NULL, cb, user_data);
+}
+
+int cryptodb_flush(cryptodb_t *cryptodb)
+{
+    if (cryptodb == NULL || cryptodb->writer == NULL)
         return CRYPTODB_ERR_NULL_POINTER;
-    if (!keylen)
-        return CRYPTODB_ERR_WRONG_ARGUMENT;
 
-    if (cryptodb->user_kdf)
-        result = cryptodb->user_kdf(cryptodb,
-                                    true,
-                                    encryption_key,
-                                    encryption_iv,
-                                    cryptodb->kdf_user_data);
-    else
-        result = _cryptodb_get_encryption_key_iv(cryptodb,
-                                                 true,
-                                                 encryption_key,
-                                                 encryption_iv);
-    if (result != CRYPTODB_ERR_OK)
-        return result;
+    _cryptodb_writer_flush((_cryptodb_writer_t *)cryptodb->writer);
 
-    if (!cryptodb->disable_keys_encryption)
-    {
-        encrypt_key_len = keylen;
-        while (encrypt_key_len % CRYPTODB_AES_BLOCK_LEN != 0)
-            ++encrypt_key_len;
+    return CRYPTODB_SUCCESS;
+}
 
-        encrypt_key = (char *)calloc(encrypt_key_len, sizeof(char));
-        if (encrypt_key == NULL)
-            return CRYPTODB_ERR_ALLOCATE_MEM;
-        memcpy(encrypt_key, key, keylen);
-
-        result = _cryptodb_aes_256_cbc(encrypt_key,
-                                       encrypt_key,
-                                       encrypt_key_len,
-                                       true,
-                                       encryption_key,
-                                       encryption_iv);
-        if (result != CRYPTODB_ERR_OK)
-        {
-            free(encrypt_key);
-            return result;
-        }
-    }
+int cryptodb_get_stats(cryptodb_t *cryptodb,
+                       cryptodb_stats_t *stats)
+{
+    cryptodb_stats_t *cstats = NULL;
 
-    leveldb_delete(cryptodb->db,
-                   cryptodb->woptions,
-                   cryptodb->disable_keys_encryption ?
-                   key : encrypt_key,
-                   cryptodb->disable_keys_encryption ?
-                   keylen : encrypt_key_len,
-                   &err);
-    if (!cryptodb->disable_keys_encryption)
-        free(encrypt_key);
-    if (err)
-    {
-        result = _leveldb_err_to_cryptodb_err(err);
-        leveldb_free(err);
-    }
+    if (cryptodb == NULL || stats == NULL || cryptodb->stats == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
 
-    return result;
+    cstats = (cryptodb_stats_t *)cryptodb->stats;
+
+    stats->puts = __atomic_load_n(&cstats->puts, __ATOMIC_RELAXED);
+    stats->gets = __atomic_load_n(&cstats->gets, __ATOMIC_RELAXED);
+    stats->deletes = __atomic_load_n(&cstats->deletes, __ATOMIC_RELAXED);
+    stats->heap_allocs = __atomic_load_n(&cstats->heap_allocs, __ATOMIC_RELAXED);
+    stats->syncs = __atomic_load_n(&cstats->syncs, __ATOMIC_RELAXED);
+    _cryptodb_filter_stats((_cryptodb_filter_t *)cryptodb->filter,
+                           &stats->filter_checks,
+                           &stats->filter_avoided_reads);
+
+    return CRYPTODB_SUCCESS;
 }
 
 int cryptodb_destroy(const char *path,
@@ -904,72 +4124,31 @@ int cryptodb_destroy(const char *path,
     char *err = NULL;
     leveldb_env_t *env = NULL;
     leveldb_cache_t *cache = NULL;
-    leveldb_comparator_t *cmp = NULL;
     leveldb_options_t *dboptions = NULL;
-    leveldb_readoptions_t *roptions = NULL;
-    leveldb_writeoptions_t *woptions = NULL;
 
     if (path == NULL)
         return CRYPTODB_ERR_NULL_POINTER;
     if (!strlen(path))
         return CRYPTODB_ERR_WRONG_ARGUMENT;
 
-    dboptions = leveldb_options_create();
-    roptions  = leveldb_readoptions_create();
+    dboptions = _cryptodb_dboptions_create(options);
     env       = leveldb_create_default_env();
-    woptions  = leveldb_writeoptions_create();
-    cmp       = leveldb_comparator_create(NULL,
-                                _cryptodb_comparator_destroy,
-                                _cryptodb_comparator_compare,
-                                _cryptodb_comparator_name);
     cache     = leveldb_cache_create_lru(options ?
                                 options->cache_capacity :
                                 CRYPTODB_OPT_DEFAULT_CACHE_SIZE);
-    if (!dboptions || !roptions || !env || !woptions || !cache || !cmp)
+    if (!dboptions || !env || !cache)
     {
         if (env)
             leveldb_env_destroy(env);
         if (cache)
             leveldb_cache_destroy(cache);
-        if (cmp)
-            leveldb_comparator_destroy(cmp);
         if (dboptions)
             leveldb_options_destroy(dboptions);
-        if (roptions)
-            leveldb_readoptions_destroy(roptions);
-        if (woptions)
-            leveldb_writeoptions_destroy(woptions);
         return CRYPTODB_ERR_ALLOCATE_MEM;
     }
 
     leveldb_options_set_env(dboptions, env);
     leveldb_options_set_cache(dboptions, cache);
-    leveldb_options_set_info_log(dboptions, NULL);
-    leveldb_options_set_comparator(dboptions, cmp);
-    leveldb_options_set_paranoid_checks(dboptions, 1);
-    leveldb_options_set_create_if_missing(dboptions, 1);
-    leveldb_options_set_compression(dboptions, leveldb_no_compression);
-
-    leveldb_options_set_block_size(dboptions,
-                                   options ?
-                                   options->block_size :
-                                   CRYPTODB_OPT_DEFAULT_BLOCK_SIZE);
-    leveldb_options_set_max_open_files(dboptions,
-                                       options ?
-                                       options->max_open_files :
-                                       CRYPTODB_OPT_DEFAULT_MAX_FILES);
-    leveldb_options_set_max_file_size(dboptions,
-                                      options ?
-                                      options->max_file_size :
-                                      CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE);
-    leveldb_options_set_write_buffer_size(dboptions,
-                                          options ?
-                                          options->write_buffer_size :
-                                          CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE);
-    leveldb_options_set_block_restart_interval(dboptions,
-                                               options ?
-                                               options->block_restart_interval :
-                                               CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT);
 
     leveldb_destroy_db(dboptions, path, &err);
     if (err)
@@ -980,10 +4159,142 @@ int cryptodb_destroy(const char *path,
 
     leveldb_env_destroy(env);
     leveldb_cache_destroy(cache);
-    leveldb_comparator_destroy(cmp);
     leveldb_options_destroy(dboptions);
-    leveldb_readoptions_destroy(roptions);
-    leveldb_writeoptions_destroy(woptions);
+
+    return result;
+}
+
+int cryptodb_migrate(const char *path,
+                     cryptodb_options_t *options)
+{
+    int result = CRYPTODB_SUCCESS;
+
+    char *err = NULL;
+    size_t path_len = 0;
+    char *new_path = NULL, *old_path = NULL;
+    leveldb_t *src = NULL, *dst = NULL;
+    leveldb_comparator_t *cmp = NULL;
+    _cryptodb_filter_t *filter = NULL;
+    leveldb_options_t *src_options = NULL, *dst_options = NULL;
+
+    if (path == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+    path_len = strlen(path);
+    while (path_len > 1 && (path[path_len - 1] == '/' || path[path_len - 1] == '\\'))
+        --path_len;
+    if (!path_len)
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+    if (options && options->bloom_bits_per_key < 0)
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+
+    result = _cryptodb_migrate_recover(path);
+    if (result != CRYPTODB_SUCCESS)
+        return result;
+
+    new_path = (char *)malloc(path_len + sizeof(".migrate"));
+    old_path = (char *)malloc(path_len + sizeof(".legacy"));
+    src_options = _cryptodb_dboptions_create(options);
+    dst_options = _cryptodb_dboptions_create(options);
+    cmp = leveldb_comparator_create(NULL,
+                                    _cryptodb_comparator_destroy,
+                                    _cryptodb_comparator_compare,
+                                    _cryptodb_comparator_name);
+    if (options && options->bloom_bits_per_key)
+        filter = _cryptodb_filter_create(options->bloom_bits_per_key);
+    if (!new_path || !old_path || !src_options || !dst_options || !cmp ||
+        (options && options->bloom_bits_per_key && !filter))
+    {
+        result = CRYPTODB_ERR_ALLOCATE_MEM;
+        goto exit;
+    }
+    memcpy(new_path, path, path_len);
+    memcpy(new_path + path_len, ".migrate", sizeof(".migrate"));
+    memcpy(old_path, path, path_len);
+    memcpy(old_path + path_len, ".legacy", sizeof(".legacy"));
+
+    leveldb_options_set_comparator(src_options, cmp);
+    leveldb_options_set_create_if_missing(src_options, 0);
+    if (filter)
+        leveldb_options_set_filter_policy(dst_options, _cryptodb_filter_policy(filter));
+
+    src = leveldb_open(src_options, path, &err);
+    if (src == NULL || err)
+    {
+        // The database already uses the built-in comparator
+        if (err && _leveldb_err_is_comparator_mismatch(err))
+        {
+            leveldb_free(err);
+            err = NULL;
+        }
+        else
+            result = err ? _leveldb_err_to_cryptodb_err(err) : CRYPTODB_ERR_FAIL;
+        goto exit;
+    }
+
+    // Leftover of an interrupted migration
+    leveldb_destroy_db(dst_options, new_path, &err);
+    if (err == NULL)
+        dst = leveldb_open(dst_options, new_path, &err);
+    if (dst == NULL || err)
+    {
+        result = err ? _leveldb_err_to_cryptodb_err(err) : CRYPTODB_ERR_FAIL;
+        goto exit;
+    }
+
+    result = _cryptodb_migrate_copy(src, dst);
+
+    leveldb_close(src);
+    leveldb_close(dst);
+    src = NULL;
+    dst = NULL;
+
+    if (result != CRYPTODB_SUCCESS)
+    {
+        leveldb_destroy_db(dst_options, new_path, &err);
+        goto exit;
+    }
+
+    // The original database is removed only after the migrated one took its place
+    if (rename(path, old_path))
+    {
+        result = CRYPTODB_ERR_FAIL;
+        goto exit;
+    }
+    if (rename(new_path, path))
+    {
+        // If it isn't moved back either, the swap is finished on the next open
+        rename(old_path, path);
+        result = CRYPTODB_ERR_FAIL;
+        goto exit;
+    }
+    leveldb_destroy_db(src_options, old_path, &err);
+    if (err)
+    {
+        // Only a copy of the migrated entries is left
+        leveldb_free(err);
+        err = NULL;
+    }
+
+exit:
+    if (err)
+    {
+        if (result == CRYPTODB_ERR_OK)
+            result = CRYPTODB_ERR_FAIL;
+        leveldb_free(err);
+    }
+    if (src)
+        leveldb_close(src);
+    if (dst)
+        leveldb_close(dst);
+    if (src_options)
+        leveldb_options_destroy(src_options);
+    if (dst_options)
+        leveldb_options_destroy(dst_options);
+    if (cmp)
+        leveldb_comparator_destroy(cmp);
+    _cryptodb_filter_destroy(filter);
+    free(new_path);
+    free(old_path);
 
     return result;
 }
@@ -26,6 +26,306 @@
 
 namespace cryptodb {
 
+/**
+ * Completion callback of asynchronous operations, "user_data" is
+ * std::promise<int> of the operation
+ */
+static void AsyncCompleted(cryptodb_t *cryptodb, int result, void *user_data)
+{
+    (void)cryptodb;
+
+    std::promise<int> *promise = static_cast<std::promise<int> *>(user_data);
+    promise->set_value(result);
+    delete promise;
+}
+
+/**
+ * If the operation wasn't queued, the callback will never be called,
+ * so the promise is fulfilled with the error here
+ */
+static void AsyncSubmitted(std::promise<int> *promise, int err)
+{
+    if (CRYPTODB_SUCCESS != err)
+    {
+        promise->set_value(err);
+        delete promise;
+    }
+}
+
+/**
+ * Key of the std::string methods, it's written with the terminating zero
+ */
+static std::string_view CStringKey(const std::string &key)
+{
+    return std::string_view(key.c_str(), strlen(key.c_str()) + 1);
+}
+
+/**
+ * Value of the std::string methods, it's taken up to the first zero
+ */
+static std::string_view CStringValue(const std::string &val)
+{
+    return std::string_view(val.c_str());
+}
+
+/**
+ * String values are passed to the C API with the terminating zero. Values
+ * shorter than CRYPTODB_SCRATCH_LEN are terminated in a stack buffer, so
+ * only longer ones are copied to the heap.
+ */
+template <typename PutFn>
+static int PutCString(std::string_view val, PutFn put)
+{
+    char scratch[CRYPTODB_SCRATCH_LEN];
+
+    if (val.find('\0') != std::string_view::npos)
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+
+    if (val.size() < sizeof(scratch))
+    {
+        memcpy(scratch, val.data(), val.size());
+        scratch[val.size()] = '\0';
+        return put(scratch);
+    }
+
+    std::string copy(val);
+
+    return put(copy.c_str());
+}
+
+/**
+ * cryptodb_get() from the snapshot, or from the database if "snapshot"
+ * is nullptr
+ */
+static int Get(cryptodb_t *db, cryptodb_snapshot_t *snapshot,
+               std::string_view key,
+               cryptodb_val_t valtype, void *val)
+{
+    if (snapshot)
+        return cryptodb_snapshot_get(snapshot, key.data(), key.size(), valtype, val);
+
+    return cryptodb_get(db, key.data(), key.size(), valtype, val);
+}
+
+/**
+ * cryptodb_get_buf() from the snapshot, or from the database if "snapshot"
+ * is nullptr
+ */
+static int GetBuf(cryptodb_t *db, cryptodb_snapshot_t *snapshot,
+                  std::string_view key,
+                  void *buf, size_t buf_cap,
+                  size_t *len, cryptodb_val_t *type)
+{
+    if (snapshot)
+        return cryptodb_snapshot_get_buf(snapshot, key.data(), key.size(),
+                                         buf, buf_cap, len, type);
+
+    return cryptodb_get_buf(db, key.data(), key.size(), buf, buf_cap, len, type);
+}
+
+/**
+ * Reads the blob value into "data" of "len" bytes, "len" is set to the
+ * value length
+ */
+static int GetData(cryptodb_t *db,
+                   cryptodb_snapshot_t *snapshot,
+                   std::string_view key,
+                   void *data, size_t &len)
+{
+    cryptodb_val_t type = CRYPTODB_VAL_UNKNOWN;
+    int err = GetBuf(db, snapshot, key, data, len, &len, &type);
+
+    if ((CRYPTODB_SUCCESS == err || CRYPTODB_ERR_BUFFER_TOO_SMALL == err) &&
+        CRYPTODB_VAL_BLOB != type)
+        return (int)type;
+
+    return err;
+}
+
+/**
+ * Reads the string (std::string) or blob (std::vector<uint8_t>) value into
+ * the whole capacity of "val", so a container that is reused between calls
+ * is grown only when the value doesn't fit
+ */
+template <typename Container>
+static int GetInto(cryptodb_t *db,
+                   cryptodb_snapshot_t *snapshot,
+                   std::string_view key,
+                   cryptodb_val_t valtype,
+                   Container &val)
+{
+    int err = 0;
+    size_t len = 0;
+    cryptodb_val_t type = CRYPTODB_VAL_UNKNOWN;
+
+    val.resize(val.capacity());
+
+    err = GetBuf(db, snapshot, key, val.data(), val.size(), &len, &type);
+    // The value can be overwritten by a longer one between the reads
+    while (CRYPTODB_ERR_BUFFER_TOO_SMALL == err && valtype == type)
+    {
+        val.resize(len);
+        err = GetBuf(db, snapshot, key, val.data(), val.size(), &len, &type);
+    }
+    if ((CRYPTODB_SUCCESS == err || CRYPTODB_ERR_BUFFER_TOO_SMALL == err) &&
+        valtype != type)
+        err = (int)type;
+    if (CRYPTODB_SUCCESS != err)
+    {
+        val.clear();
+        return err;
+    }
+
+    // String without the terminating zero
+    val.resize(CRYPTODB_VAL_STRING == valtype ? len - 1 : len);
+
+    return CRYPTODB_SUCCESS;
+}
+
+template <typename T>
+static std::optional<T> GetOptional(cryptodb_t *db,
+                                    cryptodb_snapshot_t *snapshot,
+                                    std::string_view key,
+                                    cryptodb_val_t valtype)
+{
+    T value = T();
+
+    if (CRYPTODB_SUCCESS != Get(db, snapshot, key, valtype, (void *)&value))
+        return std::nullopt;
+
+    return value;
+}
+
+static int GetStringFrom(cryptodb_t *db,
+                         cryptodb_snapshot_t *snapshot,
+                         std::string &key,
+                         int expected_max_length,
+                         std::string **val)
+{
+    int err = 0;
+    std::string value;
+
+    *val = nullptr;
+
+    // Only a hint now, the value is read whatever its length is
+    if (expected_max_length > 0)
+        value.reserve(expected_max_length);
+
+    err = GetInto(db, snapshot, CStringKey(key), CRYPTODB_VAL_STRING, value);
+    if (CRYPTODB_SUCCESS != err)
+        return err;
+
+    *val = new std::string(std::move(value));
+
+    return CRYPTODB_SUCCESS;
+}
+
+static int GetIntegerFrom(cryptodb_t *db,
+                          cryptodb_snapshot_t *snapshot,
+                          std::string &key,
+                          int **val)
+{
+    int err = 0, value = 0;
+
+    *val = nullptr;
+
+    err = Get(db, snapshot, CStringKey(key), CRYPTODB_VAL_NUM_INT, (void *)&value);
+    if (CRYPTODB_SUCCESS != err)
+        return err;
+
+    *val = new int(value);
+
+    return CRYPTODB_SUCCESS;
+}
+
+static int GetDoubleFrom(cryptodb_t *db,
+                         cryptodb_snapshot_t *snapshot,
+                         std::string &key,
+                         double **val)
+{
+    int err = 0;
+    double value = 0.0;
+
+    *val = nullptr;
+
+    err = Get(db, snapshot, CStringKey(key), CRYPTODB_VAL_NUM_DOUBLE, (void *)&value);
+    if (CRYPTODB_SUCCESS != err)
+        return err;
+
+    *val = new double(value);
+
+    return CRYPTODB_SUCCESS;
+}
+
+static int MultiGetFrom(cryptodb_t *db,
+                        cryptodb_snapshot_t *snapshot,
+                        std::vector<CryptoDBGetItem> &items)
+{
+    int err = 0;
+    size_t strings_len = 0;
+    char *strings = NULL, *str = NULL;
+    std::vector<cryptodb_get_item_t> get_items(items.size());
+
+    for (const CryptoDBGetItem &item : items)
+    {
+        if (item.type == CRYPTODB_VAL_STRING && item.expected_max_length <= 0)
+            return CRYPTODB_ERR_WRONG_ARGUMENT;
+        if (item.type == CRYPTODB_VAL_STRING)
+            strings_len += item.expected_max_length;
+    }
+
+    // One buffer for all string values
+    if (strings_len)
+    {
+        strings = (char *)calloc(strings_len, sizeof(char));
+        if (strings == NULL)
+            return CRYPTODB_ERR_ALLOCATE_MEM;
+    }
+
+    str = strings;
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        get_items[i].key = items[i].key.c_str();
+        get_items[i].keylen = strlen(items[i].key.c_str()) + 1;
+        get_items[i].valtype = items[i].type;
+        switch (items[i].type)
+        {
+        case CRYPTODB_VAL_STRING:
+            get_items[i].val = str;
+            str += items[i].expected_max_length;
+            break;
+        case CRYPTODB_VAL_NUM_INT:
+            get_items[i].val = &items[i].integer;
+            break;
+        case CRYPTODB_VAL_NUM_INT64:
+            get_items[i].val = &items[i].integer64;
+            break;
+        case CRYPTODB_VAL_NUM_UINT64:
+            get_items[i].val = &items[i].uinteger64;
+            break;
+        default:
+            get_items[i].val = &items[i].number;
+            break;
+        }
+    }
+
+    if (snapshot)
+        err = cryptodb_snapshot_multi_get(snapshot, get_items.data(), get_items.size());
+    else
+        err = cryptodb_multi_get(db, get_items.data(), get_items.size());
+
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        items[i].result = CRYPTODB_SUCCESS == err ? get_items[i].result : err;
+        if (CRYPTODB_SUCCESS == items[i].result && items[i].type == CRYPTODB_VAL_STRING)
+            items[i].str = (const char *)get_items[i].val;
+    }
+
+    free(strings);
+
+    return err;
+}
+
 const std::string CryptoDB::ErrorToStr(cryptodb_err_t err)
 {
     return (const std::string)std::string((char *)cryptodb_err_to_str(err));
@@ -36,6 +336,29 @@ const std::string CryptoDB::ValueToStr(cryptodb_val_t val)
     return (const std::string)std::string((char *)cryptodb_val_to_str(val));
 }
 
+CryptoDB::CryptoDB() : db(new cryptodb_t())
+{
+}
+
+CryptoDB::~CryptoDB()
+{
+    this->Close();
+}
+
+CryptoDB::CryptoDB(CryptoDB &&other) noexcept : db(std::move(other.db))
+{
+}
+
+CryptoDB &CryptoDB::operator=(CryptoDB &&other) noexcept
+{
+    if (this != &other)
+    {
+        this->Close();
+        this->db = std::move(other.db);
+    }
+    return *this;
+}
+
 int CryptoDB::Open(std::string path,
                    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN],
                    size_t uniq_data_len,
@@ -54,7 +377,7 @@ int CryptoDB::Open(std::string path,
                             options,
                             user_kdf,
                             kdf_user_data,
-                            &db->db);
+                            db->db.get());
     if (CRYPTODB_SUCCESS != err)
     {
         delete db;
@@ -80,7 +403,7 @@ int CryptoDB::OpenWithKeys(std::string path,
                                       encryption_key,
                                       encryption_iv,
                                       options,
-                                      &db->db);
+                                      db->db.get());
     if (CRYPTODB_SUCCESS != err)
     {
         delete db;
@@ -92,119 +415,717 @@ int CryptoDB::OpenWithKeys(std::string path,
     return CRYPTODB_SUCCESS;
 }
 
+int CryptoDB::Open(std::string path,
+                   uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN],
+                   size_t uniq_data_len,
+                   cryptodb_options_t *options,
+                   cryptodb_user_kdf user_kdf,
+                   void *kdf_user_data,
+                   CryptoDB &db)
+{
+    // The instance could be moved from
+    if (!db.db)
+        db.db.reset(new cryptodb_t());
+
+    return cryptodb_open(path.c_str(),
+                         uniq_data,
+                         uniq_data_len,
+                         options,
+                         user_kdf,
+                         kdf_user_data,
+                         db.db.get());
+}
+
+int CryptoDB::OpenWithKeys(std::string path,
+                           uint8_t encryption_key[32],
+                           uint8_t encryption_iv[16],
+                           cryptodb_options_t *options,
+                           CryptoDB &db)
+{
+    if (!db.db)
+        db.db.reset(new cryptodb_t());
+
+    return cryptodb_open_with_keys(path.c_str(),
+                                   encryption_key,
+                                   encryption_iv,
+                                   options,
+                                   db.db.get());
+}
+
 int CryptoDB::Destroy(std::string path,
                       cryptodb_options_t *options)
 {
     return cryptodb_destroy(path.c_str(), options);
 }
 
+int CryptoDB::Migrate(std::string path,
+                      cryptodb_options_t *options)
+{
+    return cryptodb_migrate(path.c_str(), options);
+}
+
 void CryptoDB::Close(void)
 {
-    cryptodb_close(&this->db);
+    cryptodb_close(this->db.get());
+}
+
+int CryptoDB::Put(std::string_view key, std::string_view val)
+{
+    return PutCString(val, [&](const char *value) {
+        return cryptodb_put_string(this->db.get(), key.data(), key.size(), value);
+    });
+}
+
+int CryptoDB::Put(std::string_view key, int val)
+{
+    return cryptodb_put_integer(this->db.get(), key.data(), key.size(), val);
+}
+
+int CryptoDB::Put(std::string_view key, double val)
+{
+    return cryptodb_put_double(this->db.get(), key.data(), key.size(), val);
+}
+
+int CryptoDB::Put(std::string_view key, int64_t val)
+{
+    return cryptodb_put_int64(this->db.get(), key.data(), key.size(), val);
+}
+
+int CryptoDB::Put(std::string_view key, uint64_t val)
+{
+    return cryptodb_put_uint64(this->db.get(), key.data(), key.size(), val);
+}
+
+int CryptoDB::Put(std::string_view key, const void *data, size_t len)
+{
+    return cryptodb_put_blob(this->db.get(), key.data(), key.size(), data, len);
+}
+
+int CryptoDB::Put(std::string_view key, const std::vector<uint8_t> &val)
+{
+    return this->Put(key, val.data(), val.size());
+}
+
+int CryptoDB::Get(std::string_view key, std::string &val)
+{
+    return GetInto(this->db.get(), nullptr, key, CRYPTODB_VAL_STRING, val);
+}
+
+int CryptoDB::Get(std::string_view key, std::vector<uint8_t> &val)
+{
+    return GetInto(this->db.get(), nullptr, key, CRYPTODB_VAL_BLOB, val);
+}
+
+int CryptoDB::Get(std::string_view key, void *data, size_t &len)
+{
+    return GetData(this->db.get(), nullptr, key, data, len);
+}
+
+int CryptoDB::Get(std::string_view key, int &val)
+{
+    return ::cryptodb::Get(this->db.get(), nullptr, key, CRYPTODB_VAL_NUM_INT, (void *)&val);
+}
+
+int CryptoDB::Get(std::string_view key, double &val)
+{
+    return ::cryptodb::Get(this->db.get(), nullptr, key, CRYPTODB_VAL_NUM_DOUBLE, (void *)&val);
+}
+
+int CryptoDB::Get(std::string_view key, int64_t &val)
+{
+    return ::cryptodb::Get(this->db.get(), nullptr, key, CRYPTODB_VAL_NUM_INT64, (void *)&val);
+}
+
+int CryptoDB::Get(std::string_view key, uint64_t &val)
+{
+    return ::cryptodb::Get(this->db.get(), nullptr, key, CRYPTODB_VAL_NUM_UINT64, (void *)&val);
+}
+
+std::optional<int> CryptoDB::GetInteger(std::string_view key)
+{
+    return GetOptional<int>(this->db.get(), nullptr, key, CRYPTODB_VAL_NUM_INT);
+}
+
+std::optional<double> CryptoDB::GetDouble(std::string_view key)
+{
+    return GetOptional<double>(this->db.get(), nullptr, key, CRYPTODB_VAL_NUM_DOUBLE);
+}
+
+std::optional<int64_t> CryptoDB::GetInt64(std::string_view key)
+{
+    return GetOptional<int64_t>(this->db.get(), nullptr, key, CRYPTODB_VAL_NUM_INT64);
+}
+
+std::optional<uint64_t> CryptoDB::GetUInt64(std::string_view key)
+{
+    return GetOptional<uint64_t>(this->db.get(), nullptr, key, CRYPTODB_VAL_NUM_UINT64);
+}
+
+int CryptoDB::Remove(std::string_view key)
+{
+    return cryptodb_delete(this->db.get(), key.data(), key.size());
 }
 
 int CryptoDB::PutString(std::string key, std::string val)
 {
-    return cryptodb_put_string(&this->db,
-                               key.c_str(),
-                               strlen(key.c_str()) + 1,
-                               val.c_str());
+    return this->Put(CStringKey(key), CStringValue(val));
 }
 
 int CryptoDB::PutInteger(std::string key, int val)
 {
-    return cryptodb_put_integer(&this->db,
-                                key.c_str(),
-                                strlen(key.c_str()) + 1,
-                                val);
+    return this->Put(CStringKey(key), val);
 }
 
 int CryptoDB::PutDouble(std::string key, double val)
 {
-    return cryptodb_put_double(&this->db,
-                               key.c_str(),
-                               strlen(key.c_str()) + 1,
-                               val);
+    return this->Put(CStringKey(key), val);
 }
 
 int CryptoDB::GetString(std::string key,
                         int expected_max_length,
                         std::string **val)
 {
-    int err = 0;
-    char *value = NULL;
+    return GetStringFrom(this->db.get(), nullptr, key, expected_max_length, val);
+}
 
-    if (expected_max_length <= 0)
-        return CRYPTODB_ERR_WRONG_ARGUMENT;
+int CryptoDB::GetInteger(std::string key, int **val)
+{
+    return GetIntegerFrom(this->db.get(), nullptr, key, val);
+}
 
-    value = (char *)calloc(expected_max_length, sizeof(char));
-    if (value == NULL)
-        return CRYPTODB_ERR_ALLOCATE_MEM;
+int CryptoDB::GetDouble(std::string key, double **val)
+{
+    return GetDoubleFrom(this->db.get(), nullptr, key, val);
+}
 
-    *val = nullptr;
+int CryptoDB::MultiGet(std::vector<CryptoDBGetItem> &items)
+{
+    return MultiGetFrom(this->db.get(), nullptr, items);
+}
+
+int CryptoDB::Delete(std::string key)
+{
+    return this->Remove(CStringKey(key));
+}
+
+int CryptoDB::CreateBatch(CryptoDBBatch** batchptr)
+{
+    *batchptr = nullptr;
+
+    CryptoDBBatch *batch = new CryptoDBBatch();
 
-    err = cryptodb_get(&this->db,
-                       key.c_str(),
-                       strlen(key.c_str()) + 1,
-                       CRYPTODB_VAL_STRING,
-                       (void *)value);
+    int err = cryptodb_batch_create(this->db.get(), &batch->batch);
     if (CRYPTODB_SUCCESS != err)
     {
-        free(value);
+        delete batch;
         return err;
     }
 
-    *val = new std::string(value);
+    *batchptr = batch;
 
-    free(value);
+    return CRYPTODB_SUCCESS;
+}
+
+int CryptoDB::CreateIterator(cryptodb_iterator_options_t *options,
+                             CryptoDBIterator** iteratorptr)
+{
+    *iteratorptr = nullptr;
+
+    CryptoDBIterator *iterator = new CryptoDBIterator();
+
+    int err = cryptodb_iterator_create(this->db.get(), options, &iterator->iterator);
+    if (CRYPTODB_SUCCESS != err)
+    {
+        delete iterator;
+        return err;
+    }
+
+    *iteratorptr = iterator;
 
     return CRYPTODB_SUCCESS;
 }
 
-int CryptoDB::GetInteger(std::string key, int **val)
+int CryptoDB::CreateSnapshot(CryptoDBSnapshot** snapshotptr)
 {
-    int err = 0, value = 0;
+    *snapshotptr = nullptr;
 
-    *val = nullptr;
+    CryptoDBSnapshot *snapshot = new CryptoDBSnapshot();
 
-    err = cryptodb_get(&this->db,
-                       key.c_str(),
-                       strlen(key.c_str()) + 1,
-                       CRYPTODB_VAL_NUM_INT,
-                       (void *)&value);
+    int err = cryptodb_snapshot_create(this->db.get(), &snapshot->snapshot);
     if (CRYPTODB_SUCCESS != err)
+    {
+        delete snapshot;
         return err;
+    }
 
-    *val = new int(value);
+    *snapshotptr = snapshot;
 
     return CRYPTODB_SUCCESS;
 }
 
-int CryptoDB::GetDouble(std::string key, double **val)
+std::future<int> CryptoDB::PutStringAsync(std::string key, std::string val)
 {
-    int err = 0;
-    double value = 0.0;
+    std::promise<int> *promise = new std::promise<int>();
+    std::future<int> future = promise->get_future();
+    std::string_view ckey = CStringKey(key);
 
-    *val = nullptr;
+    AsyncSubmitted(promise, cryptodb_put_string_async(this->db.get(),
+                                                      ckey.data(),
+                                                      ckey.size(),
+                                                      val.c_str(),
+                                                      AsyncCompleted,
+                                                      promise));
+    return future;
+}
+
+std::future<int> CryptoDB::PutIntegerAsync(std::string key, int val)
+{
+    std::promise<int> *promise = new std::promise<int>();
+    std::future<int> future = promise->get_future();
+    std::string_view ckey = CStringKey(key);
+
+    AsyncSubmitted(promise, cryptodb_put_integer_async(this->db.get(),
+                                                       ckey.data(),
+                                                       ckey.size(),
+                                                       val,
+                                                       AsyncCompleted,
+                                                       promise));
+    return future;
+}
+
+std::future<int> CryptoDB::PutDoubleAsync(std::string key, double val)
+{
+    std::promise<int> *promise = new std::promise<int>();
+    std::future<int> future = promise->get_future();
+    std::string_view ckey = CStringKey(key);
+
+    AsyncSubmitted(promise, cryptodb_put_double_async(this->db.get(),
+                                                      ckey.data(),
+                                                      ckey.size(),
+                                                      val,
+                                                      AsyncCompleted,
+                                                      promise));
+    return future;
+}
 
-    err = cryptodb_get(&this->db,
-                       key.c_str(),
-                       strlen(key.c_str()) + 1,
-                       CRYPTODB_VAL_NUM_DOUBLE,
-                       (void *)&value);
+std::future<int> CryptoDB::DeleteAsync(std::string key)
+{
+    std::promise<int> *promise = new std::promise<int>();
+    std::future<int> future = promise->get_future();
+    std::string_view ckey = CStringKey(key);
+
+    AsyncSubmitted(promise, cryptodb_delete_async(this->db.get(),
+                                                  ckey.data(),
+                                                  ckey.size(),
+                                                  AsyncCompleted,
+                                                  promise));
+    return future;
+}
+
+int CryptoDB::Flush(void)
+{
+    return cryptodb_flush(this->db.get());
+}
+
+CryptoDBBatch::~CryptoDBBatch()
+{
+    cryptodb_batch_destroy(&this->batch);
+}
+
+int CryptoDBBatch::Put(std::string_view key, std::string_view val)
+{
+    return PutCString(val, [&](const char *value) {
+        return cryptodb_batch_put_string(&this->batch, key.data(), key.size(), value);
+    });
+}
+
+int CryptoDBBatch::Put(std::string_view key, int val)
+{
+    return cryptodb_batch_put_integer(&this->batch, key.data(), key.size(), val);
+}
+
+int CryptoDBBatch::Put(std::string_view key, double val)
+{
+    return cryptodb_batch_put_double(&this->batch, key.data(), key.size(), val);
+}
+
+int CryptoDBBatch::Put(std::string_view key, int64_t val)
+{
+    return cryptodb_batch_put_int64(&this->batch, key.data(), key.size(), val);
+}
+
+int CryptoDBBatch::Put(std::string_view key, uint64_t val)
+{
+    return cryptodb_batch_put_uint64(&this->batch, key.data(), key.size(), val);
+}
+
+int CryptoDBBatch::Put(std::string_view key, const void *data, size_t len)
+{
+    return cryptodb_batch_put_blob(&this->batch, key.data(), key.size(), data, len);
+}
+
+int CryptoDBBatch::Put(std::string_view key, const std::vector<uint8_t> &val)
+{
+    return this->Put(key, val.data(), val.size());
+}
+
+int CryptoDBBatch::Remove(std::string_view key)
+{
+    return cryptodb_batch_delete(&this->batch, key.data(), key.size());
+}
+
+int CryptoDBBatch::PutString(std::string key, std::string val)
+{
+    return this->Put(CStringKey(key), CStringValue(val));
+}
+
+int CryptoDBBatch::PutInteger(std::string key, int val)
+{
+    return this->Put(CStringKey(key), val);
+}
+
+int CryptoDBBatch::PutDouble(std::string key, double val)
+{
+    return this->Put(CStringKey(key), val);
+}
+
+int CryptoDBBatch::Delete(std::string key)
+{
+    return this->Remove(CStringKey(key));
+}
+
+void CryptoDBBatch::Clear(void)
+{
+    cryptodb_batch_clear(&this->batch);
+}
+
+int CryptoDBBatch::Commit(void)
+{
+    return cryptodb_batch_commit(&this->batch);
+}
+
+CryptoDBBulkLoad::~CryptoDBBulkLoad()
+{
+    cryptodb_bulk_abort(&this->bulk);
+}
+
+int CryptoDBBulkLoad::Begin(std::string path,
+                            uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN],
+                            size_t uniq_data_len,
+                            cryptodb_options_t *options,
+                            cryptodb_user_kdf user_kdf,
+                            void *kdf_user_data,
+                            CryptoDBBulkLoad** bulkptr)
+{
+    *bulkptr = nullptr;
+
+    CryptoDBBulkLoad *bulk = new CryptoDBBulkLoad();
+
+    int err = cryptodb_bulk_begin(path.c_str(),
+                                  uniq_data,
+                                  uniq_data_len,
+                                  options,
+                                  user_kdf,
+                                  kdf_user_data,
+                                  &bulk->bulk);
     if (CRYPTODB_SUCCESS != err)
+    {
+        delete bulk;
         return err;
+    }
 
-    *val = new double(value);
+    *bulkptr = bulk;
 
     return CRYPTODB_SUCCESS;
 }
 
-int CryptoDB::Delete(std::string key)
+int CryptoDBBulkLoad::Put(std::string_view key, std::string_view val)
+{
+    return PutCString(val, [&](const char *value) {
+        return cryptodb_bulk_put_string(&this->bulk, key.data(), key.size(), value);
+    });
+}
+
+int CryptoDBBulkLoad::Put(std::string_view key, int val)
+{
+    return cryptodb_bulk_put_integer(&this->bulk, key.data(), key.size(), val);
+}
+
+int CryptoDBBulkLoad::Put(std::string_view key, double val)
+{
+    return cryptodb_bulk_put_double(&this->bulk, key.data(), key.size(), val);
+}
+
+int CryptoDBBulkLoad::Put(std::string_view key, int64_t val)
+{
+    return cryptodb_bulk_put_int64(&this->bulk, key.data(), key.size(), val);
+}
+
+int CryptoDBBulkLoad::Put(std::string_view key, uint64_t val)
+{
+    return cryptodb_bulk_put_uint64(&this->bulk, key.data(), key.size(), val);
+}
+
+int CryptoDBBulkLoad::Put(std::string_view key, const void *data, size_t len)
+{
+    return cryptodb_bulk_put_blob(&this->bulk, key.data(), key.size(), data, len);
+}
+
+int CryptoDBBulkLoad::Put(std::string_view key, const std::vector<uint8_t> &val)
+{
+    return this->Put(key, val.data(), val.size());
+}
+
+int CryptoDBBulkLoad::PutString(std::string key, std::string val)
+{
+    return this->Put(CStringKey(key), CStringValue(val));
+}
+
+int CryptoDBBulkLoad::PutInteger(std::string key, int val)
+{
+    return this->Put(CStringKey(key), val);
+}
+
+int CryptoDBBulkLoad::PutDouble(std::string key, double val)
 {
-    return cryptodb_delete(&this->db,
-                           key.c_str(),
-                           strlen(key.c_str()) + 1);
+    return this->Put(CStringKey(key), val);
+}
+
+int CryptoDBBulkLoad::Commit(void)
+{
+    return cryptodb_bulk_commit(&this->bulk);
+}
+
+void CryptoDBBulkLoad::Abort(void)
+{
+    cryptodb_bulk_abort(&this->bulk);
+}
+
+CryptoDBSnapshot::~CryptoDBSnapshot()
+{
+    cryptodb_snapshot_release(&this->snapshot);
+}
+
+int CryptoDBSnapshot::Get(std::string_view key, std::string &val)
+{
+    return GetInto(nullptr, &this->snapshot, key, CRYPTODB_VAL_STRING, val);
+}
+
+int CryptoDBSnapshot::Get(std::string_view key, std::vector<uint8_t> &val)
+{
+    return GetInto(nullptr, &this->snapshot, key, CRYPTODB_VAL_BLOB, val);
+}
+
+int CryptoDBSnapshot::Get(std::string_view key, void *data, size_t &len)
+{
+    return GetData(nullptr, &this->snapshot, key, data, len);
+}
+
+int CryptoDBSnapshot::Get(std::string_view key, int &val)
+{
+    return ::cryptodb::Get(nullptr, &this->snapshot, key, CRYPTODB_VAL_NUM_INT, (void *)&val);
+}
+
+int CryptoDBSnapshot::Get(std::string_view key, double &val)
+{
+    return ::cryptodb::Get(nullptr, &this->snapshot, key, CRYPTODB_VAL_NUM_DOUBLE, (void *)&val);
+}
+
+int CryptoDBSnapshot::Get(std::string_view key, int64_t &val)
+{
+    return ::cryptodb::Get(nullptr, &this->snapshot, key, CRYPTODB_VAL_NUM_INT64, (void *)&val);
+}
+
+int CryptoDBSnapshot::Get(std::string_view key, uint64_t &val)
+{
+    return ::cryptodb::Get(nullptr, &this->snapshot, key, CRYPTODB_VAL_NUM_UINT64, (void *)&val);
+}
+
+std::optional<int> CryptoDBSnapshot::GetInteger(std::string_view key)
+{
+    return GetOptional<int>(nullptr, &this->snapshot, key, CRYPTODB_VAL_NUM_INT);
+}
+
+std::optional<double> CryptoDBSnapshot::GetDouble(std::string_view key)
+{
+    return GetOptional<double>(nullptr, &this->snapshot, key, CRYPTODB_VAL_NUM_DOUBLE);
+}
+
+std::optional<int64_t> CryptoDBSnapshot::GetInt64(std::string_view key)
+{
+    return GetOptional<int64_t>(nullptr, &this->snapshot, key, CRYPTODB_VAL_NUM_INT64);
+}
+
+std::optional<uint64_t> CryptoDBSnapshot::GetUInt64(std::string_view key)
+{
+    return GetOptional<uint64_t>(nullptr, &this->snapshot, key, CRYPTODB_VAL_NUM_UINT64);
+}
+
+int CryptoDBSnapshot::GetString(std::string key,
+                                int expected_max_length,
+                                std::string **val)
+{
+    return GetStringFrom(nullptr, &this->snapshot, key, expected_max_length, val);
+}
+
+int CryptoDBSnapshot::GetInteger(std::string key, int **val)
+{
+    return GetIntegerFrom(nullptr, &this->snapshot, key, val);
+}
+
+int CryptoDBSnapshot::GetDouble(std::string key, double **val)
+{
+    return GetDoubleFrom(nullptr, &this->snapshot, key, val);
+}
+
+int CryptoDBSnapshot::MultiGet(std::vector<CryptoDBGetItem> &items)
+{
+    return MultiGetFrom(nullptr, &this->snapshot, items);
+}
+
+int CryptoDBSnapshot::CreateIterator(cryptodb_iterator_options_t *options,
+                                     CryptoDBIterator** iteratorptr)
+{
+    cryptodb_iterator_options_t snapshot_options;
+
+    *iteratorptr = nullptr;
+
+    if (options)
+        snapshot_options = *options;
+    else
+        memset(&snapshot_options, 0, sizeof(snapshot_options));
+    snapshot_options.snapshot = &this->snapshot;
+
+    CryptoDBIterator *iterator = new CryptoDBIterator();
+
+    int err = cryptodb_iterator_create(this->snapshot.cryptodb,
+                                       &snapshot_options,
+                                       &iterator->iterator);
+    if (CRYPTODB_SUCCESS != err)
+    {
+        delete iterator;
+        return err;
+    }
+
+    *iteratorptr = iterator;
+
+    return CRYPTODB_SUCCESS;
+}
+
+const CryptoDBEntry &CryptoDBIterator::Position::operator*() const
+{
+    return this->iterator->entry;
+}
+
+const CryptoDBEntry *CryptoDBIterator::Position::operator->() const
+{
+    return &this->iterator->entry;
+}
+
+CryptoDBIterator::Position &CryptoDBIterator::Position::operator++()
+{
+    this->iterator->Next();
+    if (!this->iterator->Valid())
+        this->iterator = nullptr;
+    return *this;
+}
+
+bool CryptoDBIterator::Position::operator==(const Position &other) const
+{
+    return this->iterator == other.iterator;
+}
+
+bool CryptoDBIterator::Position::operator!=(const Position &other) const
+{
+    return this->iterator != other.iterator;
+}
+
+CryptoDBIterator::~CryptoDBIterator()
+{
+    cryptodb_iterator_destroy(&this->iterator);
+}
+
+CryptoDBIterator::Position CryptoDBIterator::begin(void)
+{
+    this->SeekToFirst();
+    return Position(this->Valid() ? this : nullptr);
+}
+
+CryptoDBIterator::Position CryptoDBIterator::end(void)
+{
+    return Position(nullptr);
+}
+
+void CryptoDBIterator::SeekToFirst(void)
+{
+    cryptodb_iterator_seek_to_first(&this->iterator);
+    this->Load();
+}
+
+int CryptoDBIterator::Seek(std::string key)
+{
+    std::string_view ckey = CStringKey(key);
+    int err = cryptodb_iterator_seek(&this->iterator, ckey.data(), ckey.size());
+    this->Load();
+    return err;
+}
+
+bool CryptoDBIterator::Valid(void)
+{
+    return cryptodb_iterator_valid(&this->iterator);
+}
+
+void CryptoDBIterator::Next(void)
+{
+    cryptodb_iterator_next(&this->iterator);
+    this->Load();
+}
+
+const CryptoDBEntry &CryptoDBIterator::Entry(void)
+{
+    return this->entry;
+}
+
+int CryptoDBIterator::Status(void)
+{
+    return cryptodb_iterator_status(&this->iterator);
+}
+
+/**
+ * Copies the current entry of the C iterator. Encrypted keys of
+ * CRYPTODB_KEY_MODE_AES_256_CBC are padded with zeros, so the trailing
+ * zeros are stripped there, other keys are copied as they are stored.
+ */
+void CryptoDBIterator::Load(void)
+{
+    const cryptodb_entry_t *e = cryptodb_iterator_entry(&this->iterator);
+
+    this->entry = CryptoDBEntry();
+    if (e == NULL)
+        return;
+
+    this->entry.result = e->result;
+    if (e->key)
+    {
+        const cryptodb_t *db = this->iterator.cryptodb;
+        size_t keylen = e->keylen;
+
+        if (db->key_mode == CRYPTODB_KEY_MODE_AES_256_CBC && !db->disable_keys_encryption)
+        {
+            while (keylen && e->key[keylen - 1] == '\0')
+                --keylen;
+        }
+        this->entry.key = std::string(e->key, keylen);
+    }
+    this->entry.type = e->valtype;
+    if (e->str && CRYPTODB_VAL_BLOB == e->valtype)
+        this->entry.blob.assign((const uint8_t *)e->str, (const uint8_t *)e->str + e->str_len);
+    else if (e->str)
+        this->entry.str = std::string(e->str, e->str_len);
+    this->entry.integer = e->integer;
+    this->entry.number = e->number;
+    this->entry.integer64 = e->integer64;
+    this->entry.uinteger64 = e->uinteger64;
 }
 
 } // namespace cryptodb
@@ -34,7 +34,7 @@
 #endif
 #endif
 
-#define CRYPTODB_VER_MAJOR    (1)
+#define CRYPTODB_VER_MAJOR    (2)
 #define CRYPTODB_VER_MINOR    (0)
 #define CRYPTODB_VER_REVISION (0)
 
@@ -46,16 +46,40 @@
 #define CRYPTODB_OPT_DEFAULT_BLOCK_SIZE    (4 * 1024)
 #define CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT  (16)
 #define CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE (2 * 1024 * 1024)
+#define CRYPTODB_OPT_DEFAULT_WORKER_THREADS (0)
+#define CRYPTODB_OPT_DEFAULT_PAR_DEC_THRESHOLD (256 * 1024)
+#define CRYPTODB_OPT_DEFAULT_SYNC_PERIOD_MS (100)
+#define CRYPTODB_OPT_DEFAULT_ASYNC_QUEUE_LEN (1024)
+#define CRYPTODB_OPT_DEFAULT_COMPRESSION_MIN_SAVING (10)
+
+// Minimal LevelDB write buffer and table file sizes of bulk-load sessions,
+// see cryptodb_bulk_begin()
+#define CRYPTODB_BULK_WR_BUF_SIZE    (32 * 1024 * 1024)
+#define CRYPTODB_BULK_MAX_FILE_SIZE  (32 * 1024 * 1024)
+
+#define CRYPTODB_OPT_MAX_WORKER_THREADS (64)
+
+/**
+ * Keys and values (after encoding and padding) up to this length are
+ * processed in stack buffers without heap allocations. Can be changed
+ * at build time with "-DCRYPTODB_SCRATCH_LEN=<bytes>" cmake option.
+ */
+#ifndef CRYPTODB_SCRATCH_LEN
+#define CRYPTODB_SCRATCH_LEN (512)
+#endif
 
 typedef enum {
     CRYPTODB_ERR_OK  = 0,
     CRYPTODB_SUCCESS = CRYPTODB_ERR_OK,
 
-    CRYPTODB_ERR_NULL_POINTER    = -1,
-    CRYPTODB_ERR_ALLOCATE_MEM    = -2,
-    CRYPTODB_ERR_WRONG_ARGUMENT  = -3,
-    CRYPTODB_ERR_ENCRYPTION_FAIL = -4,
-    CRYPTODB_ERR_DECRYPTION_FAIL = -5,
+    CRYPTODB_ERR_NULL_POINTER     = -1,
+    CRYPTODB_ERR_ALLOCATE_MEM     = -2,
+    CRYPTODB_ERR_WRONG_ARGUMENT   = -3,
+    CRYPTODB_ERR_ENCRYPTION_FAIL  = -4,
+    CRYPTODB_ERR_DECRYPTION_FAIL  = -5,
+    CRYPTODB_ERR_INTEGRITY_FAIL   = -6, // Value was modified or doesn't belong to the key
+    CRYPTODB_ERR_BUFFER_TOO_SMALL = -7, // Value doesn't fit the buffer, see cryptodb_get_buf()
+    CRYPTODB_ERR_MOVE_FAIL        = -8, // Folder wasn't moved, can be retried, see cryptodb_bulk_commit()
     // <-- New error types should be added here
 
     CRYPTODB_ERR_FAIL = -1024 // always last
@@ -65,11 +89,67 @@ typedef enum {
     CRYPTODB_VAL_STRING = 1,
     CRYPTODB_VAL_NUM_INT = 2,    // types: int, int32_t
     CRYPTODB_VAL_NUM_DOUBLE = 3, // types: double
+    CRYPTODB_VAL_BLOB = 4,       // types: cryptodb_blob_t, see cryptodb_put() and cryptodb_get_buf()
+    CRYPTODB_VAL_NUM_INT64 = 5,  // types: int64_t
+    CRYPTODB_VAL_NUM_UINT64 = 6, // types: uint64_t
     // <-- New value types should be added here
 
     CRYPTODB_VAL_UNKNOWN // always last
 } cryptodb_val_t;
 
+typedef enum {
+    CRYPTODB_CIPHER_AES_256_CBC = 0, // Fixed IV from the KDF, values are padded
+    CRYPTODB_CIPHER_AES_256_GCM = 1, // Random nonce per value, no padding, authenticated
+    // <-- New value ciphers should be added here
+
+    CRYPTODB_CIPHER_UNKNOWN // always last
+} cryptodb_cipher_t;
+
+typedef enum {
+    CRYPTODB_KEY_MODE_AES_256_CBC = 0, // Key is padded to 16 bytes blocks and encrypted
+    CRYPTODB_KEY_MODE_TOKEN_128   = 1, // 16 bytes AES-256-CMAC of the key
+    CRYPTODB_KEY_MODE_TOKEN_256   = 2, // 32 bytes, two AES-256-CMAC of the key
+    // <-- New key modes should be added here
+
+    CRYPTODB_KEY_MODE_UNKNOWN // always last
+} cryptodb_key_mode_t;
+
+typedef enum {
+    CRYPTODB_DURABILITY_SYNC         = 0, // Every write is synced to disk before it returns
+    CRYPTODB_DURABILITY_GROUP_COMMIT = 1, // Every write is durable when it returns, writes
+                                          // of concurrent threads share one sync
+    CRYPTODB_DURABILITY_PERIODIC     = 2, // Writes are synced in background every
+                                          // "sync_period_ms", the last writes can be lost
+                                          // on a power failure (but not on a crash of the
+                                          // application)
+    // <-- New durability policies should be added here
+
+    CRYPTODB_DURABILITY_UNKNOWN // always last
+} cryptodb_durability_t;
+
+typedef enum {
+    CRYPTODB_COMPRESSION_NONE = 0, // Values are stored as they are
+    CRYPTODB_COMPRESSION_LZ4  = 1, // LZ4 block format, built-in codec
+    // <-- New compression codecs should be added here
+
+    CRYPTODB_COMPRESSION_UNKNOWN // always last
+} cryptodb_compression_t;
+
+typedef enum {
+    CRYPTODB_AES_BACKEND_PORTABLE = 0, // mbedcrypto
+    CRYPTODB_AES_BACKEND_AESNI    = 1, // x86/x86_64 AES-NI
+    CRYPTODB_AES_BACKEND_ARMV8_CE = 2, // ARMv8 Crypto Extensions
+    // <-- New AES backends should be added here
+
+    CRYPTODB_AES_BACKEND_UNKNOWN // always last
+} cryptodb_aes_backend_t;
+
+/**
+ * CPU features detected at runtime, see cryptodb_cpu_features()
+ */
+#define CRYPTODB_CPU_AES   (1u << 0) // x86 AES-NI or ARMv8 AES instructions
+#define CRYPTODB_CPU_CLMUL (1u << 1) // x86 PCLMULQDQ or ARMv8 PMULL instructions
+
 /**
  * User defined KDF (Key Derivation Function) function. User can
  * optionally specify it in cryptodb_open.
@@ -87,10 +167,26 @@ typedef int (*cryptodb_user_kdf)(void *cryptodb,
                                  uint8_t encryption_iv[16],
                                  void *user_data);
 
+/**
+ * User defined KDF epoch function. User can optionally specify it in
+ * cryptodb_options_t (see "kdf_epoch" below).
+ *
+ * The encryption key and IV are derived only once in cryptodb_open() and
+ * cached in the database handler. If "user_kdf" rotates keys, it should
+ * provide this function as well. It's called before every database
+ * operation and every time when returned value differs from the previous
+ * one, the cached key and IV are derived again with "user_kdf".
+ *
+ * "void *cryptodb" should be a pointer to cryptodb_t handler (see below)
+ * "void *user_data" is "kdf_user_data" from cryptodb_open()
+ */
+typedef uint64_t (*cryptodb_user_kdf_epoch)(void *cryptodb,
+                                            void *user_data);
+
 typedef struct {
     void *db;
     void *env;
-    void *cmp;
+    void *cmp; // NULL unless the database was created by an older version, see cryptodb_migrate()
     void *cache;
     void *options;
     void *roptions;
@@ -101,8 +197,195 @@ typedef struct {
     cryptodb_user_kdf user_kdf;
     void *kdf_user_data;
     int disable_keys_encryption; // See cryptodb_options_t below
+    void *keystore; // Cached encryption keys, zeroed in cryptodb_close()
+    void *stats; // See cryptodb_stats_t
+    void *pool; // Worker threads, see "worker_threads" in cryptodb_options_t
+    size_t parallel_decrypt_threshold; // See cryptodb_options_t below
+    cryptodb_cipher_t value_cipher; // See cryptodb_options_t below
+    cryptodb_key_mode_t key_mode; // See cryptodb_options_t below
+    int keep_original_keys; // See cryptodb_options_t below
+    cryptodb_durability_t durability; // See cryptodb_options_t below
+    void *syncer; // Sync scheduler, see "durability" in cryptodb_options_t
+    void *writer; // Writer of asynchronous operations, see cryptodb_put_async()
+    void *filter; // Bloom filter policy, see "bloom_bits_per_key" in cryptodb_options_t
+    cryptodb_compression_t compression; // See cryptodb_options_t below
+    unsigned int compression_min_saving; // See cryptodb_options_t below
 } cryptodb_t;
 
+/**
+ * cryptodb_batch_t
+ *
+ * Group of put/delete operations that cryptodb_batch_commit() writes to
+ * the database atomically, with one sync. Keys and values are encrypted
+ * when the operations are added, so commit only writes them.
+ */
+typedef struct {
+    cryptodb_t *cryptodb; // Database handler, see cryptodb_batch_create()
+    void *batch; // LevelDB write batch
+    size_t puts; // Put operations in the batch
+    size_t deletes; // Delete operations in the batch
+} cryptodb_batch_t;
+
+/**
+ * cryptodb_bulk_t
+ *
+ * Bulk-load session, see cryptodb_bulk_begin(). Entries are loaded into
+ * a separate staging database that replaces the database folder only
+ * when cryptodb_bulk_commit() is done.
+ */
+typedef struct {
+    cryptodb_t cryptodb; // Handler of the staging database
+    void *state; // Buffered entries and paths of the session
+    size_t puts; // Entries written to the staging database so far
+} cryptodb_bulk_t;
+
+/**
+ * cryptodb_snapshot_t
+ *
+ * Consistent read-only view of the database as it was when the snapshot
+ * was created, see cryptodb_snapshot_create(). Writes don't wait for
+ * snapshots, they just aren't seen through them.
+ */
+typedef struct {
+    cryptodb_t *cryptodb; // Database handler, see cryptodb_snapshot_create()
+    void *snapshot; // LevelDB snapshot
+    void *roptions; // LevelDB read options of the snapshot
+} cryptodb_snapshot_t;
+
+/**
+ * cryptodb_blob_t
+ *
+ * Value of CRYPTODB_VAL_BLOB type, binary data of explicit length that is
+ * stored as it is. See cryptodb_put().
+ */
+typedef struct {
+    const void *data; // Binary data, can be NULL if "len" is 0
+    size_t len; // "data" length
+} cryptodb_blob_t;
+
+/**
+ * cryptodb_get_item_t
+ *
+ * One entry of cryptodb_multi_get()
+ */
+typedef struct {
+    const char *key; // Database entry key
+    size_t keylen; // Database entry key length
+    cryptodb_val_t valtype; // Database entry value type, see cryptodb_get().
+                            // CRYPTODB_VAL_BLOB isn't supported.
+    void *val; // Database entry value, see cryptodb_get()
+    int result; // Output, what cryptodb_get() would return for the entry
+} cryptodb_get_item_t;
+
+/**
+ * cryptodb_entry_t
+ *
+ * Decrypted database entry, see cryptodb_iterator_entry()
+ */
+typedef struct {
+    int result; // cryptodb_err_t of the entry decryption, other fields
+                // are set only if it's CRYPTODB_SUCCESS
+    const char *key; // Zero-terminated entry key that finds the entry with
+                     // cryptodb_get(), NULL if the key can't be recovered.
+                     // With CRYPTODB_KEY_MODE_AES_256_CBC it's padded
+                     // with zeros to 16 bytes blocks. With token key modes
+                     // it's known only if the entry was written with
+                     // "keep_original_keys".
+    size_t keylen; // Entry key length, 0 if "key" is NULL
+    cryptodb_val_t valtype; // Entry value type
+    const char *str; // Zero-terminated value of CRYPTODB_VAL_STRING type,
+                     // or data of CRYPTODB_VAL_BLOB type
+    size_t str_len; // Length of "str" without the terminating zero
+    int integer; // Value of CRYPTODB_VAL_NUM_INT type
+    double number; // Value of CRYPTODB_VAL_NUM_DOUBLE type
+    int64_t integer64; // Value of CRYPTODB_VAL_NUM_INT64 type
+    uint64_t uinteger64; // Value of CRYPTODB_VAL_NUM_UINT64 type
+} cryptodb_entry_t;
+
+/**
+ * cryptodb_iterator_options_t
+ *
+ * See cryptodb_iterator_create()
+ */
+typedef struct {
+    int fill_cache; // If not 0, blocks that are read by the iterator are put
+                    // into the block cache. By default they aren't, so a full
+                    // scan doesn't evict the entries that are read often.
+    size_t read_ahead; // Number of entries that a background thread of the
+                       // iterator decrypts ahead while the caller handles
+                       // the current one. 0 means that every entry is
+                       // decrypted by the calling thread in
+                       // cryptodb_iterator_next().
+    // Bounds and prefix are supported only with "disable_keys_encryption"
+    // (see cryptodb_options_t), otherwise keys are stored encrypted and
+    // their order isn't the order of the keys. Keys are compared bytewise
+    // (including the terminating zero if it's a part of the key length).
+    // Entries out of the bounds aren't read and decrypted.
+    const char *lower_bound; // (Optional, can be NULL) The least key of the iterated entries
+    size_t lower_bound_len; // "lower_bound" length
+    const char *upper_bound; // (Optional, can be NULL) Entries with this key and greater
+                             // aren't iterated
+    size_t upper_bound_len; // "upper_bound" length
+    const char *prefix; // (Optional, can be NULL) Only entries with keys that start with
+                        // the prefix are iterated, can be combined with the bounds
+    size_t prefix_len; // "prefix" length
+    int reverse; // If not 0, entries are iterated from the greatest key to the least one
+    const cryptodb_snapshot_t *snapshot; // (Optional, can be NULL) Snapshot of the same
+                                         // handler to iterate, by default the iterator
+                                         // uses its own snapshot
+} cryptodb_iterator_options_t;
+
+/**
+ * cryptodb_iterator_t
+ *
+ * Iterator over all entries of the database. It sees the database as it
+ * was when the iterator was created.
+ */
+typedef struct {
+    cryptodb_t *cryptodb; // Database handler, see cryptodb_iterator_create()
+    void *it; // LevelDB iterator
+    void *roptions; // LevelDB read options of the iterator
+    void *readahead; // Decrypted entries, see "read_ahead" in cryptodb_iterator_options_t
+    void *entry; // The current entry, NULL if the iterator isn't valid
+    void *range; // Bounds and direction, see cryptodb_iterator_options_t
+} cryptodb_iterator_t;
+
+/**
+ * Completion callback of asynchronous operations, see cryptodb_put_async().
+ *
+ * It's called from the writer thread of the database handler when the
+ * operation is written (and synced according to "durability" in
+ * cryptodb_options_t). "result" is cryptodb_err_t of the write.
+ * The callback shouldn't block for long and shouldn't call asynchronous
+ * operations, cryptodb_flush() or cryptodb_close() of the same handler.
+ */
+typedef void (*cryptodb_write_cb)(cryptodb_t *cryptodb,
+                                  int result,
+                                  void *user_data);
+
+/**
+ * cryptodb_stats_t
+ *
+ * Database handler statistics since cryptodb_open(), see cryptodb_get_stats()
+ */
+typedef struct {
+    uint64_t puts;        // Successful cryptodb_put() calls and committed batch puts
+    uint64_t gets;        // Successful cryptodb_get() calls, cryptodb_multi_get() entries
+                          // and entries decrypted by iterators
+    uint64_t deletes;     // Successful cryptodb_delete() calls and committed batch deletes
+    uint64_t heap_allocs; // Heap buffers allocated by put/get/delete, i.e. for keys or
+                          // values longer than CRYPTODB_SCRATCH_LEN. The value buffer
+                          // that LevelDB allocates in get isn't counted.
+                          // cryptodb_multi_get() also allocates its entries state,
+                          // iterators allocate a buffer for every entry.
+    uint64_t syncs;       // Synced writes to the disk, see "durability" in cryptodb_options_t
+    uint64_t filter_checks; // Lookups of keys in disk tables that checked the bloom filter,
+                            // see "bloom_bits_per_key" in cryptodb_options_t
+    uint64_t filter_avoided_reads; // Of "filter_checks", the lookups where the filter answered
+                                   // that the key isn't in the table, so its data block
+                                   // wasn't read
+} cryptodb_stats_t;
+
 /**
  * cryptodb_options_t
  *
@@ -138,6 +421,51 @@ typedef struct {
                           // Another reason to increase this parameter might be when you are
                           // initially populating a large database.
     int disable_keys_encryption; // If not 0, entry keys will not be encrypted, only values
+    cryptodb_user_kdf_epoch kdf_epoch; // (Optional, can be NULL) See cryptodb_user_kdf_epoch
+    unsigned int worker_threads; // Number of worker threads of the database handler, up to
+                                 // CRYPTODB_OPT_MAX_WORKER_THREADS. 0 means that everything
+                                 // is done by the calling thread.
+    size_t parallel_decrypt_threshold; // Values of this size and larger are decrypted (and
+                                       // with AES-256-GCM also encrypted) by the calling
+                                       // thread and "worker_threads" together.
+                                       // If 0, CRYPTODB_OPT_DEFAULT_PAR_DEC_THRESHOLD is used.
+    cryptodb_cipher_t value_cipher; // Cipher of new values, see cryptodb_cipher_t. Every value
+                                    // is marked with its cipher, so values that were written
+                                    // with any cipher are readable. Keys are always encrypted
+                                    // with AES-256-CBC.
+    cryptodb_key_mode_t key_mode; // How keys are stored in the database, see cryptodb_key_mode_t.
+                                  // Token modes store a fixed-size keyed hash of every key
+                                  // instead of the encrypted key, so all database keys are
+                                  // 16 or 32 bytes long whatever the key length is. The mode
+                                  // can't be changed for an existing database, entries that
+                                  // were written with another mode aren't found.
+                                  // Ignored if "disable_keys_encryption" is set.
+    int keep_original_keys; // If not 0 and "key_mode" is a token mode, the original key is
+                            // stored (encrypted) in every written value, so it can be
+                            // recovered and cryptodb_get() checks that the value belongs
+                            // to the requested key.
+    cryptodb_durability_t durability; // When puts, deletes and batch commits are synced to
+                                      // disk, see cryptodb_durability_t.
+    unsigned int sync_period_ms; // Sync period of CRYPTODB_DURABILITY_PERIODIC.
+                                 // If 0, CRYPTODB_OPT_DEFAULT_SYNC_PERIOD_MS is used.
+    size_t async_queue_len; // Maximum number of asynchronous operations that are queued
+                            // or being written, cryptodb_put_async() and
+                            // cryptodb_delete_async() block when it's reached.
+                            // If 0, CRYPTODB_OPT_DEFAULT_ASYNC_QUEUE_LEN is used.
+    int bloom_bits_per_key; // If not 0, every disk table gets a bloom filter with this number
+                            // of bits per key, so lookups of missing keys mostly don't read
+                            // data blocks. 10 bits give about 1% false positives. The filter
+                            // is compatible with the LevelDB built-in bloom filter. Tables
+                            // written without the filter are read as before.
+    cryptodb_compression_t compression; // Codec that compresses new values before they are
+                                        // encrypted, see cryptodb_compression_t. Every
+                                        // compressed value is marked with its codec, so
+                                        // values are readable with any "compression".
+    unsigned int compression_min_saving; // A value is stored compressed only if compression
+                                         // saves at least this percentage of its size,
+                                         // otherwise it's stored as it is.
+                                         // If 0, CRYPTODB_OPT_DEFAULT_COMPRESSION_MIN_SAVING
+                                         // is used.
 } cryptodb_options_t;
 
 #ifdef __cplusplus
@@ -163,6 +491,42 @@ CRYPTODB_EXPORT const char * cryptodb_err_to_str(cryptodb_err_t err);
  */
 CRYPTODB_EXPORT const char * cryptodb_val_to_str(cryptodb_val_t val);
 
+/**
+ * @brief      Return string representation of cryptodb_aes_backend_t
+ *
+ * @param[in]  backend   See cryptodb_aes_backend_t
+ *
+ * @return     String representation of cryptodb_aes_backend_t
+ */
+CRYPTODB_EXPORT const char * cryptodb_aes_backend_to_str(cryptodb_aes_backend_t backend);
+
+/**
+ * @brief      Return AES backend that is used for encryption/decryption.
+ *             It's selected once at runtime: hardware kernels are used
+ *             only if the CPU supports them and they passed the self-test,
+ *             otherwise the portable mbedcrypto path is used.
+ *
+ * @return     See cryptodb_aes_backend_t
+ */
+CRYPTODB_EXPORT cryptodb_aes_backend_t cryptodb_aes_backend(void);
+
+/**
+ * @brief      Return CPU features detected at runtime
+ *
+ * @return     Bit mask of CRYPTODB_CPU_* flags
+ */
+CRYPTODB_EXPORT unsigned int cryptodb_cpu_features(void);
+
+/**
+ * @brief      Check that the selected AES backend produces output that
+ *             is bit-identical to the mbedcrypto path (and to FIPS-197,
+ *             GCM and CMAC test vectors), so the databases stay compatible
+ *             between machines with and without hardware AES.
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_aes_self_test(void);
+
 /**
  * @brief      Open database that is located in specified "path" folder.
  *             The database will be created if not exist.
@@ -227,6 +591,11 @@ CRYPTODB_EXPORT void cryptodb_close(cryptodb_t *cryptodb);
  *             * if valtype = CRYPTODB_VAL_STRING     - strlen((const char *)val) + 1
  *             * if valtype = CRYPTODB_VAL_NUM_INT    - sizeof(int)
  *             * if valtype = CRYPTODB_VAL_NUM_DOUBLE - sizeof(double)
+ *             * if valtype = CRYPTODB_VAL_NUM_INT64  - sizeof(int64_t)
+ *             * if valtype = CRYPTODB_VAL_NUM_UINT64 - sizeof(uint64_t)
+ *             * if valtype = CRYPTODB_VAL_BLOB       - "len" of cryptodb_blob_t,
+ *                                                      "val" points to cryptodb_blob_t
+ *             Numbers are stored as fixed-width little-endian payloads.
  *
  * @param[in]  cryptodb  Database handler
  * @param[in]  key       Database entry key
@@ -264,15 +633,45 @@ CRYPTODB_EXPORT int cryptodb_put_integer(cryptodb_t *cryptodb,
 CRYPTODB_EXPORT int cryptodb_put_double(cryptodb_t *cryptodb,
                                         const char* key, size_t keylen, double val);
 
+/**
+ * @brief      "cryptodb_put" wrapper where valtype == CRYPTODB_VAL_NUM_INT64
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_put_int64(cryptodb_t *cryptodb,
+                                       const char* key, size_t keylen, int64_t val);
+
+/**
+ * @brief      "cryptodb_put" wrapper where valtype == CRYPTODB_VAL_NUM_UINT64
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_put_uint64(cryptodb_t *cryptodb,
+                                        const char* key, size_t keylen, uint64_t val);
+
+/**
+ * @brief      "cryptodb_put" wrapper where valtype == CRYPTODB_VAL_BLOB
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_put_blob(cryptodb_t *cryptodb,
+                                      const char* key, size_t keylen,
+                                      const void *data, size_t len);
+
 /**
  * @brief      Get value of the entry that is assosiated with specified key.
  *             The value length should be determined in the following way:
  *             * if valtype = CRYPTODB_VAL_STRING     - strlen((const char *)val) + 1
  *             * if valtype = CRYPTODB_VAL_NUM_INT    - sizeof(int)
  *             * if valtype = CRYPTODB_VAL_NUM_DOUBLE - sizeof(double)
+ *             * if valtype = CRYPTODB_VAL_NUM_INT64  - sizeof(int64_t)
+ *             * if valtype = CRYPTODB_VAL_NUM_UINT64 - sizeof(uint64_t)
  *             If actual value type is not same as was specified in "valtype"
  *             the function doesn't touch "val" pointer and returns actual
  *             value type - cryptodb_val_t
+ *             CRYPTODB_VAL_BLOB values have no length known in advance, they
+ *             are read with cryptodb_get_buf(), "valtype" = CRYPTODB_VAL_BLOB
+ *             gives CRYPTODB_ERR_WRONG_ARGUMENT.
  *
  * @param[in]   cryptodb  Database handler
  * @param[in]   key       Database entry key
@@ -286,6 +685,237 @@ CRYPTODB_EXPORT int cryptodb_get(cryptodb_t *cryptodb,
                                  const char* key, size_t keylen,
                                  cryptodb_val_t valtype, void *val);
 
+/**
+ * @brief      "cryptodb_get" wrapper where valtype == CRYPTODB_VAL_NUM_INT64
+ *
+ * @return     cryptodb_err_t or cryptodb_val_t, see cryptodb_get()
+ */
+CRYPTODB_EXPORT int cryptodb_get_int64(cryptodb_t *cryptodb,
+                                       const char* key, size_t keylen, int64_t *val);
+
+/**
+ * @brief      "cryptodb_get" wrapper where valtype == CRYPTODB_VAL_NUM_UINT64
+ *
+ * @return     cryptodb_err_t or cryptodb_val_t, see cryptodb_get()
+ */
+CRYPTODB_EXPORT int cryptodb_get_uint64(cryptodb_t *cryptodb,
+                                        const char* key, size_t keylen, uint64_t *val);
+
+/**
+ * @brief      Get value of the entry that is assosiated with specified key
+ *             into the caller's buffer, whatever the value type is. The
+ *             value is written only if it fits into "buf_cap" bytes, its
+ *             length and type are reported anyway, so the buffer can be
+ *             reused between calls and grown only when a value doesn't
+ *             fit. The value length is the same as in cryptodb_get(),
+ *             e.g. a string value takes strlen() + 1 bytes, a
+ *             CRYPTODB_VAL_BLOB value takes exactly its length.
+ *
+ * @param[in]   cryptodb  Database handler
+ * @param[in]   key       Database entry key
+ * @param[in]   keylen    Database entry key length
+ * @param[out]  buf       Buffer of the value, can be NULL if "buf_cap" is 0
+ * @param[in]   buf_cap   "buf" size
+ * @param[out]  out_len   Value length, set on CRYPTODB_SUCCESS and
+ *                        CRYPTODB_ERR_BUFFER_TOO_SMALL, otherwise 0
+ * @param[out]  type      (Optional, can be NULL) Value type, set on
+ *                        CRYPTODB_SUCCESS and CRYPTODB_ERR_BUFFER_TOO_SMALL,
+ *                        otherwise CRYPTODB_VAL_UNKNOWN
+ *
+ * @return     See cryptodb_err_t. CRYPTODB_ERR_BUFFER_TOO_SMALL if the value
+ *             is longer than "buf_cap", "buf" isn't touched then.
+ */
+CRYPTODB_EXPORT int cryptodb_get_buf(cryptodb_t *cryptodb,
+                                     const char* key, size_t keylen,
+                                     void *buf, size_t buf_cap,
+                                     size_t *out_len, cryptodb_val_t *type);
+
+/**
+ * @brief      Get values of several entries at once. All entries are read
+ *             from the same snapshot of the database, so they are
+ *             consistent with each other even if other threads write
+ *             meanwhile. Values are decrypted by the calling thread and
+ *             "worker_threads" (see cryptodb_options_t) together.
+ *
+ * @param[in]  cryptodb  Database handler
+ * @param      items     Entries, see cryptodb_get_item_t. The result of
+ *                       every entry is written to its "result" field, so
+ *                       e.g. a missing entry doesn't fail the others.
+ * @param[in]  count     Number of entries
+ *
+ * @return     See cryptodb_err_t. CRYPTODB_SUCCESS means that all entries
+ *             were looked up, see their "result" fields.
+ */
+CRYPTODB_EXPORT int cryptodb_multi_get(cryptodb_t *cryptodb,
+                                       cryptodb_get_item_t *items,
+                                       size_t count);
+
+/**
+ * @brief      Create snapshot of the database. Gets, multi-gets and
+ *             iterators of the snapshot (see cryptodb_snapshot_get(),
+ *             cryptodb_snapshot_multi_get() and "snapshot" in
+ *             cryptodb_iterator_options_t) see the database as it was when
+ *             the snapshot was created, whatever is written meanwhile.
+ *             Must be paired with cryptodb_snapshot_release() before the
+ *             handler is closed. LevelDB keeps the entries overwritten
+ *             after the snapshot until it's released, so long-lived
+ *             snapshots take disk space.
+ *
+ * @param[in]  cryptodb  Database handler
+ * @param[out] snapshot  See cryptodb_snapshot_t
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_snapshot_create(cryptodb_t *cryptodb,
+                                             cryptodb_snapshot_t *snapshot);
+
+/**
+ * @brief      Release snapshot. Iterators of the snapshot should be
+ *             destroyed before.
+ *
+ * @param[in]  snapshot  See cryptodb_snapshot_t
+ */
+CRYPTODB_EXPORT void cryptodb_snapshot_release(cryptodb_snapshot_t *snapshot);
+
+/**
+ * @brief      cryptodb_get() from the snapshot
+ *
+ * @param[in]   snapshot  See cryptodb_snapshot_t
+ * @param[in]   key       Database entry key
+ * @param[in]   keylen    Database entry key length
+ * @param[in]   valtype   See cryptodb_val_t
+ * @param[out]  val       Pointer to entry value
+ *
+ * @return     cryptodb_err_t or cryptodb_val_t, see cryptodb_get()
+ */
+CRYPTODB_EXPORT int cryptodb_snapshot_get(cryptodb_snapshot_t *snapshot,
+                                          const char* key, size_t keylen,
+                                          cryptodb_val_t valtype, void *val);
+
+/**
+ * @brief      cryptodb_get_buf() from the snapshot
+ *
+ * @param[in]   snapshot  See cryptodb_snapshot_t
+ * @param[in]   key       Database entry key
+ * @param[in]   keylen    Database entry key length
+ * @param[out]  buf       Buffer of the value, see cryptodb_get_buf()
+ * @param[in]   buf_cap   "buf" size
+ * @param[out]  out_len   Value length, see cryptodb_get_buf()
+ * @param[out]  type      (Optional, can be NULL) Value type
+ *
+ * @return     See cryptodb_get_buf()
+ */
+CRYPTODB_EXPORT int cryptodb_snapshot_get_buf(cryptodb_snapshot_t *snapshot,
+                                              const char* key, size_t keylen,
+                                              void *buf, size_t buf_cap,
+                                              size_t *out_len, cryptodb_val_t *type);
+
+/**
+ * @brief      cryptodb_multi_get() from the snapshot
+ *
+ * @param[in]  snapshot  See cryptodb_snapshot_t
+ * @param      items     Entries, see cryptodb_get_item_t
+ * @param[in]  count     Number of entries
+ *
+ * @return     See cryptodb_multi_get()
+ */
+CRYPTODB_EXPORT int cryptodb_snapshot_multi_get(cryptodb_snapshot_t *snapshot,
+                                                cryptodb_get_item_t *items,
+                                                size_t count);
+
+/**
+ * @brief      Create iterator over all entries of the database (or over
+ *             a range of them, see cryptodb_iterator_options_t). The entries
+ *             are returned in the order of LevelDB keys, i.e. of encrypted
+ *             keys (or key tokens), not of the original keys. Must be
+ *             paired with cryptodb_iterator_destroy() before the handler
+ *             is closed. The iterator shouldn't be copied or used from
+ *             several threads at once.
+ *
+ * @param[in]  cryptodb  Database handler
+ * @param[in]  options   (Optional, can be NULL)
+ *                       See cryptodb_iterator_options_t. If NULL, default
+ *                       fields will be used.
+ * @param[out] iterator  See cryptodb_iterator_t. It isn't valid until
+ *                       cryptodb_iterator_seek_to_first().
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_iterator_create(cryptodb_t *cryptodb,
+                                             cryptodb_iterator_options_t *options,
+                                             cryptodb_iterator_t *iterator);
+
+/**
+ * @brief      Destroy iterator
+ *
+ * @param[in]  iterator  See cryptodb_iterator_t
+ */
+CRYPTODB_EXPORT void cryptodb_iterator_destroy(cryptodb_iterator_t *iterator);
+
+/**
+ * @brief      Position the iterator at the first entry of the database
+ *             (the first entry within the bounds, or the last one in the
+ *             reverse order, see cryptodb_iterator_options_t)
+ *
+ * @param[in]  iterator  See cryptodb_iterator_t
+ */
+CRYPTODB_EXPORT void cryptodb_iterator_seek_to_first(cryptodb_iterator_t *iterator);
+
+/**
+ * @brief      Position the iterator at the first entry with the key that
+ *             is equal to or greater than "key" (less than or equal to
+ *             it in the reverse order), within the bounds of the iterator.
+ *             Supported only with "disable_keys_encryption", see
+ *             cryptodb_iterator_options_t.
+ *
+ * @param[in]  iterator  See cryptodb_iterator_t
+ * @param[in]  key       Database entry key
+ * @param[in]  keylen    Database entry key length
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_iterator_seek(cryptodb_iterator_t *iterator,
+                                           const char *key, size_t keylen);
+
+/**
+ * @brief      Check that the iterator is positioned at an entry
+ *
+ * @param[in]  iterator  See cryptodb_iterator_t
+ *
+ * @return     false if all entries were iterated or on LevelDB error,
+ *             see cryptodb_iterator_status()
+ */
+CRYPTODB_EXPORT bool cryptodb_iterator_valid(cryptodb_iterator_t *iterator);
+
+/**
+ * @brief      Move the iterator to the next entry. The current entry is
+ *             zeroed and freed.
+ *
+ * @param[in]  iterator  See cryptodb_iterator_t
+ */
+CRYPTODB_EXPORT void cryptodb_iterator_next(cryptodb_iterator_t *iterator);
+
+/**
+ * @brief      Get the current entry. It's valid until the iterator is moved
+ *             or destroyed. An entry that can't be decrypted doesn't stop
+ *             the iteration, check its "result" field.
+ *
+ * @param[in]  iterator  See cryptodb_iterator_t
+ *
+ * @return     See cryptodb_entry_t, NULL if the iterator isn't valid
+ */
+CRYPTODB_EXPORT const cryptodb_entry_t * cryptodb_iterator_entry(cryptodb_iterator_t *iterator);
+
+/**
+ * @brief      Get LevelDB error that stopped the iteration, e.g. a
+ *             corrupted block
+ *
+ * @param[in]  iterator  See cryptodb_iterator_t
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_iterator_status(cryptodb_iterator_t *iterator);
+
 /**
  * @brief      Delete entry with specified key from the database
  *
@@ -298,6 +928,374 @@ CRYPTODB_EXPORT int cryptodb_get(cryptodb_t *cryptodb,
 CRYPTODB_EXPORT int cryptodb_delete(cryptodb_t *cryptodb,
                                     const char* key, size_t keylen);
 
+/**
+ * @brief      Create write batch of the database handler. Must be paired
+ *             with cryptodb_batch_destroy() before the handler is closed.
+ *             The batch shouldn't be used from several threads at once.
+ *
+ * @param[in]  cryptodb  Database handler
+ * @param[out] batch     See cryptodb_batch_t
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_batch_create(cryptodb_t *cryptodb,
+                                          cryptodb_batch_t *batch);
+
+/**
+ * @brief      Destroy write batch, operations that weren't committed
+ *             are dropped
+ *
+ * @param[in]  batch  See cryptodb_batch_t
+ */
+CRYPTODB_EXPORT void cryptodb_batch_destroy(cryptodb_batch_t *batch);
+
+/**
+ * @brief      Add "key-value" entry to the batch, see cryptodb_put().
+ *             The entry is encrypted right away and isn't visible in
+ *             the database until cryptodb_batch_commit().
+ *
+ * @param[in]  batch    See cryptodb_batch_t
+ * @param[in]  key      Database entry key
+ * @param[in]  keylen   Database entry key length
+ * @param[in]  valtype  See cryptodb_val_t
+ * @param[in]  val      Pointer to entry value
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_batch_put(cryptodb_batch_t *batch,
+                                       const char* key, size_t keylen,
+                                       cryptodb_val_t valtype, void *val);
+
+/**
+ * @brief      "cryptodb_batch_put" wrapper where valtype == CRYPTODB_VAL_STRING
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_batch_put_string(cryptodb_batch_t *batch,
+                                              const char* key, size_t keylen, const char *val);
+
+/**
+ * @brief      "cryptodb_batch_put" wrapper where valtype == CRYPTODB_VAL_NUM_INT
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_batch_put_integer(cryptodb_batch_t *batch,
+                                               const char* key, size_t keylen, int val);
+
+/**
+ * @brief      "cryptodb_batch_put" wrapper where valtype == CRYPTODB_VAL_NUM_DOUBLE
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_batch_put_double(cryptodb_batch_t *batch,
+                                              const char* key, size_t keylen, double val);
+
+/**
+ * @brief      "cryptodb_batch_put" wrapper where valtype == CRYPTODB_VAL_NUM_INT64
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_batch_put_int64(cryptodb_batch_t *batch,
+                                             const char* key, size_t keylen, int64_t val);
+
+/**
+ * @brief      "cryptodb_batch_put" wrapper where valtype == CRYPTODB_VAL_NUM_UINT64
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_batch_put_uint64(cryptodb_batch_t *batch,
+                                              const char* key, size_t keylen, uint64_t val);
+
+/**
+ * @brief      "cryptodb_batch_put" wrapper where valtype == CRYPTODB_VAL_BLOB
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_batch_put_blob(cryptodb_batch_t *batch,
+                                            const char* key, size_t keylen,
+                                            const void *data, size_t len);
+
+/**
+ * @brief      Add deletion of the entry with specified key to the batch
+ *
+ * @param[in]  batch   See cryptodb_batch_t
+ * @param[in]  key     Database entry key
+ * @param[in]  keylen  Database entry key length
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_batch_delete(cryptodb_batch_t *batch,
+                                          const char* key, size_t keylen);
+
+/**
+ * @brief      Drop all operations of the batch
+ *
+ * @param[in]  batch  See cryptodb_batch_t
+ */
+CRYPTODB_EXPORT void cryptodb_batch_clear(cryptodb_batch_t *batch);
+
+/**
+ * @brief      Write all operations of the batch to the database in one
+ *             atomic write, in the order they were added. The batch is
+ *             cleared on success and can be used again.
+ *
+ * @param[in]  batch  See cryptodb_batch_t
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_batch_commit(cryptodb_batch_t *batch);
+
+/**
+ * @brief      Begin bulk-load session of a new database that will be
+ *             located in specified "path" folder. Use it for the initial
+ *             population of large datasets.
+ *
+ *             Entries are written to a staging database in "<path>.bulk"
+ *             folder without syncs, with write buffer and table files of
+ *             at least CRYPTODB_BULK_WR_BUF_SIZE and CRYPTODB_BULK_MAX_FILE_SIZE
+ *             bytes. They are buffered and encrypted by windows of about
+ *             4 MiB, which are split between the calling thread and
+ *             "worker_threads". The database folder appears only after
+ *             cryptodb_bulk_commit(), so the load is either complete or
+ *             can be discarded: a staging folder left by a crash is
+ *             removed by the next cryptodb_bulk_begin().
+ *
+ * @param[in]  path           The full database folder path, the database
+ *                            must not exist
+ * @param[in]  uniq_data      See cryptodb_open()
+ * @param[in]  uniq_data_len  "uniq_data" length
+ * @param[in]  options        (Optional, can be NULL)
+ *                            See cryptodb_options_t, the database should be
+ *                            opened with the same options after the load.
+ * @param[in]  user_kdf       (Optional, can be NULL) See cryptodb_open()
+ * @param[in]  kdf_user_data  (Optional, can be NULL) See cryptodb_open()
+ * @param[out] bulk           See cryptodb_bulk_t
+ *
+ * @return     See cryptodb_err_t. CRYPTODB_ERR_WRONG_ARGUMENT if the
+ *             database already exists.
+ */
+CRYPTODB_EXPORT int cryptodb_bulk_begin(const char *path,
+                                        uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN],
+                                        size_t uniq_data_len,
+                                        cryptodb_options_t *options,
+                                        cryptodb_user_kdf user_kdf,
+                                        void *kdf_user_data,
+                                        cryptodb_bulk_t *bulk);
+
+/**
+ * @brief      Add "key-value" entry to the bulk load, see cryptodb_put().
+ *             The entry is copied, encrypted and written when the window
+ *             of buffered entries is full or on cryptodb_bulk_commit().
+ *             A later entry with the same key replaces the earlier one.
+ *
+ * @param[in]  bulk     See cryptodb_bulk_t
+ * @param[in]  key      Database entry key
+ * @param[in]  keylen   Database entry key length
+ * @param[in]  valtype  See cryptodb_val_t
+ * @param[in]  val      Pointer to entry value
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_bulk_put(cryptodb_bulk_t *bulk,
+                                      const char* key, size_t keylen,
+                                      cryptodb_val_t valtype, void *val);
+
+/**
+ * @brief      "cryptodb_bulk_put" wrapper where valtype == CRYPTODB_VAL_STRING
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_bulk_put_string(cryptodb_bulk_t *bulk,
+                                             const char* key, size_t keylen, const char *val);
+
+/**
+ * @brief      "cryptodb_bulk_put" wrapper where valtype == CRYPTODB_VAL_NUM_INT
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_bulk_put_integer(cryptodb_bulk_t *bulk,
+                                              const char* key, size_t keylen, int val);
+
+/**
+ * @brief      "cryptodb_bulk_put" wrapper where valtype == CRYPTODB_VAL_NUM_DOUBLE
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_bulk_put_double(cryptodb_bulk_t *bulk,
+                                             const char* key, size_t keylen, double val);
+
+/**
+ * @brief      "cryptodb_bulk_put" wrapper where valtype == CRYPTODB_VAL_NUM_INT64
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_bulk_put_int64(cryptodb_bulk_t *bulk,
+                                            const char* key, size_t keylen, int64_t val);
+
+/**
+ * @brief      "cryptodb_bulk_put" wrapper where valtype == CRYPTODB_VAL_NUM_UINT64
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_bulk_put_uint64(cryptodb_bulk_t *bulk,
+                                             const char* key, size_t keylen, uint64_t val);
+
+/**
+ * @brief      "cryptodb_bulk_put" wrapper where valtype == CRYPTODB_VAL_BLOB
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_bulk_put_blob(cryptodb_bulk_t *bulk,
+                                           const char* key, size_t keylen,
+                                           const void *data, size_t len);
+
+/**
+ * @brief      Finish bulk-load session: write the buffered entries, compact
+ *             the whole staging database, sync it once and move it to the
+ *             database folder. The session is ended even on error, the
+ *             staging database is discarded then. Except when only the
+ *             move fails: the synced staging database and the session are
+ *             kept, call cryptodb_bulk_commit() again to retry the move or
+ *             cryptodb_bulk_abort() to discard it.
+ *
+ * @param[in]  bulk  See cryptodb_bulk_t
+ *
+ * @return     See cryptodb_err_t. CRYPTODB_ERR_MOVE_FAIL if the staging
+ *             database wasn't moved to the database folder.
+ */
+CRYPTODB_EXPORT int cryptodb_bulk_commit(cryptodb_bulk_t *bulk);
+
+/**
+ * @brief      End bulk-load session and discard everything loaded
+ *
+ * @param[in]  bulk  See cryptodb_bulk_t
+ */
+CRYPTODB_EXPORT void cryptodb_bulk_abort(cryptodb_bulk_t *bulk);
+
+/**
+ * @brief      Put "key-value" entry in the database asynchronously, see
+ *             cryptodb_put(). The entry is encrypted by the calling thread
+ *             and queued, the writer thread of the handler writes queued
+ *             entries together and calls "cb" for every one of them.
+ *             Blocks while "async_queue_len" operations are pending.
+ *             Asynchronous operations are written in the order they were
+ *             queued, but aren't ordered with cryptodb_put(),
+ *             cryptodb_delete() and batches, use cryptodb_flush() for that.
+ *
+ * @param[in]  cryptodb   Database handler
+ * @param[in]  key        Database entry key
+ * @param[in]  keylen     Database entry key length
+ * @param[in]  valtype    Database entry value type
+ * @param[in]  val        Database entry value, can be freed after return
+ * @param[in]  cb         (Optional, can be NULL) See cryptodb_write_cb
+ * @param[in]  user_data  (Optional, can be NULL) Passed to "cb"
+ *
+ * @return     See cryptodb_err_t. If it isn't CRYPTODB_SUCCESS, the entry
+ *             wasn't queued and "cb" isn't called.
+ */
+CRYPTODB_EXPORT int cryptodb_put_async(cryptodb_t *cryptodb,
+                                       const char* key, size_t keylen,
+                                       cryptodb_val_t valtype, void *val,
+                                       cryptodb_write_cb cb, void *user_data);
+
+/**
+ * @brief      "cryptodb_put_async" wrapper where valtype == CRYPTODB_VAL_STRING
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_put_string_async(cryptodb_t *cryptodb,
+                                              const char* key, size_t keylen,
+                                              const char *val,
+                                              cryptodb_write_cb cb, void *user_data);
+
+/**
+ * @brief      "cryptodb_put_async" wrapper where valtype == CRYPTODB_VAL_NUM_INT
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_put_integer_async(cryptodb_t *cryptodb,
+                                               const char* key, size_t keylen,
+                                               int val,
+                                               cryptodb_write_cb cb, void *user_data);
+
+/**
+ * @brief      "cryptodb_put_async" wrapper where valtype == CRYPTODB_VAL_NUM_DOUBLE
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_put_double_async(cryptodb_t *cryptodb,
+                                              const char* key, size_t keylen,
+                                              double val,
+                                              cryptodb_write_cb cb, void *user_data);
+
+/**
+ * @brief      "cryptodb_put_async" wrapper where valtype == CRYPTODB_VAL_NUM_INT64
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_put_int64_async(cryptodb_t *cryptodb,
+                                             const char* key, size_t keylen,
+                                             int64_t val,
+                                             cryptodb_write_cb cb, void *user_data);
+
+/**
+ * @brief      "cryptodb_put_async" wrapper where valtype == CRYPTODB_VAL_NUM_UINT64
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_put_uint64_async(cryptodb_t *cryptodb,
+                                              const char* key, size_t keylen,
+                                              uint64_t val,
+                                              cryptodb_write_cb cb, void *user_data);
+
+/**
+ * @brief      "cryptodb_put_async" wrapper where valtype == CRYPTODB_VAL_BLOB
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_put_blob_async(cryptodb_t *cryptodb,
+                                            const char* key, size_t keylen,
+                                            const void *data, size_t len,
+                                            cryptodb_write_cb cb, void *user_data);
+
+/**
+ * @brief      Delete entry with specified key from the database
+ *             asynchronously, see cryptodb_put_async()
+ *
+ * @param[in]  cryptodb   Database handler
+ * @param[in]  key        Database entry key
+ * @param[in]  keylen     Database entry key length
+ * @param[in]  cb         (Optional, can be NULL) See cryptodb_write_cb
+ * @param[in]  user_data  (Optional, can be NULL) Passed to "cb"
+ *
+ * @return     See cryptodb_put_async()
+ */
+CRYPTODB_EXPORT int cryptodb_delete_async(cryptodb_t *cryptodb,
+                                          const char* key, size_t keylen,
+                                          cryptodb_write_cb cb, void *user_data);
+
+/**
+ * @brief      Wait until all asynchronous operations that were queued
+ *             before the call are written and their callbacks are called.
+ *             cryptodb_close() does it as well.
+ *
+ * @param[in]  cryptodb  Database handler
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_flush(cryptodb_t *cryptodb);
+
+/**
+ * @brief      Get database handler statistics
+ *
+ * @param[in]  cryptodb  The cryptodb handler
+ * @param[out] stats     See cryptodb_stats_t
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_get_stats(cryptodb_t *cryptodb,
+                                       cryptodb_stats_t *stats);
+
 /**
  * @brief      Destroy database that is located in specified "path" folder.
  *
@@ -311,6 +1309,30 @@ CRYPTODB_EXPORT int cryptodb_delete(cryptodb_t *cryptodb,
 CRYPTODB_EXPORT int cryptodb_destroy(const char *path,
                                      cryptodb_options_t *options);
 
+/**
+ * @brief      Migrate database that is located in specified "path" folder
+ *             to the LevelDB built-in bytewise comparator.
+ *
+ *             Databases created by older versions use a comparator that is
+ *             called through the LevelDB C API for every key comparison.
+ *             They are still opened by cryptodb_open(), but keep using it.
+ *             This function copies all entries to a new database in
+ *             "<path>.migrate" folder, that then replaces the original one.
+ *             The database must be closed. Does nothing if the database
+ *             already uses the built-in comparator. A swap of the folders
+ *             interrupted by a crash is finished or reverted by the next
+ *             cryptodb_open() or cryptodb_migrate().
+ *
+ * @param[in]  path     The full database folder path
+ * @param[in]  options  (Optional, can be NULL)
+ *                      See cryptodb_options_t. If NULL, default
+ *                      fields will be used.
+ *
+ * @return     See cryptodb_err_t
+ */
+CRYPTODB_EXPORT int cryptodb_migrate(const char *path,
+                                     cryptodb_options_t *options);
+
 #ifdef __cplusplus
 }
 #endif
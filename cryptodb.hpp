@@ -22,17 +22,261 @@
 
 #pragma once
 
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 #include "cryptodb.h"
 
 namespace cryptodb {
 
+class CryptoDBBatch;
+class CryptoDBBulkLoad;
+class CryptoDBIterator;
+class CryptoDBSnapshot;
+
+/**
+ * One entry of CryptoDB::MultiGet(), see cryptodb_get_item_t
+ */
+struct CryptoDBGetItem
+{
+    std::string key; // The entry key
+    cryptodb_val_t type = CRYPTODB_VAL_STRING; // Expected value type
+    int expected_max_length = 0; // Expected maximum length of string value
+    std::string str; // Output, value of CRYPTODB_VAL_STRING type
+    int integer = 0; // Output, value of CRYPTODB_VAL_NUM_INT type
+    double number = 0.0; // Output, value of CRYPTODB_VAL_NUM_DOUBLE type
+    int64_t integer64 = 0; // Output, value of CRYPTODB_VAL_NUM_INT64 type
+    uint64_t uinteger64 = 0; // Output, value of CRYPTODB_VAL_NUM_UINT64 type
+    int result = CRYPTODB_SUCCESS; // Output, cryptodb_err_t or cryptodb_val_t,
+                                   // see GetString()
+};
+
+/**
+ * Decrypted database entry, see cryptodb_entry_t
+ */
+struct CryptoDBEntry
+{
+    int result = CRYPTODB_SUCCESS; // cryptodb_err_t of the entry decryption
+    std::string key; // The entry key, empty if it can't be recovered
+    cryptodb_val_t type = CRYPTODB_VAL_UNKNOWN; // Value type
+    std::string str; // Value of CRYPTODB_VAL_STRING type
+    std::vector<uint8_t> blob; // Value of CRYPTODB_VAL_BLOB type
+    int integer = 0; // Value of CRYPTODB_VAL_NUM_INT type
+    double number = 0.0; // Value of CRYPTODB_VAL_NUM_DOUBLE type
+    int64_t integer64 = 0; // Value of CRYPTODB_VAL_NUM_INT64 type
+    uint64_t uinteger64 = 0; // Value of CRYPTODB_VAL_NUM_UINT64 type
+};
+
+/**
+ * Compile-time mapping of a C++ type to a value type of the database, used
+ * by the Put() and Get() templates of CryptoDB, CryptoDBBatch,
+ * CryptoDBBulkLoad and CryptoDBSnapshot. A specialization defines
+ * "can_encode" and "can_decode", and
+ * * static int Encode(Writer &db, std::string_view key, const T &val)
+ * * static int Decode(Reader &db, std::string_view key, T &val)
+ * that put and get the value with a non-template overload of "db", so the
+ * value type is chosen at compile time. Specialized for:
+ * * 32-bit and 64-bit integers and double - CRYPTODB_VAL_NUM_INT,
+ *   CRYPTODB_VAL_NUM_INT64, CRYPTODB_VAL_NUM_UINT64, CRYPTODB_VAL_NUM_DOUBLE;
+ * * narrower integers and bool as CRYPTODB_VAL_NUM_INT (signed) or
+ *   CRYPTODB_VAL_NUM_UINT64 (unsigned), float as CRYPTODB_VAL_NUM_DOUBLE.
+ *   Get() returns CRYPTODB_ERR_WRONG_ARGUMENT if the integer doesn't fit;
+ * * std::string, std::string_view (put only) - CRYPTODB_VAL_STRING;
+ * * std::vector<uint8_t>, cryptodb_blob_t (put only) - CRYPTODB_VAL_BLOB;
+ * * trivially copyable standard layout structs - CRYPTODB_VAL_BLOB of
+ *   sizeof(T) bytes in the memory layout of the platform. Get() returns
+ *   CRYPTODB_ERR_WRONG_ARGUMENT if the value has another length.
+ * Users can specialize it for their own types.
+ */
+template <typename T, typename Enable = void>
+struct Codec
+{
+    static constexpr bool can_encode = false;
+    static constexpr bool can_decode = false;
+};
+
+/**
+ * Codec of the numbers that are stored as "Native" type
+ */
+template <typename T, typename Native>
+struct NumberCodec
+{
+    static constexpr bool can_encode = true;
+    static constexpr bool can_decode = true;
+
+    template <typename Writer>
+    static int Encode(Writer &db, std::string_view key, const T &val)
+    {
+        return db.Put(key, static_cast<Native>(val));
+    }
+
+    template <typename Reader>
+    static int Decode(Reader &db, std::string_view key, T &val)
+    {
+        Native native = Native();
+        int err = db.Get(key, native);
+
+        if constexpr (std::is_integral_v<T>)
+        {
+            if (CRYPTODB_SUCCESS == err && static_cast<Native>(static_cast<T>(native)) != native)
+                return CRYPTODB_ERR_WRONG_ARGUMENT;
+        }
+        if (CRYPTODB_SUCCESS == err)
+            val = static_cast<T>(native);
+
+        return err;
+    }
+};
+
+template <typename T>
+struct Codec<T, std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T> &&
+                                 sizeof(T) <= sizeof(int32_t)>>
+    : NumberCodec<T, int> {};
+
+template <typename T>
+struct Codec<T, std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T> &&
+                                 sizeof(T) == sizeof(int64_t)>>
+    : NumberCodec<T, int64_t> {};
+
+template <typename T>
+struct Codec<T, std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T>>>
+    : NumberCodec<T, uint64_t> {};
+
+template <>
+struct Codec<double> : NumberCodec<double, double> {};
+
+template <>
+struct Codec<float> : NumberCodec<float, double> {};
+
+template <>
+struct Codec<std::string_view>
+{
+    static constexpr bool can_encode = true;
+    static constexpr bool can_decode = false;
+
+    template <typename Writer>
+    static int Encode(Writer &db, std::string_view key, const std::string_view &val)
+    {
+        return db.Put(key, val);
+    }
+};
+
+template <>
+struct Codec<std::string>
+{
+    static constexpr bool can_encode = true;
+    static constexpr bool can_decode = true;
+
+    template <typename Writer>
+    static int Encode(Writer &db, std::string_view key, const std::string &val)
+    {
+        return db.Put(key, std::string_view(val));
+    }
+
+    template <typename Reader>
+    static int Decode(Reader &db, std::string_view key, std::string &val)
+    {
+        return db.Get(key, val);
+    }
+};
+
+template <>
+struct Codec<cryptodb_blob_t>
+{
+    static constexpr bool can_encode = true;
+    static constexpr bool can_decode = false;
+
+    template <typename Writer>
+    static int Encode(Writer &db, std::string_view key, const cryptodb_blob_t &val)
+    {
+        return db.Put(key, val.data, val.len);
+    }
+};
+
+template <>
+struct Codec<std::vector<uint8_t>>
+{
+    static constexpr bool can_encode = true;
+    static constexpr bool can_decode = true;
+
+    template <typename Writer>
+    static int Encode(Writer &db, std::string_view key, const std::vector<uint8_t> &val)
+    {
+        return db.Put(key, (const void *)val.data(), val.size());
+    }
+
+    template <typename Reader>
+    static int Decode(Reader &db, std::string_view key, std::vector<uint8_t> &val)
+    {
+        return db.Get(key, val);
+    }
+};
+
+template <typename T>
+struct Codec<T, std::enable_if_t<std::is_class_v<T> && std::is_trivially_copyable_v<T> &&
+                                 std::is_standard_layout_v<T>>>
+{
+    static constexpr bool can_encode = true;
+    static constexpr bool can_decode = true;
+
+    template <typename Writer>
+    static int Encode(Writer &db, std::string_view key, const T &val)
+    {
+        return db.Put(key, (const void *)&val, sizeof(T));
+    }
+
+    template <typename Reader>
+    static int Decode(Reader &db, std::string_view key, T &val)
+    {
+        // "val" isn't touched if the value isn't T
+        T value;
+        size_t len = sizeof(T);
+        int err = db.Get(key, (void *)&value, len);
+
+        if (CRYPTODB_ERR_BUFFER_TOO_SMALL == err || (CRYPTODB_SUCCESS == err && len != sizeof(T)))
+            return CRYPTODB_ERR_WRONG_ARGUMENT;
+        if (CRYPTODB_SUCCESS == err)
+            val = value;
+
+        return err;
+    }
+};
+
+/**
+ * Database handler, see cryptodb_t. It's closed when deleted and can be
+ * moved but not copied.
+ *
+ * There are two sets of methods:
+ * * std::string_view methods (Put(), Get(), Remove(), ...) write the key as
+ *   is, so it can be binary and contain zeros, and return values through
+ *   output parameters or std::optional without heap allocations;
+ * * std::string methods (PutString(), GetString(), Delete(), ...) write the
+ *   key with the terminating zero, as the older versions did, and return
+ *   values allocated by "new". They are thin wrappers of the first set.
+ * Put() and Get() templates take any type that has a Codec, e.g. a POD
+ * struct.
+ * The same entry written by PutString("key", ...) is read by
+ * Get(std::string_view("key", 4), ...). With CRYPTODB_KEY_MODE_AES_256_CBC
+ * keys are padded with zeros, so keys that differ only in trailing zeros
+ * are the same key.
+ */
 class CRYPTODB_EXPORT CryptoDB
 {
 public:
-    CryptoDB()  = default;
-    ~CryptoDB() = default;
+    CryptoDB();
+    ~CryptoDB();
+
+    CryptoDB(CryptoDB &&other) noexcept;
+    CryptoDB &operator=(CryptoDB &&other) noexcept;
+
+    CryptoDB(const CryptoDB &) = delete;
+    CryptoDB &operator=(const CryptoDB &) = delete;
 
     /**
      * @brief      Returns a string representation of an CryptoDB error.
@@ -82,6 +326,20 @@ public:
                     void *kdf_user_data,
                     CryptoDB** dbptr);
 
+    /**
+     * @brief      Open database in the "db" instance, see above. The
+     *             database that was open in "db" is closed before.
+     *
+     * @return     See cryptodb_err_t
+     */
+    static int Open(std::string path,
+                    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN],
+                    size_t uniq_data_len,
+                    cryptodb_options_t *options,
+                    cryptodb_user_kdf user_kdf,
+                    void *kdf_user_data,
+                    CryptoDB &db);
+
     /**
      * @brief      Open database that is located in specified "path" folder.
      *             The database will be created if not exist.
@@ -101,6 +359,18 @@ public:
                             cryptodb_options_t *options,
                             CryptoDB** dbptr);
 
+    /**
+     * @brief      Open database in the "db" instance, see above. The
+     *             database that was open in "db" is closed before.
+     *
+     * @return     See cryptodb_err_t
+     */
+    static int OpenWithKeys(std::string path,
+                            uint8_t encryption_key[32],
+                            uint8_t encryption_iv[16],
+                            cryptodb_options_t *options,
+                            CryptoDB &db);
+
     /**
      * @brief      Destroy database that is located in specified "path" folder.
      *             C++ analogue of the cryptodb_destroy().
@@ -113,12 +383,311 @@ public:
     static int Destroy(std::string path,
                        cryptodb_options_t *options);
 
+    /**
+     * @brief      Migrate database that is located in specified "path" folder
+     *             to the LevelDB built-in bytewise comparator.
+     *             C++ analogue of the cryptodb_migrate().
+     *
+     * @param[in]  path     The full database folder path
+     * @param[in]  options  See cryptodb_options_t
+     *
+     * @return     See cryptodb_err_t
+     */
+    static int Migrate(std::string path,
+                       cryptodb_options_t *options);
+
     /**
      * @brief      Close database
      *             C++ analogue of the cryptodb_close().
      */
     void Close(void);
 
+    /**
+     * @brief      Put the "key-value" entry in the database
+     *             where "value" is string.
+     *             C++ analogue of the cryptodb_put_string().
+     *
+     * @param[in]  key   The entry key, written as is
+     * @param[in]  val   The entry string value, shouldn't contain zeros
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, std::string_view val);
+
+    /**
+     * @brief      Put the "key-value" entry in the database
+     *             where "value" is integer number.
+     *             C++ analogue of the cryptodb_put_integer().
+     *
+     * @param[in]  key   The entry key, written as is
+     * @param[in]  val   The entry integer number value
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, int val);
+
+    /**
+     * @brief      Put the "key-value" entry in the database
+     *             where "value" is double-precision floating-point
+     *             number.
+     *             C++ analogue of the cryptodb_put_double().
+     *
+     * @param[in]  key   The entry key, written as is
+     * @param[in]  val   The entry double-precision floating-point number value
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, double val);
+
+    /**
+     * @brief      Put the "key-value" entry in the database
+     *             where "value" is 64-bit integer number, stored exactly.
+     *             C++ analogue of the cryptodb_put_int64().
+     *
+     * @param[in]  key   The entry key, written as is
+     * @param[in]  val   The entry 64-bit integer number value
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, int64_t val);
+
+    /**
+     * @brief      Put the "key-value" entry in the database
+     *             where "value" is 64-bit unsigned integer number.
+     *             C++ analogue of the cryptodb_put_uint64().
+     *
+     * @param[in]  key   The entry key, written as is
+     * @param[in]  val   The entry 64-bit unsigned integer number value
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, uint64_t val);
+
+    /**
+     * @brief      Put the "key-value" entry in the database
+     *             where "value" is binary data (CRYPTODB_VAL_BLOB).
+     *             C++ analogue of the cryptodb_put_blob().
+     *
+     * @param[in]  key   The entry key, written as is
+     * @param[in]  data  The entry binary data, can be nullptr if "len" is 0
+     * @param[in]  len   The data length
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, const void *data, size_t len);
+
+    /**
+     * @brief      Put the "key-value" entry in the database
+     *             where "value" is binary data, see Put() above.
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, const std::vector<uint8_t> &val);
+
+    /**
+     * @brief      Get string value of the entry that is assosiated
+     *             with specified key. The value is read into the capacity
+     *             of "val" (see cryptodb_get_buf()), so a string that is
+     *             reused between calls is grown only when the value
+     *             doesn't fit. In case if the key exists but value is
+     *             not string, "val" is cleared and function returns
+     *             the actual value type - cryptodb_val_t.
+     *             C++ analogue of the cryptodb_get_buf().
+     *
+     * @param[in]   key  The entry key, written as is
+     * @param[out]  val  The value
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t, see @brief
+     */
+    int Get(std::string_view key, std::string &val);
+
+    /**
+     * @brief      Get binary data value (CRYPTODB_VAL_BLOB) of the entry
+     *             that is assosiated with specified key. It's read into
+     *             the capacity of "val" like the string value, see Get()
+     *             above. In case if the key exists but value is not
+     *             binary data, "val" is cleared and function returns
+     *             the actual value type - cryptodb_val_t.
+     *             C++ analogue of the cryptodb_get_buf().
+     *
+     * @param[in]   key  The entry key, written as is
+     * @param[out]  val  The value
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t, see @brief
+     */
+    int Get(std::string_view key, std::vector<uint8_t> &val);
+
+    /**
+     * @brief      Get binary data value of the entry that is assosiated
+     *             with specified key into "data" of "len" bytes, "len" is
+     *             set to the value length. If the value doesn't fit,
+     *             function returns CRYPTODB_ERR_BUFFER_TOO_SMALL. In case
+     *             if the key exists but value is not binary data, function
+     *             returns the actual value type - cryptodb_val_t, "data"
+     *             may be overwritten.
+     *             C++ analogue of the cryptodb_get_buf().
+     *
+     * @param[in]      key   The entry key, written as is
+     * @param[out]     data  The value
+     * @param[in,out]  len   "data" length, the value length
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t, see @brief
+     */
+    int Get(std::string_view key, void *data, size_t &len);
+
+    /**
+     * @brief      Get integer number value of the entry that is assosiated
+     *             with specified key. In case if the key exists but value
+     *             is not integer, "val" isn't touched and function returns
+     *             the actual value type - cryptodb_val_t.
+     *
+     * @param[in]   key  The entry key, written as is
+     * @param[out]  val  The value
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t, see @brief
+     */
+    int Get(std::string_view key, int &val);
+
+    /**
+     * @brief      Get double-precision floating-point number value of
+     *             the entry that is assosiated with specified key.
+     *             In case if the key exists but value is not
+     *             double-precision floating-point, "val" isn't touched
+     *             and function returns the actual value type - cryptodb_val_t.
+     *
+     * @param[in]   key  The entry key, written as is
+     * @param[out]  val  The value
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t, see @brief
+     */
+    int Get(std::string_view key, double &val);
+
+    /**
+     * @brief      Get 64-bit integer number value of the entry that is
+     *             assosiated with specified key. In case if the key exists
+     *             but value is not 64-bit integer (e.g. it's int), "val"
+     *             isn't touched and function returns the actual value
+     *             type - cryptodb_val_t.
+     *             C++ analogue of the cryptodb_get_int64().
+     *
+     * @param[in]   key  The entry key, written as is
+     * @param[out]  val  The value
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t, see @brief
+     */
+    int Get(std::string_view key, int64_t &val);
+
+    /**
+     * @brief      Get 64-bit unsigned integer number value of the entry
+     *             that is assosiated with specified key, see Get() above.
+     *             C++ analogue of the cryptodb_get_uint64().
+     *
+     * @param[in]   key  The entry key, written as is
+     * @param[out]  val  The value
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t, see @brief
+     */
+    int Get(std::string_view key, uint64_t &val);
+
+    /**
+     * @brief      Get integer number value of the entry, see Get().
+     *
+     * @param[in]  key   The entry key, written as is
+     *
+     * @return     The value, or std::nullopt if it can't be read
+     */
+    std::optional<int> GetInteger(std::string_view key);
+
+    /**
+     * @brief      Get double-precision floating-point number value of
+     *             the entry, see Get().
+     *
+     * @param[in]  key   The entry key, written as is
+     *
+     * @return     The value, or std::nullopt if it can't be read
+     */
+    std::optional<double> GetDouble(std::string_view key);
+
+    /**
+     * @brief      Get 64-bit integer number value of the entry, see Get().
+     *
+     * @param[in]  key   The entry key, written as is
+     *
+     * @return     The value, or std::nullopt if it can't be read
+     */
+    std::optional<int64_t> GetInt64(std::string_view key);
+
+    /**
+     * @brief      Get 64-bit unsigned integer number value of the entry,
+     *             see Get().
+     *
+     * @param[in]  key   The entry key, written as is
+     *
+     * @return     The value, or std::nullopt if it can't be read
+     */
+    std::optional<uint64_t> GetUInt64(std::string_view key);
+
+    /**
+     * @brief      Delete entry with specified key from the database.
+     *             C++ analogue of the cryptodb_delete().
+     *
+     * @param[in]  key   The key, written as is
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Remove(std::string_view key);
+
+    /**
+     * @brief      Put the "key-value" entry in the database, the value is
+     *             stored as Codec<T> resolves at compile time, e.g. a POD
+     *             struct as binary data. Types with their own Put()
+     *             overload are put by it.
+     *
+     * @param[in]  key   The entry key, written as is
+     * @param[in]  val   The entry value
+     *
+     * @return     See cryptodb_err_t
+     */
+    template <typename T, typename = std::enable_if_t<Codec<T>::can_encode>>
+    int Put(std::string_view key, const T &val)
+    {
+        return Codec<T>::Encode(*this, key, val);
+    }
+
+    /**
+     * @brief      Get value of the entry that is assosiated with specified
+     *             key, as Codec<T> resolves at compile time.
+     *
+     * @param[in]   key  The entry key, written as is
+     * @param[out]  val  The value
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t, see Codec
+     */
+    template <typename T, typename = std::enable_if_t<Codec<T>::can_decode>>
+    int Get(std::string_view key, T &val)
+    {
+        return Codec<T>::Decode(*this, key, val);
+    }
+
+    /**
+     * @brief      Get value of the entry, see Get() above, e.g.
+     *             db.Get<Point>("point").
+     *
+     * @param[in]  key   The entry key, written as is
+     *
+     * @return     The value, or std::nullopt if it can't be read
+     */
+    template <typename T, typename = std::enable_if_t<Codec<T>::can_decode>>
+    std::optional<T> Get(std::string_view key)
+    {
+        T val = T();
+
+        if (CRYPTODB_SUCCESS != this->Get(key, val))
+            return std::nullopt;
+
+        return val;
+    }
+
     /**
      * @brief      Put the "key-value" entry in the database
      *             where "value" is string.
@@ -164,8 +733,10 @@ public:
      *             actual value type - cryptodb_val_t.
      *
      * @param[in]   key                  The entry key
-     * @param[in]   expected_max_length  Expected maximum length that
-     *                                   string value should have.
+     * @param[in]   expected_max_length  Expected length of the string
+     *                                   value. It's only a hint of the
+     *                                   buffer size, longer values are
+     *                                   read as well.
      * @param[out]  val                  The value, should be nullptr
      *
      * @return     cryptodb_err_t or cryptodb_val_t, see @brief
@@ -202,6 +773,18 @@ public:
      */
     int GetDouble(std::string key, double **val);
 
+    /**
+     * @brief      Get values of several entries at once from the same
+     *             snapshot of the database.
+     *             C++ analogue of the cryptodb_multi_get().
+     *
+     * @param      items  Entries, the value and result of every entry
+     *                    are written to the entry
+     *
+     * @return     See cryptodb_err_t
+     */
+    int MultiGet(std::vector<CryptoDBGetItem> &items);
+
     /**
      * @brief      Delete entry with specified key from the database.
      *             C++ analogue of the cryptodb_delete().
@@ -212,8 +795,744 @@ public:
      */
     int Delete(std::string key);
 
-private:
-    cryptodb_t db;
+    /**
+     * @brief      Create write batch of the database. The batch should be
+     *             deleted before the database is closed.
+     *             C++ analogue of the cryptodb_batch_create().
+     *
+     * @param[out]  batchptr  Output batch instance, should be nullptr
+     *
+     * @return     See cryptodb_err_t
+     */
+    int CreateBatch(CryptoDBBatch** batchptr);
+
+    /**
+     * @brief      Create iterator over all entries of the database. The
+     *             iterator should be deleted before the database is closed.
+     *             C++ analogue of the cryptodb_iterator_create().
+     *
+     * @param[in]   options      (Optional, can be nullptr)
+     *                           See cryptodb_iterator_options_t
+     * @param[out]  iteratorptr  Output iterator instance, should be nullptr
+     *
+     * @return     See cryptodb_err_t
+     */
+    int CreateIterator(cryptodb_iterator_options_t *options,
+                       CryptoDBIterator** iteratorptr);
+
+    /**
+     * @brief      Create snapshot of the database. The snapshot should be
+     *             deleted before the database is closed.
+     *             C++ analogue of the cryptodb_snapshot_create().
+     *
+     * @param[out]  snapshotptr  Output snapshot instance, should be nullptr
+     *
+     * @return     See cryptodb_err_t
+     */
+    int CreateSnapshot(CryptoDBSnapshot** snapshotptr);
+
+    /**
+     * @brief      Put the "key-value" entry in the database asynchronously
+     *             where "value" is string.
+     *             C++ analogue of the cryptodb_put_string_async().
+     *
+     * @param[in]  key   The entry key
+     * @param[in]  val   The entry string value
+     *
+     * @return     Future of cryptodb_err_t, ready when the entry is written
+     */
+    std::future<int> PutStringAsync(std::string key, std::string val);
+
+    /**
+     * @brief      Put the "key-value" entry in the database asynchronously
+     *             where "value" is integer number.
+     *             C++ analogue of the cryptodb_put_integer_async().
+     *
+     * @param[in]  key   The entry key
+     * @param[in]  val   The entry integer number value
+     *
+     * @return     Future of cryptodb_err_t, ready when the entry is written
+     */
+    std::future<int> PutIntegerAsync(std::string key, int val);
+
+    /**
+     * @brief      Put the "key-value" entry in the database asynchronously
+     *             where "value" is double-precision floating-point
+     *             number.
+     *             C++ analogue of the cryptodb_put_double_async().
+     *
+     * @param[in]  key   The entry key
+     * @param[in]  val   The entry double-precision floating-point number value
+     *
+     * @return     Future of cryptodb_err_t, ready when the entry is written
+     */
+    std::future<int> PutDoubleAsync(std::string key, double val);
+
+    /**
+     * @brief      Delete entry with specified key from the database
+     *             asynchronously.
+     *             C++ analogue of the cryptodb_delete_async().
+     *
+     * @param[in]  key   The key
+     *
+     * @return     Future of cryptodb_err_t, ready when the entry is deleted
+     */
+    std::future<int> DeleteAsync(std::string key);
+
+    /**
+     * @brief      Wait until all asynchronous operations are written.
+     *             C++ analogue of the cryptodb_flush().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Flush(void);
+
+private:
+    // Allocated separately, because the writer of asynchronous operations,
+    // batches and snapshots keep the address of the handler
+    std::unique_ptr<cryptodb_t> db;
+};
+
+/**
+ * Group of put/delete operations that are written to the database
+ * atomically by Commit(), see cryptodb_batch_t
+ */
+class CRYPTODB_EXPORT CryptoDBBatch
+{
+public:
+    ~CryptoDBBatch();
+
+    CryptoDBBatch(const CryptoDBBatch &) = delete;
+    CryptoDBBatch &operator=(const CryptoDBBatch &) = delete;
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is string,
+     *             see CryptoDB::Put().
+     *             C++ analogue of the cryptodb_batch_put_string().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, std::string_view val);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is integer
+     *             number, see CryptoDB::Put().
+     *             C++ analogue of the cryptodb_batch_put_integer().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, int val);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is
+     *             double-precision floating-point number, see CryptoDB::Put().
+     *             C++ analogue of the cryptodb_batch_put_double().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, double val);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is 64-bit integer
+     *             number, see CryptoDB::Put().
+     *             C++ analogue of the cryptodb_batch_put_int64().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, int64_t val);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is 64-bit unsigned
+     *             integer number, see CryptoDB::Put().
+     *             C++ analogue of the cryptodb_batch_put_uint64().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, uint64_t val);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is binary data,
+     *             see CryptoDB::Put().
+     *             C++ analogue of the cryptodb_batch_put_blob().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, const void *data, size_t len);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is binary data,
+     *             see CryptoDB::Put().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, const std::vector<uint8_t> &val);
+
+    /**
+     * @brief      Add deletion of the entry with specified key, see
+     *             CryptoDB::Remove().
+     *             C++ analogue of the cryptodb_batch_delete().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Remove(std::string_view key);
+
+    /**
+     * @brief      Add the "key-value" entry, see CryptoDB::Put() with
+     *             Codec<T>.
+     *
+     * @return     See cryptodb_err_t
+     */
+    template <typename T, typename = std::enable_if_t<Codec<T>::can_encode>>
+    int Put(std::string_view key, const T &val)
+    {
+        return Codec<T>::Encode(*this, key, val);
+    }
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is string.
+     *             C++ analogue of the cryptodb_batch_put_string().
+     *
+     * @param[in]  key   The entry key
+     * @param[in]  val   The entry string value
+     *
+     * @return     See cryptodb_err_t
+     */
+    int PutString(std::string key, std::string val);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is integer number.
+     *             C++ analogue of the cryptodb_batch_put_integer().
+     *
+     * @param[in]  key   The entry key
+     * @param[in]  val   The entry integer number value
+     *
+     * @return     See cryptodb_err_t
+     */
+    int PutInteger(std::string key, int val);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is
+     *             double-precision floating-point number.
+     *             C++ analogue of the cryptodb_batch_put_double().
+     *
+     * @param[in]  key   The entry key
+     * @param[in]  val   The entry double-precision floating-point number value
+     *
+     * @return     See cryptodb_err_t
+     */
+    int PutDouble(std::string key, double val);
+
+    /**
+     * @brief      Add deletion of the entry with specified key.
+     *             C++ analogue of the cryptodb_batch_delete().
+     *
+     * @param[in]  key   The key
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Delete(std::string key);
+
+    /**
+     * @brief      Drop all operations of the batch.
+     *             C++ analogue of the cryptodb_batch_clear().
+     */
+    void Clear(void);
+
+    /**
+     * @brief      Write all operations to the database atomically.
+     *             C++ analogue of the cryptodb_batch_commit().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Commit(void);
+
+private:
+    friend class CryptoDB;
+
+    CryptoDBBatch() = default;
+
+    cryptodb_batch_t batch;
+};
+
+/**
+ * Bulk-load session of a new database, see cryptodb_bulk_t. Everything
+ * loaded is discarded if the session is deleted without Commit().
+ */
+class CRYPTODB_EXPORT CryptoDBBulkLoad
+{
+public:
+    ~CryptoDBBulkLoad();
+
+    CryptoDBBulkLoad(const CryptoDBBulkLoad &) = delete;
+    CryptoDBBulkLoad &operator=(const CryptoDBBulkLoad &) = delete;
+
+    /**
+     * @brief      Begin bulk-load session of a new database that will be
+     *             located in specified "path" folder.
+     *             C++ analogue of the cryptodb_bulk_begin().
+     *
+     * @param[in]   path           The full database folder path
+     * @param[in]   uniq_data      See CryptoDB::Open()
+     * @param[in]   uniq_data_len  "uniq_data" length
+     * @param[in]   options        See cryptodb_options_t
+     * @param[in]   user_kdf       (Optional, can be NULL) See CryptoDB::Open()
+     * @param[in]   kdf_user_data  (Optional, can be NULL) See CryptoDB::Open()
+     * @param[out]  bulkptr        Output session instance, should be nullptr
+     *
+     * @return     See cryptodb_err_t
+     */
+    static int Begin(std::string path,
+                     uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN],
+                     size_t uniq_data_len,
+                     cryptodb_options_t *options,
+                     cryptodb_user_kdf user_kdf,
+                     void *kdf_user_data,
+                     CryptoDBBulkLoad** bulkptr);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is string,
+     *             see CryptoDB::Put().
+     *             C++ analogue of the cryptodb_bulk_put_string().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, std::string_view val);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is integer
+     *             number, see CryptoDB::Put().
+     *             C++ analogue of the cryptodb_bulk_put_integer().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, int val);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is
+     *             double-precision floating-point number, see CryptoDB::Put().
+     *             C++ analogue of the cryptodb_bulk_put_double().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, double val);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is 64-bit integer
+     *             number, see CryptoDB::Put().
+     *             C++ analogue of the cryptodb_bulk_put_int64().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, int64_t val);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is 64-bit unsigned
+     *             integer number, see CryptoDB::Put().
+     *             C++ analogue of the cryptodb_bulk_put_uint64().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, uint64_t val);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is binary data,
+     *             see CryptoDB::Put().
+     *             C++ analogue of the cryptodb_bulk_put_blob().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, const void *data, size_t len);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is binary data,
+     *             see CryptoDB::Put().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Put(std::string_view key, const std::vector<uint8_t> &val);
+
+    /**
+     * @brief      Add the "key-value" entry, see CryptoDB::Put() with
+     *             Codec<T>.
+     *
+     * @return     See cryptodb_err_t
+     */
+    template <typename T, typename = std::enable_if_t<Codec<T>::can_encode>>
+    int Put(std::string_view key, const T &val)
+    {
+        return Codec<T>::Encode(*this, key, val);
+    }
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is string.
+     *             C++ analogue of the cryptodb_bulk_put_string().
+     *
+     * @param[in]  key   The entry key
+     * @param[in]  val   The entry string value
+     *
+     * @return     See cryptodb_err_t
+     */
+    int PutString(std::string key, std::string val);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is integer number.
+     *             C++ analogue of the cryptodb_bulk_put_integer().
+     *
+     * @param[in]  key   The entry key
+     * @param[in]  val   The entry integer number value
+     *
+     * @return     See cryptodb_err_t
+     */
+    int PutInteger(std::string key, int val);
+
+    /**
+     * @brief      Add the "key-value" entry where "value" is
+     *             double-precision floating-point number.
+     *             C++ analogue of the cryptodb_bulk_put_double().
+     *
+     * @param[in]  key   The entry key
+     * @param[in]  val   The entry double-precision floating-point number value
+     *
+     * @return     See cryptodb_err_t
+     */
+    int PutDouble(std::string key, double val);
+
+    /**
+     * @brief      Finish the session and move the loaded database to its folder.
+     *             C++ analogue of the cryptodb_bulk_commit().
+     *
+     * @return     See cryptodb_err_t. CRYPTODB_ERR_MOVE_FAIL if only the move
+     *             failed, the session is kept and Commit() can be retried.
+     */
+    int Commit(void);
+
+    /**
+     * @brief      Finish the session and discard everything loaded.
+     *             C++ analogue of the cryptodb_bulk_abort().
+     */
+    void Abort(void);
+
+private:
+    CryptoDBBulkLoad() = default;
+
+    cryptodb_bulk_t bulk;
+};
+
+/**
+ * Consistent read-only view of the database as it was when the snapshot
+ * was created, see cryptodb_snapshot_t
+ */
+class CRYPTODB_EXPORT CryptoDBSnapshot
+{
+public:
+    ~CryptoDBSnapshot();
+
+    CryptoDBSnapshot(const CryptoDBSnapshot &) = delete;
+    CryptoDBSnapshot &operator=(const CryptoDBSnapshot &) = delete;
+
+    /**
+     * @brief      Get string value of the entry from the snapshot, see
+     *             CryptoDB::Get().
+     *             C++ analogue of the cryptodb_snapshot_get_buf().
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t
+     */
+    int Get(std::string_view key, std::string &val);
+
+    /**
+     * @brief      Get binary data value of the entry from the snapshot, see
+     *             CryptoDB::Get().
+     *             C++ analogue of the cryptodb_snapshot_get_buf().
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t
+     */
+    int Get(std::string_view key, std::vector<uint8_t> &val);
+
+    /**
+     * @brief      Get binary data value of the entry from the snapshot, see
+     *             CryptoDB::Get().
+     *             C++ analogue of the cryptodb_snapshot_get_buf().
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t
+     */
+    int Get(std::string_view key, void *data, size_t &len);
+
+    /**
+     * @brief      Get integer number value of the entry from the snapshot,
+     *             see CryptoDB::Get().
+     *             C++ analogue of the cryptodb_snapshot_get().
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t
+     */
+    int Get(std::string_view key, int &val);
+
+    /**
+     * @brief      Get double-precision floating-point number value of the
+     *             entry from the snapshot, see CryptoDB::Get().
+     *             C++ analogue of the cryptodb_snapshot_get().
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t
+     */
+    int Get(std::string_view key, double &val);
+
+    /**
+     * @brief      Get 64-bit integer number value of the entry from the
+     *             snapshot, see CryptoDB::Get().
+     *             C++ analogue of the cryptodb_snapshot_get().
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t
+     */
+    int Get(std::string_view key, int64_t &val);
+
+    /**
+     * @brief      Get 64-bit unsigned integer number value of the entry from
+     *             the snapshot, see CryptoDB::Get().
+     *             C++ analogue of the cryptodb_snapshot_get().
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t
+     */
+    int Get(std::string_view key, uint64_t &val);
+
+    /**
+     * @brief      Get integer number value of the entry from the snapshot,
+     *             see CryptoDB::GetInteger().
+     *
+     * @return     The value, or std::nullopt if it can't be read
+     */
+    std::optional<int> GetInteger(std::string_view key);
+
+    /**
+     * @brief      Get double-precision floating-point number value of the
+     *             entry from the snapshot, see CryptoDB::GetDouble().
+     *
+     * @return     The value, or std::nullopt if it can't be read
+     */
+    std::optional<double> GetDouble(std::string_view key);
+
+    /**
+     * @brief      Get 64-bit integer number value of the entry from the
+     *             snapshot, see CryptoDB::GetInt64().
+     *
+     * @return     The value, or std::nullopt if it can't be read
+     */
+    std::optional<int64_t> GetInt64(std::string_view key);
+
+    /**
+     * @brief      Get 64-bit unsigned integer number value of the entry from
+     *             the snapshot, see CryptoDB::GetUInt64().
+     *
+     * @return     The value, or std::nullopt if it can't be read
+     */
+    std::optional<uint64_t> GetUInt64(std::string_view key);
+
+    /**
+     * @brief      Get value of the entry from the snapshot, see
+     *             CryptoDB::Get() with Codec<T>.
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t
+     */
+    template <typename T, typename = std::enable_if_t<Codec<T>::can_decode>>
+    int Get(std::string_view key, T &val)
+    {
+        return Codec<T>::Decode(*this, key, val);
+    }
+
+    /**
+     * @brief      Get value of the entry from the snapshot, see
+     *             CryptoDB::Get() with Codec<T>.
+     *
+     * @return     The value, or std::nullopt if it can't be read
+     */
+    template <typename T, typename = std::enable_if_t<Codec<T>::can_decode>>
+    std::optional<T> Get(std::string_view key)
+    {
+        T val = T();
+
+        if (CRYPTODB_SUCCESS != this->Get(key, val))
+            return std::nullopt;
+
+        return val;
+    }
+
+    /**
+     * @brief      Get string value of the entry from the snapshot, see
+     *             CryptoDB::GetString().
+     *             C++ analogue of the cryptodb_snapshot_get().
+     *
+     * @param[in]   key                  The entry key
+     * @param[in]   expected_max_length  Expected length of the string
+     *                                   value, see CryptoDB::GetString()
+     * @param[out]  val                  The value, should be nullptr
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t
+     */
+    int GetString(std::string key,
+                  int expected_max_length,
+                  std::string **val);
+
+    /**
+     * @brief      Get integer number value of the entry from the snapshot,
+     *             see CryptoDB::GetInteger().
+     *             C++ analogue of the cryptodb_snapshot_get().
+     *
+     * @param[in]   key  The entry key
+     * @param[out]  val  The value, should be nullptr
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t
+     */
+    int GetInteger(std::string key, int **val);
+
+    /**
+     * @brief      Get double-precision floating-point number value of the
+     *             entry from the snapshot, see CryptoDB::GetDouble().
+     *             C++ analogue of the cryptodb_snapshot_get().
+     *
+     * @param[in]   key  The entry key
+     * @param[out]  val  The value, should be nullptr
+     *
+     * @return     cryptodb_err_t or cryptodb_val_t
+     */
+    int GetDouble(std::string key, double **val);
+
+    /**
+     * @brief      Get values of several entries at once from the snapshot.
+     *             C++ analogue of the cryptodb_snapshot_multi_get().
+     *
+     * @param      items  Entries, the value and result of every entry
+     *                    are written to the entry
+     *
+     * @return     See cryptodb_err_t
+     */
+    int MultiGet(std::vector<CryptoDBGetItem> &items);
+
+    /**
+     * @brief      Create iterator over the entries of the snapshot. The
+     *             iterator should be deleted before the snapshot.
+     *             See "snapshot" in cryptodb_iterator_options_t.
+     *
+     * @param[in]   options      (Optional, can be nullptr)
+     *                           See cryptodb_iterator_options_t, its
+     *                           "snapshot" field is ignored
+     * @param[out]  iteratorptr  Output iterator instance, should be nullptr
+     *
+     * @return     See cryptodb_err_t
+     */
+    int CreateIterator(cryptodb_iterator_options_t *options,
+                       CryptoDBIterator** iteratorptr);
+
+private:
+    friend class CryptoDB;
+
+    CryptoDBSnapshot() = default;
+
+    cryptodb_snapshot_t snapshot;
+};
+
+/**
+ * Iterator over all entries of the database, see cryptodb_iterator_t.
+ * It can be used in range-based for loops:
+ *
+ *     for (const CryptoDBEntry &entry : *iterator)
+ */
+class CRYPTODB_EXPORT CryptoDBIterator
+{
+public:
+    /**
+     * Position of the iterator in range-based for loops, the position at
+     * the end is equal to end()
+     */
+    class Position
+    {
+    public:
+        const CryptoDBEntry &operator*() const;
+        const CryptoDBEntry *operator->() const;
+        Position &operator++();
+        bool operator==(const Position &other) const;
+        bool operator!=(const Position &other) const;
+
+    private:
+        friend class CryptoDBIterator;
+
+        explicit Position(CryptoDBIterator *iterator) : iterator(iterator) {}
+
+        CryptoDBIterator *iterator; // nullptr at the end
+    };
+
+    ~CryptoDBIterator();
+
+    CryptoDBIterator(const CryptoDBIterator &) = delete;
+    CryptoDBIterator &operator=(const CryptoDBIterator &) = delete;
+
+    /**
+     * @brief      Position the iterator at the first entry
+     *
+     * @return     Position of the first entry
+     */
+    Position begin(void);
+
+    /**
+     * @return     Position after the last entry
+     */
+    Position end(void);
+
+    /**
+     * @brief      Position the iterator at the first entry.
+     *             C++ analogue of the cryptodb_iterator_seek_to_first().
+     */
+    void SeekToFirst(void);
+
+    /**
+     * @brief      Position the iterator at the first entry with the key
+     *             that is equal to or greater than "key" (less than or
+     *             equal to it in the reverse order).
+     *             C++ analogue of the cryptodb_iterator_seek().
+     *
+     * @param[in]  key   The entry key
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Seek(std::string key);
+
+    /**
+     * @brief      Check that the iterator is positioned at an entry.
+     *             C++ analogue of the cryptodb_iterator_valid().
+     *
+     * @return     false if all entries were iterated or on error
+     */
+    bool Valid(void);
+
+    /**
+     * @brief      Move the iterator to the next entry.
+     *             C++ analogue of the cryptodb_iterator_next().
+     */
+    void Next(void);
+
+    /**
+     * @brief      Get the current entry, it's valid until the iterator
+     *             is moved. C++ analogue of the cryptodb_iterator_entry().
+     *
+     * @return     See CryptoDBEntry
+     */
+    const CryptoDBEntry &Entry(void);
+
+    /**
+     * @brief      Get error that stopped the iteration.
+     *             C++ analogue of the cryptodb_iterator_status().
+     *
+     * @return     See cryptodb_err_t
+     */
+    int Status(void);
+
+private:
+    friend class CryptoDB;
+    friend class CryptoDBSnapshot;
+
+    CryptoDBIterator() = default;
+
+    void Load(void);
+
+    cryptodb_iterator_t iterator;
+    CryptoDBEntry entry;
 };
 
 } // namespace cryptodb
@@ -0,0 +1,1052 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+#include <string.h>
+#include <pthread.h>
+
+#include <mbedtls/gcm.h>
+#include <mbedtls/platform_util.h>
+
+#if defined(CRYPTODB_HAVE_AESNI)
+#include <cpuid.h>
+#endif
+#if defined(CRYPTODB_HAVE_ARMV8_CE) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+#include <cryptodb_aes.h>
+
+/**
+ * PRIVATE API
+ */
+
+typedef void (*_cryptodb_aes_keys_fn)(const uint8_t *rk, uint8_t *drk);
+typedef void (*_cryptodb_aes_cbc_fn)(const uint8_t *rk, uint8_t iv[16],
+                                     const uint8_t *in, uint8_t *out,
+                                     size_t blocks);
+typedef void (*_cryptodb_aes_ghash_fn)(const uint8_t h[16], uint8_t x[16],
+                                       const uint8_t *in, size_t blocks);
+
+typedef struct {
+    cryptodb_aes_backend_t backend;
+    unsigned int cpu_features;
+    // NULL for the portable path
+    _cryptodb_aes_keys_fn decrypt_keys;
+    _cryptodb_aes_cbc_fn cbc_encrypt;
+    _cryptodb_aes_cbc_fn cbc_decrypt;
+    _cryptodb_aes_cbc_fn ctr32;
+    // NULL if there is no carry-less multiplication
+    _cryptodb_aes_ghash_fn ghash;
+} _cryptodb_aes_impl_t;
+
+static _cryptodb_aes_impl_t _cryptodb_aes_impl = {
+    CRYPTODB_AES_BACKEND_PORTABLE, 0, NULL, NULL, NULL, NULL, NULL
+};
+static pthread_once_t _cryptodb_aes_impl_once = PTHREAD_ONCE_INIT;
+
+static const uint8_t _cryptodb_aes_sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+/**
+ * AES-256 key expansion (FIPS-197, 5.2). It's done only once per key,
+ * so table-based SubWord is fine here.
+ */
+static void _cryptodb_aes_expand_key(const uint8_t key[CRYPTODB_AES_256_KEY_LEN],
+                                     uint8_t rk[CRYPTODB_AES_256_RK_LEN])
+{
+    uint8_t rcon = 0x01;
+    uint8_t t[4] = {0};
+
+    memcpy(rk, key, CRYPTODB_AES_256_KEY_LEN);
+
+    for (int i = 8; i < 4 * (CRYPTODB_AES_256_ROUNDS + 1); ++i)
+    {
+        memcpy(t, rk + 4 * (i - 1), 4);
+        if (i % 8 == 0)
+        {
+            uint8_t b0 = t[0];
+            t[0] = _cryptodb_aes_sbox[t[1]] ^ rcon;
+            t[1] = _cryptodb_aes_sbox[t[2]];
+            t[2] = _cryptodb_aes_sbox[t[3]];
+            t[3] = _cryptodb_aes_sbox[b0];
+            rcon = (uint8_t)((rcon << 1) ^ ((rcon & 0x80) ? 0x1b : 0x00));
+        }
+        else if (i % 8 == 4)
+        {
+            for (int j = 0; j < 4; ++j)
+                t[j] = _cryptodb_aes_sbox[t[j]];
+        }
+        for (int j = 0; j < 4; ++j)
+            rk[4 * i + j] = rk[4 * (i - 8) + j] ^ t[j];
+    }
+
+    mbedtls_platform_zeroize(t, sizeof(t));
+}
+
+static unsigned int _cryptodb_aes_detect_cpu(void)
+{
+    unsigned int features = 0;
+
+#if defined(CRYPTODB_HAVE_AESNI)
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        // CPUID.01H:ECX.AESNI[bit 25], CPUID.01H:ECX.PCLMULQDQ[bit 1],
+        // CPUID.01H:EDX.SSE2[bit 26], CPUID.01H:ECX.SSSE3[bit 9]
+        if ((ecx & (1u << 25)) && (edx & (1u << 26)) && (ecx & (1u << 9)))
+            features |= CRYPTODB_CPU_AES;
+        if (ecx & (1u << 1))
+            features |= CRYPTODB_CPU_CLMUL;
+    }
+#elif defined(CRYPTODB_HAVE_ARMV8_CE)
+#if defined(__APPLE__)
+    // Every Apple arm64 CPU has the crypto extensions
+    features |= CRYPTODB_CPU_AES | CRYPTODB_CPU_CLMUL;
+#elif defined(__linux__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+
+    // See arch/arm64/include/uapi/asm/hwcap.h
+    if (hwcap & (1ul << 3))
+        features |= CRYPTODB_CPU_AES;
+    if (hwcap & (1ul << 4))
+        features |= CRYPTODB_CPU_CLMUL;
+#endif
+#endif
+
+    return features;
+}
+
+/**
+ * Small GCM messages are processed in one zero-padded stack buffer, so
+ * every kernel is called only once per message
+ */
+#define CRYPTODB_AES_GCM_SMALL_LEN (256)
+
+/**
+ * GCM 4-bit multiplication tables (Shoup's method), the same as in mbedtls
+ */
+static const uint16_t _cryptodb_aes_gcm_last4[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+static uint64_t _cryptodb_aes_load_be64(const uint8_t *in)
+{
+    uint64_t v = 0;
+
+    for (int i = 0; i < 8; ++i)
+        v = (v << 8) | in[i];
+
+    return v;
+}
+
+static void _cryptodb_aes_store_be64(uint8_t *out, uint64_t v)
+{
+    for (int i = 7; i >= 0; --i, v >>= 8)
+        out[i] = (uint8_t)v;
+}
+
+static void _cryptodb_aes_gcm_gen_table(_cryptodb_aes_t *aes)
+{
+    uint64_t vh = _cryptodb_aes_load_be64(aes->h);
+    uint64_t vl = _cryptodb_aes_load_be64(aes->h + 8);
+
+    aes->hh[0] = 0;
+    aes->hl[0] = 0;
+    aes->hh[8] = vh;
+    aes->hl[8] = vl;
+
+    for (int i = 4; i > 0; i >>= 1)
+    {
+        uint32_t t = (uint32_t)(vl & 1) * 0xe1000000u;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ ((uint64_t)t << 32);
+        aes->hh[i] = vh;
+        aes->hl[i] = vl;
+    }
+
+    for (int i = 2; i <= 8; i *= 2)
+    {
+        vh = aes->hh[i];
+        vl = aes->hl[i];
+        for (int j = 1; j < i; ++j)
+        {
+            aes->hh[i + j] = vh ^ aes->hh[j];
+            aes->hl[i + j] = vl ^ aes->hl[j];
+        }
+    }
+}
+
+/**
+ * x = x * H
+ */
+static void _cryptodb_aes_gcm_mult(const _cryptodb_aes_t *aes, uint8_t x[16])
+{
+    uint8_t lo = x[15] & 0xf, hi = 0, rem = 0;
+    uint64_t zh = aes->hh[lo], zl = aes->hl[lo];
+
+    for (int i = 15; i >= 0; --i)
+    {
+        lo = x[i] & 0xf;
+        hi = (x[i] >> 4) & 0xf;
+
+        if (i != 15)
+        {
+            rem = (uint8_t)(zl & 0xf);
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ ((uint64_t)_cryptodb_aes_gcm_last4[rem] << 48);
+            zh ^= aes->hh[lo];
+            zl ^= aes->hl[lo];
+        }
+
+        rem = (uint8_t)(zl & 0xf);
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ ((uint64_t)_cryptodb_aes_gcm_last4[rem] << 48);
+        zh ^= aes->hh[hi];
+        zl ^= aes->hl[hi];
+    }
+
+    _cryptodb_aes_store_be64(x, zh);
+    _cryptodb_aes_store_be64(x + 8, zl);
+}
+
+/**
+ * Updates GHASH state "x" with "data", the last block is zero padded
+ */
+static void _cryptodb_aes_ghash(const _cryptodb_aes_impl_t *impl,
+                                const _cryptodb_aes_t *aes,
+                                uint8_t x[16],
+                                const uint8_t *data, size_t len)
+{
+    uint8_t last[16] = {0};
+    size_t blocks = len / 16;
+
+    if (impl->ghash)
+    {
+        impl->ghash(aes->h, x, data, blocks);
+    }
+    else
+    {
+        for (size_t b = 0; b < blocks; ++b)
+        {
+            for (int i = 0; i < 16; ++i)
+                x[i] ^= data[16 * b + i];
+            _cryptodb_aes_gcm_mult(aes, x);
+        }
+    }
+
+    if (len % 16)
+    {
+        memcpy(last, data + 16 * blocks, len % 16);
+        if (impl->ghash)
+        {
+            impl->ghash(aes->h, x, last, 1);
+        }
+        else
+        {
+            for (int i = 0; i < 16; ++i)
+                x[i] ^= last[i];
+            _cryptodb_aes_gcm_mult(aes, x);
+        }
+        mbedtls_platform_zeroize(last, sizeof(last));
+    }
+}
+
+/**
+ * CTR mode with 32-bit big-endian counter, "size" doesn't have to be
+ * multiple of 16. "ctr" is updated after the call.
+ */
+static int _cryptodb_aes_ctr32(const _cryptodb_aes_impl_t *impl,
+                               const _cryptodb_aes_t *aes,
+                               uint8_t ctr[16],
+                               size_t size,
+                               const uint8_t *in,
+                               uint8_t *out)
+{
+    uint8_t buf[CRYPTODB_AES_GCM_SMALL_LEN];
+    size_t blocks = size / 16, tail = size % 16, len = 0;
+
+    if (impl->ctr32)
+    {
+        // The last partial block goes through the kernel in a zero-padded
+        // buffer, together with the whole message if it's small
+        len = (tail && size < sizeof(buf)) ? size : tail;
+
+        if (size > len)
+            impl->ctr32(aes->rk, ctr, in, out, (size - len) / 16);
+        if (len)
+        {
+            memset(buf, 0, (len + 15) & ~(size_t)15);
+            memcpy(buf, in + size - len, len);
+            impl->ctr32(aes->rk, ctr, buf, buf, (len + 15) / 16);
+            memcpy(out + size - len, buf, len);
+            mbedtls_platform_zeroize(buf, len);
+        }
+        return CRYPTODB_SUCCESS;
+    }
+
+    for (size_t b = 0; b < blocks + (tail ? 1 : 0); ++b)
+    {
+        len = b < blocks ? 16 : tail;
+
+        // mbedtls_aes_crypt_ecb() doesn't modify the context, the cast is safe
+        if (mbedtls_aes_crypt_ecb((mbedtls_aes_context *)&aes->enc,
+                                  MBEDTLS_AES_ENCRYPT, ctr, buf))
+        {
+            mbedtls_platform_zeroize(buf, 16);
+            return CRYPTODB_ERR_ENCRYPTION_FAIL;
+        }
+        for (size_t i = 0; i < len; ++i)
+            out[16 * b + i] = in[16 * b + i] ^ buf[i];
+        for (int i = 15; i >= 12; --i)
+            if (++ctr[i] != 0)
+                break;
+    }
+
+    mbedtls_platform_zeroize(buf, 16);
+
+    return CRYPTODB_SUCCESS;
+}
+
+/**
+ * CMAC subkey generation: x * 2 in GF(2^128) (NIST SP 800-38B, 6.1)
+ */
+static void _cryptodb_aes_cmac_double(const uint8_t in[16], uint8_t out[16])
+{
+    uint8_t msb = in[0] >> 7;
+
+    for (int i = 0; i < 15; ++i)
+        out[i] = (uint8_t)((in[i] << 1) | (in[i + 1] >> 7));
+    out[15] = (uint8_t)((in[15] << 1) ^ (0x87 & (0 - msb)));
+}
+
+static int _cryptodb_aes_setkey_impl(const _cryptodb_aes_impl_t *impl,
+                                     _cryptodb_aes_t *aes,
+                                     const uint8_t key[CRYPTODB_AES_256_KEY_LEN])
+{
+    uint8_t zero[16] = {0}, iv[16] = {0};
+
+    _cryptodb_aes_free(aes);
+    _cryptodb_aes_init(aes);
+
+    if (impl->cbc_encrypt)
+    {
+        _cryptodb_aes_expand_key(key, aes->rk);
+        impl->decrypt_keys(aes->rk, aes->drk);
+        impl->cbc_encrypt(aes->rk, iv, zero, aes->h, 1);
+    }
+    else
+    {
+        if (mbedtls_aes_setkey_enc(&aes->enc, (const unsigned char *)key, 256))
+            return CRYPTODB_ERR_ENCRYPTION_FAIL;
+        if (mbedtls_aes_setkey_dec(&aes->dec, (const unsigned char *)key, 256))
+            return CRYPTODB_ERR_DECRYPTION_FAIL;
+        if (mbedtls_aes_crypt_ecb(&aes->enc, MBEDTLS_AES_ENCRYPT, zero, aes->h))
+            return CRYPTODB_ERR_ENCRYPTION_FAIL;
+    }
+
+    _cryptodb_aes_gcm_gen_table(aes);
+    _cryptodb_aes_cmac_double(aes->h, aes->k1);
+    _cryptodb_aes_cmac_double(aes->k1, aes->k2);
+
+    return CRYPTODB_SUCCESS;
+}
+
+/**
+ * Counter block of the message block "block": IV || (block + 2), the
+ * counter 1 is used for the tag (NIST SP 800-38D, 7.1)
+ */
+static void _cryptodb_aes_gcm_counter(const uint8_t iv[CRYPTODB_AES_GCM_IV_LEN],
+                                      uint32_t counter,
+                                      uint8_t ctr[16])
+{
+    memcpy(ctr, iv, CRYPTODB_AES_GCM_IV_LEN);
+    ctr[12] = (uint8_t)(counter >> 24);
+    ctr[13] = (uint8_t)(counter >> 16);
+    ctr[14] = (uint8_t)(counter >> 8);
+    ctr[15] = (uint8_t)counter;
+}
+
+static int _cryptodb_aes_gcm_crypt_impl(const _cryptodb_aes_impl_t *impl,
+                                        const _cryptodb_aes_t *aes,
+                                        const uint8_t iv[CRYPTODB_AES_GCM_IV_LEN],
+                                        size_t block,
+                                        size_t size,
+                                        const uint8_t *in,
+                                        uint8_t *out)
+{
+    uint8_t ctr[16] = {0};
+
+    // GCM message is limited to 2^32 - 2 blocks
+    if ((uint64_t)block + (size + 15) / 16 > 0xfffffffeull)
+        return CRYPTODB_ERR_WRONG_ARGUMENT;
+
+    _cryptodb_aes_gcm_counter(iv, (uint32_t)(block + 2), ctr);
+
+    return _cryptodb_aes_ctr32(impl, aes, ctr, size, in, out);
+}
+
+static int _cryptodb_aes_gcm_tag_impl(const _cryptodb_aes_impl_t *impl,
+                                      const _cryptodb_aes_t *aes,
+                                      bool encrypt_decrypt,
+                                      const uint8_t iv[CRYPTODB_AES_GCM_IV_LEN],
+                                      const uint8_t *add, size_t add_len,
+                                      const uint8_t *c, size_t c_len,
+                                      uint8_t tag[CRYPTODB_AES_GCM_TAG_LEN])
+{
+    int result = CRYPTODB_SUCCESS;
+    uint8_t x[16] = {0}, lens[16] = {0}, ctr[16] = {0}, diff = 0;
+    uint8_t small[CRYPTODB_AES_GCM_SMALL_LEN];
+    size_t add_padded = (add_len + 15) & ~(size_t)15, c_padded = (c_len + 15) & ~(size_t)15;
+
+    _cryptodb_aes_store_be64(lens, (uint64_t)add_len * 8);
+    _cryptodb_aes_store_be64(lens + 8, (uint64_t)c_len * 8);
+
+    if (add_padded + c_padded + sizeof(lens) <= sizeof(small))
+    {
+        // Ciphertext and additional data aren't secret, no need to zero the buffer
+        if (add_len)
+        {
+            memset(small + add_padded - 16, 0, 16);
+            memcpy(small, add, add_len);
+        }
+        if (c_len)
+        {
+            memset(small + add_padded + c_padded - 16, 0, 16);
+            memcpy(small + add_padded, c, c_len);
+        }
+        memcpy(small + add_padded + c_padded, lens, sizeof(lens));
+        _cryptodb_aes_ghash(impl, aes, x, small, add_padded + c_padded + sizeof(lens));
+    }
+    else
+    {
+        if (add_len)
+            _cryptodb_aes_ghash(impl, aes, x, add, add_len);
+        if (c_len)
+            _cryptodb_aes_ghash(impl, aes, x, c, c_len);
+        _cryptodb_aes_ghash(impl, aes, x, lens, sizeof(lens));
+    }
+
+    _cryptodb_aes_gcm_counter(iv, 1, ctr);
+    result = _cryptodb_aes_ctr32(impl, aes, ctr, sizeof(x), x, x);
+
+    if (result == CRYPTODB_SUCCESS)
+    {
+        if (encrypt_decrypt)
+        {
+            memcpy(tag, x, CRYPTODB_AES_GCM_TAG_LEN);
+        }
+        else
+        {
+            // Constant time comparison
+            for (int i = 0; i < CRYPTODB_AES_GCM_TAG_LEN; ++i)
+                diff |= x[i] ^ tag[i];
+            if (diff)
+                result = CRYPTODB_ERR_INTEGRITY_FAIL;
+        }
+    }
+
+    mbedtls_platform_zeroize(x, sizeof(x));
+
+    return result;
+}
+
+static int _cryptodb_aes_gcm_impl(const _cryptodb_aes_impl_t *impl,
+                                  const _cryptodb_aes_t *aes,
+                                  bool encrypt_decrypt,
+                                  size_t size,
+                                  const uint8_t iv[CRYPTODB_AES_GCM_IV_LEN],
+                                  const uint8_t *add, size_t add_len,
+                                  const uint8_t *in,
+                                  uint8_t *out,
+                                  uint8_t tag[CRYPTODB_AES_GCM_TAG_LEN])
+{
+    int result = CRYPTODB_SUCCESS;
+
+    if (encrypt_decrypt)
+    {
+        result = _cryptodb_aes_gcm_crypt_impl(impl, aes, iv, 0, size, in, out);
+        if (result == CRYPTODB_SUCCESS)
+            result = _cryptodb_aes_gcm_tag_impl(impl, aes, true, iv,
+                                                add, add_len, out, size, tag);
+    }
+    else
+    {
+        result = _cryptodb_aes_gcm_tag_impl(impl, aes, false, iv,
+                                            add, add_len, in, size, tag);
+        if (result == CRYPTODB_SUCCESS)
+            result = _cryptodb_aes_gcm_crypt_impl(impl, aes, iv, 0, size, in, out);
+    }
+
+    return result;
+}
+
+/**
+ * CMAC processes the message in stack buffers of this many blocks, the
+ * CBC ciphertext itself isn't needed
+ */
+#define CRYPTODB_AES_CMAC_CHUNK_BLOCKS (16)
+
+/**
+ * CBC-MAC of "blocks" 16 bytes blocks: x = AES(x ^ block) for every block
+ */
+static int _cryptodb_aes_cbc_mac(const _cryptodb_aes_impl_t *impl,
+                                 const _cryptodb_aes_t *aes,
+                                 uint8_t x[16],
+                                 const uint8_t *in,
+                                 size_t blocks)
+{
+    uint8_t buf[CRYPTODB_AES_CMAC_CHUNK_BLOCKS * 16];
+    size_t n = 0, used = 0;
+    int result = CRYPTODB_SUCCESS;
+
+    while (blocks && result == CRYPTODB_SUCCESS)
+    {
+        n = blocks < CRYPTODB_AES_CMAC_CHUNK_BLOCKS ? blocks : CRYPTODB_AES_CMAC_CHUNK_BLOCKS;
+        used = n > used ? n : used;
+
+        // mbedtls_aes_crypt_cbc() doesn't modify the context, the cast is safe
+        if (impl->cbc_encrypt)
+            impl->cbc_encrypt(aes->rk, x, in, buf, n);
+        else if (mbedtls_aes_crypt_cbc((mbedtls_aes_context *)&aes->enc,
+                                       MBEDTLS_AES_ENCRYPT, 16 * n, x, in, buf))
+            result = CRYPTODB_ERR_ENCRYPTION_FAIL;
+
+        in += 16 * n;
+        blocks -= n;
+    }
+
+    mbedtls_platform_zeroize(buf, 16 * used);
+
+    return result;
+}
+
+static int _cryptodb_aes_cmac_impl(const _cryptodb_aes_impl_t *impl,
+                                   const _cryptodb_aes_t *aes,
+                                   const uint8_t prefix[16],
+                                   const uint8_t *in, size_t len,
+                                   uint8_t mac[CRYPTODB_AES_CMAC_LEN])
+{
+    uint8_t x[16] = {0}, last[16] = {0};
+    size_t blocks = len ? (len - 1) / 16 : 0, tail = len - 16 * blocks;
+    const uint8_t *k = aes->k1;
+    int result = CRYPTODB_SUCCESS;
+
+    // The last block (complete or not) is XORed with the subkey
+    if (prefix && !len)
+    {
+        memcpy(last, prefix, 16);
+        tail = 16;
+    }
+    else
+    {
+        if (prefix)
+            result = _cryptodb_aes_cbc_mac(impl, aes, x, prefix, 1);
+        if (result == CRYPTODB_SUCCESS)
+            result = _cryptodb_aes_cbc_mac(impl, aes, x, in, blocks);
+        if (tail)
+            memcpy(last, in + 16 * blocks, tail);
+    }
+    if (tail < 16)
+    {
+        last[tail] = 0x80;
+        k = aes->k2;
+    }
+    for (int i = 0; i < 16; ++i)
+        last[i] ^= k[i];
+
+    if (result == CRYPTODB_SUCCESS)
+        result = _cryptodb_aes_cbc_mac(impl, aes, x, last, 1);
+    if (result == CRYPTODB_SUCCESS)
+        memcpy(mac, x, CRYPTODB_AES_CMAC_LEN);
+
+    mbedtls_platform_zeroize(x, sizeof(x));
+    mbedtls_platform_zeroize(last, sizeof(last));
+
+    return result;
+}
+
+/**
+ * Checks "impl" against FIPS-197 AES-256 test vector and against
+ * mbedtls on several CBC messages of different lengths.
+ */
+static int _cryptodb_aes_self_test_cbc(const _cryptodb_aes_impl_t *impl,
+                                       const uint8_t key[CRYPTODB_AES_256_KEY_LEN])
+{
+    // FIPS-197, C.3 AES-256
+    static const uint8_t fips_pt[16] = {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+        0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+    };
+    static const uint8_t fips_ct[16] = {
+        0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf,
+        0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89
+    };
+    // Pipelined kernels decrypt up to 8 blocks at once, check the tails as well
+    static const size_t sizes[] = { 16, 32, 48, 64, 80, 112, 128, 144, 208, 256, 1024 };
+
+    int result = CRYPTODB_ERR_FAIL;
+    uint8_t rk[CRYPTODB_AES_256_RK_LEN] = {0};
+    uint8_t drk[CRYPTODB_AES_256_RK_LEN] = {0};
+    uint8_t iv_ref[16] = {0}, iv[16] = {0};
+    uint8_t in[1024] = {0}, ref[1024] = {0}, out[1024] = {0};
+    mbedtls_aes_context enc, dec;
+
+    mbedtls_aes_init(&enc);
+    mbedtls_aes_init(&dec);
+
+    if (mbedtls_aes_setkey_enc(&enc, key, 256) ||
+        mbedtls_aes_setkey_dec(&dec, key, 256))
+        goto exit;
+
+    // Known answer
+    if (mbedtls_aes_crypt_cbc(&enc, MBEDTLS_AES_ENCRYPT, 16, iv_ref, fips_pt, ref) ||
+        memcmp(ref, fips_ct, 16))
+        goto exit;
+
+    if (impl->cbc_encrypt == NULL)
+    {
+        result = CRYPTODB_SUCCESS;
+        goto exit;
+    }
+
+    _cryptodb_aes_expand_key(key, rk);
+    impl->decrypt_keys(rk, drk);
+
+    memset(iv, 0, sizeof(iv));
+    impl->cbc_encrypt(rk, iv, fips_pt, out, 1);
+    if (memcmp(out, fips_ct, 16))
+        goto exit;
+
+    // Bit-identical with mbedtls
+    for (size_t i = 0; i < sizeof(in); ++i)
+        in[i] = (uint8_t)(i * 31 + 7);
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        size_t size = sizes[s];
+
+        for (size_t i = 0; i < 16; ++i)
+            iv_ref[i] = iv[i] = (uint8_t)(0xa5 ^ (i + s));
+        if (mbedtls_aes_crypt_cbc(&enc, MBEDTLS_AES_ENCRYPT, size, iv_ref, in, ref))
+            goto exit;
+        impl->cbc_encrypt(rk, iv, in, out, size / 16);
+        if (memcmp(out, ref, size) || memcmp(iv, iv_ref, 16))
+            goto exit;
+
+        for (size_t i = 0; i < 16; ++i)
+            iv_ref[i] = iv[i] = (uint8_t)(0x5a ^ (i + s));
+        if (mbedtls_aes_crypt_cbc(&dec, MBEDTLS_AES_DECRYPT, size, iv_ref, in, ref))
+            goto exit;
+        // In-place, as cryptodb does it
+        memcpy(out, in, size);
+        impl->cbc_decrypt(drk, iv, out, out, size / 16);
+        if (memcmp(out, ref, size) || memcmp(iv, iv_ref, 16))
+            goto exit;
+    }
+
+    result = CRYPTODB_SUCCESS;
+
+exit:
+    mbedtls_aes_free(&enc);
+    mbedtls_aes_free(&dec);
+    mbedtls_platform_zeroize(rk, sizeof(rk));
+    mbedtls_platform_zeroize(drk, sizeof(drk));
+
+    return result;
+}
+
+/**
+ * Checks GCM of "impl" against NIST GCM test vector and against mbedtls
+ * on messages and additional data of different lengths.
+ */
+static int _cryptodb_aes_self_test_gcm(const _cryptodb_aes_impl_t *impl,
+                                       const uint8_t key[CRYPTODB_AES_256_KEY_LEN])
+{
+    // "The Galois/Counter Mode of Operation (GCM)", test case 14:
+    // zero key, zero IV, one zero block
+    static const uint8_t nist_ct[16] = {
+        0xce, 0xa7, 0x40, 0x3d, 0x4d, 0x60, 0x6b, 0x6e,
+        0x07, 0x4e, 0xc5, 0xd3, 0xba, 0xf3, 0x9d, 0x18
+    };
+    static const uint8_t nist_tag[16] = {
+        0xd0, 0xd1, 0xc8, 0xa7, 0x99, 0x99, 0x6b, 0xf0,
+        0x26, 0x5b, 0x98, 0xb5, 0xd4, 0x8a, 0xb9, 0x19
+    };
+    // Pipelined kernels encrypt up to 8 blocks at once, check the tails
+    // and the partial blocks as well
+    static const size_t sizes[] = { 0, 1, 15, 16, 17, 64, 100, 128, 143, 144, 255, 1000 };
+    static const size_t add_sizes[] = { 0, 13, 16, 20, 32 };
+
+    int result = CRYPTODB_ERR_FAIL;
+    uint8_t zero[CRYPTODB_AES_256_KEY_LEN] = {0};
+    uint8_t iv[CRYPTODB_AES_GCM_IV_LEN] = {0};
+    uint8_t tag_ref[16] = {0}, tag[16] = {0};
+    uint8_t in[1024] = {0}, ref[1024] = {0}, out[1024] = {0};
+    mbedtls_gcm_context gcm;
+    _cryptodb_aes_t aes;
+
+    mbedtls_gcm_init(&gcm);
+    _cryptodb_aes_init(&aes);
+
+    // Known answer
+    if (_cryptodb_aes_setkey_impl(impl, &aes, zero) != CRYPTODB_SUCCESS ||
+        _cryptodb_aes_gcm_impl(impl, &aes, true, 16, iv, NULL, 0, zero, out, tag) != CRYPTODB_SUCCESS ||
+        memcmp(out, nist_ct, 16) || memcmp(tag, nist_tag, 16))
+        goto exit;
+
+    // Bit-identical with mbedtls
+    if (_cryptodb_aes_setkey_impl(impl, &aes, key) != CRYPTODB_SUCCESS ||
+        mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, 256))
+        goto exit;
+
+    for (size_t i = 0; i < sizeof(in); ++i)
+        in[i] = (uint8_t)(i * 29 + 3);
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        size_t size = sizes[s];
+        size_t add_len = add_sizes[s % (sizeof(add_sizes) / sizeof(add_sizes[0]))];
+        const uint8_t *add = in + sizeof(in) - add_len;
+
+        for (size_t i = 0; i < sizeof(iv); ++i)
+            iv[i] = (uint8_t)(0xa5 ^ (i + s));
+
+        if (mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, size, iv, sizeof(iv),
+                                      add, add_len, in, ref, sizeof(tag_ref), tag_ref))
+            goto exit;
+        if (_cryptodb_aes_gcm_impl(impl, &aes, true, size, iv, add, add_len,
+                                   in, out, tag) != CRYPTODB_SUCCESS ||
+            memcmp(out, ref, size) || memcmp(tag, tag_ref, 16))
+            goto exit;
+
+        // In-place, as cryptodb does it
+        if (_cryptodb_aes_gcm_impl(impl, &aes, false, size, iv, add, add_len,
+                                   out, out, tag) != CRYPTODB_SUCCESS ||
+            memcmp(out, in, size))
+            goto exit;
+
+        tag[s % 16] ^= 0x01;
+        if (_cryptodb_aes_gcm_impl(impl, &aes, false, size, iv, add, add_len,
+                                   ref, out, tag) != CRYPTODB_ERR_INTEGRITY_FAIL)
+            goto exit;
+    }
+
+    result = CRYPTODB_SUCCESS;
+
+exit:
+    mbedtls_gcm_free(&gcm);
+    _cryptodb_aes_free(&aes);
+
+    return result;
+}
+
+/**
+ * Checks CMAC of "impl" against NIST SP 800-38B AES-256 examples and
+ * against the portable path on messages of different lengths.
+ */
+static int _cryptodb_aes_self_test_cmac(const _cryptodb_aes_impl_t *impl,
+                                        const uint8_t key[CRYPTODB_AES_256_KEY_LEN])
+{
+    static const uint8_t nist_key[CRYPTODB_AES_256_KEY_LEN] = {
+        0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe,
+        0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+        0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7,
+        0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4
+    };
+    static const uint8_t nist_msg[64] = {
+        0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+        0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+        0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+        0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+        0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+        0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+        0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+        0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+    };
+    static const size_t nist_len[4] = { 0, 16, 40, 64 };
+    static const uint8_t nist_mac[4][16] = {
+        { 0x02, 0x89, 0x62, 0xf6, 0x1b, 0x7b, 0xf8, 0x9e,
+          0xfc, 0x6b, 0x55, 0x1f, 0x46, 0x67, 0xd9, 0x83 },
+        { 0x28, 0xa7, 0x02, 0x3f, 0x45, 0x2e, 0x8f, 0x82,
+          0xbd, 0x4b, 0xf2, 0x8d, 0x8c, 0x37, 0xc3, 0x5c },
+        { 0xaa, 0xf3, 0xd8, 0xf1, 0xde, 0x56, 0x40, 0xc2,
+          0x32, 0xf5, 0xb1, 0x69, 0xb9, 0xc9, 0x11, 0xe6 },
+        { 0xe1, 0x99, 0x21, 0x90, 0x54, 0x9f, 0x6e, 0xd5,
+          0x69, 0x6a, 0x2c, 0x05, 0x6c, 0x31, 0x54, 0x10 }
+    };
+    // Whole messages go through the kernels in chunks, check the chunk
+    // boundaries and the partial blocks as well
+    static const size_t sizes[] = { 0, 1, 15, 16, 17, 31, 32, 100, 255, 256, 257, 1000 };
+
+    const _cryptodb_aes_impl_t portable = {
+        CRYPTODB_AES_BACKEND_PORTABLE, 0, NULL, NULL, NULL, NULL, NULL
+    };
+    int result = CRYPTODB_ERR_FAIL;
+    uint8_t in[1024] = {0}, mac_ref[16] = {0}, mac[16] = {0};
+    _cryptodb_aes_t aes, ref;
+
+    _cryptodb_aes_init(&aes);
+    _cryptodb_aes_init(&ref);
+
+    // Known answer
+    if (_cryptodb_aes_setkey_impl(impl, &aes, nist_key) != CRYPTODB_SUCCESS)
+        goto exit;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        if (_cryptodb_aes_cmac_impl(impl, &aes, NULL, nist_msg, nist_len[i], mac) != CRYPTODB_SUCCESS ||
+            memcmp(mac, nist_mac[i], 16))
+            goto exit;
+    }
+    // The prefix is the first block of the message
+    if (_cryptodb_aes_cmac_impl(impl, &aes, nist_msg, nist_msg + 16, 24, mac) != CRYPTODB_SUCCESS ||
+        memcmp(mac, nist_mac[2], 16) ||
+        _cryptodb_aes_cmac_impl(impl, &aes, nist_msg, NULL, 0, mac) != CRYPTODB_SUCCESS ||
+        memcmp(mac, nist_mac[1], 16))
+        goto exit;
+
+    // Bit-identical with the portable path
+    if (_cryptodb_aes_setkey_impl(impl, &aes, key) != CRYPTODB_SUCCESS ||
+        _cryptodb_aes_setkey_impl(&portable, &ref, key) != CRYPTODB_SUCCESS)
+        goto exit;
+
+    for (size_t i = 0; i < sizeof(in); ++i)
+        in[i] = (uint8_t)(i * 37 + 11);
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        const uint8_t *prefix = (s % 2) ? in + sizeof(in) - 16 : NULL;
+
+        if (_cryptodb_aes_cmac_impl(&portable, &ref, prefix, in, sizes[s], mac_ref) != CRYPTODB_SUCCESS ||
+            _cryptodb_aes_cmac_impl(impl, &aes, prefix, in, sizes[s], mac) != CRYPTODB_SUCCESS ||
+            memcmp(mac, mac_ref, 16))
+            goto exit;
+    }
+
+    result = CRYPTODB_SUCCESS;
+
+exit:
+    _cryptodb_aes_free(&aes);
+    _cryptodb_aes_free(&ref);
+
+    return result;
+}
+
+static int _cryptodb_aes_self_test_impl(const _cryptodb_aes_impl_t *impl)
+{
+    int result = CRYPTODB_SUCCESS;
+    uint8_t key[CRYPTODB_AES_256_KEY_LEN] = {0};
+
+    for (size_t i = 0; i < sizeof(key); ++i)
+        key[i] = (uint8_t)i;
+
+    result = _cryptodb_aes_self_test_cbc(impl, key);
+    if (result == CRYPTODB_SUCCESS)
+        result = _cryptodb_aes_self_test_gcm(impl, key);
+    if (result == CRYPTODB_SUCCESS)
+        result = _cryptodb_aes_self_test_cmac(impl, key);
+
+    return result;
+}
+
+static void _cryptodb_aes_impl_select(void)
+{
+    _cryptodb_aes_impl_t hw = {
+        CRYPTODB_AES_BACKEND_PORTABLE, 0, NULL, NULL, NULL, NULL, NULL
+    };
+
+    hw.cpu_features = _cryptodb_aes_detect_cpu();
+    _cryptodb_aes_impl.cpu_features = hw.cpu_features;
+
+    if (!(hw.cpu_features & CRYPTODB_CPU_AES))
+        return;
+
+#if defined(CRYPTODB_HAVE_AESNI)
+    hw.backend = CRYPTODB_AES_BACKEND_AESNI;
+    hw.decrypt_keys = _cryptodb_aesni_decrypt_keys;
+    hw.cbc_encrypt = _cryptodb_aesni_cbc_encrypt;
+    hw.cbc_decrypt = _cryptodb_aesni_cbc_decrypt;
+    hw.ctr32 = _cryptodb_aesni_ctr32;
+    if (hw.cpu_features & CRYPTODB_CPU_CLMUL)
+        hw.ghash = _cryptodb_aesni_ghash;
+#elif defined(CRYPTODB_HAVE_ARMV8_CE)
+    hw.backend = CRYPTODB_AES_BACKEND_ARMV8_CE;
+    hw.decrypt_keys = _cryptodb_armv8_decrypt_keys;
+    hw.cbc_encrypt = _cryptodb_armv8_cbc_encrypt;
+    hw.cbc_decrypt = _cryptodb_armv8_cbc_decrypt;
+    hw.ctr32 = _cryptodb_armv8_ctr32;
+    // No PMULL GHASH kernel, the portable one is checked against mbedtls_gcm
+#endif
+
+    // Never use kernels that don't match mbedtls, otherwise the
+    // database won't be readable on other machines
+    if (hw.cbc_encrypt && _cryptodb_aes_self_test_impl(&hw) == CRYPTODB_SUCCESS)
+        _cryptodb_aes_impl = hw;
+}
+
+static const _cryptodb_aes_impl_t * _cryptodb_aes_get_impl(void)
+{
+    pthread_once(&_cryptodb_aes_impl_once, _cryptodb_aes_impl_select);
+    return &_cryptodb_aes_impl;
+}
+
+void _cryptodb_aes_init(_cryptodb_aes_t *aes)
+{
+    memset(aes, 0, sizeof(_cryptodb_aes_t));
+    mbedtls_aes_init(&aes->enc);
+    mbedtls_aes_init(&aes->dec);
+}
+
+void _cryptodb_aes_free(_cryptodb_aes_t *aes)
+{
+    mbedtls_aes_free(&aes->enc);
+    mbedtls_aes_free(&aes->dec);
+    mbedtls_platform_zeroize(aes, sizeof(_cryptodb_aes_t));
+}
+
+int _cryptodb_aes_setkey(_cryptodb_aes_t *aes,
+                         const uint8_t key[CRYPTODB_AES_256_KEY_LEN])
+{
+    return _cryptodb_aes_setkey_impl(_cryptodb_aes_get_impl(), aes, key);
+}
+
+int _cryptodb_aes_cbc(const _cryptodb_aes_t *aes,
+                      bool encrypt_decrypt,
+                      size_t size,
+                      uint8_t iv[16],
+                      const uint8_t *in,
+                      uint8_t *out)
+{
+    const _cryptodb_aes_impl_t *impl = _cryptodb_aes_get_impl();
+
+    if (size % 16)
+        return encrypt_decrypt ? CRYPTODB_ERR_ENCRYPTION_FAIL :
+                                 CRYPTODB_ERR_DECRYPTION_FAIL;
+
+    if (impl->cbc_encrypt)
+    {
+        if (encrypt_decrypt)
+            impl->cbc_encrypt(aes->rk, iv, in, out, size / 16);
+        else
+            impl->cbc_decrypt(aes->drk, iv, in, out, size / 16);
+        return CRYPTODB_SUCCESS;
+    }
+
+    // mbedtls_aes_crypt_cbc() doesn't modify the context, the cast is safe
+    if (encrypt_decrypt)
+    {
+        if (mbedtls_aes_crypt_cbc((mbedtls_aes_context *)&aes->enc,
+                                  MBEDTLS_AES_ENCRYPT, size, iv, in, out))
+            return CRYPTODB_ERR_ENCRYPTION_FAIL;
+    }
+    else
+    {
+        if (mbedtls_aes_crypt_cbc((mbedtls_aes_context *)&aes->dec,
+                                  MBEDTLS_AES_DECRYPT, size, iv, in, out))
+            return CRYPTODB_ERR_DECRYPTION_FAIL;
+    }
+
+    return CRYPTODB_SUCCESS;
+}
+
+int _cryptodb_aes_gcm_crypt(const _cryptodb_aes_t *aes,
+                            const uint8_t iv[CRYPTODB_AES_GCM_IV_LEN],
+                            size_t block,
+                            size_t size,
+                            const uint8_t *in,
+                            uint8_t *out)
+{
+    return _cryptodb_aes_gcm_crypt_impl(_cryptodb_aes_get_impl(), aes, iv,
+                                        block, size, in, out);
+}
+
+int _cryptodb_aes_gcm_tag(const _cryptodb_aes_t *aes,
+                          bool encrypt_decrypt,
+                          const uint8_t iv[CRYPTODB_AES_GCM_IV_LEN],
+                          const uint8_t *add, size_t add_len,
+                          const uint8_t *c, size_t c_len,
+                          uint8_t tag[CRYPTODB_AES_GCM_TAG_LEN])
+{
+    return _cryptodb_aes_gcm_tag_impl(_cryptodb_aes_get_impl(), aes, encrypt_decrypt,
+                                      iv, add, add_len, c, c_len, tag);
+}
+
+int _cryptodb_aes_cmac(const _cryptodb_aes_t *aes,
+                       const uint8_t prefix[16],
+                       const uint8_t *in, size_t len,
+                       uint8_t mac[CRYPTODB_AES_CMAC_LEN])
+{
+    return _cryptodb_aes_cmac_impl(_cryptodb_aes_get_impl(), aes, prefix, in, len, mac);
+}
+
+/**
+ * PUBLIC API
+ */
+
+cryptodb_aes_backend_t cryptodb_aes_backend(void)
+{
+    return _cryptodb_aes_get_impl()->backend;
+}
+
+unsigned int cryptodb_cpu_features(void)
+{
+    return _cryptodb_aes_get_impl()->cpu_features;
+}
+
+const char * cryptodb_aes_backend_to_str(cryptodb_aes_backend_t backend)
+{
+    switch (backend)
+    {
+    default:
+        break;
+    case CRYPTODB_AES_BACKEND_PORTABLE:
+        return "Portable (mbedcrypto)";
+    case CRYPTODB_AES_BACKEND_AESNI:
+        return "x86 AES-NI";
+    case CRYPTODB_AES_BACKEND_ARMV8_CE:
+        return "ARMv8 Crypto Extensions";
+    }
+
+    return "Unknown AES backend";
+}
+
+int cryptodb_aes_self_test(void)
+{
+    return _cryptodb_aes_self_test_impl(_cryptodb_aes_get_impl());
+}
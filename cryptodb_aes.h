@@ -0,0 +1,192 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+/**
+ * Private AES-256-CBC/GCM backend of cryptodb. Not a part of the public API.
+ *
+ * The backend is selected once at runtime: x86 AES-NI or ARMv8 Crypto
+ * Extensions kernels are used if the CPU supports them and they pass the
+ * self-test against mbedtls, otherwise mbedtls is used (portable path).
+ * Both paths produce bit-identical output.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <mbedtls/aes.h>
+
+#include <cryptodb.h>
+
+#define CRYPTODB_AES_256_KEY_LEN (32)
+#define CRYPTODB_AES_256_ROUNDS  (14)
+#define CRYPTODB_AES_256_RK_LEN  ((CRYPTODB_AES_256_ROUNDS + 1) * 16)
+#define CRYPTODB_AES_GCM_IV_LEN  (12)
+#define CRYPTODB_AES_GCM_TAG_LEN (16)
+#define CRYPTODB_AES_CMAC_LEN    (16)
+
+typedef struct {
+    // Portable path
+    mbedtls_aes_context enc;
+    mbedtls_aes_context dec;
+    // Hardware path. Round keys are stored in the FIPS-197 byte order,
+    // "drk" are the "Equivalent Inverse Cipher" round keys.
+    uint8_t rk[CRYPTODB_AES_256_RK_LEN];
+    uint8_t drk[CRYPTODB_AES_256_RK_LEN];
+    // GCM hash subkey H = AES(K, 0^128) and its 4-bit multiplication
+    // tables for the portable GHASH
+    uint8_t h[16];
+    uint64_t hl[16];
+    uint64_t hh[16];
+    // CMAC subkeys K1 and K2 (NIST SP 800-38B), derived from H as well
+    uint8_t k1[16];
+    uint8_t k2[16];
+} _cryptodb_aes_t;
+
+/**
+ * Hardware kernels, see cryptodb_aes_hw.c. "blocks" is the number of
+ * 16 bytes blocks, "in" and "out" may point to the same buffer.
+ * "ctr32" kernels increment only the last 32 bits of the counter block
+ * (big-endian), like GCM does. "ghash" kernels update "x" with every
+ * block: x = (x ^ block) * H in GF(2^128).
+ */
+#if defined(CRYPTODB_HAVE_AESNI)
+void _cryptodb_aesni_decrypt_keys(const uint8_t *rk, uint8_t *drk);
+void _cryptodb_aesni_cbc_encrypt(const uint8_t *rk, uint8_t iv[16],
+                                 const uint8_t *in, uint8_t *out,
+                                 size_t blocks);
+void _cryptodb_aesni_cbc_decrypt(const uint8_t *drk, uint8_t iv[16],
+                                 const uint8_t *in, uint8_t *out,
+                                 size_t blocks);
+void _cryptodb_aesni_ctr32(const uint8_t *rk, uint8_t ctr[16],
+                           const uint8_t *in, uint8_t *out,
+                           size_t blocks);
+void _cryptodb_aesni_ghash(const uint8_t h[16], uint8_t x[16],
+                           const uint8_t *in, size_t blocks);
+#endif
+
+#if defined(CRYPTODB_HAVE_ARMV8_CE)
+void _cryptodb_armv8_decrypt_keys(const uint8_t *rk, uint8_t *drk);
+void _cryptodb_armv8_cbc_encrypt(const uint8_t *rk, uint8_t iv[16],
+                                 const uint8_t *in, uint8_t *out,
+                                 size_t blocks);
+void _cryptodb_armv8_cbc_decrypt(const uint8_t *drk, uint8_t iv[16],
+                                 const uint8_t *in, uint8_t *out,
+                                 size_t blocks);
+void _cryptodb_armv8_ctr32(const uint8_t *rk, uint8_t ctr[16],
+                           const uint8_t *in, uint8_t *out,
+                           size_t blocks);
+#endif
+
+/**
+ * @brief      Initialize AES context. Must be paired with _cryptodb_aes_free().
+ */
+void _cryptodb_aes_init(_cryptodb_aes_t *aes);
+
+/**
+ * @brief      Free AES context and zero its key material.
+ */
+void _cryptodb_aes_free(_cryptodb_aes_t *aes);
+
+/**
+ * @brief      Expand encryption and decryption key schedules for the
+ *             selected backend.
+ *
+ * @return     See cryptodb_err_t
+ */
+int _cryptodb_aes_setkey(_cryptodb_aes_t *aes,
+                         const uint8_t key[CRYPTODB_AES_256_KEY_LEN]);
+
+/**
+ * @brief      AES-256-CBC encryption/decryption. The context is only read,
+ *             so it can be used from several threads at once.
+ *
+ * @param[in]  size  Must be multiple of 16
+ * @param      iv    Updated after the call, like in mbedtls_aes_crypt_cbc()
+ *
+ * @return     See cryptodb_err_t
+ */
+int _cryptodb_aes_cbc(const _cryptodb_aes_t *aes,
+                      bool encrypt_decrypt,
+                      size_t size,
+                      uint8_t iv[16],
+                      const uint8_t *in,
+                      uint8_t *out);
+
+/**
+ * @brief      AES-256-GCM encryption/decryption of the part of the message
+ *             that starts at the 16 bytes block number "block" (CTR mode
+ *             without authentication). The context is only read, so parts
+ *             of one message can be processed from several threads at once.
+ *
+ * @param[in]  iv     Nonce of the message
+ * @param[in]  block  Index of the first block of the part in the message
+ * @param[in]  size   Part length, must be multiple of 16 unless it's the
+ *                    last part of the message
+ *
+ * @return     See cryptodb_err_t
+ */
+int _cryptodb_aes_gcm_crypt(const _cryptodb_aes_t *aes,
+                            const uint8_t iv[CRYPTODB_AES_GCM_IV_LEN],
+                            size_t block,
+                            size_t size,
+                            const uint8_t *in,
+                            uint8_t *out);
+
+/**
+ * @brief      AES-256-GCM authentication tag of the message.
+ *
+ * @param[in]  encrypt_decrypt  If true, "tag" is written, otherwise it's
+ *                              compared with the tag of the message
+ * @param[in]  add              Additional authenticated data, can be NULL
+ *                              if "add_len" is 0
+ * @param[in]  c                Ciphertext
+ * @param      tag              Authentication tag
+ *
+ * @return     See cryptodb_err_t, CRYPTODB_ERR_INTEGRITY_FAIL if the tags
+ *             don't match
+ */
+int _cryptodb_aes_gcm_tag(const _cryptodb_aes_t *aes,
+                          bool encrypt_decrypt,
+                          const uint8_t iv[CRYPTODB_AES_GCM_IV_LEN],
+                          const uint8_t *add, size_t add_len,
+                          const uint8_t *c, size_t c_len,
+                          uint8_t tag[CRYPTODB_AES_GCM_TAG_LEN]);
+
+/**
+ * @brief      AES-256-CMAC (NIST SP 800-38B) of "prefix" || "in". The
+ *             context is only read, so it can be used from several threads
+ *             at once.
+ *
+ * @param[in]  prefix  (Optional, can be NULL) The first 16 bytes block of
+ *                     the message, e.g. to get several independent MACs
+ *                     of the same data
+ * @param[out] mac     Message authentication code
+ *
+ * @return     See cryptodb_err_t
+ */
+int _cryptodb_aes_cmac(const _cryptodb_aes_t *aes,
+                       const uint8_t prefix[16],
+                       const uint8_t *in, size_t len,
+                       uint8_t mac[CRYPTODB_AES_CMAC_LEN]);
@@ -0,0 +1,416 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+/**
+ * Hardware AES-256-CBC/GCM kernels. This file is compiled with extra compiler
+ * flags (see CMakeLists.txt), so the functions below must be called only
+ * after the runtime CPU check in cryptodb_aes.c.
+ */
+
+#include <cryptodb_aes.h>
+
+#if defined(CRYPTODB_HAVE_AESNI)
+
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+
+#define CRYPTODB_AES_PIPELINE_BLOCKS (8)
+
+void _cryptodb_aesni_decrypt_keys(const uint8_t *rk, uint8_t *drk)
+{
+    __m128i k;
+
+    k = _mm_loadu_si128((const __m128i *)(rk + 16 * CRYPTODB_AES_256_ROUNDS));
+    _mm_storeu_si128((__m128i *)drk, k);
+    for (int i = 1; i < CRYPTODB_AES_256_ROUNDS; ++i)
+    {
+        k = _mm_loadu_si128((const __m128i *)(rk + 16 * (CRYPTODB_AES_256_ROUNDS - i)));
+        _mm_storeu_si128((__m128i *)(drk + 16 * i), _mm_aesimc_si128(k));
+    }
+    k = _mm_loadu_si128((const __m128i *)rk);
+    _mm_storeu_si128((__m128i *)(drk + 16 * CRYPTODB_AES_256_ROUNDS), k);
+}
+
+void _cryptodb_aesni_cbc_encrypt(const uint8_t *rk, uint8_t iv[16],
+                                 const uint8_t *in, uint8_t *out,
+                                 size_t blocks)
+{
+    __m128i k[CRYPTODB_AES_256_ROUNDS + 1];
+    __m128i c = _mm_loadu_si128((const __m128i *)iv);
+
+    for (int i = 0; i <= CRYPTODB_AES_256_ROUNDS; ++i)
+        k[i] = _mm_loadu_si128((const __m128i *)(rk + 16 * i));
+
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        c = _mm_xor_si128(c, _mm_loadu_si128((const __m128i *)(in + 16 * b)));
+        c = _mm_xor_si128(c, k[0]);
+        for (int i = 1; i < CRYPTODB_AES_256_ROUNDS; ++i)
+            c = _mm_aesenc_si128(c, k[i]);
+        c = _mm_aesenclast_si128(c, k[CRYPTODB_AES_256_ROUNDS]);
+        _mm_storeu_si128((__m128i *)(out + 16 * b), c);
+    }
+
+    _mm_storeu_si128((__m128i *)iv, c);
+}
+
+void _cryptodb_aesni_cbc_decrypt(const uint8_t *drk, uint8_t iv[16],
+                                 const uint8_t *in, uint8_t *out,
+                                 size_t blocks)
+{
+    size_t b = 0;
+    __m128i k[CRYPTODB_AES_256_ROUNDS + 1];
+    __m128i prev = _mm_loadu_si128((const __m128i *)iv);
+    __m128i c[CRYPTODB_AES_PIPELINE_BLOCKS], p[CRYPTODB_AES_PIPELINE_BLOCKS];
+
+    for (int i = 0; i <= CRYPTODB_AES_256_ROUNDS; ++i)
+        k[i] = _mm_loadu_si128((const __m128i *)(drk + 16 * i));
+
+    // Every plaintext block depends only on two ciphertext blocks, so
+    // several blocks go through AESDEC pipeline at once
+    for (; b + CRYPTODB_AES_PIPELINE_BLOCKS <= blocks; b += CRYPTODB_AES_PIPELINE_BLOCKS)
+    {
+        for (int j = 0; j < CRYPTODB_AES_PIPELINE_BLOCKS; ++j)
+        {
+            c[j] = _mm_loadu_si128((const __m128i *)(in + 16 * (b + j)));
+            p[j] = _mm_xor_si128(c[j], k[0]);
+        }
+        for (int i = 1; i < CRYPTODB_AES_256_ROUNDS; ++i)
+            for (int j = 0; j < CRYPTODB_AES_PIPELINE_BLOCKS; ++j)
+                p[j] = _mm_aesdec_si128(p[j], k[i]);
+        for (int j = 0; j < CRYPTODB_AES_PIPELINE_BLOCKS; ++j)
+            p[j] = _mm_aesdeclast_si128(p[j], k[CRYPTODB_AES_256_ROUNDS]);
+
+        _mm_storeu_si128((__m128i *)(out + 16 * b), _mm_xor_si128(p[0], prev));
+        for (int j = 1; j < CRYPTODB_AES_PIPELINE_BLOCKS; ++j)
+            _mm_storeu_si128((__m128i *)(out + 16 * (b + j)), _mm_xor_si128(p[j], c[j - 1]));
+        prev = c[CRYPTODB_AES_PIPELINE_BLOCKS - 1];
+    }
+
+    for (; b < blocks; ++b)
+    {
+        c[0] = _mm_loadu_si128((const __m128i *)(in + 16 * b));
+        p[0] = _mm_xor_si128(c[0], k[0]);
+        for (int i = 1; i < CRYPTODB_AES_256_ROUNDS; ++i)
+            p[0] = _mm_aesdec_si128(p[0], k[i]);
+        p[0] = _mm_aesdeclast_si128(p[0], k[CRYPTODB_AES_256_ROUNDS]);
+        _mm_storeu_si128((__m128i *)(out + 16 * b), _mm_xor_si128(p[0], prev));
+        prev = c[0];
+    }
+
+    _mm_storeu_si128((__m128i *)iv, prev);
+}
+
+void _cryptodb_aesni_ctr32(const uint8_t *rk, uint8_t ctr[16],
+                           const uint8_t *in, uint8_t *out,
+                           size_t blocks)
+{
+    size_t b = 0;
+    __m128i k[CRYPTODB_AES_256_ROUNDS + 1];
+    __m128i s[CRYPTODB_AES_PIPELINE_BLOCKS];
+    // Reverses the byte order of the last 32 bits, so the big-endian
+    // counter can be incremented with PADDD
+    const __m128i swap = _mm_set_epi8(12, 13, 14, 15, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i one = _mm_set_epi32(1, 0, 0, 0);
+    __m128i c = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)ctr), swap);
+
+    for (int i = 0; i <= CRYPTODB_AES_256_ROUNDS; ++i)
+        k[i] = _mm_loadu_si128((const __m128i *)(rk + 16 * i));
+
+    // Counter blocks are independent, so they go through AESENC pipeline at once
+    for (; b + CRYPTODB_AES_PIPELINE_BLOCKS <= blocks; b += CRYPTODB_AES_PIPELINE_BLOCKS)
+    {
+        for (int j = 0; j < CRYPTODB_AES_PIPELINE_BLOCKS; ++j)
+        {
+            s[j] = _mm_xor_si128(_mm_shuffle_epi8(c, swap), k[0]);
+            c = _mm_add_epi32(c, one);
+        }
+        for (int i = 1; i < CRYPTODB_AES_256_ROUNDS; ++i)
+            for (int j = 0; j < CRYPTODB_AES_PIPELINE_BLOCKS; ++j)
+                s[j] = _mm_aesenc_si128(s[j], k[i]);
+        for (int j = 0; j < CRYPTODB_AES_PIPELINE_BLOCKS; ++j)
+        {
+            s[j] = _mm_aesenclast_si128(s[j], k[CRYPTODB_AES_256_ROUNDS]);
+            s[j] = _mm_xor_si128(s[j], _mm_loadu_si128((const __m128i *)(in + 16 * (b + j))));
+            _mm_storeu_si128((__m128i *)(out + 16 * (b + j)), s[j]);
+        }
+    }
+
+    for (; b < blocks; ++b)
+    {
+        s[0] = _mm_xor_si128(_mm_shuffle_epi8(c, swap), k[0]);
+        c = _mm_add_epi32(c, one);
+        for (int i = 1; i < CRYPTODB_AES_256_ROUNDS; ++i)
+            s[0] = _mm_aesenc_si128(s[0], k[i]);
+        s[0] = _mm_aesenclast_si128(s[0], k[CRYPTODB_AES_256_ROUNDS]);
+        s[0] = _mm_xor_si128(s[0], _mm_loadu_si128((const __m128i *)(in + 16 * b)));
+        _mm_storeu_si128((__m128i *)(out + 16 * b), s[0]);
+    }
+
+    _mm_storeu_si128((__m128i *)ctr, _mm_shuffle_epi8(c, swap));
+}
+
+#define CRYPTODB_GHASH_AGGREGATE_BLOCKS (4)
+
+/**
+ * Carry-less multiplication of byte-reflected operands, the 256-bit product
+ * is XORed into "lo" and "hi". See "Intel Carry-Less Multiplication
+ * Instruction and its Usage for Computing the GCM Mode".
+ */
+static inline void _cryptodb_aesni_clmul(__m128i a, __m128i b, __m128i *lo, __m128i *hi)
+{
+    __m128i t3, t4, t5, t6;
+
+    t3 = _mm_clmulepi64_si128(a, b, 0x00);
+    t4 = _mm_clmulepi64_si128(a, b, 0x10);
+    t5 = _mm_clmulepi64_si128(a, b, 0x01);
+    t6 = _mm_clmulepi64_si128(a, b, 0x11);
+
+    t4 = _mm_xor_si128(t4, t5);
+    *lo = _mm_xor_si128(*lo, _mm_xor_si128(t3, _mm_slli_si128(t4, 8)));
+    *hi = _mm_xor_si128(*hi, _mm_xor_si128(t6, _mm_srli_si128(t4, 8)));
+}
+
+/**
+ * Reduction of the 256-bit product modulo x^128 + x^7 + x^2 + x + 1.
+ * It's linear, so several products can be summed up and reduced once.
+ */
+static inline __m128i _cryptodb_aesni_gfreduce(__m128i t3, __m128i t6)
+{
+    __m128i t2, t4, t5, t7, t8, t9;
+
+    // Shift the 256-bit product left by one bit
+    t7 = _mm_srli_epi32(t3, 31);
+    t8 = _mm_srli_epi32(t6, 31);
+    t3 = _mm_slli_epi32(t3, 1);
+    t6 = _mm_slli_epi32(t6, 1);
+    t9 = _mm_srli_si128(t7, 12);
+    t8 = _mm_slli_si128(t8, 4);
+    t7 = _mm_slli_si128(t7, 4);
+    t3 = _mm_or_si128(t3, t7);
+    t6 = _mm_or_si128(t6, t8);
+    t6 = _mm_or_si128(t6, t9);
+
+    t7 = _mm_slli_epi32(t3, 31);
+    t8 = _mm_slli_epi32(t3, 30);
+    t9 = _mm_slli_epi32(t3, 25);
+    t7 = _mm_xor_si128(t7, t8);
+    t7 = _mm_xor_si128(t7, t9);
+    t8 = _mm_srli_si128(t7, 4);
+    t7 = _mm_slli_si128(t7, 12);
+    t3 = _mm_xor_si128(t3, t7);
+
+    t2 = _mm_srli_epi32(t3, 1);
+    t4 = _mm_srli_epi32(t3, 2);
+    t5 = _mm_srli_epi32(t3, 7);
+    t2 = _mm_xor_si128(t2, t4);
+    t2 = _mm_xor_si128(t2, t5);
+    t2 = _mm_xor_si128(t2, t8);
+    t3 = _mm_xor_si128(t3, t2);
+
+    return _mm_xor_si128(t6, t3);
+}
+
+static inline __m128i _cryptodb_aesni_gfmul(__m128i a, __m128i b)
+{
+    __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+
+    _cryptodb_aesni_clmul(a, b, &lo, &hi);
+
+    return _cryptodb_aesni_gfreduce(lo, hi);
+}
+
+void _cryptodb_aesni_ghash(const uint8_t h[16], uint8_t x[16],
+                           const uint8_t *in, size_t blocks)
+{
+    size_t b = 0;
+    const __m128i rev = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m128i hr[CRYPTODB_GHASH_AGGREGATE_BLOCKS], lo, hi, d;
+    __m128i xr = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)x), rev);
+
+    // hr[i] = H^(i + 1)
+    hr[0] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)h), rev);
+
+    // x = (x ^ b0) * H^4 ^ b1 * H^3 ^ b2 * H^2 ^ b3 * H, so the products don't
+    // depend on each other and there is only one reduction per 4 blocks
+    if (blocks >= 2 * CRYPTODB_GHASH_AGGREGATE_BLOCKS)
+    {
+        for (int i = 1; i < CRYPTODB_GHASH_AGGREGATE_BLOCKS; ++i)
+            hr[i] = _cryptodb_aesni_gfmul(hr[i - 1], hr[0]);
+
+        for (; b + CRYPTODB_GHASH_AGGREGATE_BLOCKS <= blocks; b += CRYPTODB_GHASH_AGGREGATE_BLOCKS)
+        {
+            lo = _mm_setzero_si128();
+            hi = _mm_setzero_si128();
+            for (int j = 0; j < CRYPTODB_GHASH_AGGREGATE_BLOCKS; ++j)
+            {
+                d = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(in + 16 * (b + j))), rev);
+                if (j == 0)
+                    d = _mm_xor_si128(d, xr);
+                _cryptodb_aesni_clmul(d, hr[CRYPTODB_GHASH_AGGREGATE_BLOCKS - 1 - j], &lo, &hi);
+            }
+            xr = _cryptodb_aesni_gfreduce(lo, hi);
+        }
+    }
+
+    for (; b < blocks; ++b)
+    {
+        xr = _mm_xor_si128(xr, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(in + 16 * b)), rev));
+        xr = _cryptodb_aesni_gfmul(xr, hr[0]);
+    }
+
+    _mm_storeu_si128((__m128i *)x, _mm_shuffle_epi8(xr, rev));
+}
+
+#endif // CRYPTODB_HAVE_AESNI
+
+#if defined(CRYPTODB_HAVE_ARMV8_CE)
+
+#include <arm_neon.h>
+
+#define CRYPTODB_AES_PIPELINE_BLOCKS (4)
+
+void _cryptodb_armv8_decrypt_keys(const uint8_t *rk, uint8_t *drk)
+{
+    vst1q_u8(drk, vld1q_u8(rk + 16 * CRYPTODB_AES_256_ROUNDS));
+    for (int i = 1; i < CRYPTODB_AES_256_ROUNDS; ++i)
+        vst1q_u8(drk + 16 * i,
+                 vaesimcq_u8(vld1q_u8(rk + 16 * (CRYPTODB_AES_256_ROUNDS - i))));
+    vst1q_u8(drk + 16 * CRYPTODB_AES_256_ROUNDS, vld1q_u8(rk));
+}
+
+void _cryptodb_armv8_cbc_encrypt(const uint8_t *rk, uint8_t iv[16],
+                                 const uint8_t *in, uint8_t *out,
+                                 size_t blocks)
+{
+    uint8x16_t k[CRYPTODB_AES_256_ROUNDS + 1];
+    uint8x16_t c = vld1q_u8(iv);
+
+    for (int i = 0; i <= CRYPTODB_AES_256_ROUNDS; ++i)
+        k[i] = vld1q_u8(rk + 16 * i);
+
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        c = veorq_u8(c, vld1q_u8(in + 16 * b));
+        // AESE does AddRoundKey + SubBytes + ShiftRows, AESMC does MixColumns
+        for (int i = 0; i < CRYPTODB_AES_256_ROUNDS - 1; ++i)
+            c = vaesmcq_u8(vaeseq_u8(c, k[i]));
+        c = vaeseq_u8(c, k[CRYPTODB_AES_256_ROUNDS - 1]);
+        c = veorq_u8(c, k[CRYPTODB_AES_256_ROUNDS]);
+        vst1q_u8(out + 16 * b, c);
+    }
+
+    vst1q_u8(iv, c);
+}
+
+void _cryptodb_armv8_cbc_decrypt(const uint8_t *drk, uint8_t iv[16],
+                                 const uint8_t *in, uint8_t *out,
+                                 size_t blocks)
+{
+    size_t b = 0;
+    uint8x16_t k[CRYPTODB_AES_256_ROUNDS + 1];
+    uint8x16_t prev = vld1q_u8(iv);
+    uint8x16_t c[CRYPTODB_AES_PIPELINE_BLOCKS], p[CRYPTODB_AES_PIPELINE_BLOCKS];
+
+    for (int i = 0; i <= CRYPTODB_AES_256_ROUNDS; ++i)
+        k[i] = vld1q_u8(drk + 16 * i);
+
+    // See _cryptodb_aesni_cbc_decrypt()
+    for (; b + CRYPTODB_AES_PIPELINE_BLOCKS <= blocks; b += CRYPTODB_AES_PIPELINE_BLOCKS)
+    {
+        for (int j = 0; j < CRYPTODB_AES_PIPELINE_BLOCKS; ++j)
+            p[j] = c[j] = vld1q_u8(in + 16 * (b + j));
+        for (int i = 0; i < CRYPTODB_AES_256_ROUNDS - 1; ++i)
+            for (int j = 0; j < CRYPTODB_AES_PIPELINE_BLOCKS; ++j)
+                p[j] = vaesimcq_u8(vaesdq_u8(p[j], k[i]));
+        for (int j = 0; j < CRYPTODB_AES_PIPELINE_BLOCKS; ++j)
+            p[j] = veorq_u8(vaesdq_u8(p[j], k[CRYPTODB_AES_256_ROUNDS - 1]),
+                            k[CRYPTODB_AES_256_ROUNDS]);
+
+        vst1q_u8(out + 16 * b, veorq_u8(p[0], prev));
+        for (int j = 1; j < CRYPTODB_AES_PIPELINE_BLOCKS; ++j)
+            vst1q_u8(out + 16 * (b + j), veorq_u8(p[j], c[j - 1]));
+        prev = c[CRYPTODB_AES_PIPELINE_BLOCKS - 1];
+    }
+
+    for (; b < blocks; ++b)
+    {
+        p[0] = c[0] = vld1q_u8(in + 16 * b);
+        for (int i = 0; i < CRYPTODB_AES_256_ROUNDS - 1; ++i)
+            p[0] = vaesimcq_u8(vaesdq_u8(p[0], k[i]));
+        p[0] = vaesdq_u8(p[0], k[CRYPTODB_AES_256_ROUNDS - 1]);
+        p[0] = veorq_u8(p[0], k[CRYPTODB_AES_256_ROUNDS]);
+        vst1q_u8(out + 16 * b, veorq_u8(p[0], prev));
+        prev = c[0];
+    }
+
+    vst1q_u8(iv, prev);
+}
+
+void _cryptodb_armv8_ctr32(const uint8_t *rk, uint8_t ctr[16],
+                           const uint8_t *in, uint8_t *out,
+                           size_t blocks)
+{
+    size_t b = 0;
+    uint8x16_t k[CRYPTODB_AES_256_ROUNDS + 1];
+    uint8x16_t s[CRYPTODB_AES_PIPELINE_BLOCKS];
+    uint32x4_t base = vreinterpretq_u32_u8(vld1q_u8(ctr));
+    uint32_t n = ((uint32_t)ctr[12] << 24) | ((uint32_t)ctr[13] << 16) |
+                 ((uint32_t)ctr[14] << 8) | (uint32_t)ctr[15];
+
+    for (int i = 0; i <= CRYPTODB_AES_256_ROUNDS; ++i)
+        k[i] = vld1q_u8(rk + 16 * i);
+
+    // See _cryptodb_aesni_ctr32()
+    for (; b + CRYPTODB_AES_PIPELINE_BLOCKS <= blocks; b += CRYPTODB_AES_PIPELINE_BLOCKS)
+    {
+        for (int j = 0; j < CRYPTODB_AES_PIPELINE_BLOCKS; ++j)
+            s[j] = vreinterpretq_u8_u32(vsetq_lane_u32(__builtin_bswap32(n++), base, 3));
+        for (int i = 0; i < CRYPTODB_AES_256_ROUNDS - 1; ++i)
+            for (int j = 0; j < CRYPTODB_AES_PIPELINE_BLOCKS; ++j)
+                s[j] = vaesmcq_u8(vaeseq_u8(s[j], k[i]));
+        for (int j = 0; j < CRYPTODB_AES_PIPELINE_BLOCKS; ++j)
+        {
+            s[j] = veorq_u8(vaeseq_u8(s[j], k[CRYPTODB_AES_256_ROUNDS - 1]),
+                            k[CRYPTODB_AES_256_ROUNDS]);
+            vst1q_u8(out + 16 * (b + j), veorq_u8(s[j], vld1q_u8(in + 16 * (b + j))));
+        }
+    }
+
+    for (; b < blocks; ++b)
+    {
+        s[0] = vreinterpretq_u8_u32(vsetq_lane_u32(__builtin_bswap32(n++), base, 3));
+        for (int i = 0; i < CRYPTODB_AES_256_ROUNDS - 1; ++i)
+            s[0] = vaesmcq_u8(vaeseq_u8(s[0], k[i]));
+        s[0] = veorq_u8(vaeseq_u8(s[0], k[CRYPTODB_AES_256_ROUNDS - 1]),
+                        k[CRYPTODB_AES_256_ROUNDS]);
+        vst1q_u8(out + 16 * b, veorq_u8(s[0], vld1q_u8(in + 16 * b)));
+    }
+
+    ctr[12] = (uint8_t)(n >> 24);
+    ctr[13] = (uint8_t)(n >> 16);
+    ctr[14] = (uint8_t)(n >> 8);
+    ctr[15] = (uint8_t)n;
+}
+
+#endif // CRYPTODB_HAVE_ARMV8_CE
@@ -0,0 +1,230 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <cryptodb_filter.h>
+
+/**
+ * PRIVATE API
+ */
+
+struct _cryptodb_filter {
+    leveldb_filterpolicy_t *policy;
+    size_t bits_per_key;
+    size_t probes; // k, number of hash functions
+    uint64_t checks;
+    uint64_t avoided_reads;
+};
+
+/**
+ * Hash of LevelDB (util/hash.cc) with the seed of its bloom filter
+ */
+static uint32_t _cryptodb_filter_hash(const char *key, size_t len)
+{
+    const uint32_t m = 0xc6a4a793;
+    const uint8_t *data = (const uint8_t *)key;
+    const uint8_t *limit = data + len;
+    uint32_t h = 0xbc9f1d34 ^ (uint32_t)(len * m);
+
+    for (; data + 4 <= limit; data += 4)
+    {
+        h += (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+             ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+        h *= m;
+        h ^= (h >> 16);
+    }
+
+    switch (limit - data)
+    {
+    case 3:
+        h += (uint32_t)data[2] << 16;
+        // fall through
+    case 2:
+        h += (uint32_t)data[1] << 8;
+        // fall through
+    case 1:
+        h += data[0];
+        h *= m;
+        h ^= (h >> 24);
+        break;
+    default:
+        break;
+    }
+
+    return h;
+}
+
+static void _cryptodb_filter_state_destroy(void *state)
+{
+    (void)state;
+}
+
+static const char * _cryptodb_filter_name(void *state)
+{
+    (void)state;
+
+    return "leveldb.BuiltinBloomFilter2";
+}
+
+/**
+ * Bit array of "n * bits_per_key" bits (at least 64) followed by the number
+ * of probes. Every key sets "probes" bits, the bit positions are generated
+ * from one hash by double hashing.
+ */
+static char * _cryptodb_filter_create_filter(void *state,
+                                             const char *const *keys,
+                                             const size_t *keys_len,
+                                             int n,
+                                             size_t *filter_len)
+{
+    _cryptodb_filter_t *filter = (_cryptodb_filter_t *)state;
+    size_t bits = (size_t)(n > 0 ? n : 0) * filter->bits_per_key;
+    size_t bytes = 0;
+    uint32_t h = 0, delta = 0, bitpos = 0;
+    char *array = NULL;
+
+    if (bits < 64)
+        bits = 64;
+    bytes = (bits + 7) / 8;
+    bits = bytes * 8;
+
+    // LevelDB frees the filter with free()
+    array = (char *)calloc(bytes + 1, sizeof(char));
+    if (array == NULL)
+    {
+        *filter_len = 0;
+        return NULL;
+    }
+    array[bytes] = (char)filter->probes;
+
+    for (int i = 0; i < n; ++i)
+    {
+        h = _cryptodb_filter_hash(keys[i], keys_len[i]);
+        delta = (h >> 17) | (h << 15);
+        for (size_t j = 0; j < filter->probes; ++j)
+        {
+            bitpos = h % bits;
+            array[bitpos / 8] |= (char)(1 << (bitpos % 8));
+            h += delta;
+        }
+    }
+
+    *filter_len = bytes + 1;
+
+    return array;
+}
+
+static uint8_t _cryptodb_filter_key_may_match(void *state,
+                                              const char *key,
+                                              size_t len,
+                                              const char *array,
+                                              size_t array_len)
+{
+    _cryptodb_filter_t *filter = (_cryptodb_filter_t *)state;
+    size_t bits = 0, probes = 0;
+    uint32_t h = 0, delta = 0, bitpos = 0;
+
+    // An empty table has no keys
+    if (array_len < 2)
+        return 0;
+
+    bits = (array_len - 1) * 8;
+    probes = (uint8_t)array[array_len - 1];
+    // Reserved for new encodings of short bloom filters
+    if (probes > 30)
+        return 1;
+
+    __atomic_fetch_add(&filter->checks, 1, __ATOMIC_RELAXED);
+
+    h = _cryptodb_filter_hash(key, len);
+    delta = (h >> 17) | (h << 15);
+    for (size_t j = 0; j < probes; ++j)
+    {
+        bitpos = h % bits;
+        if (!(array[bitpos / 8] & (1 << (bitpos % 8))))
+        {
+            __atomic_fetch_add(&filter->avoided_reads, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+        h += delta;
+    }
+
+    return 1;
+}
+
+_cryptodb_filter_t * _cryptodb_filter_create(int bits_per_key)
+{
+    _cryptodb_filter_t *filter = NULL;
+
+    if (bits_per_key <= 0)
+        return NULL;
+
+    filter = (_cryptodb_filter_t *)calloc(1, sizeof(_cryptodb_filter_t));
+    if (filter == NULL)
+        return NULL;
+
+    // Rounding down to reduce probing cost a little bit, ln(2) is optimal
+    filter->bits_per_key = (size_t)bits_per_key;
+    filter->probes = (size_t)(bits_per_key * 0.69);
+    if (filter->probes < 1)
+        filter->probes = 1;
+    if (filter->probes > 30)
+        filter->probes = 30;
+
+    filter->policy = leveldb_filterpolicy_create(filter,
+                                                 _cryptodb_filter_state_destroy,
+                                                 _cryptodb_filter_create_filter,
+                                                 _cryptodb_filter_key_may_match,
+                                                 _cryptodb_filter_name);
+    if (filter->policy == NULL)
+    {
+        free(filter);
+        return NULL;
+    }
+
+    return filter;
+}
+
+void _cryptodb_filter_destroy(_cryptodb_filter_t *filter)
+{
+    if (filter == NULL)
+        return;
+
+    leveldb_filterpolicy_destroy(filter->policy);
+    free(filter);
+}
+
+leveldb_filterpolicy_t * _cryptodb_filter_policy(_cryptodb_filter_t *filter)
+{
+    return filter ? filter->policy : NULL;
+}
+
+void _cryptodb_filter_stats(const _cryptodb_filter_t *filter,
+                            uint64_t *checks,
+                            uint64_t *avoided_reads)
+{
+    *checks = filter ? __atomic_load_n(&filter->checks, __ATOMIC_RELAXED) : 0;
+    *avoided_reads = filter ? __atomic_load_n(&filter->avoided_reads, __ATOMIC_RELAXED) : 0;
+}
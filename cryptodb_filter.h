@@ -0,0 +1,67 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+/**
+ * Private bloom filter policy of cryptodb. Not a part of the public API.
+ *
+ * The filter is bit-identical to the built-in LevelDB bloom filter (see
+ * leveldb_filterpolicy_create_bloom()) and has the same name, so tables
+ * written with either of them are read with the other. It's implemented
+ * here only to count the lookups that the filter answers: the C API of
+ * LevelDB doesn't show how many disk reads the built-in filter avoided.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <leveldb/c.h>
+
+typedef struct _cryptodb_filter _cryptodb_filter_t;
+
+/**
+ * @brief      Create bloom filter policy with "bits_per_key" bits per key
+ *
+ * @return     Filter or NULL on error
+ */
+_cryptodb_filter_t * _cryptodb_filter_create(int bits_per_key);
+
+/**
+ * @brief      Free the filter. The database that uses it should be
+ *             closed before.
+ */
+void _cryptodb_filter_destroy(_cryptodb_filter_t *filter);
+
+/**
+ * @brief      LevelDB filter policy for leveldb_options_set_filter_policy()
+ */
+leveldb_filterpolicy_t * _cryptodb_filter_policy(_cryptodb_filter_t *filter);
+
+/**
+ * @brief      Number of lookups in disk tables that checked the filter and
+ *             the number of them that the filter answered that the key
+ *             isn't in the table, i.e. its data block wasn't read. Both
+ *             are 0 for NULL filter.
+ */
+void _cryptodb_filter_stats(const _cryptodb_filter_t *filter,
+                            uint64_t *checks,
+                            uint64_t *avoided_reads);
@@ -0,0 +1,227 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <cryptodb_lz4.h>
+
+/**
+ * PRIVATE API
+ */
+
+#define CRYPTODB_LZ4_HASH_LOG    (12) // 16 KiB table on the stack, as LZ4 default
+#define CRYPTODB_LZ4_MIN_MATCH   (4)
+#define CRYPTODB_LZ4_MAX_OFFSET  (65535)
+#define CRYPTODB_LZ4_LAST_LITERALS (5) // the block always ends with literals
+#define CRYPTODB_LZ4_MF_LIMIT    (12) // the last match starts before it
+#define CRYPTODB_LZ4_SKIP_TRIGGER (6) // search step grows after 2^6 misses
+
+static inline uint32_t _cryptodb_lz4_read32(const uint8_t *p)
+{
+    uint32_t v = 0;
+
+    memcpy(&v, p, sizeof(v));
+
+    return v;
+}
+
+static inline uint32_t _cryptodb_lz4_hash(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - CRYPTODB_LZ4_HASH_LOG);
+}
+
+/**
+ * Writes a length of 15 and more as the extension bytes after the token
+ */
+static uint8_t * _cryptodb_lz4_write_len(uint8_t *op, size_t len)
+{
+    for (; len >= 255; len -= 255)
+        *op++ = 255;
+    *op++ = (uint8_t)len;
+
+    return op;
+}
+
+/**
+ * Writes the sequence of literals [anchor, anchor + lit_len) and the match
+ * of "match_len" bytes at "offset". match_len is 0 for the last sequence
+ * that has only literals. Returns NULL if it doesn't fit before "oend".
+ */
+static uint8_t * _cryptodb_lz4_write_sequence(uint8_t *op, const uint8_t *oend,
+                                              const uint8_t *anchor, size_t lit_len,
+                                              size_t offset, size_t match_len)
+{
+    uint8_t *token = op;
+    size_t ml = match_len ? match_len - CRYPTODB_LZ4_MIN_MATCH : 0;
+
+    // token + literals + offset + length extensions
+    if ((size_t)(oend - op) < 1 + lit_len + 2 + lit_len / 255 + 1 + ml / 255 + 1)
+        return NULL;
+
+    ++op;
+    *token = (uint8_t)((lit_len < 15 ? lit_len : 15) << 4);
+    if (lit_len >= 15)
+        op = _cryptodb_lz4_write_len(op, lit_len - 15);
+    memcpy(op, anchor, lit_len);
+    op += lit_len;
+
+    if (!match_len)
+        return op;
+
+    *op++ = (uint8_t)offset;
+    *op++ = (uint8_t)(offset >> 8);
+    *token |= (uint8_t)(ml < 15 ? ml : 15);
+    if (ml >= 15)
+        op = _cryptodb_lz4_write_len(op, ml - 15);
+
+    return op;
+}
+
+/**
+ * Reads the extension bytes of a length, returns false if "src" ends
+ */
+static bool _cryptodb_lz4_read_len(const uint8_t **ip, const uint8_t *iend, size_t *len)
+{
+    uint8_t b = 0;
+
+    do
+    {
+        if (*ip >= iend)
+            return false;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+
+    return true;
+}
+
+size_t _cryptodb_lz4_compress(const uint8_t *src, size_t src_len,
+                              uint8_t *dst, size_t dst_len)
+{
+    uint32_t table[1 << CRYPTODB_LZ4_HASH_LOG];
+    const uint8_t *ip = src, *anchor = src, *ref = NULL;
+    const uint8_t *iend = src + src_len, *mflimit = NULL, *matchlimit = NULL;
+    uint8_t *op = dst;
+    const uint8_t *oend = dst + dst_len;
+    uint32_t h = 0, misses = 0;
+    size_t match_len = 0;
+
+    if (src_len > CRYPTODB_LZ4_MF_LIMIT)
+    {
+        mflimit = iend - CRYPTODB_LZ4_MF_LIMIT;
+        matchlimit = iend - CRYPTODB_LZ4_LAST_LITERALS;
+        memset(table, 0, sizeof(table));
+
+        while (ip < mflimit)
+        {
+            h = _cryptodb_lz4_hash(_cryptodb_lz4_read32(ip));
+            ref = src + table[h];
+            table[h] = (uint32_t)(ip - src);
+
+            if (ref >= ip || ip - ref > CRYPTODB_LZ4_MAX_OFFSET ||
+                _cryptodb_lz4_read32(ref) != _cryptodb_lz4_read32(ip))
+            {
+                // Incompressible data is skipped faster and faster
+                ip += 1 + (misses++ >> CRYPTODB_LZ4_SKIP_TRIGGER);
+                continue;
+            }
+            misses = 0;
+
+            // Extend the match backwards over the literals and forwards
+            while (ip > anchor && ref > src && ip[-1] == ref[-1])
+            {
+                --ip;
+                --ref;
+            }
+            match_len = CRYPTODB_LZ4_MIN_MATCH;
+            while (ip + match_len < matchlimit && ip[match_len] == ref[match_len])
+                ++match_len;
+
+            op = _cryptodb_lz4_write_sequence(op, oend, anchor, (size_t)(ip - anchor),
+                                              (size_t)(ip - ref), match_len);
+            if (op == NULL)
+                return 0;
+
+            ip += match_len;
+            anchor = ip;
+        }
+    }
+
+    op = _cryptodb_lz4_write_sequence(op, oend, anchor, (size_t)(iend - anchor), 0, 0);
+    if (op == NULL)
+        return 0;
+
+    return (size_t)(op - dst);
+}
+
+bool _cryptodb_lz4_decompress(const uint8_t *src, size_t src_len,
+                              uint8_t *dst, size_t dst_len)
+{
+    const uint8_t *ip = src, *iend = src + src_len, *match = NULL;
+    uint8_t *op = dst;
+    size_t lit_len = 0, match_len = 0, offset = 0, left = dst_len;
+    uint8_t token = 0;
+
+    while (ip < iend)
+    {
+        token = *ip++;
+
+        lit_len = token >> 4;
+        if (lit_len == 15 && !_cryptodb_lz4_read_len(&ip, iend, &lit_len))
+            return false;
+        if (lit_len > (size_t)(iend - ip) || lit_len > left)
+            return false;
+        memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+        left -= lit_len;
+
+        // The last sequence has only literals
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return false;
+        offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (!offset || offset > (size_t)(op - dst))
+            return false;
+
+        match_len = token & 15;
+        if (match_len == 15 && !_cryptodb_lz4_read_len(&ip, iend, &match_len))
+            return false;
+        match_len += CRYPTODB_LZ4_MIN_MATCH;
+        if (match_len > left)
+            return false;
+
+        // The match can overlap the output, e.g. a run of one byte
+        match = op - offset;
+        for (size_t i = 0; i < match_len; ++i)
+            op[i] = match[i];
+        op += match_len;
+        left -= match_len;
+    }
+
+    return !left;
+}
@@ -0,0 +1,55 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+/**
+ * Private LZ4 codec of cryptodb. Not a part of the public API.
+ *
+ * Built-in compressor and decompressor of the LZ4 block format (see
+ * CRYPTODB_COMPRESSION_LZ4), so the values are compressed without an
+ * external library. The compressor is greedy with one hash table of
+ * 4 bytes sequences, like the LZ4 fast mode. The decompressor checks
+ * every length and offset, so a corrupted block can't write out of
+ * the output buffer.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief      Compress "src" into "dst" of "dst_len" bytes
+ *
+ * @return     Compressed length, 0 if it doesn't fit into "dst"
+ */
+size_t _cryptodb_lz4_compress(const uint8_t *src, size_t src_len,
+                              uint8_t *dst, size_t dst_len);
+
+/**
+ * @brief      Decompress "src" into "dst" of exactly "dst_len" bytes
+ *
+ * @return     false if "src" is corrupted or isn't decompressed into
+ *             "dst_len" bytes
+ */
+bool _cryptodb_lz4_decompress(const uint8_t *src, size_t src_len,
+                              uint8_t *dst, size_t dst_len);
@@ -0,0 +1,234 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include <cryptodb_pool.h>
+
+/**
+ * PRIVATE API
+ */
+
+typedef struct _cryptodb_pool_job {
+    _cryptodb_pool_fn fn;
+    uint8_t *args;
+    size_t arg_size;
+    size_t count;
+    size_t next; // next task to take
+    size_t done;
+    pthread_cond_t done_cond;
+    struct _cryptodb_pool_job *prev_job;
+    struct _cryptodb_pool_job *next_job;
+} _cryptodb_pool_job_t;
+
+struct _cryptodb_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool stop;
+    _cryptodb_pool_job_t *jobs; // jobs with tasks that nobody took yet
+    size_t threads;
+    pthread_t *tids;
+};
+
+static void _cryptodb_pool_job_unlink(_cryptodb_pool_t *pool,
+                                      _cryptodb_pool_job_t *job)
+{
+    if (job->prev_job)
+        job->prev_job->next_job = job->next_job;
+    else
+        pool->jobs = job->next_job;
+    if (job->next_job)
+        job->next_job->prev_job = job->prev_job;
+    job->prev_job = job->next_job = NULL;
+}
+
+/**
+ * Takes the next task of the job, should be called under the pool lock.
+ * Returns task argument or NULL if there are no tasks left.
+ */
+static void * _cryptodb_pool_job_take(_cryptodb_pool_t *pool,
+                                      _cryptodb_pool_job_t *job)
+{
+    void *arg = NULL;
+
+    if (job->next >= job->count)
+        return NULL;
+
+    arg = job->args + job->arg_size * job->next;
+    if (++job->next == job->count && pool)
+        _cryptodb_pool_job_unlink(pool, job);
+
+    return arg;
+}
+
+static void _cryptodb_pool_job_finish(_cryptodb_pool_job_t *job)
+{
+    if (++job->done == job->count)
+        pthread_cond_signal(&job->done_cond);
+}
+
+static void * _cryptodb_pool_worker(void *ptr)
+{
+    void *arg = NULL;
+    _cryptodb_pool_job_t *job = NULL;
+    _cryptodb_pool_t *pool = (_cryptodb_pool_t *)ptr;
+
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stop)
+    {
+        if (pool->jobs == NULL)
+        {
+            pthread_cond_wait(&pool->cond, &pool->lock);
+            continue;
+        }
+
+        job = pool->jobs;
+        arg = _cryptodb_pool_job_take(pool, job);
+        pthread_mutex_unlock(&pool->lock);
+
+        job->fn(arg);
+
+        pthread_mutex_lock(&pool->lock);
+        _cryptodb_pool_job_finish(job);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+_cryptodb_pool_t * _cryptodb_pool_create(size_t threads)
+{
+    _cryptodb_pool_t *pool = NULL;
+
+    if (!threads)
+        return NULL;
+
+    pool = (_cryptodb_pool_t *)calloc(1, sizeof(_cryptodb_pool_t));
+    if (pool == NULL)
+        return NULL;
+
+    pool->tids = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    if (pool->tids == NULL)
+    {
+        free(pool);
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&pool->lock, NULL))
+    {
+        free(pool->tids);
+        free(pool);
+        return NULL;
+    }
+    if (pthread_cond_init(&pool->cond, NULL))
+    {
+        pthread_mutex_destroy(&pool->lock);
+        free(pool->tids);
+        free(pool);
+        return NULL;
+    }
+
+    for (pool->threads = 0; pool->threads < threads; ++pool->threads)
+    {
+        if (pthread_create(&pool->tids[pool->threads], NULL,
+                           _cryptodb_pool_worker, pool))
+        {
+            _cryptodb_pool_destroy(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+void _cryptodb_pool_destroy(_cryptodb_pool_t *pool)
+{
+    if (pool == NULL)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->threads; ++i)
+        pthread_join(pool->tids[i], NULL);
+
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->tids);
+    free(pool);
+}
+
+size_t _cryptodb_pool_threads(const _cryptodb_pool_t *pool)
+{
+    return pool ? pool->threads : 0;
+}
+
+void _cryptodb_pool_run(_cryptodb_pool_t *pool,
+                        _cryptodb_pool_fn fn,
+                        void *args,
+                        size_t arg_size,
+                        size_t count)
+{
+    void *arg = NULL;
+    _cryptodb_pool_job_t job;
+
+    if (pool == NULL || count < 2)
+    {
+        for (size_t i = 0; i < count; ++i)
+            fn((uint8_t *)args + arg_size * i);
+        return;
+    }
+
+    memset(&job, 0, sizeof(_cryptodb_pool_job_t));
+    job.fn = fn;
+    job.args = (uint8_t *)args;
+    job.arg_size = arg_size;
+    job.count = count;
+    pthread_cond_init(&job.done_cond, NULL);
+
+    pthread_mutex_lock(&pool->lock);
+    job.next_job = pool->jobs;
+    if (pool->jobs)
+        pool->jobs->prev_job = &job;
+    pool->jobs = &job;
+    pthread_cond_broadcast(&pool->cond);
+
+    while ((arg = _cryptodb_pool_job_take(pool, &job)) != NULL)
+    {
+        pthread_mutex_unlock(&pool->lock);
+        fn(arg);
+        pthread_mutex_lock(&pool->lock);
+        _cryptodb_pool_job_finish(&job);
+    }
+
+    while (job.done < job.count)
+        pthread_cond_wait(&job.done_cond, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+
+    pthread_cond_destroy(&job.done_cond);
+}
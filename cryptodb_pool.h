@@ -0,0 +1,66 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+/**
+ * Private worker pool of cryptodb. Not a part of the public API.
+ *
+ * The pool runs "parallel for" jobs: fn(arg) for every element of an array
+ * of task arguments. The calling thread takes tasks of its own job as well,
+ * so a job is always finished even if all workers are busy with other jobs.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+typedef struct _cryptodb_pool _cryptodb_pool_t;
+
+typedef void (*_cryptodb_pool_fn)(void *arg);
+
+/**
+ * @brief      Create pool with "threads" worker threads
+ *
+ * @return     Pool or NULL if "threads" is 0 or on error
+ */
+_cryptodb_pool_t * _cryptodb_pool_create(size_t threads);
+
+/**
+ * @brief      Stop worker threads and free the pool. There should be no
+ *             running jobs.
+ */
+void _cryptodb_pool_destroy(_cryptodb_pool_t *pool);
+
+/**
+ * @brief      Number of worker threads, 0 for NULL pool
+ */
+size_t _cryptodb_pool_threads(const _cryptodb_pool_t *pool);
+
+/**
+ * @brief      Run fn() for "count" task arguments of "arg_size" bytes
+ *             located one after another in "args" and wait for all of
+ *             them. With NULL pool everything is done by the calling thread.
+ */
+void _cryptodb_pool_run(_cryptodb_pool_t *pool,
+                        _cryptodb_pool_fn fn,
+                        void *args,
+                        size_t arg_size,
+                        size_t count);
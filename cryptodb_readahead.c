@@ -0,0 +1,265 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include <cryptodb_readahead.h>
+
+/**
+ * PRIVATE API
+ */
+
+struct _cryptodb_readahead {
+    _cryptodb_readahead_fill_t fill;
+    _cryptodb_readahead_clear_t clear;
+    void *arg;
+    size_t depth; // 0 if the entries are filled by the consumer
+    size_t slot_size;
+
+    pthread_mutex_t lock;
+    pthread_cond_t filled_cond; // a slot was filled or the source has ended
+    pthread_cond_t free_cond; // a slot was cleared or the thread is stopped
+    uint8_t *slots; // "count" slots of "slot_size" bytes
+    size_t count; // depth + 1, the consumer holds one slot
+    size_t head; // the first filled slot
+    size_t filled; // filled slots from "head"
+    bool held; // the slot before "head" is held by the consumer
+    bool end; // the source has no more entries
+    // The thread and the consumer wake each other up only when half of
+    // the slots are filled (or free), not for every entry
+    size_t wakeup;
+    bool thread_waiting;
+    bool consumer_waiting;
+
+    bool stop;
+    bool thread_started;
+    pthread_t thread;
+};
+
+static inline void * _cryptodb_readahead_slot(_cryptodb_readahead_t *readahead,
+                                              size_t index)
+{
+    return readahead->slots + (index % readahead->count) * readahead->slot_size;
+}
+
+static void * _cryptodb_readahead_thread(void *arg)
+{
+    bool filled = false;
+    void *slot = NULL;
+    _cryptodb_readahead_t *readahead = (_cryptodb_readahead_t *)arg;
+
+    pthread_mutex_lock(&readahead->lock);
+    for (;;)
+    {
+        while (!readahead->stop &&
+               readahead->filled + readahead->held >= readahead->count)
+        {
+            readahead->thread_waiting = true;
+            pthread_cond_wait(&readahead->free_cond, &readahead->lock);
+            readahead->thread_waiting = false;
+        }
+        if (readahead->stop)
+            break;
+
+        slot = _cryptodb_readahead_slot(readahead, readahead->head + readahead->filled);
+        pthread_mutex_unlock(&readahead->lock);
+
+        // The consumer doesn't touch the slots that aren't filled yet
+        filled = readahead->fill(readahead->arg, slot);
+
+        pthread_mutex_lock(&readahead->lock);
+        if (!filled)
+        {
+            readahead->end = true;
+            pthread_cond_signal(&readahead->filled_cond);
+            break;
+        }
+        ++readahead->filled;
+        if (readahead->consumer_waiting && readahead->filled >= readahead->wakeup)
+            pthread_cond_signal(&readahead->filled_cond);
+    }
+    pthread_mutex_unlock(&readahead->lock);
+
+    return NULL;
+}
+
+_cryptodb_readahead_t * _cryptodb_readahead_create(size_t depth,
+                                                   size_t slot_size,
+                                                   _cryptodb_readahead_fill_t fill,
+                                                   _cryptodb_readahead_clear_t clear,
+                                                   void *arg)
+{
+    _cryptodb_readahead_t *readahead = NULL;
+
+    if (!slot_size || fill == NULL || clear == NULL || depth >= SIZE_MAX / slot_size)
+        return NULL;
+
+    readahead = (_cryptodb_readahead_t *)calloc(1, sizeof(_cryptodb_readahead_t));
+    if (readahead == NULL)
+        return NULL;
+
+    readahead->fill = fill;
+    readahead->clear = clear;
+    readahead->arg = arg;
+    readahead->depth = depth;
+    readahead->slot_size = slot_size;
+    readahead->count = depth + 1;
+    readahead->wakeup = (depth + 1) / 2;
+
+    readahead->slots = (uint8_t *)calloc(readahead->count, slot_size);
+    if (readahead->slots == NULL)
+    {
+        free(readahead);
+        return NULL;
+    }
+    if (pthread_mutex_init(&readahead->lock, NULL))
+    {
+        free(readahead->slots);
+        free(readahead);
+        return NULL;
+    }
+    if (pthread_cond_init(&readahead->filled_cond, NULL))
+    {
+        pthread_mutex_destroy(&readahead->lock);
+        free(readahead->slots);
+        free(readahead);
+        return NULL;
+    }
+    if (pthread_cond_init(&readahead->free_cond, NULL))
+    {
+        pthread_cond_destroy(&readahead->filled_cond);
+        pthread_mutex_destroy(&readahead->lock);
+        free(readahead->slots);
+        free(readahead);
+        return NULL;
+    }
+
+    return readahead;
+}
+
+void _cryptodb_readahead_destroy(_cryptodb_readahead_t *readahead)
+{
+    if (readahead == NULL)
+        return;
+
+    _cryptodb_readahead_reset(readahead);
+
+    pthread_cond_destroy(&readahead->free_cond);
+    pthread_cond_destroy(&readahead->filled_cond);
+    pthread_mutex_destroy(&readahead->lock);
+    free(readahead->slots);
+    free(readahead);
+}
+
+void _cryptodb_readahead_reset(_cryptodb_readahead_t *readahead)
+{
+    if (readahead == NULL)
+        return;
+
+    if (readahead->thread_started)
+    {
+        pthread_mutex_lock(&readahead->lock);
+        readahead->stop = true;
+        pthread_cond_signal(&readahead->free_cond);
+        pthread_mutex_unlock(&readahead->lock);
+        pthread_join(readahead->thread, NULL);
+        readahead->thread_started = false;
+        readahead->stop = false;
+    }
+
+    // The thread is stopped, nobody else touches the slots
+    if (readahead->held)
+        readahead->clear(readahead->arg,
+                         _cryptodb_readahead_slot(readahead,
+                                                  readahead->head + readahead->count - 1));
+    for (size_t i = 0; i < readahead->filled; ++i)
+        readahead->clear(readahead->arg,
+                         _cryptodb_readahead_slot(readahead, readahead->head + i));
+
+    readahead->head = 0;
+    readahead->filled = 0;
+    readahead->held = false;
+    readahead->end = false;
+}
+
+void * _cryptodb_readahead_next(_cryptodb_readahead_t *readahead)
+{
+    void *slot = NULL;
+
+    if (readahead == NULL)
+        return NULL;
+
+    // The thread doesn't fill the held slot, so it's cleared without the lock
+    if (readahead->held)
+        readahead->clear(readahead->arg,
+                         _cryptodb_readahead_slot(readahead,
+                                                  readahead->head + readahead->count - 1));
+
+    if (readahead->depth && !readahead->thread_started && !readahead->end)
+    {
+        if (pthread_create(&readahead->thread, NULL, _cryptodb_readahead_thread, readahead))
+            readahead->depth = 0; // fill the entries here then
+        else
+            readahead->thread_started = true;
+    }
+
+    if (!readahead->thread_started)
+    {
+        readahead->held = false;
+        if (readahead->end)
+            return NULL;
+
+        slot = _cryptodb_readahead_slot(readahead, readahead->head);
+        if (!readahead->fill(readahead->arg, slot))
+        {
+            readahead->end = true;
+            return NULL;
+        }
+        readahead->head = (readahead->head + 1) % readahead->count;
+        readahead->held = true;
+        return slot;
+    }
+
+    pthread_mutex_lock(&readahead->lock);
+    readahead->held = false;
+    if (readahead->thread_waiting &&
+        readahead->count - readahead->filled >= readahead->wakeup)
+        pthread_cond_signal(&readahead->free_cond);
+    while (!readahead->filled && !readahead->end)
+    {
+        readahead->consumer_waiting = true;
+        pthread_cond_wait(&readahead->filled_cond, &readahead->lock);
+        readahead->consumer_waiting = false;
+    }
+    if (readahead->filled)
+    {
+        slot = _cryptodb_readahead_slot(readahead, readahead->head);
+        readahead->head = (readahead->head + 1) % readahead->count;
+        --readahead->filled;
+        readahead->held = true;
+    }
+    pthread_mutex_unlock(&readahead->lock);
+
+    return slot;
+}
@@ -0,0 +1,86 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+/**
+ * Private read-ahead stage of cryptodb. Not a part of the public API.
+ *
+ * Entries of a source (e.g. LevelDB iterator) are filled into a ring of
+ * slots by a background thread, up to "depth" entries ahead of the
+ * consumer, while the consumer handles the current one. With depth 0
+ * there is no thread, the entries are filled by the consumer itself.
+ * The thread is started with the first entry that is taken.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct _cryptodb_readahead _cryptodb_readahead_t;
+
+/**
+ * Fills "slot" with the next entry of the source and advances it.
+ * Returns false if the source has no more entries.
+ */
+typedef bool (*_cryptodb_readahead_fill_t)(void *arg, void *slot);
+
+/**
+ * Releases the entry of a filled "slot", it's filled again later
+ */
+typedef void (*_cryptodb_readahead_clear_t)(void *arg, void *slot);
+
+/**
+ * @brief      Create read-ahead stage
+ *
+ * @param[in]  depth      Maximum number of entries filled ahead
+ * @param[in]  slot_size  Size of one slot, slots are zeroed initially
+ * @param[in]  fill       Fill function, called from the thread
+ * @param[in]  clear      Clear function, called from the consumer
+ * @param      arg        Argument of "fill" and "clear"
+ *
+ * @return     Read-ahead stage or NULL on error
+ */
+_cryptodb_readahead_t * _cryptodb_readahead_create(size_t depth,
+                                                   size_t slot_size,
+                                                   _cryptodb_readahead_fill_t fill,
+                                                   _cryptodb_readahead_clear_t clear,
+                                                   void *arg);
+
+/**
+ * @brief      Stop the thread, clear all slots and free the stage
+ */
+void _cryptodb_readahead_destroy(_cryptodb_readahead_t *readahead);
+
+/**
+ * @brief      Stop the thread and clear all slots. The source isn't used
+ *             until the next _cryptodb_readahead_next(), so it can be
+ *             repositioned meanwhile.
+ */
+void _cryptodb_readahead_reset(_cryptodb_readahead_t *readahead);
+
+/**
+ * @brief      Clear the slot that was returned before and take the next
+ *             entry, blocks until it's filled
+ *
+ * @return     Filled slot or NULL if the source has no more entries
+ */
+void * _cryptodb_readahead_next(_cryptodb_readahead_t *readahead);
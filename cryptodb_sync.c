@@ -0,0 +1,297 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+#include <time.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include <cryptodb_sync.h>
+
+/**
+ * PRIVATE API
+ */
+
+/**
+ * Batch of a writer waiting for the group commit, lives on its stack
+ */
+typedef struct _cryptodb_sync_op {
+    leveldb_writebatch_t *batch;
+    struct _cryptodb_sync_op *next;
+    bool done;
+    int result;
+} _cryptodb_sync_op_t;
+
+struct _cryptodb_sync {
+    leveldb_t *db;
+    leveldb_writeoptions_t *woptions; // synced
+    leveldb_writebatch_t *empty;
+    leveldb_writebatch_t *group; // batches of one group commit
+    cryptodb_durability_t durability;
+    unsigned int period_ms;
+    uint64_t *syncs;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    // CRYPTODB_DURABILITY_GROUP_COMMIT only
+    _cryptodb_sync_op_t *pending; // batches waiting for the next commit
+    _cryptodb_sync_op_t *pending_tail;
+    bool leader; // a commit is in progress
+    // CRYPTODB_DURABILITY_PERIODIC only
+    uint64_t written; // number of writes, the write gets it as a ticket
+    uint64_t synced; // writes up to this ticket are durable
+
+    bool stop;
+    bool thread_started;
+    pthread_t thread; // CRYPTODB_DURABILITY_PERIODIC only
+};
+
+/**
+ * Syncs the writes up to "target" ticket with an empty synced write.
+ * Called with the lock held, the lock is released during the sync.
+ */
+static int _cryptodb_sync_run(_cryptodb_sync_t *sync, uint64_t target)
+{
+    char *err = NULL;
+    int result = CRYPTODB_SUCCESS;
+
+    pthread_mutex_unlock(&sync->lock);
+
+    leveldb_write(sync->db, sync->woptions, sync->empty, &err);
+    if (err)
+    {
+        result = CRYPTODB_ERR_FAIL;
+        leveldb_free(err);
+    }
+    else
+    {
+        __atomic_fetch_add(sync->syncs, 1, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_lock(&sync->lock);
+    if (result == CRYPTODB_SUCCESS && target > sync->synced)
+        sync->synced = target;
+
+    return result;
+}
+
+/**
+ * Writes the batches of all pending writers with one synced write.
+ * Called with the lock held, the lock is released during the write.
+ */
+static void _cryptodb_sync_lead(_cryptodb_sync_t *sync)
+{
+    char *err = NULL;
+    int result = CRYPTODB_SUCCESS;
+    leveldb_writebatch_t *batch = NULL;
+    _cryptodb_sync_op_t *ops = sync->pending, *op = NULL;
+
+    sync->leader = true;
+    sync->pending = NULL;
+    sync->pending_tail = NULL;
+    pthread_mutex_unlock(&sync->lock);
+
+    // A single batch is written as is, without the copy
+    if (ops->next == NULL)
+        batch = ops->batch;
+    else
+    {
+        batch = sync->group;
+        leveldb_writebatch_clear(batch);
+        for (op = ops; op; op = op->next)
+            leveldb_writebatch_append(batch, op->batch);
+    }
+
+    leveldb_write(sync->db, sync->woptions, batch, &err);
+    if (err)
+    {
+        result = CRYPTODB_ERR_FAIL;
+        leveldb_free(err);
+    }
+    else
+    {
+        __atomic_fetch_add(sync->syncs, 1, __ATOMIC_RELAXED);
+    }
+    if (batch == sync->group)
+        leveldb_writebatch_clear(batch);
+
+    pthread_mutex_lock(&sync->lock);
+    sync->leader = false;
+    for (op = ops; op; op = op->next)
+    {
+        op->result = result;
+        op->done = true;
+    }
+    pthread_cond_broadcast(&sync->cond);
+}
+
+static void * _cryptodb_sync_thread(void *arg)
+{
+    _cryptodb_sync_t *sync = (_cryptodb_sync_t *)arg;
+    struct timespec deadline;
+
+    pthread_mutex_lock(&sync->lock);
+    while (!sync->stop)
+    {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += sync->period_ms / 1000;
+        deadline.tv_nsec += (long)(sync->period_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            ++deadline.tv_sec;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        while (!sync->stop &&
+               pthread_cond_timedwait(&sync->cond, &sync->lock, &deadline) != ETIMEDOUT)
+            ;
+
+        // A failed sync is retried in the next period
+        if (!sync->stop && __atomic_load_n(&sync->written, __ATOMIC_ACQUIRE) > sync->synced)
+            _cryptodb_sync_run(sync, __atomic_load_n(&sync->written, __ATOMIC_ACQUIRE));
+    }
+    pthread_mutex_unlock(&sync->lock);
+
+    return NULL;
+}
+
+_cryptodb_sync_t * _cryptodb_sync_create(leveldb_t *db,
+                                         cryptodb_durability_t durability,
+                                         unsigned int period_ms,
+                                         uint64_t *syncs)
+{
+    _cryptodb_sync_t *sync = NULL;
+
+    if (db == NULL || syncs == NULL ||
+        (durability != CRYPTODB_DURABILITY_GROUP_COMMIT &&
+         durability != CRYPTODB_DURABILITY_PERIODIC))
+        return NULL;
+
+    sync = (_cryptodb_sync_t *)calloc(1, sizeof(_cryptodb_sync_t));
+    if (sync == NULL)
+        return NULL;
+
+    sync->db = db;
+    sync->durability = durability;
+    sync->period_ms = period_ms ? period_ms : 1;
+    sync->syncs = syncs;
+
+    if (pthread_mutex_init(&sync->lock, NULL))
+    {
+        free(sync);
+        return NULL;
+    }
+    if (pthread_cond_init(&sync->cond, NULL))
+    {
+        pthread_mutex_destroy(&sync->lock);
+        free(sync);
+        return NULL;
+    }
+
+    sync->woptions = leveldb_writeoptions_create();
+    sync->empty = leveldb_writebatch_create();
+    sync->group = leveldb_writebatch_create();
+    if (sync->woptions == NULL || sync->empty == NULL || sync->group == NULL)
+    {
+        _cryptodb_sync_destroy(sync);
+        return NULL;
+    }
+    leveldb_writeoptions_set_sync(sync->woptions, 1);
+
+    if (durability == CRYPTODB_DURABILITY_PERIODIC)
+    {
+        if (pthread_create(&sync->thread, NULL, _cryptodb_sync_thread, sync))
+        {
+            _cryptodb_sync_destroy(sync);
+            return NULL;
+        }
+        sync->thread_started = true;
+    }
+
+    return sync;
+}
+
+void _cryptodb_sync_destroy(_cryptodb_sync_t *sync)
+{
+    if (sync == NULL)
+        return;
+
+    if (sync->thread_started)
+    {
+        pthread_mutex_lock(&sync->lock);
+        sync->stop = true;
+        pthread_cond_broadcast(&sync->cond);
+        pthread_mutex_unlock(&sync->lock);
+        pthread_join(sync->thread, NULL);
+    }
+
+    if (sync->woptions && sync->empty)
+    {
+        pthread_mutex_lock(&sync->lock);
+        if (sync->written > sync->synced)
+            _cryptodb_sync_run(sync, sync->written);
+        pthread_mutex_unlock(&sync->lock);
+    }
+
+    if (sync->woptions)
+        leveldb_writeoptions_destroy(sync->woptions);
+    if (sync->empty)
+        leveldb_writebatch_destroy(sync->empty);
+    if (sync->group)
+        leveldb_writebatch_destroy(sync->group);
+    pthread_cond_destroy(&sync->cond);
+    pthread_mutex_destroy(&sync->lock);
+    free(sync);
+}
+
+void _cryptodb_sync_written(_cryptodb_sync_t *sync)
+{
+    __atomic_add_fetch(&sync->written, 1, __ATOMIC_ACQ_REL);
+}
+
+int _cryptodb_sync_commit(_cryptodb_sync_t *sync, leveldb_writebatch_t *batch)
+{
+    _cryptodb_sync_op_t op = { batch, NULL, false, CRYPTODB_SUCCESS };
+
+    pthread_mutex_lock(&sync->lock);
+
+    if (sync->pending_tail)
+        sync->pending_tail->next = &op;
+    else
+        sync->pending = &op;
+    sync->pending_tail = &op;
+
+    // The writer that finds no commit in progress writes the batches of
+    // all writers that came so far, the others wait for it
+    while (!op.done)
+    {
+        if (!sync->leader)
+            _cryptodb_sync_lead(sync);
+        else
+            pthread_cond_wait(&sync->cond, &sync->lock);
+    }
+
+    pthread_mutex_unlock(&sync->lock);
+
+    return op.result;
+}
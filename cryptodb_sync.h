@@ -0,0 +1,82 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+/**
+ * Private sync scheduler of cryptodb. Not a part of the public API.
+ *
+ * * group commit: writers hand their batches to the scheduler. The writer
+ *   that finds no commit in progress becomes the leader and writes the
+ *   batches of all writers that came so far with one synced write, the
+ *   writers that come meanwhile wait for the next commit. A write is
+ *   durable only when it's in a synced write itself: LevelDB doesn't sync
+ *   the previous log when it switches to a new one, so a separate sync
+ *   wouldn't make the writes of the previous log durable;
+ * * periodic: the database is written without sync, a background thread
+ *   syncs the log every "period_ms" if there were writes with an empty
+ *   synced write, writers don't wait.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <leveldb/c.h>
+
+#include <cryptodb.h>
+
+typedef struct _cryptodb_sync _cryptodb_sync_t;
+
+/**
+ * @brief      Create sync scheduler of "db"
+ *
+ * @param[in]  durability  CRYPTODB_DURABILITY_GROUP_COMMIT or
+ *                         CRYPTODB_DURABILITY_PERIODIC
+ * @param[in]  period_ms   Sync period of CRYPTODB_DURABILITY_PERIODIC
+ * @param      syncs       Counter of synced writes, incremented atomically
+ *
+ * @return     Scheduler or NULL on error
+ */
+_cryptodb_sync_t * _cryptodb_sync_create(leveldb_t *db,
+                                         cryptodb_durability_t durability,
+                                         unsigned int period_ms,
+                                         uint64_t *syncs);
+
+/**
+ * @brief      Sync the writes that weren't synced yet and free the
+ *             scheduler. There should be no running writes.
+ */
+void _cryptodb_sync_destroy(_cryptodb_sync_t *sync);
+
+/**
+ * @brief      CRYPTODB_DURABILITY_PERIODIC: should be called after every
+ *             successful unsynced write
+ */
+void _cryptodb_sync_written(_cryptodb_sync_t *sync);
+
+/**
+ * @brief      CRYPTODB_DURABILITY_GROUP_COMMIT: write "batch" to the
+ *             database together with the batches of concurrent writers.
+ *             Returns when the batch is durable, "batch" isn't modified.
+ *
+ * @return     See cryptodb_err_t
+ */
+int _cryptodb_sync_commit(_cryptodb_sync_t *sync, leveldb_writebatch_t *batch);
@@ -0,0 +1,261 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include <cryptodb_writer.h>
+
+/**
+ * PRIVATE API
+ */
+
+typedef struct {
+    leveldb_writebatch_t *op;
+    bool put;
+    cryptodb_write_cb cb;
+    void *user_data;
+} _cryptodb_writer_op_t;
+
+struct _cryptodb_writer {
+    _cryptodb_writer_commit_t commit;
+    void *arg;
+    size_t capacity;
+
+    pthread_mutex_t lock;
+    pthread_cond_t queued_cond; // an operation was queued or the writer is stopped
+    pthread_cond_t done_cond; // operations were completed
+    _cryptodb_writer_op_t *ring; // "capacity" operations, allocated with the thread
+    size_t head; // the first queued operation in "ring"
+    size_t queued; // queued operations after "head"
+    size_t inflight; // operations before "head" that are being written
+    uint64_t submitted; // operations that were ever queued
+    uint64_t completed; // operations that were written and their callbacks called
+
+    leveldb_writebatch_t *group; // operations of one commit
+    bool stop;
+    bool thread_started;
+    pthread_t thread;
+};
+
+static void * _cryptodb_writer_thread(void *arg)
+{
+    int result = CRYPTODB_SUCCESS;
+    size_t first = 0, count = 0, puts = 0, deletes = 0;
+    _cryptodb_writer_op_t *op = NULL;
+    _cryptodb_writer_t *writer = (_cryptodb_writer_t *)arg;
+
+    pthread_mutex_lock(&writer->lock);
+    for (;;)
+    {
+        while (!writer->queued && !writer->stop)
+            pthread_cond_wait(&writer->queued_cond, &writer->lock);
+        // The queue is drained before the writer is stopped
+        if (!writer->queued)
+            break;
+
+        first = writer->head;
+        count = writer->queued;
+        writer->head = (writer->head + count) % writer->capacity;
+        writer->queued = 0;
+        writer->inflight = count;
+        pthread_mutex_unlock(&writer->lock);
+
+        // Submits don't touch the slots of the operations in flight
+        puts = deletes = 0;
+        leveldb_writebatch_clear(writer->group);
+        for (size_t i = 0; i < count; ++i)
+        {
+            op = &writer->ring[(first + i) % writer->capacity];
+            leveldb_writebatch_append(writer->group, op->op);
+            if (op->put)
+                ++puts;
+            else
+                ++deletes;
+        }
+
+        result = writer->commit(writer->arg, writer->group, puts, deletes);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            op = &writer->ring[(first + i) % writer->capacity];
+            leveldb_writebatch_destroy(op->op);
+            op->op = NULL;
+            if (op->cb)
+                op->cb((cryptodb_t *)writer->arg, result, op->user_data);
+        }
+
+        pthread_mutex_lock(&writer->lock);
+        writer->inflight = 0;
+        writer->completed += count;
+        pthread_cond_broadcast(&writer->done_cond);
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    return NULL;
+}
+
+/**
+ * Called with the lock held. On failure nothing is left allocated, so the
+ * next submit starts over.
+ */
+static int _cryptodb_writer_start(_cryptodb_writer_t *writer)
+{
+    int result = CRYPTODB_SUCCESS;
+
+    writer->ring = (_cryptodb_writer_op_t *)calloc(writer->capacity,
+                                                   sizeof(_cryptodb_writer_op_t));
+    writer->group = leveldb_writebatch_create();
+    if (writer->ring == NULL || writer->group == NULL)
+        result = CRYPTODB_ERR_ALLOCATE_MEM;
+    else if (pthread_create(&writer->thread, NULL, _cryptodb_writer_thread, writer))
+        result = CRYPTODB_ERR_FAIL;
+
+    if (result != CRYPTODB_SUCCESS)
+    {
+        if (writer->group)
+            leveldb_writebatch_destroy(writer->group);
+        free(writer->ring);
+        writer->group = NULL;
+        writer->ring = NULL;
+        return result;
+    }
+    writer->thread_started = true;
+
+    return CRYPTODB_SUCCESS;
+}
+
+_cryptodb_writer_t * _cryptodb_writer_create(size_t capacity,
+                                             _cryptodb_writer_commit_t commit,
+                                             void *arg)
+{
+    _cryptodb_writer_t *writer = NULL;
+
+    if (!capacity || commit == NULL)
+        return NULL;
+
+    writer = (_cryptodb_writer_t *)calloc(1, sizeof(_cryptodb_writer_t));
+    if (writer == NULL)
+        return NULL;
+
+    writer->commit = commit;
+    writer->arg = arg;
+    writer->capacity = capacity;
+
+    if (pthread_mutex_init(&writer->lock, NULL))
+    {
+        free(writer);
+        return NULL;
+    }
+    if (pthread_cond_init(&writer->queued_cond, NULL))
+    {
+        pthread_mutex_destroy(&writer->lock);
+        free(writer);
+        return NULL;
+    }
+    if (pthread_cond_init(&writer->done_cond, NULL))
+    {
+        pthread_cond_destroy(&writer->queued_cond);
+        pthread_mutex_destroy(&writer->lock);
+        free(writer);
+        return NULL;
+    }
+
+    return writer;
+}
+
+void _cryptodb_writer_destroy(_cryptodb_writer_t *writer)
+{
+    if (writer == NULL)
+        return;
+
+    if (writer->thread_started)
+    {
+        pthread_mutex_lock(&writer->lock);
+        writer->stop = true;
+        pthread_cond_signal(&writer->queued_cond);
+        pthread_mutex_unlock(&writer->lock);
+        pthread_join(writer->thread, NULL);
+    }
+
+    if (writer->group)
+        leveldb_writebatch_destroy(writer->group);
+    free(writer->ring);
+    pthread_cond_destroy(&writer->done_cond);
+    pthread_cond_destroy(&writer->queued_cond);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer);
+}
+
+int _cryptodb_writer_submit(_cryptodb_writer_t *writer,
+                            leveldb_writebatch_t *op, bool put,
+                            cryptodb_write_cb cb, void *user_data)
+{
+    int result = CRYPTODB_SUCCESS;
+    _cryptodb_writer_op_t *slot = NULL;
+
+    if (writer == NULL || op == NULL)
+        return CRYPTODB_ERR_NULL_POINTER;
+
+    pthread_mutex_lock(&writer->lock);
+
+    if (!writer->thread_started)
+        result = _cryptodb_writer_start(writer);
+
+    // Backpressure: the operations in flight still occupy their slots
+    while (result == CRYPTODB_SUCCESS && !writer->stop &&
+           writer->queued + writer->inflight >= writer->capacity)
+        pthread_cond_wait(&writer->done_cond, &writer->lock);
+    if (result == CRYPTODB_SUCCESS && writer->stop)
+        result = CRYPTODB_ERR_FAIL;
+
+    if (result == CRYPTODB_SUCCESS)
+    {
+        slot = &writer->ring[(writer->head + writer->queued) % writer->capacity];
+        slot->op = op;
+        slot->put = put;
+        slot->cb = cb;
+        slot->user_data = user_data;
+        ++writer->queued;
+        ++writer->submitted;
+        pthread_cond_signal(&writer->queued_cond);
+    }
+
+    pthread_mutex_unlock(&writer->lock);
+
+    return result;
+}
+
+void _cryptodb_writer_flush(_cryptodb_writer_t *writer)
+{
+    uint64_t target = 0;
+
+    if (writer == NULL)
+        return;
+
+    pthread_mutex_lock(&writer->lock);
+    target = writer->submitted;
+    while (writer->completed < target)
+        pthread_cond_wait(&writer->done_cond, &writer->lock);
+    pthread_mutex_unlock(&writer->lock);
+}
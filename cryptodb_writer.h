@@ -0,0 +1,90 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+/**
+ * Private asynchronous writer of cryptodb. Not a part of the public API.
+ *
+ * Callers encrypt their operations into small LevelDB write batches and
+ * put them into a bounded queue. The writer thread takes all queued
+ * operations at once, writes them with one commit and calls their
+ * callbacks, while the callers already encrypt the next operations.
+ * The thread is started with the first operation.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <leveldb/c.h>
+
+#include <cryptodb.h>
+
+typedef struct _cryptodb_writer _cryptodb_writer_t;
+
+/**
+ * Writes "batch" to the database, returns cryptodb_err_t
+ */
+typedef int (*_cryptodb_writer_commit_t)(void *arg,
+                                         leveldb_writebatch_t *batch,
+                                         size_t puts, size_t deletes);
+
+/**
+ * @brief      Create writer
+ *
+ * @param[in]  capacity  Maximum number of queued and not yet completed
+ *                       operations
+ * @param[in]  commit    Commit function, called from the writer thread
+ * @param      arg       Argument of "commit", also passed to the
+ *                       operation callbacks as cryptodb_t handler
+ *
+ * @return     Writer or NULL on error
+ */
+_cryptodb_writer_t * _cryptodb_writer_create(size_t capacity,
+                                             _cryptodb_writer_commit_t commit,
+                                             void *arg);
+
+/**
+ * @brief      Complete all queued operations and free the writer.
+ *             There should be no running submits.
+ */
+void _cryptodb_writer_destroy(_cryptodb_writer_t *writer);
+
+/**
+ * @brief      Queue an operation, blocks while the queue is full.
+ *             On success the writer owns "op" and calls "cb" (if not NULL)
+ *             when the operation is written.
+ *
+ * @param[in]  op    Operation, a write batch with one put or delete
+ * @param[in]  put   true for put, false for delete
+ *
+ * @return     See cryptodb_err_t
+ */
+int _cryptodb_writer_submit(_cryptodb_writer_t *writer,
+                            leveldb_writebatch_t *op, bool put,
+                            cryptodb_write_cb cb, void *user_data);
+
+/**
+ * @brief      Wait until all operations that were queued before are
+ *             written and their callbacks are called
+ */
+void _cryptodb_writer_flush(_cryptodb_writer_t *writer);
@@ -0,0 +1,1622 @@
+/**
+ * MIT License
+ *
+ * Copyright 2024 PE Stanislav Yahniukov <pe@yahniukov.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the “Software”), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+*/
+
+/**
+ * Microbenchmarks. Not a part of the tests, build with
+ * -DCRYPTODB_BUILD_BENCHMARKS=ON and run "./build/test/cryptodb_bench".
+ */
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <leveldb/c.h>
+#include <mbedtls/aes.h>
+
+#include "cryptodb.h"
+
+#define BENCH_DB_FOLDER "db_bench"
+
+#define BENCH_AES_ITERATIONS (200000)
+#define BENCH_DB_ITERATIONS  (20000)
+#define BENCH_GET_ITERATIONS (2000)
+#define BENCH_GET_MAX_SIZE   (64 * 1024)
+#define BENCH_GET_BUF_GUESS  (4 * 1024)
+#define BENCH_WRITER_THREADS (4)
+
+static const size_t bench_record_sizes[] = { 16, 32, 64, 128, 256 };
+
+#define BENCH_RECORD_SIZES_COUNT (sizeof(bench_record_sizes) / sizeof(bench_record_sizes[0]))
+
+static const size_t bench_get_sizes[] = { 16, 256, 4 * 1024, BENCH_GET_MAX_SIZE };
+
+#define BENCH_GET_SIZES_COUNT (sizeof(bench_get_sizes) / sizeof(bench_get_sizes[0]))
+
+/**
+ * Heap allocations counter. On glibc malloc()/calloc()/realloc() are
+ * interposed for the whole process, including libcryptodb.
+ */
+static unsigned long bench_allocs = 0;
+
+#if defined(__GLIBC__)
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+__attribute__((visibility("default"))) void *malloc(size_t size)
+{
+    __atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+__attribute__((visibility("default"))) void *calloc(size_t nmemb, size_t size)
+{
+    __atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(nmemb, size);
+}
+
+__attribute__((visibility("default"))) void *realloc(void *ptr, size_t size)
+{
+    __atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+static unsigned long bench_allocs_now(void)
+{
+    return __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED);
+}
+
+static double bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static double bench_cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * AES-256 CBC of one record: key schedule expanded on every call
+ * (as it was done before) vs expanded once per database handler
+ */
+static void bench_aes_key_schedule(void)
+{
+    uint8_t key[32], iv[16], iv_copy[16];
+    uint8_t in[256], out[256];
+    mbedtls_aes_context ctx, ctx_enc, ctx_dec;
+
+    memset(key, 0x42, sizeof(key));
+    memset(iv, 0x24, sizeof(iv));
+    memset(in, 0x5A, sizeof(in));
+
+    mbedtls_aes_init(&ctx_enc);
+    mbedtls_aes_init(&ctx_dec);
+    mbedtls_aes_setkey_enc(&ctx_enc, key, 256);
+    mbedtls_aes_setkey_dec(&ctx_dec, key, 256);
+
+    fprintf(stdout, "AES-256 CBC, ns per record (encrypt + decrypt)\n");
+    fprintf(stdout, "%8s %16s %16s %10s\n", "bytes", "re-keyed", "pre-expanded", "saving");
+
+    for (size_t s = 0; s < BENCH_RECORD_SIZES_COUNT; ++s)
+    {
+        size_t size = bench_record_sizes[s];
+        double start = 0, rekeyed = 0, expanded = 0;
+
+        start = bench_now_ns();
+        for (int i = 0; i < BENCH_AES_ITERATIONS; ++i)
+        {
+            mbedtls_aes_init(&ctx);
+            mbedtls_aes_setkey_enc(&ctx, key, 256);
+            memcpy(iv_copy, iv, 16);
+            mbedtls_aes_crypt_cbc(&ctx, MBEDTLS_AES_ENCRYPT, size, iv_copy, in, out);
+            mbedtls_aes_free(&ctx);
+
+            mbedtls_aes_init(&ctx);
+            mbedtls_aes_setkey_dec(&ctx, key, 256);
+            memcpy(iv_copy, iv, 16);
+            mbedtls_aes_crypt_cbc(&ctx, MBEDTLS_AES_DECRYPT, size, iv_copy, out, out);
+            mbedtls_aes_free(&ctx);
+        }
+        rekeyed = (bench_now_ns() - start) / BENCH_AES_ITERATIONS;
+
+        start = bench_now_ns();
+        for (int i = 0; i < BENCH_AES_ITERATIONS; ++i)
+        {
+            memcpy(iv_copy, iv, 16);
+            mbedtls_aes_crypt_cbc(&ctx_enc, MBEDTLS_AES_ENCRYPT, size, iv_copy, in, out);
+            memcpy(iv_copy, iv, 16);
+            mbedtls_aes_crypt_cbc(&ctx_dec, MBEDTLS_AES_DECRYPT, size, iv_copy, out, out);
+        }
+        expanded = (bench_now_ns() - start) / BENCH_AES_ITERATIONS;
+
+        fprintf(stdout, "%8zu %16.1f %16.1f %9.1f%%\n", size, rekeyed, expanded,
+                100.0 * (rekeyed - expanded) / rekeyed);
+    }
+
+    mbedtls_aes_free(&ctx_enc);
+    mbedtls_aes_free(&ctx_dec);
+}
+
+/**
+ * Per-operation latency of cryptodb_put()/cryptodb_get() with string values
+ */
+static int bench_db_ops(void)
+{
+    int ret = 0;
+    char key[32] = "";
+    cryptodb_t cryptodb;
+    cryptodb_stats_t stats;
+    char value[257] = "", out[257] = "";
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN] = {0};
+
+    memset(&cryptodb, 0, sizeof(cryptodb_t));
+    memset(uniq_data, 0x11, CRYPTODB_UNIQ_DATA_MAX_LEN);
+
+    cryptodb_destroy(BENCH_DB_FOLDER, NULL);
+
+    ret = cryptodb_open(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, NULL, NULL, NULL, &cryptodb);
+    if (CRYPTODB_SUCCESS != ret)
+    {
+        fprintf(stderr, "ERROR: cryptodb_open(), error = %d\n", ret);
+        return -1;
+    }
+
+    fprintf(stdout, "\ncryptodb ops, ns per operation (string values)\n");
+    fprintf(stdout, "%8s %16s %16s\n", "bytes", "put", "get");
+
+    for (size_t s = 0; s < BENCH_RECORD_SIZES_COUNT; ++s)
+    {
+        size_t size = bench_record_sizes[s];
+        double start = 0, put = 0, get = 0;
+
+        memset(value, 'v', size - 1);
+        value[size - 1] = '\0';
+
+        start = bench_now_ns();
+        for (int i = 0; i < BENCH_DB_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(key, sizeof(key), "key%d", i);
+            ret = cryptodb_put_string(&cryptodb, key, strlen(key) + 1, value);
+        }
+        put = (bench_now_ns() - start) / BENCH_DB_ITERATIONS;
+
+        start = bench_now_ns();
+        for (int i = 0; i < BENCH_DB_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(key, sizeof(key), "key%d", i);
+            ret = cryptodb_get(&cryptodb, key, strlen(key) + 1, CRYPTODB_VAL_STRING, out);
+        }
+        get = (bench_now_ns() - start) / BENCH_DB_ITERATIONS;
+
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            fprintf(stderr, "ERROR: put/get, error = %d\n", ret);
+            break;
+        }
+
+        fprintf(stdout, "%8zu %16.1f %16.1f\n", size, put, get);
+    }
+
+    if (CRYPTODB_SUCCESS == ret && CRYPTODB_SUCCESS == cryptodb_get_stats(&cryptodb, &stats))
+        fprintf(stdout, "cryptodb heap allocations: %llu for %llu ops (scratch %d bytes)\n",
+                (unsigned long long)stats.heap_allocs,
+                (unsigned long long)(stats.puts + stats.gets),
+                CRYPTODB_SCRATCH_LEN);
+
+    cryptodb_close(&cryptodb);
+    cryptodb_destroy(BENCH_DB_FOLDER, NULL);
+
+    return ret == CRYPTODB_SUCCESS ? 0 : -1;
+}
+
+/**
+ * Writes legacy JSON record as it was done by older versions
+ */
+static int bench_put_legacy_string(cryptodb_t *cryptodb, const uint8_t key[32],
+                                   const uint8_t iv[16], const char *dbkey,
+                                   const char *value, size_t size)
+{
+    char *err = NULL;
+    uint8_t iv_copy[16];
+    mbedtls_aes_context ctx;
+    size_t json_len = size + 32, enc_len = 0;
+    char *json = (char *)calloc(json_len + 16, 1);
+
+    if (json == NULL)
+        return CRYPTODB_ERR_ALLOCATE_MEM;
+
+    snprintf(json, json_len, "{\"type\":\"string\",\"val\":\"%s\"}", value);
+    enc_len = strlen(json) + 1;
+    while (enc_len % 16 != 0)
+        ++enc_len;
+
+    memcpy(iv_copy, iv, 16);
+    mbedtls_aes_init(&ctx);
+    mbedtls_aes_setkey_enc(&ctx, key, 256);
+    mbedtls_aes_crypt_cbc(&ctx, MBEDTLS_AES_ENCRYPT, enc_len, iv_copy,
+                          (const unsigned char *)json, (unsigned char *)json);
+    mbedtls_aes_free(&ctx);
+
+    leveldb_put(cryptodb->db, cryptodb->woptions, dbkey, strlen(dbkey) + 1,
+                json, enc_len, &err);
+    free(json);
+    if (err)
+    {
+        leveldb_free(err);
+        return CRYPTODB_ERR_FAIL;
+    }
+
+    return CRYPTODB_SUCCESS;
+}
+
+/**
+ * Time and heap allocations per cryptodb_get() of string values,
+ * for binary and legacy JSON records
+ */
+static int bench_get_strings(void)
+{
+    int ret = 0;
+    cryptodb_t cryptodb;
+    cryptodb_options_t options;
+    uint8_t key[32], iv[16];
+    char *value = NULL, *out = NULL;
+
+    memset(&cryptodb, 0, sizeof(cryptodb_t));
+    memset(&options, 0, sizeof(cryptodb_options_t));
+    memset(key, 0x42, sizeof(key));
+    memset(iv, 0x24, sizeof(iv));
+
+    options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+    options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+    options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+    options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+    options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+    options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+    options.disable_keys_encryption = 1; // legacy records are written directly
+
+    value = (char *)malloc(BENCH_GET_MAX_SIZE);
+    out = (char *)malloc(BENCH_GET_MAX_SIZE);
+    if (value == NULL || out == NULL)
+    {
+        free(value);
+        free(out);
+        return -1;
+    }
+
+    cryptodb_destroy(BENCH_DB_FOLDER, &options);
+
+    ret = cryptodb_open_with_keys(BENCH_DB_FOLDER, key, iv, &options, &cryptodb);
+    if (CRYPTODB_SUCCESS != ret)
+    {
+        fprintf(stderr, "ERROR: cryptodb_open_with_keys(), error = %d\n", ret);
+        free(value);
+        free(out);
+        return -1;
+    }
+
+    fprintf(stdout, "\ncryptodb_get(), string values, per operation\n");
+    fprintf(stdout, "%8s %16s %16s %16s %16s\n", "bytes",
+            "binary ns", "binary allocs", "legacy ns", "legacy allocs");
+
+    for (size_t s = 0; s < BENCH_GET_SIZES_COUNT && ret == CRYPTODB_SUCCESS; ++s)
+    {
+        size_t size = bench_get_sizes[s];
+        double start = 0, ns[2] = {0};
+        unsigned long allocs[2] = {0};
+        const char *keys[2] = { "binary", "legacy" };
+
+        memset(value, 'v', size - 1);
+        value[size - 1] = '\0';
+
+        ret = cryptodb_put_string(&cryptodb, keys[0], strlen(keys[0]) + 1, value);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = bench_put_legacy_string(&cryptodb, key, iv, keys[1], value, size);
+
+        for (int k = 0; k < 2 && ret == CRYPTODB_SUCCESS; ++k)
+        {
+            allocs[k] = bench_allocs_now();
+            start = bench_now_ns();
+            for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+                ret = cryptodb_get(&cryptodb, keys[k], strlen(keys[k]) + 1, CRYPTODB_VAL_STRING, out);
+            ns[k] = (bench_now_ns() - start) / BENCH_GET_ITERATIONS;
+            allocs[k] = bench_allocs_now() - allocs[k];
+            if (CRYPTODB_SUCCESS == ret && strcmp(out, value))
+                ret = CRYPTODB_ERR_FAIL;
+        }
+
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            fprintf(stderr, "ERROR: get, error = %d\n", ret);
+            break;
+        }
+
+        fprintf(stdout, "%8zu %16.1f %16.2f %16.1f %16.2f\n", size,
+                ns[0], (double)allocs[0] / BENCH_GET_ITERATIONS,
+                ns[1], (double)allocs[1] / BENCH_GET_ITERATIONS);
+    }
+
+    cryptodb_close(&cryptodb);
+    cryptodb_destroy(BENCH_DB_FOLDER, &options);
+
+    free(value);
+    free(out);
+
+    return ret == CRYPTODB_SUCCESS ? 0 : -1;
+}
+
+/**
+ * cryptodb_get() of large values: single-threaded decryption (baseline)
+ * vs decryption split across worker threads
+ */
+static int bench_parallel_decrypt(void)
+{
+    static const size_t sizes[] = { 64 * 1024, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024 };
+
+    int ret = CRYPTODB_SUCCESS;
+    cryptodb_options_t options;
+    char *value = NULL, *out = NULL;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int threads[2] = { 0, 0 };
+    double ns[2] = {0};
+    char label[32] = "";
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN] = {0};
+
+    threads[1] = cpus > 1 ? (unsigned int)(cpus - 1) : 1;
+    if (threads[1] > CRYPTODB_OPT_MAX_WORKER_THREADS)
+        threads[1] = CRYPTODB_OPT_MAX_WORKER_THREADS;
+
+    memset(uniq_data, 0x11, CRYPTODB_UNIQ_DATA_MAX_LEN);
+    memset(&options, 0, sizeof(cryptodb_options_t));
+    options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+    options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+    options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+    options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+    options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+    options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+    options.parallel_decrypt_threshold = sizes[0];
+
+    value = (char *)malloc(sizes[3]);
+    out = (char *)malloc(sizes[3]);
+    if (value == NULL || out == NULL)
+    {
+        free(value);
+        free(out);
+        return -1;
+    }
+
+    fprintf(stdout, "\ncryptodb_get() of large values, us per operation\n");
+    snprintf(label, sizeof(label), "1 + %u threads", threads[1]);
+    fprintf(stdout, "%10s %16s %16s %10s\n", "bytes", "1 thread", label, "speedup");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && ret == CRYPTODB_SUCCESS; ++s)
+    {
+        int iterations = (int)((64 * 1024 * 1024) / sizes[s]);
+
+        memset(value, 'v', sizes[s] - 1);
+        value[sizes[s] - 1] = '\0';
+
+        for (int t = 0; t < 2 && ret == CRYPTODB_SUCCESS; ++t)
+        {
+            cryptodb_t cryptodb;
+            double start = 0;
+
+            memset(&cryptodb, 0, sizeof(cryptodb_t));
+            options.worker_threads = threads[t];
+
+            cryptodb_destroy(BENCH_DB_FOLDER, &options);
+            ret = cryptodb_open(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_put_string(&cryptodb, "key", strlen("key") + 1, value);
+
+            start = bench_now_ns();
+            for (int i = 0; i < iterations && ret == CRYPTODB_SUCCESS; ++i)
+                ret = cryptodb_get(&cryptodb, "key", strlen("key") + 1, CRYPTODB_VAL_STRING, out);
+            ns[t] = (bench_now_ns() - start) / iterations;
+
+            cryptodb_close(&cryptodb);
+            cryptodb_destroy(BENCH_DB_FOLDER, &options);
+        }
+
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            fprintf(stderr, "ERROR: get, error = %d\n", ret);
+            break;
+        }
+
+        fprintf(stdout, "%10zu %16.1f %16.1f %9.2fx\n", sizes[s], ns[0] / 1000, ns[1] / 1000, ns[0] / ns[1]);
+    }
+
+    free(value);
+    free(out);
+
+    return ret == CRYPTODB_SUCCESS ? 0 : -1;
+}
+
+/**
+ * AES-256-CBC vs AES-256-GCM values: put/get time and stored value size
+ */
+static int bench_value_ciphers(void)
+{
+    int ret = CRYPTODB_SUCCESS;
+    cryptodb_options_t options;
+    char *value = NULL, *out = NULL;
+    double ns[2][2] = {{0}};
+    size_t stored[2] = {0};
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN] = {0};
+    const cryptodb_cipher_t ciphers[2] = { CRYPTODB_CIPHER_AES_256_CBC, CRYPTODB_CIPHER_AES_256_GCM };
+
+    memset(uniq_data, 0x11, CRYPTODB_UNIQ_DATA_MAX_LEN);
+    memset(&options, 0, sizeof(cryptodb_options_t));
+    options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+    options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+    options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+    options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+    options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+    options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+    options.disable_keys_encryption = 1; // stored values are read directly
+
+    value = (char *)malloc(BENCH_GET_MAX_SIZE);
+    out = (char *)malloc(BENCH_GET_MAX_SIZE);
+    if (value == NULL || out == NULL)
+    {
+        free(value);
+        free(out);
+        return -1;
+    }
+
+    fprintf(stdout, "\nValue ciphers, ns per operation and stored value bytes\n");
+    fprintf(stdout, "%10s %12s %12s %10s %12s %12s %10s\n", "bytes",
+            "CBC put", "CBC get", "CBC size", "GCM put", "GCM get", "GCM size");
+
+    for (size_t s = 0; s < BENCH_GET_SIZES_COUNT && ret == CRYPTODB_SUCCESS; ++s)
+    {
+        int iterations = (int)(BENCH_GET_ITERATIONS * (bench_get_sizes[s] < 4096 ? 10 : 1));
+
+        memset(value, 'v', bench_get_sizes[s] - 1);
+        value[bench_get_sizes[s] - 1] = '\0';
+
+        for (int c = 0; c < 2 && ret == CRYPTODB_SUCCESS; ++c)
+        {
+            cryptodb_t cryptodb;
+            char *err = NULL, *raw = NULL;
+            double start = 0;
+
+            memset(&cryptodb, 0, sizeof(cryptodb_t));
+            options.value_cipher = ciphers[c];
+
+            cryptodb_destroy(BENCH_DB_FOLDER, &options);
+            ret = cryptodb_open(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+
+            start = bench_now_ns();
+            for (int i = 0; i < iterations && ret == CRYPTODB_SUCCESS; ++i)
+                ret = cryptodb_put_string(&cryptodb, "key", strlen("key") + 1, value);
+            ns[c][0] = (bench_now_ns() - start) / iterations;
+
+            start = bench_now_ns();
+            for (int i = 0; i < iterations && ret == CRYPTODB_SUCCESS; ++i)
+                ret = cryptodb_get(&cryptodb, "key", strlen("key") + 1, CRYPTODB_VAL_STRING, out);
+            ns[c][1] = (bench_now_ns() - start) / iterations;
+
+            if (CRYPTODB_SUCCESS == ret)
+                raw = leveldb_get(cryptodb.db, cryptodb.roptions, "key", strlen("key") + 1, &stored[c], &err);
+            if (raw)
+                leveldb_free(raw);
+            if (err)
+                leveldb_free(err);
+
+            cryptodb_close(&cryptodb);
+            cryptodb_destroy(BENCH_DB_FOLDER, &options);
+        }
+
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            fprintf(stderr, "ERROR: value ciphers, error = %d\n", ret);
+            break;
+        }
+
+        fprintf(stdout, "%10zu %12.1f %12.1f %10zu %12.1f %12.1f %10zu\n", bench_get_sizes[s],
+                ns[0][0], ns[0][1], stored[0], ns[1][0], ns[1][1], stored[1]);
+    }
+
+    free(value);
+    free(out);
+
+    return ret == CRYPTODB_SUCCESS ? 0 : -1;
+}
+
+/**
+ * put/get of integers with different key lengths and key modes, and the
+ * length of the keys that are stored in LevelDB
+ */
+static int bench_key_modes(void)
+{
+    static const size_t key_lens[] = { 16, 64, 256 };
+    const cryptodb_key_mode_t modes[3] = {
+        CRYPTODB_KEY_MODE_AES_256_CBC, CRYPTODB_KEY_MODE_TOKEN_128, CRYPTODB_KEY_MODE_TOKEN_256
+    };
+    int ret = CRYPTODB_SUCCESS, out = 0;
+    cryptodb_options_t options;
+    char key[256] = {0};
+    double ns[3][2] = {{0}};
+    size_t stored[3] = {0};
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN] = {0};
+
+    memset(uniq_data, 0x11, CRYPTODB_UNIQ_DATA_MAX_LEN);
+    memset(&options, 0, sizeof(cryptodb_options_t));
+    options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+    options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+    options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+    options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+    options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+    options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+
+    fprintf(stdout, "\nKey modes, ns per operation and stored key bytes (%d keys)\n", BENCH_GET_ITERATIONS);
+    fprintf(stdout, "%10s %10s %10s %6s %10s %10s %6s %10s %10s %6s\n", "key bytes",
+            "CBC put", "CBC get", "size", "T128 put", "T128 get", "size", "T256 put", "T256 get", "size");
+
+    for (size_t k = 0; k < sizeof(key_lens) / sizeof(key_lens[0]) && ret == CRYPTODB_SUCCESS; ++k)
+    {
+        size_t keylen = key_lens[k];
+
+        memset(key, 'k', keylen);
+
+        for (int m = 0; m < 3 && ret == CRYPTODB_SUCCESS; ++m)
+        {
+            cryptodb_t cryptodb;
+            leveldb_iterator_t *it = NULL;
+            double start = 0;
+
+            memset(&cryptodb, 0, sizeof(cryptodb_t));
+            options.key_mode = modes[m];
+
+            cryptodb_destroy(BENCH_DB_FOLDER, &options);
+            ret = cryptodb_open(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+
+            // Keys differ only at the end, as ids with a common prefix do
+            start = bench_now_ns();
+            for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+            {
+                memcpy(key + keylen - sizeof(int), &i, sizeof(int));
+                ret = cryptodb_put_integer(&cryptodb, key, keylen, i);
+            }
+            ns[m][0] = (bench_now_ns() - start) / BENCH_GET_ITERATIONS;
+
+            start = bench_now_ns();
+            for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+            {
+                memcpy(key + keylen - sizeof(int), &i, sizeof(int));
+                ret = cryptodb_get(&cryptodb, key, keylen, CRYPTODB_VAL_NUM_INT, &out);
+            }
+            ns[m][1] = (bench_now_ns() - start) / BENCH_GET_ITERATIONS;
+
+            if (CRYPTODB_SUCCESS == ret)
+            {
+                it = leveldb_create_iterator(cryptodb.db, cryptodb.roptions);
+                leveldb_iter_seek_to_first(it);
+                if (leveldb_iter_valid(it))
+                    leveldb_iter_key(it, &stored[m]);
+                leveldb_iter_destroy(it);
+            }
+
+            cryptodb_close(&cryptodb);
+            cryptodb_destroy(BENCH_DB_FOLDER, &options);
+        }
+
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            fprintf(stderr, "ERROR: key modes, error = %d\n", ret);
+            break;
+        }
+
+        fprintf(stdout, "%10zu %10.1f %10.1f %6zu %10.1f %10.1f %6zu %10.1f %10.1f %6zu\n", keylen,
+                ns[0][0], ns[0][1], stored[0], ns[1][0], ns[1][1], stored[1],
+                ns[2][0], ns[2][1], stored[2]);
+    }
+
+    return ret == CRYPTODB_SUCCESS ? 0 : -1;
+}
+
+/**
+ * Loading of integers with one cryptodb_put() per entry and with one
+ * write batch. With the real LevelDB every put is a synced write.
+ */
+static int bench_batch_writes(void)
+{
+    int ret = CRYPTODB_SUCCESS;
+    cryptodb_t cryptodb;
+    cryptodb_batch_t batch;
+    cryptodb_options_t options;
+    char key[32] = {0};
+    double start = 0, ns[2] = {0};
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN] = {0};
+
+    memset(uniq_data, 0x11, CRYPTODB_UNIQ_DATA_MAX_LEN);
+    memset(&cryptodb, 0, sizeof(cryptodb_t));
+    memset(&batch, 0, sizeof(cryptodb_batch_t));
+    memset(&options, 0, sizeof(cryptodb_options_t));
+    options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+    options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+    options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+    options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+    options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+    options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+
+    cryptodb_destroy(BENCH_DB_FOLDER, &options);
+    ret = cryptodb_open(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+
+    start = bench_now_ns();
+    for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+    {
+        snprintf(key, sizeof(key), "put_%d", i);
+        ret = cryptodb_put_integer(&cryptodb, key, strlen(key) + 1, i);
+    }
+    ns[0] = (bench_now_ns() - start) / BENCH_GET_ITERATIONS;
+
+    start = bench_now_ns();
+    if (CRYPTODB_SUCCESS == ret)
+        ret = cryptodb_batch_create(&cryptodb, &batch);
+    for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+    {
+        snprintf(key, sizeof(key), "batch_%d", i);
+        ret = cryptodb_batch_put_integer(&batch, key, strlen(key) + 1, i);
+    }
+    if (CRYPTODB_SUCCESS == ret)
+        ret = cryptodb_batch_commit(&batch);
+    ns[1] = (bench_now_ns() - start) / BENCH_GET_ITERATIONS;
+
+    cryptodb_batch_destroy(&batch);
+    cryptodb_close(&cryptodb);
+    cryptodb_destroy(BENCH_DB_FOLDER, &options);
+
+    if (CRYPTODB_SUCCESS != ret)
+    {
+        fprintf(stderr, "ERROR: batch writes, error = %d\n", ret);
+        return -1;
+    }
+
+    fprintf(stdout, "\nWrites of %d integers, ns per entry\n", BENCH_GET_ITERATIONS);
+    fprintf(stdout, "%12s %12s\n", "put", "batch");
+    fprintf(stdout, "%12.1f %12.1f\n", ns[0], ns[1]);
+
+    return 0;
+}
+
+typedef struct {
+    int id;
+    int retval;
+    cryptodb_t *cryptodb;
+} bench_writer_arg_t;
+
+static void * bench_writer_func(void *ptr)
+{
+    char key[32] = {0};
+    bench_writer_arg_t *arg = (bench_writer_arg_t *)ptr;
+
+    arg->retval = CRYPTODB_SUCCESS;
+    for (int i = 0; i < BENCH_GET_ITERATIONS && arg->retval == CRYPTODB_SUCCESS; ++i)
+    {
+        snprintf(key, sizeof(key), "writer_%d_%d", arg->id, i);
+        arg->retval = cryptodb_put_integer(arg->cryptodb, key, strlen(key) + 1, i);
+    }
+
+    return NULL;
+}
+
+static int bench_durability(void)
+{
+    int ret = CRYPTODB_SUCCESS;
+    cryptodb_t cryptodb;
+    cryptodb_stats_t stats;
+    cryptodb_options_t options;
+    double start = 0, ns[CRYPTODB_DURABILITY_UNKNOWN] = {0};
+    uint64_t syncs[CRYPTODB_DURABILITY_UNKNOWN] = {0};
+    pthread_t threads[BENCH_WRITER_THREADS];
+    bench_writer_arg_t args[BENCH_WRITER_THREADS];
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN] = {0};
+    const char *names[CRYPTODB_DURABILITY_UNKNOWN] = { "sync", "group", "periodic" };
+
+    memset(uniq_data, 0x11, CRYPTODB_UNIQ_DATA_MAX_LEN);
+    memset(&cryptodb, 0, sizeof(cryptodb_t));
+    memset(&options, 0, sizeof(cryptodb_options_t));
+    options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+    options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+    options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+    options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+    options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+    options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+
+    for (int d = 0; d < CRYPTODB_DURABILITY_UNKNOWN && ret == CRYPTODB_SUCCESS; ++d)
+    {
+        options.durability = (cryptodb_durability_t)d;
+        cryptodb_destroy(BENCH_DB_FOLDER, &options);
+        ret = cryptodb_open(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS != ret)
+            break;
+
+        start = bench_now_ns();
+        for (int t = 0; t < BENCH_WRITER_THREADS; ++t)
+        {
+            args[t].id = t;
+            args[t].retval = CRYPTODB_SUCCESS;
+            args[t].cryptodb = &cryptodb;
+            if (pthread_create(&threads[t], NULL, bench_writer_func, &args[t]))
+                args[t].retval = CRYPTODB_ERR_FAIL;
+        }
+        for (int t = 0; t < BENCH_WRITER_THREADS; ++t)
+        {
+            if (args[t].retval == CRYPTODB_SUCCESS)
+                pthread_join(threads[t], NULL);
+            if (args[t].retval != CRYPTODB_SUCCESS)
+                ret = args[t].retval;
+        }
+        ns[d] = (bench_now_ns() - start) / (BENCH_WRITER_THREADS * BENCH_GET_ITERATIONS);
+
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_stats(&cryptodb, &stats);
+        syncs[d] = stats.syncs;
+
+        cryptodb_close(&cryptodb);
+        cryptodb_destroy(BENCH_DB_FOLDER, &options);
+    }
+
+    if (CRYPTODB_SUCCESS != ret)
+    {
+        fprintf(stderr, "ERROR: durability, error = %d\n", ret);
+        return -1;
+    }
+
+    fprintf(stdout, "\nPuts of %d integers by %d threads, ns per put and number of syncs\n",
+            BENCH_GET_ITERATIONS, BENCH_WRITER_THREADS);
+    fprintf(stdout, "%10s %12s %10s\n", "durability", "ns", "syncs");
+    for (int d = 0; d < CRYPTODB_DURABILITY_UNKNOWN; ++d)
+        fprintf(stdout, "%10s %12.1f %10llu\n", names[d], ns[d], (unsigned long long)syncs[d]);
+
+    return 0;
+}
+
+static int bench_async_writes(void)
+{
+    int ret = CRYPTODB_SUCCESS;
+    cryptodb_t cryptodb;
+    cryptodb_options_t options;
+    char key[32] = {0};
+    double start = 0, ns[2] = {0};
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN] = {0};
+
+    memset(uniq_data, 0x11, CRYPTODB_UNIQ_DATA_MAX_LEN);
+    memset(&cryptodb, 0, sizeof(cryptodb_t));
+    memset(&options, 0, sizeof(cryptodb_options_t));
+    options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+    options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+    options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+    options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+    options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+    options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+
+    cryptodb_destroy(BENCH_DB_FOLDER, &options);
+    ret = cryptodb_open(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+
+    start = bench_now_ns();
+    for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+    {
+        snprintf(key, sizeof(key), "put_%d", i);
+        ret = cryptodb_put_integer(&cryptodb, key, strlen(key) + 1, i);
+    }
+    ns[0] = (bench_now_ns() - start) / BENCH_GET_ITERATIONS;
+
+    // Including the flush, i.e. until every entry is written
+    start = bench_now_ns();
+    for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+    {
+        snprintf(key, sizeof(key), "async_%d", i);
+        ret = cryptodb_put_integer_async(&cryptodb, key, strlen(key) + 1, i, NULL, NULL);
+    }
+    if (CRYPTODB_SUCCESS == ret)
+        ret = cryptodb_flush(&cryptodb);
+    ns[1] = (bench_now_ns() - start) / BENCH_GET_ITERATIONS;
+
+    cryptodb_close(&cryptodb);
+    cryptodb_destroy(BENCH_DB_FOLDER, &options);
+
+    if (CRYPTODB_SUCCESS != ret)
+    {
+        fprintf(stderr, "ERROR: async writes, error = %d\n", ret);
+        return -1;
+    }
+
+    fprintf(stdout, "\nSynced puts of %d integers by one thread, ns per entry\n", BENCH_GET_ITERATIONS);
+    fprintf(stdout, "%12s %12s\n", "put", "put_async");
+    fprintf(stdout, "%12.1f %12.1f\n", ns[0], ns[1]);
+
+    return 0;
+}
+
+static int bench_multi_get(void)
+{
+    int ret = CRYPTODB_SUCCESS;
+    cryptodb_t cryptodb;
+    cryptodb_options_t options;
+    static char keys[BENCH_GET_ITERATIONS][32];
+    static cryptodb_get_item_t items[BENCH_GET_ITERATIONS];
+    const size_t sizes[] = { 64, 4 * 1024 };
+    const unsigned int threads[] = { 0, 3 };
+    char *value = NULL, *out = NULL;
+    double start = 0, ns[2][2][2] = {{{0}}};
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN] = {0};
+
+    value = (char *)malloc(4 * 1024);
+    out = (char *)malloc((size_t)BENCH_GET_ITERATIONS * 4 * 1024);
+    if (value == NULL || out == NULL)
+    {
+        free(value);
+        free(out);
+        return -1;
+    }
+    // Touch all pages before the measurements
+    memset(out, 0, (size_t)BENCH_GET_ITERATIONS * 4 * 1024);
+
+    memset(uniq_data, 0x11, CRYPTODB_UNIQ_DATA_MAX_LEN);
+    memset(&cryptodb, 0, sizeof(cryptodb_t));
+    memset(&options, 0, sizeof(cryptodb_options_t));
+    options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+    options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+    options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+    options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+    options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+    options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+
+    for (size_t z = 0; z < 2 && ret == CRYPTODB_SUCCESS; ++z)
+    {
+        for (size_t t = 0; t < 2 && ret == CRYPTODB_SUCCESS; ++t)
+        {
+            options.worker_threads = threads[t];
+            cryptodb_destroy(BENCH_DB_FOLDER, &options);
+            ret = cryptodb_open(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+
+            memset(value, 'v', sizes[z] - 1);
+            value[sizes[z] - 1] = '\0';
+            for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+            {
+                snprintf(keys[i], sizeof(keys[i]), "multi_%d", i);
+                ret = cryptodb_put_string(&cryptodb, keys[i], strlen(keys[i]) + 1, value);
+                items[i].key = keys[i];
+                items[i].keylen = strlen(keys[i]) + 1;
+                items[i].valtype = CRYPTODB_VAL_STRING;
+                items[i].val = out + (size_t)i * sizes[z];
+            }
+
+            start = bench_now_ns();
+            for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+                ret = cryptodb_get(&cryptodb, keys[i], strlen(keys[i]) + 1, CRYPTODB_VAL_STRING, items[i].val);
+            ns[z][t][0] = (bench_now_ns() - start) / BENCH_GET_ITERATIONS;
+
+            start = bench_now_ns();
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_multi_get(&cryptodb, items, BENCH_GET_ITERATIONS);
+            ns[z][t][1] = (bench_now_ns() - start) / BENCH_GET_ITERATIONS;
+            for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+                ret = items[i].result;
+
+            cryptodb_close(&cryptodb);
+            cryptodb_destroy(BENCH_DB_FOLDER, &options);
+        }
+    }
+
+    free(value);
+    free(out);
+
+    if (CRYPTODB_SUCCESS != ret)
+    {
+        fprintf(stderr, "ERROR: multi-get, error = %d\n", ret);
+        return -1;
+    }
+
+    fprintf(stdout, "\nGets of %d strings, ns per entry\n", BENCH_GET_ITERATIONS);
+    fprintf(stdout, "%8s %8s %12s %12s\n", "size", "threads", "get", "multi_get");
+    for (size_t z = 0; z < 2; ++z)
+        for (size_t t = 0; t < 2; ++t)
+            fprintf(stdout, "%8zu %8u %12.1f %12.1f\n", sizes[z], threads[t], ns[z][t][0], ns[z][t][1]);
+
+    return 0;
+}
+
+static int bench_iterator(void)
+{
+    int ret = CRYPTODB_SUCCESS;
+    cryptodb_t cryptodb;
+    cryptodb_options_t options;
+    cryptodb_iterator_t iterator;
+    cryptodb_iterator_options_t iterator_options;
+    const cryptodb_entry_t *entry = NULL;
+    const size_t sizes[] = { 64, 4 * 1024 };
+    const size_t read_ahead[] = { 0, 64 };
+    char key[32], *value = NULL;
+    int entries = 0;
+    unsigned long sum = 0;
+    double start = 0, ns[2][2] = {{0}};
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN] = {0};
+
+    value = (char *)malloc(4 * 1024);
+    if (value == NULL)
+        return -1;
+
+    memset(uniq_data, 0x11, CRYPTODB_UNIQ_DATA_MAX_LEN);
+    memset(&cryptodb, 0, sizeof(cryptodb_t));
+    memset(&options, 0, sizeof(cryptodb_options_t));
+    memset(&iterator_options, 0, sizeof(cryptodb_iterator_options_t));
+    options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+    options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+    options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+    options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+    options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+    options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+
+    for (size_t z = 0; z < 2 && ret == CRYPTODB_SUCCESS; ++z)
+    {
+        cryptodb_destroy(BENCH_DB_FOLDER, &options);
+        ret = cryptodb_open(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+
+        memset(value, 'v', sizes[z] - 1);
+        value[sizes[z] - 1] = '\0';
+        for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(key, sizeof(key), "scan_%d", i);
+            ret = cryptodb_put_string(&cryptodb, key, strlen(key) + 1, value);
+        }
+
+        for (size_t r = 0; r < 2 && ret == CRYPTODB_SUCCESS; ++r)
+        {
+            iterator_options.read_ahead = read_ahead[r];
+            ret = cryptodb_iterator_create(&cryptodb, &iterator_options, &iterator);
+            if (CRYPTODB_SUCCESS != ret)
+                break;
+
+            // The caller reads every value while the next ones are decrypted
+            entries = 0;
+            start = bench_now_ns();
+            for (cryptodb_iterator_seek_to_first(&iterator);
+                 cryptodb_iterator_valid(&iterator);
+                 cryptodb_iterator_next(&iterator), ++entries)
+            {
+                entry = cryptodb_iterator_entry(&iterator);
+                if (entry->result != CRYPTODB_SUCCESS)
+                    ret = entry->result;
+                for (size_t i = 0; i < entry->str_len; ++i)
+                    sum += (unsigned char)entry->str[i];
+            }
+            ns[z][r] = (bench_now_ns() - start) / BENCH_GET_ITERATIONS;
+            if (CRYPTODB_SUCCESS == ret && entries != BENCH_GET_ITERATIONS)
+                ret = CRYPTODB_ERR_FAIL;
+
+            cryptodb_iterator_destroy(&iterator);
+        }
+
+        cryptodb_close(&cryptodb);
+        cryptodb_destroy(BENCH_DB_FOLDER, &options);
+    }
+
+    free(value);
+
+    if (CRYPTODB_SUCCESS != ret)
+    {
+        fprintf(stderr, "ERROR: iterator, error = %d\n", ret);
+        return -1;
+    }
+
+    fprintf(stdout, "\nFull scan of %d strings (checksum %lu), ns per entry\n", BENCH_GET_ITERATIONS, sum);
+    fprintf(stdout, "%8s %12s %12s\n", "size", "read_ahead", "scan");
+    for (size_t z = 0; z < 2; ++z)
+        for (size_t r = 0; r < 2; ++r)
+            fprintf(stdout, "%8zu %12zu %12.1f\n", sizes[z], read_ahead[r], ns[z][r]);
+
+    return 0;
+}
+
+static int bench_range_scan(void)
+{
+    int ret = CRYPTODB_SUCCESS;
+    cryptodb_t cryptodb;
+    cryptodb_options_t options;
+    cryptodb_iterator_t iterator;
+    cryptodb_iterator_options_t iterator_options;
+    const cryptodb_entry_t *entry = NULL;
+    char key[32];
+    int entries[2] = {0};
+    double start = 0, ns[2] = {0};
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN] = {0};
+
+    memset(uniq_data, 0x11, CRYPTODB_UNIQ_DATA_MAX_LEN);
+    memset(&cryptodb, 0, sizeof(cryptodb_t));
+    memset(&options, 0, sizeof(cryptodb_options_t));
+    options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+    options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+    options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+    options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+    options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+    options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+    options.disable_keys_encryption = 1;
+
+    cryptodb_destroy(BENCH_DB_FOLDER, &options);
+    ret = cryptodb_open(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+
+    // 20 time buckets, the scan reads one of them
+    for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+    {
+        snprintf(key, sizeof(key), "ts_%02d_%06d", i % 20, i);
+        ret = cryptodb_put_integer(&cryptodb, key, strlen(key) + 1, i);
+    }
+
+    for (int p = 0; p < 2 && ret == CRYPTODB_SUCCESS; ++p)
+    {
+        memset(&iterator_options, 0, sizeof(cryptodb_iterator_options_t));
+        if (p)
+        {
+            iterator_options.prefix = "ts_07_";
+            iterator_options.prefix_len = strlen("ts_07_");
+        }
+        ret = cryptodb_iterator_create(&cryptodb, &iterator_options, &iterator);
+        if (CRYPTODB_SUCCESS != ret)
+            break;
+
+        start = bench_now_ns();
+        for (cryptodb_iterator_seek_to_first(&iterator);
+             cryptodb_iterator_valid(&iterator);
+             cryptodb_iterator_next(&iterator))
+        {
+            entry = cryptodb_iterator_entry(&iterator);
+            if (entry->result != CRYPTODB_SUCCESS)
+                ret = entry->result;
+            else if (!strncmp(entry->key, "ts_07_", strlen("ts_07_")))
+                ++entries[p];
+        }
+        ns[p] = bench_now_ns() - start;
+
+        cryptodb_iterator_destroy(&iterator);
+    }
+
+    cryptodb_close(&cryptodb);
+    cryptodb_destroy(BENCH_DB_FOLDER, &options);
+
+    if (CRYPTODB_SUCCESS == ret && entries[0] != entries[1])
+        ret = CRYPTODB_ERR_FAIL;
+    if (CRYPTODB_SUCCESS != ret)
+    {
+        fprintf(stderr, "ERROR: range scan, error = %d\n", ret);
+        return -1;
+    }
+
+    fprintf(stdout, "\nScan of one of 20 buckets of %d entries, us\n", BENCH_GET_ITERATIONS);
+    fprintf(stdout, "%12s %12s\n", "full scan", "prefix scan");
+    fprintf(stdout, "%12.1f %12.1f\n", ns[0] / 1000, ns[1] / 1000);
+
+    return 0;
+}
+
+static int bench_bloom_filter(void)
+{
+    int ret = CRYPTODB_SUCCESS, value = 0;
+    cryptodb_t cryptodb;
+    cryptodb_options_t options;
+    cryptodb_stats_t stats[2];
+    char key[32];
+    const int bits[2] = { 0, 10 };
+    double start = 0, ns[2] = {0};
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN] = {0};
+
+    memset(uniq_data, 0x11, CRYPTODB_UNIQ_DATA_MAX_LEN);
+    memset(stats, 0, sizeof(stats));
+
+    for (int b = 0; b < 2 && ret == CRYPTODB_SUCCESS; ++b)
+    {
+        memset(&cryptodb, 0, sizeof(cryptodb_t));
+        memset(&options, 0, sizeof(cryptodb_options_t));
+        options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+        options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+        options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+        options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+        options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+        options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+        options.bloom_bits_per_key = bits[b];
+
+        cryptodb_destroy(BENCH_DB_FOLDER, &options);
+        ret = cryptodb_open(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(key, sizeof(key), "device_%d", i);
+            ret = cryptodb_put_integer(&cryptodb, key, strlen(key) + 1, i);
+        }
+        if (CRYPTODB_SUCCESS == ret)
+            leveldb_compact_range(cryptodb.db, NULL, 0, NULL, 0);
+
+        // "Does the device exist" lookups of missing devices
+        start = bench_now_ns();
+        for (int i = BENCH_GET_ITERATIONS; i < 2 * BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(key, sizeof(key), "device_%d", i);
+            if (CRYPTODB_ERR_FAIL != cryptodb_get(&cryptodb, key, strlen(key) + 1, CRYPTODB_VAL_NUM_INT, &value))
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        ns[b] = (bench_now_ns() - start) / BENCH_GET_ITERATIONS;
+
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_stats(&cryptodb, &stats[b]);
+
+        cryptodb_close(&cryptodb);
+        cryptodb_destroy(BENCH_DB_FOLDER, &options);
+    }
+
+    if (CRYPTODB_SUCCESS != ret)
+    {
+        fprintf(stderr, "ERROR: bloom filter, error = %d\n", ret);
+        return -1;
+    }
+
+    fprintf(stdout, "\nLookups of %d missing keys, ns per lookup and reads avoided by the filter\n",
+            BENCH_GET_ITERATIONS);
+    fprintf(stdout, "%14s %12s %14s\n", "bits per key", "ns", "avoided reads");
+    for (int b = 0; b < 2; ++b)
+        fprintf(stdout, "%14d %12.1f %14llu\n", bits[b], ns[b],
+                (unsigned long long)stats[b].filter_avoided_reads);
+
+    return 0;
+}
+
+static int bench_compression(void)
+{
+    int ret = CRYPTODB_SUCCESS;
+    cryptodb_t cryptodb;
+    cryptodb_options_t options;
+    char *text = NULL, *out = NULL, *raw = NULL, *err = NULL;
+    size_t text_len = 0, raw_len[2] = {0};
+    double start = 0, ns[2][2] = {{0}};
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN] = {0};
+
+    memset(uniq_data, 0x11, CRYPTODB_UNIQ_DATA_MAX_LEN);
+
+    text = (char *)calloc(4096, sizeof(char));
+    out = (char *)calloc(4096, sizeof(char));
+    if (text == NULL || out == NULL)
+    {
+        free(text);
+        free(out);
+        return -1;
+    }
+    while (text_len < 4000)
+        text_len += snprintf(text + text_len, 4096 - text_len,
+                             "{\"device\":\"sensor-%04d\",\"temp\":%d.5,\"online\":true},",
+                             (int)(text_len % 97), (int)(text_len % 31));
+
+    for (int c = 0; c < 2 && ret == CRYPTODB_SUCCESS; ++c)
+    {
+        memset(&cryptodb, 0, sizeof(cryptodb_t));
+        memset(&options, 0, sizeof(cryptodb_options_t));
+        options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+        options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+        options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+        options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+        options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+        options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+        options.disable_keys_encryption = 1;
+        options.durability = CRYPTODB_DURABILITY_PERIODIC;
+        options.compression = c ? CRYPTODB_COMPRESSION_LZ4 : CRYPTODB_COMPRESSION_NONE;
+
+        cryptodb_destroy(BENCH_DB_FOLDER, &options);
+        ret = cryptodb_open(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+
+        start = bench_now_ns();
+        for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+            ret = cryptodb_put_string(&cryptodb, "json", 5, text);
+        ns[c][0] = (bench_now_ns() - start) / BENCH_GET_ITERATIONS;
+
+        start = bench_now_ns();
+        for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+            ret = cryptodb_get(&cryptodb, "json", 5, CRYPTODB_VAL_STRING, out);
+        ns[c][1] = (bench_now_ns() - start) / BENCH_GET_ITERATIONS;
+
+        if (CRYPTODB_SUCCESS == ret && strcmp(out, text))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            raw = leveldb_get(cryptodb.db, cryptodb.roptions, "json", 5, &raw_len[c], &err);
+            if (raw)
+                leveldb_free(raw);
+            if (err)
+                leveldb_free(err);
+        }
+
+        cryptodb_close(&cryptodb);
+        cryptodb_destroy(BENCH_DB_FOLDER, &options);
+    }
+
+    free(text);
+    free(out);
+
+    if (CRYPTODB_SUCCESS != ret)
+    {
+        fprintf(stderr, "ERROR: compression, error = %d\n", ret);
+        return -1;
+    }
+
+    fprintf(stdout, "\n%zu bytes JSON-like string, ns per operation and stored bytes\n", text_len);
+    fprintf(stdout, "%12s %12s %12s %12s\n", "compression", "put", "get", "stored");
+    fprintf(stdout, "%12s %12.1f %12.1f %12zu\n", "none", ns[0][0], ns[0][1], raw_len[0]);
+    fprintf(stdout, "%12s %12.1f %12.1f %12zu\n", "lz4", ns[1][0], ns[1][1], raw_len[1]);
+
+    return 0;
+}
+
+/**
+ * Comparator of the databases created by older versions, it's called
+ * through the LevelDB C API
+ */
+static void bench_legacy_comparator_destroy(void *arg)
+{
+    (void)arg;
+}
+
+static int bench_legacy_comparator_compare(void *arg,
+                                           const char *a, size_t alen,
+                                           const char *b, size_t blen)
+{
+    int r = memcmp(a, b, alen < blen ? alen : blen);
+
+    (void)arg;
+    if (r == 0)
+        r = (alen < blen) ? -1 : (alen > blen);
+    return r;
+}
+
+static const char * bench_legacy_comparator_name(void *arg)
+{
+    (void)arg;
+    return "cryptodb_comparator";
+}
+
+static int bench_comparator(void)
+{
+    int ret = CRYPTODB_SUCCESS, value = 0;
+    cryptodb_t cryptodb;
+    cryptodb_options_t options;
+    cryptodb_batch_t batch;
+    char key[32];
+    double start = 0, compact_ms[2] = {0}, get_ns[2] = {0};
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN] = {0};
+
+    memset(uniq_data, 0x11, CRYPTODB_UNIQ_DATA_MAX_LEN);
+
+    for (int m = 0; m < 2 && ret == CRYPTODB_SUCCESS; ++m)
+    {
+        memset(&cryptodb, 0, sizeof(cryptodb_t));
+        memset(&options, 0, sizeof(cryptodb_options_t));
+        options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+        options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+        options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+        options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+        options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+        options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+
+        cryptodb_destroy(BENCH_DB_FOLDER, &options);
+        if (m == 0)
+        {
+            char *err = NULL;
+            leveldb_t *db = NULL;
+            leveldb_options_t *dboptions = leveldb_options_create();
+            leveldb_comparator_t *cmp = leveldb_comparator_create(NULL,
+                                                                  bench_legacy_comparator_destroy,
+                                                                  bench_legacy_comparator_compare,
+                                                                  bench_legacy_comparator_name);
+
+            leveldb_options_set_create_if_missing(dboptions, 1);
+            leveldb_options_set_comparator(dboptions, cmp);
+            db = leveldb_open(dboptions, BENCH_DB_FOLDER, &err);
+            if (db == NULL || err)
+                ret = CRYPTODB_ERR_FAIL;
+            if (db)
+                leveldb_close(db);
+            if (err)
+                leveldb_free(err);
+            leveldb_comparator_destroy(cmp);
+            leveldb_options_destroy(dboptions);
+        }
+
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_open(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_batch_create(&cryptodb, &batch);
+        for (int i = 0; i < BENCH_DB_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(key, sizeof(key), "device_%d", i);
+            ret = cryptodb_batch_put_integer(&batch, key, strlen(key) + 1, i);
+        }
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_batch_commit(&batch);
+        cryptodb_batch_destroy(&batch);
+
+        start = bench_cpu_ns();
+        if (CRYPTODB_SUCCESS == ret)
+            leveldb_compact_range(cryptodb.db, NULL, 0, NULL, 0);
+        compact_ms[m] = (bench_cpu_ns() - start) / 1e6;
+
+        start = bench_cpu_ns();
+        for (int i = 0; i < BENCH_DB_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(key, sizeof(key), "device_%d", i);
+            ret = cryptodb_get(&cryptodb, key, strlen(key) + 1, CRYPTODB_VAL_NUM_INT, &value);
+            if (CRYPTODB_SUCCESS == ret && value != i)
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        get_ns[m] = (bench_cpu_ns() - start) / BENCH_DB_ITERATIONS;
+
+        cryptodb_close(&cryptodb);
+        cryptodb_destroy(BENCH_DB_FOLDER, &options);
+    }
+
+    if (CRYPTODB_SUCCESS != ret)
+    {
+        fprintf(stderr, "ERROR: comparator, error = %d\n", ret);
+        return -1;
+    }
+
+    fprintf(stdout, "\n%d entries, CPU time of the full compaction and of one lookup\n",
+            BENCH_DB_ITERATIONS);
+    fprintf(stdout, "%12s %14s %12s\n", "comparator", "compaction ms", "lookup ns");
+    fprintf(stdout, "%12s %14.2f %12.1f\n", "callback", compact_ms[0], get_ns[0]);
+    fprintf(stdout, "%12s %14.2f %12.1f\n", "built-in", compact_ms[1], get_ns[1]);
+
+    return 0;
+}
+
+#define BENCH_BULK_ENTRIES (100000)
+
+static int bench_bulk_load(void)
+{
+    int ret = CRYPTODB_SUCCESS;
+    cryptodb_t cryptodb;
+    cryptodb_bulk_t bulk;
+    cryptodb_batch_t batch;
+    cryptodb_options_t options;
+    char key[32];
+    const char *modes[3] = { "batches", "bulk", "bulk+3 workers" };
+    double start = 0, ms[3] = {0};
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN] = {0};
+
+    memset(uniq_data, 0x11, CRYPTODB_UNIQ_DATA_MAX_LEN);
+
+    for (int m = 0; m < 3 && ret == CRYPTODB_SUCCESS; ++m)
+    {
+        memset(&cryptodb, 0, sizeof(cryptodb_t));
+        memset(&options, 0, sizeof(cryptodb_options_t));
+        options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+        options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+        options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+        options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+        options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+        options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+        options.worker_threads = (m == 2) ? 3 : 0;
+
+        cryptodb_destroy(BENCH_DB_FOLDER, &options);
+        start = bench_now_ns();
+        if (m == 0)
+        {
+            // Synced batches of 1000 entries
+            ret = cryptodb_open(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_batch_create(&cryptodb, &batch);
+            for (int i = 0; i < BENCH_BULK_ENTRIES && ret == CRYPTODB_SUCCESS; ++i)
+            {
+                snprintf(key, sizeof(key), "device_%d", i);
+                ret = cryptodb_batch_put_integer(&batch, key, strlen(key) + 1, i);
+                if (CRYPTODB_SUCCESS == ret && (i % 1000 == 999 || i == BENCH_BULK_ENTRIES - 1))
+                    ret = cryptodb_batch_commit(&batch);
+            }
+            cryptodb_batch_destroy(&batch);
+            if (CRYPTODB_SUCCESS == ret)
+                leveldb_compact_range(cryptodb.db, NULL, 0, NULL, 0);
+            cryptodb_close(&cryptodb);
+        }
+        else
+        {
+            ret = cryptodb_bulk_begin(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &bulk);
+            for (int i = 0; i < BENCH_BULK_ENTRIES && ret == CRYPTODB_SUCCESS; ++i)
+            {
+                snprintf(key, sizeof(key), "device_%d", i);
+                ret = cryptodb_bulk_put_integer(&bulk, key, strlen(key) + 1, i);
+            }
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_bulk_commit(&bulk);
+            else
+                cryptodb_bulk_abort(&bulk);
+        }
+        ms[m] = (bench_now_ns() - start) / 1e6;
+
+        cryptodb_destroy(BENCH_DB_FOLDER, &options);
+    }
+
+    if (CRYPTODB_SUCCESS != ret)
+    {
+        fprintf(stderr, "ERROR: bulk load, error = %d\n", ret);
+        return -1;
+    }
+
+    fprintf(stdout, "\nLoad of %d entries including the final compaction, ms\n", BENCH_BULK_ENTRIES);
+    fprintf(stdout, "%16s %12s\n", "mode", "ms");
+    for (int m = 0; m < 3; ++m)
+        fprintf(stdout, "%16s %12.1f\n", modes[m], ms[m]);
+
+    return 0;
+}
+
+/**
+ * String gets of the C++ GetString() before cryptodb_get_buf() allocated
+ * a buffer of the guessed length for every get
+ */
+static int bench_get_buf(void)
+{
+    int ret = CRYPTODB_SUCCESS;
+    cryptodb_t cryptodb;
+    cryptodb_options_t options;
+    char *value = NULL, *buf = NULL, *guess = NULL;
+    size_t sizes[3] = { 16, 256, 4000 }, len = 0;
+    double start = 0, ns[3][2] = {{0}};
+    uint8_t uniq_data[CRYPTODB_UNIQ_DATA_MAX_LEN] = {0};
+
+    memset(uniq_data, 0x11, CRYPTODB_UNIQ_DATA_MAX_LEN);
+    memset(&cryptodb, 0, sizeof(cryptodb_t));
+    memset(&options, 0, sizeof(cryptodb_options_t));
+    options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+    options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+    options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+    options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+    options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+    options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+
+    value = (char *)calloc(BENCH_GET_BUF_GUESS, sizeof(char));
+    if (value == NULL)
+        return -1;
+
+    cryptodb_destroy(BENCH_DB_FOLDER, &options);
+    ret = cryptodb_open(BENCH_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+
+    for (int s = 0; s < 3 && ret == CRYPTODB_SUCCESS; ++s)
+    {
+        memset(value, 'v', sizes[s] - 1);
+        value[sizes[s] - 1] = '\0';
+        ret = cryptodb_put_string(&cryptodb, "string", 7, value);
+
+        start = bench_now_ns();
+        for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            guess = (char *)calloc(BENCH_GET_BUF_GUESS, sizeof(char));
+            if (guess == NULL)
+                ret = CRYPTODB_ERR_ALLOCATE_MEM;
+            else
+                ret = cryptodb_get(&cryptodb, "string", 7, CRYPTODB_VAL_STRING, guess);
+            free(guess);
+        }
+        ns[s][0] = (bench_now_ns() - start) / BENCH_GET_ITERATIONS;
+
+        // The buffer starts empty and is grown once
+        len = 0;
+        start = bench_now_ns();
+        for (int i = 0; i < BENCH_GET_ITERATIONS && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            ret = cryptodb_get_buf(&cryptodb, "string", 7, buf, buf ? len : 0, &len, NULL);
+            if (CRYPTODB_ERR_BUFFER_TOO_SMALL == ret)
+            {
+                free(buf);
+                buf = (char *)malloc(len);
+                ret = buf ? cryptodb_get_buf(&cryptodb, "string", 7, buf, len, &len, NULL) :
+                            CRYPTODB_ERR_ALLOCATE_MEM;
+            }
+        }
+        ns[s][1] = (bench_now_ns() - start) / BENCH_GET_ITERATIONS;
+
+        if (CRYPTODB_SUCCESS == ret && strcmp(buf, value))
+            ret = CRYPTODB_ERR_FAIL;
+        free(buf);
+        buf = NULL;
+    }
+
+    cryptodb_close(&cryptodb);
+    cryptodb_destroy(BENCH_DB_FOLDER, &options);
+    free(value);
+
+    if (CRYPTODB_SUCCESS != ret)
+    {
+        fprintf(stderr, "ERROR: get_buf, error = %d\n", ret);
+        return -1;
+    }
+
+    fprintf(stdout, "\nString gets, ns per operation\n");
+    fprintf(stdout, "%8s %20s %20s\n", "bytes", "4 KiB guess buffer", "cryptodb_get_buf()");
+    for (int s = 0; s < 3; ++s)
+        fprintf(stdout, "%8zu %20.1f %20.1f\n", sizes[s], ns[s][0], ns[s][1]);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    fprintf(stdout, "AES backend: %s\n\n", cryptodb_aes_backend_to_str(cryptodb_aes_backend()));
+
+    bench_aes_key_schedule();
+
+    if (bench_db_ops())
+        return -1;
+
+    if (bench_get_strings())
+        return -1;
+
+    if (bench_parallel_decrypt())
+        return -1;
+
+    if (bench_value_ciphers())
+        return -1;
+
+    if (bench_key_modes())
+        return -1;
+
+    if (bench_batch_writes())
+        return -1;
+
+    if (bench_durability())
+        return -1;
+
+    if (bench_async_writes())
+        return -1;
+
+    if (bench_multi_get())
+        return -1;
+
+    if (bench_iterator())
+        return -1;
+
+    if (bench_range_scan())
+        return -1;
+
+    if (bench_bloom_filter())
+        return -1;
+
+    if (bench_compression())
+        return -1;
+
+    if (bench_comparator())
+        return -1;
+
+    if (bench_bulk_load())
+        return -1;
+
+    if (bench_get_buf())
+        return -1;
+
+    return 0;
+}
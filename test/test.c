@@ -29,11 +29,28 @@
 #include <stdbool.h>
 #include <pthread.h>
 
+#include <leveldb/c.h>
+
 #include "cryptodb.h"
 
 #define TEST_DB_FOLDER "db"
 #define TEST_THREADS_COUNT (4)
 
+// Legacy JSON records encrypted with zero key and IV
+static const uint8_t LEGACY_RECORD_INT[] = { // {"type":"int","val":42}
+    0x0f, 0x5c, 0x36, 0x02, 0xa0, 0x30, 0xab, 0xfc, 0xa1, 0xcb, 0xa2, 0x2b, 0x48, 0xde, 0x8e, 0x59,
+    0xd2, 0x68, 0x8b, 0xae, 0x20, 0xc6, 0x3b, 0xe4, 0xbc, 0x0b, 0xc3, 0xc9, 0x63, 0x96, 0x0f, 0xc7
+};
+static const uint8_t LEGACY_RECORD_DOUBLE[] = { // {"type":"double","val":3.5}
+    0x10, 0x12, 0x3f, 0xbc, 0xb8, 0xbc, 0x19, 0x33, 0xe6, 0x3b, 0xe5, 0x21, 0x0d, 0xcb, 0x40, 0x9f,
+    0x6f, 0xa7, 0xb0, 0xec, 0x02, 0xce, 0x4e, 0x62, 0x2b, 0x2a, 0x8a, 0x45, 0x27, 0x90, 0x32, 0xa7
+};
+static const uint8_t LEGACY_RECORD_STRING[] = { // {"type":"string","val":"legacy value"}
+    0x59, 0xe8, 0x5f, 0xd6, 0x69, 0xd2, 0x08, 0x2c, 0xbd, 0xbf, 0x4a, 0x4c, 0x60, 0x50, 0x3c, 0x0c,
+    0xb1, 0x41, 0x54, 0xe1, 0xc4, 0x68, 0xd8, 0x32, 0x25, 0x83, 0x73, 0x1d, 0x1d, 0x23, 0x69, 0x58,
+    0x6a, 0x28, 0x44, 0x9e, 0xc0, 0xb9, 0x4a, 0x2c, 0x2b, 0x6a, 0xba, 0x62, 0xd8, 0xb4, 0x96, 0x5a
+};
+
 typedef struct
 {
     int id;
@@ -57,6 +74,36 @@ static int custom_user_kdf(void *cryptodb,
     return CRYPTODB_SUCCESS;
 }
 
+typedef struct
+{
+    uint64_t epoch;
+    uint8_t key_byte;
+    int kdf_calls;
+    bool fail_decrypt;
+} test_kdf_epoch_data_t;
+
+static int epoch_user_kdf(void *cryptodb,
+                          bool encrypt_decrypt,
+                          uint8_t encryption_key[32],
+                          uint8_t encryption_iv[16],
+                          void *user_data)
+{
+    test_kdf_epoch_data_t *data = (test_kdf_epoch_data_t *)user_data;
+    (void)cryptodb;
+    data->kdf_calls++;
+    if (!encrypt_decrypt && data->fail_decrypt)
+        return CRYPTODB_ERR_FAIL;
+    memset(encryption_iv, data->key_byte, 16);
+    memset(encryption_key, data->key_byte, 32);
+    return CRYPTODB_SUCCESS;
+}
+
+static uint64_t epoch_user_kdf_epoch(void *cryptodb, void *user_data)
+{
+    (void)cryptodb;
+    return ((test_kdf_epoch_data_t *)user_data)->epoch;
+}
+
 static bool compare_double(double a, double b)
 {
     double maxVal = fabs(a) > fabs(b) ? fabs(a) : fabs(b);
@@ -126,6 +173,83 @@ static void * _test_thread_func(void *ptr)
     return NULL;
 }
 
+static void * _test_durability_thread_func(void *ptr)
+{
+    char key[32] = "";
+    test_thread_arg_t *args = (test_thread_arg_t *)ptr;
+
+    args->retval = CRYPTODB_SUCCESS;
+
+    for (int i = 0; i < 50 && args->retval == CRYPTODB_SUCCESS; ++i)
+    {
+        snprintf(key, sizeof(key), "durable_%d_%d", args->id, i);
+        args->retval = cryptodb_put_integer(args->cryptodb, key, strlen(key) + 1, i);
+    }
+    if (args->retval != CRYPTODB_SUCCESS)
+        fprintf(stderr, "Thread #%d: ERROR: cryptodb_put_integer(), error = %d\n", args->id,
+                                                                                   args->retval);
+
+    return NULL;
+}
+
+static void _test_async_cb(cryptodb_t *cryptodb, int result, void *user_data)
+{
+    int *completed = (int *)user_data;
+
+    // Callbacks are called by the writer thread only, in the queue order
+    if (cryptodb && result == CRYPTODB_SUCCESS)
+        ++completed[0];
+    else
+        ++completed[1];
+}
+
+static void * _test_multi_get_writer_func(void *ptr)
+{
+    cryptodb_batch_t batch;
+    char key[32] = "";
+    test_thread_arg_t *args = (test_thread_arg_t *)ptr;
+
+    // Every batch writes the same version to all keys
+    args->retval = cryptodb_batch_create(args->cryptodb, &batch);
+    for (int version = 1; version <= 200 && args->retval == CRYPTODB_SUCCESS; ++version)
+    {
+        for (int i = 0; i < 64 && args->retval == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(key, sizeof(key), "version_%d", i);
+            args->retval = cryptodb_batch_put_integer(&batch, key, strlen(key) + 1, version);
+        }
+        if (args->retval == CRYPTODB_SUCCESS)
+            args->retval = cryptodb_batch_commit(&batch);
+    }
+    cryptodb_batch_destroy(&batch);
+
+    return NULL;
+}
+
+// Comparator of the databases created by older versions of the library
+static void _test_legacy_comparator_destroy(void *arg)
+{
+    (void)arg;
+}
+
+static int _test_legacy_comparator_compare(void *arg,
+                                           const char *a, size_t alen,
+                                           const char *b, size_t blen)
+{
+    int r = memcmp(a, b, alen < blen ? alen : blen);
+
+    (void)arg;
+    if (r == 0)
+        r = (alen < blen) ? -1 : (alen > blen);
+    return r;
+}
+
+static const char * _test_legacy_comparator_name(void *arg)
+{
+    (void)arg;
+    return "cryptodb_comparator";
+}
+
 int main(int argc, char **argv)
 {
     int ret = 0;
@@ -247,6 +371,28 @@ In the cedar-limbs.";
         fprintf(stderr, "ERROR: cryptodb_val_to_str()\n");
         return -1;
     }
+    if (strcmp(cryptodb_aes_backend_to_str(CRYPTODB_AES_BACKEND_PORTABLE), "Portable (mbedcrypto)") ||
+        strcmp(cryptodb_aes_backend_to_str(CRYPTODB_AES_BACKEND_AESNI), "x86 AES-NI") ||
+        strcmp(cryptodb_aes_backend_to_str(CRYPTODB_AES_BACKEND_ARMV8_CE), "ARMv8 Crypto Extensions") ||
+        strcmp(cryptodb_aes_backend_to_str(CRYPTODB_AES_BACKEND_UNKNOWN), "Unknown AES backend"))
+    {
+        fprintf(stderr, "ERROR: cryptodb_aes_backend_to_str()\n");
+        return -1;
+    }
+
+    /**
+     * AES backend test: selected backend must be bit-identical to mbedcrypto
+     */
+
+    if (cryptodb_aes_backend() >= CRYPTODB_AES_BACKEND_UNKNOWN ||
+        (cryptodb_aes_backend() != CRYPTODB_AES_BACKEND_PORTABLE &&
+         !(cryptodb_cpu_features() & CRYPTODB_CPU_AES)) ||
+        cryptodb_aes_self_test() != CRYPTODB_SUCCESS)
+    {
+        fprintf(stderr, "ERROR: cryptodb_aes_self_test()\n");
+        return -1;
+    }
+    fprintf(stdout, "AES backend: %s\n", cryptodb_aes_backend_to_str(cryptodb_aes_backend()));
     if (cryptodb_open(NULL, NULL, 0, NULL, NULL, NULL, NULL) != CRYPTODB_ERR_NULL_POINTER ||
         cryptodb_open(TEST_DB_FOLDER, NULL, 0, NULL, NULL, NULL, NULL) != CRYPTODB_ERR_NULL_POINTER ||
         cryptodb_open(TEST_DB_FOLDER, NULL, 0, NULL, NULL, NULL, &cryptodb) != CRYPTODB_ERR_NULL_POINTER ||
@@ -256,8 +402,9 @@ In the cedar-limbs.";
         fprintf(stderr, "ERROR: cryptodb_open()\n");
         return -1;
     }
-    if (!cryptodb.db || !cryptodb.env || !cryptodb.cmp || !cryptodb.cache ||
-        !cryptodb.options || !cryptodb.roptions || !cryptodb.woptions ||
+    if (!cryptodb.db || !cryptodb.env || cryptodb.cmp || !cryptodb.cache ||
+        !cryptodb.options || !cryptodb.roptions || !cryptodb.woptions || !cryptodb.keystore ||
+        !cryptodb.stats ||
         memcmp(cryptodb.uniq_data, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN) ||
         cryptodb.uniq_data_len != CRYPTODB_UNIQ_DATA_MAX_LEN ||
         (dirdb = opendir(TEST_DB_FOLDER)) == NULL)
@@ -272,7 +419,8 @@ In the cedar-limbs.";
 
     cryptodb_close(&cryptodb);
     if (cryptodb.db || cryptodb.env || cryptodb.cmp || cryptodb.cache ||
-        cryptodb.options || cryptodb.roptions || cryptodb.woptions ||
+        cryptodb.options || cryptodb.roptions || cryptodb.woptions || cryptodb.keystore ||
+        cryptodb.stats ||
         cryptodb.uniq_data_len != 0)
     {
         fprintf(stderr, "ERROR: cryptodb_close()\n");
@@ -595,6 +743,106 @@ In the cedar-limbs.";
         return -1;
     }
 
+    /**
+     * User KDF with epoch test: keys are derived once and re-derived
+     * only when epoch is changed
+     */
+
+    test_kdf_epoch_data_t kdf_epoch_data = {0};
+    memset(&kdf_epoch_data, 0, sizeof(test_kdf_epoch_data_t));
+    kdf_epoch_data.key_byte = 0xAA;
+
+    memset(&options, 0, sizeof(cryptodb_options_t));
+
+    options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+    options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+    options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+    options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+    options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+    options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+
+    options.kdf_epoch = epoch_user_kdf_epoch;
+
+    ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, epoch_user_kdf, &kdf_epoch_data, &cryptodb);
+    if (CRYPTODB_SUCCESS != ret || kdf_epoch_data.kdf_calls != 2)
+    {
+        fprintf(stderr, "ERROR: cryptodb_open() kdf_epoch\n");
+        return -1;
+    }
+
+    if (cryptodb_put_integer(&cryptodb, "test_key", strlen("test_key") + 1, 42) != CRYPTODB_SUCCESS ||
+        cryptodb_get(&cryptodb, "test_key", strlen("test_key") + 1, CRYPTODB_VAL_NUM_INT, &out_val_int) != CRYPTODB_SUCCESS ||
+        out_val_int != 42 || kdf_epoch_data.kdf_calls != 2)
+    {
+        cryptodb_close(&cryptodb);
+        fprintf(stderr, "ERROR: cryptodb_get() kdf_epoch\n");
+        return -1;
+    }
+
+    // Rotate the key, old entry must not be readable anymore
+    kdf_epoch_data.epoch++;
+    kdf_epoch_data.key_byte = 0x55;
+    out_val_int = 0;
+
+    if (cryptodb_get(&cryptodb, "test_key", strlen("test_key") + 1, CRYPTODB_VAL_NUM_INT, &out_val_int) == CRYPTODB_SUCCESS ||
+        out_val_int == 42 || kdf_epoch_data.kdf_calls != 4)
+    {
+        cryptodb_close(&cryptodb);
+        fprintf(stderr, "ERROR: cryptodb_get() kdf_epoch rotation\n");
+        return -1;
+    }
+
+    // Rotate back
+    kdf_epoch_data.epoch++;
+    kdf_epoch_data.key_byte = 0xAA;
+
+    if (cryptodb_get(&cryptodb, "test_key", strlen("test_key") + 1, CRYPTODB_VAL_NUM_INT, &out_val_int) != CRYPTODB_SUCCESS ||
+        out_val_int != 42 || kdf_epoch_data.kdf_calls != 6 ||
+        cryptodb_delete(&cryptodb, "test_key", strlen("test_key") + 1) != CRYPTODB_SUCCESS)
+    {
+        cryptodb_close(&cryptodb);
+        fprintf(stderr, "ERROR: cryptodb_get() kdf_epoch rotation back\n");
+        return -1;
+    }
+
+    // Failed re-derivation must keep both current keys
+    kdf_epoch_data.epoch++;
+    kdf_epoch_data.key_byte = 0x55;
+    kdf_epoch_data.fail_decrypt = true;
+
+    if (cryptodb_put_integer(&cryptodb, "test_key", strlen("test_key") + 1, 43) == CRYPTODB_SUCCESS ||
+        kdf_epoch_data.kdf_calls != 8)
+    {
+        cryptodb_close(&cryptodb);
+        fprintf(stderr, "ERROR: cryptodb_put() kdf_epoch failed rotation\n");
+        return -1;
+    }
+
+    kdf_epoch_data.epoch--;
+    kdf_epoch_data.fail_decrypt = false;
+    out_val_int = 0;
+
+    if (cryptodb_put_integer(&cryptodb, "test_key", strlen("test_key") + 1, 43) != CRYPTODB_SUCCESS ||
+        cryptodb_get(&cryptodb, "test_key", strlen("test_key") + 1, CRYPTODB_VAL_NUM_INT, &out_val_int) != CRYPTODB_SUCCESS ||
+        out_val_int != 43 || kdf_epoch_data.kdf_calls != 8 ||
+        cryptodb_delete(&cryptodb, "test_key", strlen("test_key") + 1) != CRYPTODB_SUCCESS)
+    {
+        cryptodb_close(&cryptodb);
+        fprintf(stderr, "ERROR: cryptodb_get() kdf_epoch after failed rotation\n");
+        return -1;
+    }
+
+    cryptodb_close(&cryptodb);
+
+    if (cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS ||
+        (dirdb = opendir(TEST_DB_FOLDER)) != NULL)
+    {
+        if (dirdb)
+            (void)closedir(dirdb);
+        fprintf(stderr, "ERROR: cryptodb_destroy() kdf_epoch\n");
+        return -1;
+    }
+
     /**
      * Options test with disabled keys encryption
      */
@@ -652,6 +900,2436 @@ In the cedar-limbs.";
         return -1;
     }
 
+    /**
+     * Record format test: new records are binary, legacy JSON records are still readable
+     */
+
+    {
+        char *err = NULL, *raw = NULL;
+        size_t raw_len = 0;
+        uint8_t zero_key[32] = {0}, zero_iv[16] = {0};
+
+        ret = cryptodb_open_with_keys(TEST_DB_FOLDER, zero_key, zero_iv, &options, &cryptodb);
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            fprintf(stderr, "ERROR: cryptodb_open() record format\n");
+            return -1;
+        }
+
+        // 7 bytes record fits one AES block, JSON took two
+        ret = cryptodb_put_integer(&cryptodb, "int", strlen("int") + 1, -42);
+        if (CRYPTODB_SUCCESS == ret)
+            raw = leveldb_get(cryptodb.db, cryptodb.roptions, "int", strlen("int") + 1, &raw_len, &err);
+        if (CRYPTODB_SUCCESS != ret || raw == NULL || err || raw_len != 16 ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "int", strlen("int") + 1, CRYPTODB_VAL_NUM_INT, &out_val_int) ||
+            out_val_int != -42)
+        {
+            if (raw)
+                leveldb_free(raw);
+            if (err)
+                leveldb_free(err);
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_put() record format\n");
+            return -1;
+        }
+        leveldb_free(raw);
+
+        ret = cryptodb_put_string(&cryptodb, "empty", strlen("empty") + 1, "");
+        if (CRYPTODB_SUCCESS != ret ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "empty", strlen("empty") + 1, CRYPTODB_VAL_STRING, out_val) ||
+            strcmp(out_val, "") ||
+            CRYPTODB_VAL_STRING != cryptodb_get(&cryptodb, "empty", strlen("empty") + 1, CRYPTODB_VAL_NUM_INT, &out_val_int))
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_get() record format\n");
+            return -1;
+        }
+
+        leveldb_put(cryptodb.db, cryptodb.woptions, "legacy_int", strlen("legacy_int") + 1,
+                    (const char *)LEGACY_RECORD_INT, sizeof(LEGACY_RECORD_INT), &err);
+        leveldb_put(cryptodb.db, cryptodb.woptions, "legacy_double", strlen("legacy_double") + 1,
+                    (const char *)LEGACY_RECORD_DOUBLE, sizeof(LEGACY_RECORD_DOUBLE), &err);
+        leveldb_put(cryptodb.db, cryptodb.woptions, "legacy_string", strlen("legacy_string") + 1,
+                    (const char *)LEGACY_RECORD_STRING, sizeof(LEGACY_RECORD_STRING), &err);
+        if (err ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "legacy_int", strlen("legacy_int") + 1, CRYPTODB_VAL_NUM_INT, &out_val_int) ||
+            out_val_int != 42 ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "legacy_double", strlen("legacy_double") + 1, CRYPTODB_VAL_NUM_DOUBLE, &out_val_double) ||
+            !compare_double(out_val_double, 3.5) ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "legacy_string", strlen("legacy_string") + 1, CRYPTODB_VAL_STRING, out_val) ||
+            strcmp(out_val, "legacy value") ||
+            CRYPTODB_VAL_STRING != cryptodb_get(&cryptodb, "legacy_string", strlen("legacy_string") + 1, CRYPTODB_VAL_NUM_DOUBLE, &out_val_double))
+        {
+            if (err)
+                leveldb_free(err);
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_get() legacy record format\n");
+            return -1;
+        }
+
+        cryptodb_close(&cryptodb);
+
+        if (cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: cryptodb_destroy() record format\n");
+            return -1;
+        }
+    }
+
+    /**
+     * Scratch buffers test: no heap allocations for small keys and values
+     */
+
+    {
+        cryptodb_stats_t stats;
+
+        memset(&stats, 0, sizeof(cryptodb_stats_t));
+
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, NULL, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS != ret ||
+            cryptodb_get_stats(NULL, &stats) != CRYPTODB_ERR_NULL_POINTER ||
+            cryptodb_get_stats(&cryptodb, NULL) != CRYPTODB_ERR_NULL_POINTER)
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_open() stats\n");
+            return -1;
+        }
+
+        for (int i = 0; i < 10 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            ret = cryptodb_put_string(&cryptodb, "test_key", strlen("test_key") + 1, "small value");
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_get(&cryptodb, "test_key", strlen("test_key") + 1, CRYPTODB_VAL_STRING, out_val);
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_delete(&cryptodb, "test_key", strlen("test_key") + 1);
+        }
+        if (CRYPTODB_SUCCESS != ret ||
+            cryptodb_get_stats(&cryptodb, &stats) != CRYPTODB_SUCCESS ||
+            stats.puts != 10 || stats.gets != 10 || stats.deletes != 10 ||
+            stats.heap_allocs != 0)
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_get_stats() small values\n");
+            return -1;
+        }
+
+        ret = cryptodb_put_string(&cryptodb, "test_key", strlen("test_key") + 1, LARGE_TEXT);
+        if (CRYPTODB_SUCCESS != ret ||
+            cryptodb_get_stats(&cryptodb, &stats) != CRYPTODB_SUCCESS ||
+            stats.puts != 11 || stats.heap_allocs != 1)
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_get_stats() large value\n");
+            return -1;
+        }
+
+        cryptodb_close(&cryptodb);
+
+        if (cryptodb_destroy(TEST_DB_FOLDER, NULL) != CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: cryptodb_destroy() stats\n");
+            return -1;
+        }
+    }
+
+    /**
+     * Parallel decryption test: large values are decrypted by worker threads
+     */
+
+    {
+        const size_t sizes[] = { 4000, 4096, 5000, 100003, 1 << 20 };
+        char *large_val = (char *)malloc(1 << 20), *large_out = (char *)malloc(1 << 20);
+
+        if (large_val == NULL || large_out == NULL)
+        {
+            free(large_val);
+            free(large_out);
+            fprintf(stderr, "ERROR: malloc() parallel decryption\n");
+            return -1;
+        }
+
+        options.disable_keys_encryption = 0;
+        options.worker_threads = CRYPTODB_OPT_MAX_WORKER_THREADS + 1;
+        options.parallel_decrypt_threshold = 4096;
+
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_ERR_WRONG_ARGUMENT != ret)
+        {
+            free(large_val);
+            free(large_out);
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_open() worker_threads\n");
+            return -1;
+        }
+
+        options.worker_threads = 3;
+
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS != ret || !cryptodb.pool)
+        {
+            free(large_val);
+            free(large_out);
+            fprintf(stderr, "ERROR: cryptodb_open() parallel decryption\n");
+            return -1;
+        }
+
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]) && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            for (size_t j = 0; j < sizes[i] - 1; ++j)
+                large_val[j] = 'a' + (char)((j * 7 + i) % 26);
+            large_val[sizes[i] - 1] = '\0';
+
+            ret = cryptodb_put_string(&cryptodb, "large_key", strlen("large_key") + 1, large_val);
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_get(&cryptodb, "large_key", strlen("large_key") + 1, CRYPTODB_VAL_STRING, large_out);
+            if (CRYPTODB_SUCCESS == ret && strcmp(large_val, large_out))
+                ret = CRYPTODB_ERR_FAIL;
+        }
+
+        free(large_val);
+        free(large_out);
+        cryptodb_close(&cryptodb);
+
+        if (CRYPTODB_SUCCESS != ret || cryptodb.pool)
+        {
+            fprintf(stderr, "ERROR: cryptodb_get() parallel decryption\n");
+            return -1;
+        }
+
+        options.worker_threads = 0;
+        options.parallel_decrypt_threshold = 0;
+
+        if (cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: cryptodb_destroy() parallel decryption\n");
+            return -1;
+        }
+    }
+
+    /**
+     * AES-256-GCM values test: values are authenticated, bound to their keys
+     * and readable together with AES-256-CBC values
+     */
+
+    {
+        char *err = NULL, *raw = NULL, *raw2 = NULL;
+        size_t raw_len = 0, raw2_len = 0;
+        char gcm_val[64] = {0};
+
+        options.disable_keys_encryption = 1; // values are read directly
+        options.value_cipher = CRYPTODB_CIPHER_UNKNOWN;
+
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_ERR_WRONG_ARGUMENT != ret)
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_open() value_cipher\n");
+            return -1;
+        }
+
+        options.value_cipher = CRYPTODB_CIPHER_AES_256_CBC;
+
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_string(&cryptodb, "cbc", strlen("cbc") + 1, "cbc value");
+        cryptodb_close(&cryptodb);
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            fprintf(stderr, "ERROR: cryptodb_put() AES-256-CBC value\n");
+            return -1;
+        }
+
+        options.value_cipher = CRYPTODB_CIPHER_AES_256_GCM;
+
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS != ret || cryptodb.value_cipher != CRYPTODB_CIPHER_AES_256_GCM)
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_open() AES-256-GCM\n");
+            return -1;
+        }
+
+        // Every length around the block boundaries
+        for (size_t len = 0; len < sizeof(gcm_val) - 1 && ret == CRYPTODB_SUCCESS; ++len)
+        {
+            memset(gcm_val, 0, sizeof(gcm_val));
+            memset(gcm_val, 'g', len);
+            ret = cryptodb_put_string(&cryptodb, "gcm", strlen("gcm") + 1, gcm_val);
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_get(&cryptodb, "gcm", strlen("gcm") + 1, CRYPTODB_VAL_STRING, out_val);
+            if (CRYPTODB_SUCCESS == ret && strcmp(out_val, gcm_val))
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        if (CRYPTODB_SUCCESS != ret ||
+            CRYPTODB_SUCCESS != cryptodb_put_integer(&cryptodb, "gcm_int", strlen("gcm_int") + 1, -42) ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "gcm_int", strlen("gcm_int") + 1, CRYPTODB_VAL_NUM_INT, &out_val_int) ||
+            out_val_int != -42 ||
+            CRYPTODB_VAL_NUM_INT != cryptodb_get(&cryptodb, "gcm_int", strlen("gcm_int") + 1, CRYPTODB_VAL_STRING, out_val) ||
+            CRYPTODB_SUCCESS != cryptodb_put_double(&cryptodb, "gcm_double", strlen("gcm_double") + 1, 3.5) ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "gcm_double", strlen("gcm_double") + 1, CRYPTODB_VAL_NUM_DOUBLE, &out_val_double) ||
+            !compare_double(out_val_double, 3.5) ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "cbc", strlen("cbc") + 1, CRYPTODB_VAL_STRING, out_val) ||
+            strcmp(out_val, "cbc value"))
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_get() AES-256-GCM\n");
+            return -1;
+        }
+
+        // Integer takes 7 + 29 bytes instead of one AES block, and nonces are never reused
+        raw = leveldb_get(cryptodb.db, cryptodb.roptions, "gcm_int", strlen("gcm_int") + 1, &raw_len, &err);
+        if (CRYPTODB_SUCCESS == cryptodb_put_integer(&cryptodb, "gcm_int", strlen("gcm_int") + 1, -42))
+            raw2 = leveldb_get(cryptodb.db, cryptodb.roptions, "gcm_int", strlen("gcm_int") + 1, &raw2_len, &err);
+        if (raw == NULL || raw2 == NULL || err || raw_len != 7 + 29 || raw2_len != raw_len ||
+            (uint8_t)raw[0] != 0xa7 || !memcmp(raw, raw2, raw_len))
+        {
+            if (raw)
+                leveldb_free(raw);
+            if (raw2)
+                leveldb_free(raw2);
+            if (err)
+                leveldb_free(err);
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_put() AES-256-GCM format\n");
+            return -1;
+        }
+        leveldb_free(raw2);
+
+        // Value moved to another key
+        leveldb_put(cryptodb.db, cryptodb.woptions, "gcm_moved", strlen("gcm_moved") + 1,
+                    raw, raw_len, &err);
+        if (err ||
+            CRYPTODB_ERR_INTEGRITY_FAIL != cryptodb_get(&cryptodb, "gcm_moved", strlen("gcm_moved") + 1, CRYPTODB_VAL_NUM_INT, &out_val_int))
+        {
+            leveldb_free(raw);
+            if (err)
+                leveldb_free(err);
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_get() AES-256-GCM moved value\n");
+            return -1;
+        }
+
+        // Modified value
+        raw[20] ^= 0x01;
+        leveldb_put(cryptodb.db, cryptodb.woptions, "gcm_int", strlen("gcm_int") + 1,
+                    raw, raw_len, &err);
+        leveldb_free(raw);
+        if (err ||
+            CRYPTODB_ERR_INTEGRITY_FAIL != cryptodb_get(&cryptodb, "gcm_int", strlen("gcm_int") + 1, CRYPTODB_VAL_NUM_INT, &out_val_int))
+        {
+            if (err)
+                leveldb_free(err);
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_get() AES-256-GCM modified value\n");
+            return -1;
+        }
+
+        cryptodb_close(&cryptodb);
+
+        // AES-256-GCM values are readable by AES-256-CBC handler
+        options.value_cipher = CRYPTODB_CIPHER_AES_256_CBC;
+
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS != ret ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "gcm_double", strlen("gcm_double") + 1, CRYPTODB_VAL_NUM_DOUBLE, &out_val_double) ||
+            !compare_double(out_val_double, 3.5))
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_get() AES-256-GCM value by AES-256-CBC handler\n");
+            return -1;
+        }
+
+        cryptodb_close(&cryptodb);
+
+        // Large values with encrypted keys, split between worker threads
+        options.disable_keys_encryption = 0;
+        options.value_cipher = CRYPTODB_CIPHER_AES_256_GCM;
+        options.worker_threads = 2;
+        options.parallel_decrypt_threshold = 4096;
+
+        {
+            const size_t sizes[] = { 4095, 4096, 5001, 100003 };
+            char *large_val = (char *)malloc(100003), *large_out = (char *)malloc(100003);
+
+            ret = large_val && large_out ? CRYPTODB_SUCCESS : CRYPTODB_ERR_ALLOCATE_MEM;
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+
+            for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]) && ret == CRYPTODB_SUCCESS; ++i)
+            {
+                for (size_t j = 0; j < sizes[i] - 1; ++j)
+                    large_val[j] = 'a' + (char)((j * 11 + i) % 26);
+                large_val[sizes[i] - 1] = '\0';
+
+                ret = cryptodb_put_string(&cryptodb, "large_key", strlen("large_key") + 1, large_val);
+                if (CRYPTODB_SUCCESS == ret)
+                    ret = cryptodb_get(&cryptodb, "large_key", strlen("large_key") + 1, CRYPTODB_VAL_STRING, large_out);
+                if (CRYPTODB_SUCCESS == ret && strcmp(large_val, large_out))
+                    ret = CRYPTODB_ERR_FAIL;
+            }
+
+            free(large_val);
+            free(large_out);
+            cryptodb_close(&cryptodb);
+
+            if (CRYPTODB_SUCCESS != ret)
+            {
+                fprintf(stderr, "ERROR: cryptodb_get() AES-256-GCM large values\n");
+                return -1;
+            }
+        }
+
+        options.worker_threads = 0;
+        options.parallel_decrypt_threshold = 0;
+        options.value_cipher = CRYPTODB_CIPHER_AES_256_CBC;
+
+        if (cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: cryptodb_destroy() AES-256-GCM\n");
+            return -1;
+        }
+    }
+
+    /**
+     * Key tokens test: database keys are fixed-size keyed hashes of the keys
+     */
+
+    {
+        const cryptodb_key_mode_t modes[] = { CRYPTODB_KEY_MODE_TOKEN_128, CRYPTODB_KEY_MODE_TOKEN_256 };
+        const size_t token_lens[] = { 16, 32 };
+        char token_key[128] = {0};
+        size_t token_count = 0;
+
+        options.key_mode = CRYPTODB_KEY_MODE_UNKNOWN;
+
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_ERR_WRONG_ARGUMENT != ret)
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_open() key_mode\n");
+            return -1;
+        }
+
+        for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m)
+        {
+            leveldb_iterator_t *it = NULL;
+
+            options.key_mode = modes[m];
+            options.keep_original_keys = 0;
+
+            ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+            if (CRYPTODB_SUCCESS != ret || cryptodb.key_mode != modes[m])
+            {
+                cryptodb_close(&cryptodb);
+                fprintf(stderr, "ERROR: cryptodb_open() key tokens\n");
+                return -1;
+            }
+
+            // Keys of every length around the block boundaries, and a key
+            // that is a prefix of another one
+            for (size_t len = 1; len < sizeof(token_key) && ret == CRYPTODB_SUCCESS; ++len)
+            {
+                memset(token_key, 0, sizeof(token_key));
+                memset(token_key, 'k', len);
+                ret = cryptodb_put_integer(&cryptodb, token_key, len, (int)len);
+            }
+            for (size_t len = 1; len < sizeof(token_key) && ret == CRYPTODB_SUCCESS; ++len)
+            {
+                memset(token_key, 0, sizeof(token_key));
+                memset(token_key, 'k', len);
+                ret = cryptodb_get(&cryptodb, token_key, len, CRYPTODB_VAL_NUM_INT, &out_val_int);
+                if (CRYPTODB_SUCCESS == ret && out_val_int != (int)len)
+                    ret = CRYPTODB_ERR_FAIL;
+                if (CRYPTODB_SUCCESS == ret && len % 2)
+                    ret = cryptodb_delete(&cryptodb, token_key, len);
+            }
+            if (CRYPTODB_SUCCESS != ret ||
+                CRYPTODB_SUCCESS == cryptodb_get(&cryptodb, "k", 1, CRYPTODB_VAL_NUM_INT, &out_val_int))
+            {
+                cryptodb_close(&cryptodb);
+                fprintf(stderr, "ERROR: cryptodb_get() key tokens\n");
+                return -1;
+            }
+
+            // Every database key is a token
+            token_count = 0;
+            it = leveldb_create_iterator(cryptodb.db, cryptodb.roptions);
+            for (leveldb_iter_seek_to_first(it); leveldb_iter_valid(it); leveldb_iter_next(it))
+            {
+                size_t raw_key_len = 0;
+                leveldb_iter_key(it, &raw_key_len);
+                if (raw_key_len != token_lens[m])
+                    ret = CRYPTODB_ERR_FAIL;
+                ++token_count;
+            }
+            leveldb_iter_destroy(it);
+            if (CRYPTODB_SUCCESS != ret || token_count != (sizeof(token_key) - 1) / 2)
+            {
+                cryptodb_close(&cryptodb);
+                fprintf(stderr, "ERROR: cryptodb_put() key token length\n");
+                return -1;
+            }
+
+            cryptodb_close(&cryptodb);
+            if (m + 1 < sizeof(modes) / sizeof(modes[0]) &&
+                cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+            {
+                fprintf(stderr, "ERROR: cryptodb_destroy() key tokens\n");
+                return -1;
+            }
+        }
+
+        // Tokens aren't found with encrypted keys
+        options.key_mode = CRYPTODB_KEY_MODE_AES_256_CBC;
+
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS != ret ||
+            CRYPTODB_SUCCESS == cryptodb_get(&cryptodb, "kk", 2, CRYPTODB_VAL_NUM_INT, &out_val_int))
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_get() key token with AES-256-CBC key mode\n");
+            return -1;
+        }
+        cryptodb_close(&cryptodb);
+
+        if (cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: cryptodb_destroy() key tokens\n");
+            return -1;
+        }
+
+        // Original keys are kept in the values, swapped values are detected
+        options.key_mode = CRYPTODB_KEY_MODE_TOKEN_128;
+        options.keep_original_keys = 1;
+
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_string(&cryptodb, "first", strlen("first") + 1, "first value");
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_string(&cryptodb, "second", strlen("second") + 1, "second value");
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get(&cryptodb, "first", strlen("first") + 1, CRYPTODB_VAL_STRING, out_val);
+        if (CRYPTODB_SUCCESS != ret || strcmp(out_val, "first value") || !cryptodb.keep_original_keys)
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_get() keep_original_keys\n");
+            return -1;
+        }
+
+        {
+            char *raw_keys[2] = {NULL}, *raw_vals[2] = {NULL};
+            size_t raw_key_lens[2] = {0}, raw_val_lens[2] = {0};
+            char *err = NULL;
+            leveldb_iterator_t *it = leveldb_create_iterator(cryptodb.db, cryptodb.roptions);
+
+            token_count = 0;
+            for (leveldb_iter_seek_to_first(it); leveldb_iter_valid(it) && token_count < 2; leveldb_iter_next(it))
+            {
+                const char *p = leveldb_iter_key(it, &raw_key_lens[token_count]);
+                raw_keys[token_count] = (char *)malloc(raw_key_lens[token_count]);
+                memcpy(raw_keys[token_count], p, raw_key_lens[token_count]);
+                p = leveldb_iter_value(it, &raw_val_lens[token_count]);
+                raw_vals[token_count] = (char *)malloc(raw_val_lens[token_count]);
+                memcpy(raw_vals[token_count], p, raw_val_lens[token_count]);
+                ++token_count;
+            }
+            leveldb_iter_destroy(it);
+
+            if (token_count == 2)
+            {
+                leveldb_put(cryptodb.db, cryptodb.woptions, raw_keys[0], raw_key_lens[0],
+                            raw_vals[1], raw_val_lens[1], &err);
+                if (err == NULL)
+                    leveldb_put(cryptodb.db, cryptodb.woptions, raw_keys[1], raw_key_lens[1],
+                                raw_vals[0], raw_val_lens[0], &err);
+            }
+            for (int i = 0; i < 2; ++i)
+            {
+                free(raw_keys[i]);
+                free(raw_vals[i]);
+            }
+            if (err || token_count != 2 ||
+                CRYPTODB_ERR_INTEGRITY_FAIL != cryptodb_get(&cryptodb, "first", strlen("first") + 1, CRYPTODB_VAL_STRING, out_val) ||
+                CRYPTODB_ERR_INTEGRITY_FAIL != cryptodb_get(&cryptodb, "second", strlen("second") + 1, CRYPTODB_VAL_STRING, out_val))
+            {
+                if (err)
+                    leveldb_free(err);
+                cryptodb_close(&cryptodb);
+                fprintf(stderr, "ERROR: cryptodb_get() swapped values with original keys\n");
+                return -1;
+            }
+        }
+
+        // Values with original keys are readable without "keep_original_keys"
+        ret = cryptodb_put_double(&cryptodb, "third", strlen("third") + 1, 2.25);
+        cryptodb_close(&cryptodb);
+        options.keep_original_keys = 0;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get(&cryptodb, "third", strlen("third") + 1, CRYPTODB_VAL_NUM_DOUBLE, &out_val_double);
+        cryptodb_close(&cryptodb);
+        if (CRYPTODB_SUCCESS != ret || !compare_double(out_val_double, 2.25))
+        {
+            fprintf(stderr, "ERROR: cryptodb_get() value with original key\n");
+            return -1;
+        }
+
+        options.key_mode = CRYPTODB_KEY_MODE_AES_256_CBC;
+
+        if (cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: cryptodb_destroy() keep_original_keys\n");
+            return -1;
+        }
+    }
+
+    /**
+     * Write batch test: operations are encrypted when added and written
+     * to the database at once
+     */
+
+    {
+        cryptodb_batch_t batch;
+        cryptodb_stats_t stats_before, stats_after;
+        char batch_key[32] = {0};
+
+        memset(&batch, 0, sizeof(cryptodb_batch_t));
+
+        if (CRYPTODB_ERR_NULL_POINTER != cryptodb_batch_create(&cryptodb, &batch) ||
+            CRYPTODB_ERR_NULL_POINTER != cryptodb_batch_put_integer(&batch, "key", strlen("key") + 1, 1) ||
+            CRYPTODB_ERR_NULL_POINTER != cryptodb_batch_commit(&batch))
+        {
+            fprintf(stderr, "ERROR: cryptodb_batch_create() of closed database\n");
+            return -1;
+        }
+
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_string(&cryptodb, "batch_deleted", strlen("batch_deleted") + 1, "deleted");
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_batch_create(&cryptodb, &batch);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_stats(&cryptodb, &stats_before);
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            cryptodb_batch_destroy(&batch);
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_batch_create()\n");
+            return -1;
+        }
+
+        for (int i = 0; i < 100 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(batch_key, sizeof(batch_key), "batch_%d", i);
+            ret = cryptodb_batch_put_integer(&batch, batch_key, strlen(batch_key) + 1, i);
+        }
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_batch_put_string(&batch, "batch_string", strlen("batch_string") + 1, "batch value");
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_batch_put_double(&batch, "batch_double", strlen("batch_double") + 1, 0.5);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_batch_delete(&batch, "batch_deleted", strlen("batch_deleted") + 1);
+        // The last operation with the same key wins
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_batch_put_integer(&batch, "batch_0", strlen("batch_0") + 1, -1);
+
+        // Nothing is written before commit
+        if (CRYPTODB_SUCCESS != ret || batch.puts != 103 || batch.deletes != 1 ||
+            CRYPTODB_SUCCESS == cryptodb_get(&cryptodb, "batch_1", strlen("batch_1") + 1, CRYPTODB_VAL_NUM_INT, &out_val_int) ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "batch_deleted", strlen("batch_deleted") + 1, CRYPTODB_VAL_STRING, out_val))
+        {
+            cryptodb_batch_destroy(&batch);
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_batch_put()\n");
+            return -1;
+        }
+
+        ret = cryptodb_batch_commit(&batch);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_stats(&cryptodb, &stats_after);
+        if (CRYPTODB_SUCCESS != ret || batch.puts || batch.deletes ||
+            stats_after.puts - stats_before.puts != 103 ||
+            stats_after.deletes - stats_before.deletes != 1)
+        {
+            cryptodb_batch_destroy(&batch);
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_batch_commit()\n");
+            return -1;
+        }
+
+        for (int i = 1; i < 100 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(batch_key, sizeof(batch_key), "batch_%d", i);
+            ret = cryptodb_get(&cryptodb, batch_key, strlen(batch_key) + 1, CRYPTODB_VAL_NUM_INT, &out_val_int);
+            if (CRYPTODB_SUCCESS == ret && out_val_int != i)
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        if (CRYPTODB_SUCCESS != ret ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "batch_0", strlen("batch_0") + 1, CRYPTODB_VAL_NUM_INT, &out_val_int) ||
+            out_val_int != -1 ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "batch_string", strlen("batch_string") + 1, CRYPTODB_VAL_STRING, out_val) ||
+            strcmp(out_val, "batch value") ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "batch_double", strlen("batch_double") + 1, CRYPTODB_VAL_NUM_DOUBLE, &out_val_double) ||
+            !compare_double(out_val_double, 0.5) ||
+            CRYPTODB_SUCCESS == cryptodb_get(&cryptodb, "batch_deleted", strlen("batch_deleted") + 1, CRYPTODB_VAL_STRING, out_val))
+        {
+            cryptodb_batch_destroy(&batch);
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_get() after cryptodb_batch_commit()\n");
+            return -1;
+        }
+
+        // Cleared operations are never written, the batch is reusable
+        ret = cryptodb_batch_delete(&batch, "batch_string", strlen("batch_string") + 1);
+        cryptodb_batch_clear(&batch);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_batch_commit(&batch);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_batch_put_integer(&batch, "batch_1", strlen("batch_1") + 1, 11);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_batch_commit(&batch);
+        if (CRYPTODB_SUCCESS != ret ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "batch_string", strlen("batch_string") + 1, CRYPTODB_VAL_STRING, out_val) ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "batch_1", strlen("batch_1") + 1, CRYPTODB_VAL_NUM_INT, &out_val_int) ||
+            out_val_int != 11)
+        {
+            cryptodb_batch_destroy(&batch);
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_batch_clear()\n");
+            return -1;
+        }
+
+        cryptodb_batch_destroy(&batch);
+        cryptodb_close(&cryptodb);
+
+        if (batch.batch || cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: cryptodb_destroy() write batch\n");
+            return -1;
+        }
+    }
+
+    /**
+     * Durability test: every write is durable when it returns with sync
+     * and group commit, group commit shares syncs of concurrent writes
+     */
+
+    {
+        cryptodb_stats_t stats;
+        char durable_key[32] = {0};
+        const cryptodb_durability_t policies[] = {
+            CRYPTODB_DURABILITY_SYNC,
+            CRYPTODB_DURABILITY_GROUP_COMMIT,
+            CRYPTODB_DURABILITY_PERIODIC
+        };
+
+        options.durability = CRYPTODB_DURABILITY_UNKNOWN;
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_ERR_WRONG_ARGUMENT != ret)
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_open() with unknown durability\n");
+            return -1;
+        }
+
+        for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); ++p)
+        {
+            options.durability = policies[p];
+            options.sync_period_ms = 10;
+            ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+            if (CRYPTODB_SUCCESS != ret)
+            {
+                fprintf(stderr, "ERROR: cryptodb_open() durability %d\n", (int)policies[p]);
+                return -1;
+            }
+
+            for (int i = 0; i < TEST_THREADS_COUNT; ++i)
+            {
+                threads_arg[i].id = i;
+                threads_arg[i].retval = 0;
+                threads_arg[i].cryptodb = &cryptodb;
+                if (pthread_create(&threads[i], NULL, _test_durability_thread_func, (void *)&threads_arg[i]))
+                {
+                    cryptodb_close(&cryptodb);
+                    fprintf(stderr, "ERROR: pthread_create() %d durability\n", i);
+                    return -1;
+                }
+            }
+            for (int i = 0; i < TEST_THREADS_COUNT; ++i)
+            {
+                if (pthread_join(threads[i], NULL) || threads_arg[i].retval != CRYPTODB_SUCCESS)
+                {
+                    cryptodb_close(&cryptodb);
+                    fprintf(stderr, "ERROR: thread #%d durability %d\n", i, (int)policies[p]);
+                    return -1;
+                }
+            }
+
+            ret = cryptodb_get_stats(&cryptodb, &stats);
+            if (CRYPTODB_SUCCESS != ret || stats.puts != TEST_THREADS_COUNT * 50 ||
+                (policies[p] == CRYPTODB_DURABILITY_SYNC && stats.syncs != stats.puts) ||
+                (policies[p] == CRYPTODB_DURABILITY_GROUP_COMMIT && (!stats.syncs || stats.syncs > stats.puts)) ||
+                (policies[p] == CRYPTODB_DURABILITY_PERIODIC && stats.syncs > stats.puts))
+            {
+                cryptodb_close(&cryptodb);
+                fprintf(stderr, "ERROR: cryptodb_get_stats() durability %d\n", (int)policies[p]);
+                return -1;
+            }
+
+            // Periodic sync also syncs the last writes on close
+            cryptodb_close(&cryptodb);
+
+            options.durability = CRYPTODB_DURABILITY_SYNC;
+            ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+            for (int t = 0; t < TEST_THREADS_COUNT && ret == CRYPTODB_SUCCESS; ++t)
+            {
+                for (int i = 0; i < 50 && ret == CRYPTODB_SUCCESS; ++i)
+                {
+                    snprintf(durable_key, sizeof(durable_key), "durable_%d_%d", t, i);
+                    ret = cryptodb_get(&cryptodb, durable_key, strlen(durable_key) + 1, CRYPTODB_VAL_NUM_INT, &out_val_int);
+                    if (CRYPTODB_SUCCESS == ret && out_val_int != i)
+                        ret = CRYPTODB_ERR_FAIL;
+                }
+            }
+            cryptodb_close(&cryptodb);
+
+            if (CRYPTODB_SUCCESS != ret || cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+            {
+                fprintf(stderr, "ERROR: cryptodb_get() after reopen, durability %d\n", (int)policies[p]);
+                return -1;
+            }
+        }
+
+        options.durability = CRYPTODB_DURABILITY_SYNC;
+        options.sync_period_ms = 0;
+    }
+
+    /**
+     * Asynchronous writes test: operations are encrypted by the caller,
+     * written by the writer thread, and drained by flush and close
+     */
+
+    {
+        int completed[2] = {0}; // successful and failed operations
+        char async_key[32] = {0};
+
+        if (CRYPTODB_ERR_NULL_POINTER != cryptodb_put_integer_async(&cryptodb, "key", strlen("key") + 1, 1, NULL, NULL) ||
+            CRYPTODB_ERR_NULL_POINTER != cryptodb_flush(&cryptodb))
+        {
+            fprintf(stderr, "ERROR: cryptodb_put_async() of closed database\n");
+            return -1;
+        }
+
+        // Small queue to check backpressure
+        options.async_queue_len = 4;
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS != ret ||
+            CRYPTODB_ERR_WRONG_ARGUMENT != cryptodb_put_integer_async(&cryptodb, "key", 0, 1, _test_async_cb, completed) ||
+            CRYPTODB_ERR_NULL_POINTER != cryptodb_delete_async(&cryptodb, NULL, 1, _test_async_cb, completed))
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_put_async() wrong arguments\n");
+            return -1;
+        }
+
+        for (int i = 0; i < 200 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(async_key, sizeof(async_key), "async_%d", i);
+            ret = cryptodb_put_integer_async(&cryptodb, async_key, strlen(async_key) + 1, i, _test_async_cb, completed);
+        }
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_string_async(&cryptodb, "async_string", strlen("async_string") + 1, "async value", NULL, NULL);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_double_async(&cryptodb, "async_double", strlen("async_double") + 1, 0.25, _test_async_cb, completed);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_flush(&cryptodb);
+        if (CRYPTODB_SUCCESS != ret || completed[0] != 201 || completed[1])
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_flush()\n");
+            return -1;
+        }
+
+        for (int i = 0; i < 200 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(async_key, sizeof(async_key), "async_%d", i);
+            ret = cryptodb_get(&cryptodb, async_key, strlen(async_key) + 1, CRYPTODB_VAL_NUM_INT, &out_val_int);
+            if (CRYPTODB_SUCCESS == ret && out_val_int != i)
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        if (CRYPTODB_SUCCESS != ret ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "async_string", strlen("async_string") + 1, CRYPTODB_VAL_STRING, out_val) ||
+            strcmp(out_val, "async value") ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "async_double", strlen("async_double") + 1, CRYPTODB_VAL_NUM_DOUBLE, &out_val_double) ||
+            !compare_double(out_val_double, 0.25))
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_get() after cryptodb_flush()\n");
+            return -1;
+        }
+
+        // Queued operations are written in order and drained by close
+        for (int i = 0; i < 100 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(async_key, sizeof(async_key), "async_%d", i);
+            ret = cryptodb_delete_async(&cryptodb, async_key, strlen(async_key) + 1, _test_async_cb, completed);
+        }
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_integer_async(&cryptodb, "async_0", strlen("async_0") + 1, -1, _test_async_cb, completed);
+        cryptodb_close(&cryptodb);
+        if (CRYPTODB_SUCCESS != ret || completed[0] != 302 || completed[1])
+        {
+            fprintf(stderr, "ERROR: cryptodb_delete_async()\n");
+            return -1;
+        }
+
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        for (int i = 1; i < 200 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(async_key, sizeof(async_key), "async_%d", i);
+            if ((CRYPTODB_SUCCESS == cryptodb_get(&cryptodb, async_key, strlen(async_key) + 1, CRYPTODB_VAL_NUM_INT, &out_val_int)) != (i >= 100))
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        if (CRYPTODB_SUCCESS != ret ||
+            CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, "async_0", strlen("async_0") + 1, CRYPTODB_VAL_NUM_INT, &out_val_int) ||
+            out_val_int != -1)
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_get() after cryptodb_delete_async()\n");
+            return -1;
+        }
+        cryptodb_close(&cryptodb);
+
+        options.async_queue_len = 0;
+        if (cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: cryptodb_destroy() asynchronous writes\n");
+            return -1;
+        }
+    }
+
+    /**
+     * Multi-get test: every entry gets its own result, all entries are
+     * read from one snapshot
+     */
+
+    {
+        cryptodb_stats_t stats;
+        char multi_keys[64][32];
+        int multi_ints[64] = {0};
+        char multi_strings[32][32];
+        char multi_values[32][1024];
+        char large_value[1000];
+        cryptodb_get_item_t items[64 + 32 + 4];
+        size_t items_count = 0;
+
+        memset(items, 0, sizeof(items));
+        memset(large_value, 'v', sizeof(large_value) - 1);
+        large_value[sizeof(large_value) - 1] = '\0';
+
+        if (CRYPTODB_ERR_NULL_POINTER != cryptodb_multi_get(&cryptodb, items, 1) ||
+            CRYPTODB_ERR_NULL_POINTER != cryptodb_multi_get(NULL, items, 1))
+        {
+            fprintf(stderr, "ERROR: cryptodb_multi_get() of closed database\n");
+            return -1;
+        }
+
+        // Enough large values to be decoded by the worker threads
+        options.worker_threads = 2;
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        for (int i = 0; i < 64 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(multi_keys[i], sizeof(multi_keys[i]), "multi_%d", i);
+            if (i % 2 == 0) // odd keys are missing
+                ret = cryptodb_put_integer(&cryptodb, multi_keys[i], strlen(multi_keys[i]) + 1, i);
+        }
+        for (int i = 0; i < 32 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            large_value[0] = (char)('a' + i % 26);
+            snprintf(multi_strings[i], sizeof(multi_strings[i]), "multi_string_%d", i);
+            ret = cryptodb_put_string(&cryptodb, multi_strings[i], strlen(multi_strings[i]) + 1, large_value);
+        }
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_stats(&cryptodb, &stats);
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_put() multi-get\n");
+            return -1;
+        }
+
+        for (int i = 0; i < 64; ++i, ++items_count)
+        {
+            items[items_count].key = multi_keys[i];
+            items[items_count].keylen = strlen(multi_keys[i]) + 1;
+            items[items_count].valtype = CRYPTODB_VAL_NUM_INT;
+            items[items_count].val = &multi_ints[i];
+        }
+        for (int i = 0; i < 32; ++i, ++items_count)
+        {
+            items[items_count].key = multi_strings[i];
+            items[items_count].keylen = strlen(multi_strings[i]) + 1;
+            items[items_count].valtype = CRYPTODB_VAL_STRING;
+            items[items_count].val = multi_values[i];
+        }
+        // Wrong type, zero key length, NULL value
+        items[items_count].key = multi_keys[0];
+        items[items_count].keylen = strlen(multi_keys[0]) + 1;
+        items[items_count].valtype = CRYPTODB_VAL_STRING;
+        items[items_count++].val = out_val;
+        items[items_count].key = multi_keys[0];
+        items[items_count].valtype = CRYPTODB_VAL_NUM_INT;
+        items[items_count++].val = &out_val_int;
+        items[items_count].key = multi_keys[0];
+        items[items_count].keylen = strlen(multi_keys[0]) + 1;
+        items[items_count++].valtype = CRYPTODB_VAL_NUM_INT;
+
+        ret = cryptodb_multi_get(&cryptodb, items, items_count);
+        for (int i = 0; i < 64 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            if (i % 2 == 0 && (items[i].result != CRYPTODB_SUCCESS || multi_ints[i] != i))
+                ret = CRYPTODB_ERR_FAIL;
+            if (i % 2 == 1 && items[i].result == CRYPTODB_SUCCESS)
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        for (int i = 0; i < 32 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            large_value[0] = (char)('a' + i % 26);
+            if (items[64 + i].result != CRYPTODB_SUCCESS || strcmp(multi_values[i], large_value))
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            memset(&stats, 0, sizeof(stats));
+            ret = cryptodb_get_stats(&cryptodb, &stats);
+        }
+        if (CRYPTODB_SUCCESS != ret ||
+            items[96].result != CRYPTODB_VAL_NUM_INT ||
+            items[97].result != CRYPTODB_ERR_WRONG_ARGUMENT ||
+            items[98].result != CRYPTODB_ERR_NULL_POINTER ||
+            stats.gets != 32 + 32)
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_multi_get()\n");
+            return -1;
+        }
+
+        // Concurrent batches are never seen half-written
+        threads_arg[0].id = 0;
+        threads_arg[0].cryptodb = &cryptodb;
+        for (int i = 0; i < 64 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(multi_keys[i], sizeof(multi_keys[i]), "version_%d", i);
+            ret = cryptodb_put_integer(&cryptodb, multi_keys[i], strlen(multi_keys[i]) + 1, 0);
+            items[i].key = multi_keys[i];
+            items[i].keylen = strlen(multi_keys[i]) + 1;
+            items[i].valtype = CRYPTODB_VAL_NUM_INT;
+            items[i].val = &multi_ints[i];
+        }
+        if (CRYPTODB_SUCCESS == ret &&
+            pthread_create(&threads[0], NULL, _test_multi_get_writer_func, (void *)&threads_arg[0]))
+            ret = CRYPTODB_ERR_FAIL;
+        for (int n = 0; n < 200 && ret == CRYPTODB_SUCCESS; ++n)
+        {
+            ret = cryptodb_multi_get(&cryptodb, items, 64);
+            for (int i = 0; i < 64 && ret == CRYPTODB_SUCCESS; ++i)
+                if (items[i].result != CRYPTODB_SUCCESS || multi_ints[i] != multi_ints[0])
+                    ret = CRYPTODB_ERR_FAIL;
+        }
+        if (pthread_join(threads[0], NULL) || threads_arg[0].retval != CRYPTODB_SUCCESS)
+            ret = CRYPTODB_ERR_FAIL;
+        cryptodb_close(&cryptodb);
+
+        options.worker_threads = 0;
+        if (CRYPTODB_SUCCESS != ret || cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: cryptodb_multi_get() snapshot\n");
+            return -1;
+        }
+    }
+
+    /**
+     * Iterator test: all entries are decrypted with their keys, with and
+     * without read-ahead, the iterator doesn't see later writes
+     */
+
+    {
+        cryptodb_stats_t stats;
+        cryptodb_iterator_t iterator;
+        cryptodb_iterator_options_t iterator_options;
+        const cryptodb_entry_t *entry = NULL;
+        const size_t read_ahead[] = { 0, 1, 4 };
+        char iter_key[32];
+        char large_value[1000];
+        int ints = 0, strings = 0, doubles = 0, n = 0;
+
+        memset(&iterator_options, 0, sizeof(iterator_options));
+        memset(large_value, 'i', sizeof(large_value) - 1);
+        large_value[sizeof(large_value) - 1] = '\0';
+
+        if (CRYPTODB_ERR_NULL_POINTER != cryptodb_iterator_create(&cryptodb, NULL, &iterator) ||
+            CRYPTODB_ERR_NULL_POINTER != cryptodb_iterator_create(NULL, NULL, &iterator) ||
+            cryptodb_iterator_valid(NULL) || cryptodb_iterator_entry(NULL) != NULL)
+        {
+            fprintf(stderr, "ERROR: cryptodb_iterator_create() of closed database\n");
+            return -1;
+        }
+
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        for (int i = 0; i < 100 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(iter_key, sizeof(iter_key), "iter_int_%d", i);
+            ret = cryptodb_put_integer(&cryptodb, iter_key, strlen(iter_key) + 1, i);
+        }
+        for (int i = 0; i < 50 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            // Keys of 16 bytes with the terminating zero take two AES blocks,
+            // the first value is larger than CRYPTODB_SCRATCH_LEN
+            snprintf(iter_key, sizeof(iter_key), "iter_str_%07d", i);
+            large_value[i] = '\0';
+            ret = cryptodb_put_string(&cryptodb, iter_key, strlen(iter_key) + 1, large_value + (i ? 0 : 1));
+            large_value[i] = 'i';
+        }
+        for (int i = 0; i < 10 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(iter_key, sizeof(iter_key), "iter_double_%d", i);
+            ret = cryptodb_put_double(&cryptodb, iter_key, strlen(iter_key) + 1, i + 0.5);
+        }
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_stats(&cryptodb, &stats);
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_put() iterator\n");
+            return -1;
+        }
+
+        for (size_t r = 0; r < sizeof(read_ahead) / sizeof(read_ahead[0]) && ret == CRYPTODB_SUCCESS; ++r)
+        {
+            iterator_options.read_ahead = read_ahead[r];
+            ret = cryptodb_iterator_create(&cryptodb, &iterator_options, &iterator);
+            if (CRYPTODB_SUCCESS != ret || cryptodb_iterator_valid(&iterator))
+                ret = CRYPTODB_ERR_FAIL;
+
+            // Written after the iterator was created
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_put_integer(&cryptodb, "iter_late", strlen("iter_late") + 1, 0);
+
+            // The second pass sees the same entries
+            for (int pass = 0; pass < 2 && ret == CRYPTODB_SUCCESS; ++pass)
+            {
+                ints = strings = doubles = 0;
+                for (cryptodb_iterator_seek_to_first(&iterator);
+                     cryptodb_iterator_valid(&iterator) && ret == CRYPTODB_SUCCESS;
+                     cryptodb_iterator_next(&iterator))
+                {
+                    entry = cryptodb_iterator_entry(&iterator);
+                    if (entry == NULL || entry->result != CRYPTODB_SUCCESS || entry->key == NULL ||
+                        entry->keylen % 16 != 0 || entry->key[entry->keylen] != '\0')
+                    {
+                        ret = CRYPTODB_ERR_FAIL;
+                        break;
+                    }
+
+                    if (!strncmp(entry->key, "iter_int_", strlen("iter_int_")))
+                    {
+                        ++ints;
+                        if (entry->valtype != CRYPTODB_VAL_NUM_INT ||
+                            entry->integer != atoi(entry->key + strlen("iter_int_")))
+                            ret = CRYPTODB_ERR_FAIL;
+                    }
+                    else if (!strncmp(entry->key, "iter_str_", strlen("iter_str_")))
+                    {
+                        ++strings;
+                        n = atoi(entry->key + strlen("iter_str_"));
+                        if (entry->valtype != CRYPTODB_VAL_STRING ||
+                            entry->str_len != (n ? (size_t)n : sizeof(large_value) - 2) ||
+                            strspn(entry->str, "i") != entry->str_len ||
+                            entry->str[entry->str_len] != '\0')
+                            ret = CRYPTODB_ERR_FAIL;
+                    }
+                    else if (!strncmp(entry->key, "iter_double_", strlen("iter_double_")))
+                    {
+                        ++doubles;
+                        if (entry->valtype != CRYPTODB_VAL_NUM_DOUBLE ||
+                            entry->number != atoi(entry->key + strlen("iter_double_")) + 0.5)
+                            ret = CRYPTODB_ERR_FAIL;
+                    }
+                    else
+                        ret = CRYPTODB_ERR_FAIL;
+
+                    // The padded key finds the entry
+                    if (CRYPTODB_SUCCESS == ret && entry->valtype == CRYPTODB_VAL_NUM_INT &&
+                        (CRYPTODB_SUCCESS != cryptodb_get(&cryptodb, entry->key, entry->keylen,
+                                                          CRYPTODB_VAL_NUM_INT, &out_val_int) ||
+                         out_val_int != entry->integer))
+                        ret = CRYPTODB_ERR_FAIL;
+                }
+                if (CRYPTODB_SUCCESS == ret &&
+                    (ints != 100 || strings != 50 || doubles != 10 ||
+                     cryptodb_iterator_entry(&iterator) != NULL ||
+                     cryptodb_iterator_status(&iterator) != CRYPTODB_SUCCESS))
+                    ret = CRYPTODB_ERR_FAIL;
+            }
+
+            // Destroyed in the middle, while the read-ahead thread works
+            if (CRYPTODB_SUCCESS == ret)
+            {
+                cryptodb_iterator_seek_to_first(&iterator);
+                cryptodb_iterator_next(&iterator);
+                if (!cryptodb_iterator_valid(&iterator))
+                    ret = CRYPTODB_ERR_FAIL;
+            }
+            cryptodb_iterator_destroy(&iterator);
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_delete(&cryptodb, "iter_late", strlen("iter_late") + 1);
+        }
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_iterator_next()\n");
+            return -1;
+        }
+        cryptodb_close(&cryptodb);
+
+        // Key tokens can't be decrypted, only keys that were kept in the
+        // values are known
+        options.key_mode = CRYPTODB_KEY_MODE_TOKEN_128;
+        options.value_cipher = CRYPTODB_CIPHER_AES_256_GCM;
+        ret = cryptodb_destroy(TEST_DB_FOLDER, &options);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        for (int i = 0; i < 20 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(iter_key, sizeof(iter_key), "iter_token_%d", i);
+            ret = cryptodb_put_integer(&cryptodb, iter_key, strlen(iter_key) + 1, i);
+        }
+        cryptodb_close(&cryptodb);
+        options.keep_original_keys = 1;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        for (int i = 20; i < 40 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(iter_key, sizeof(iter_key), "iter_token_%d", i);
+            ret = cryptodb_put_integer(&cryptodb, iter_key, strlen(iter_key) + 1, i);
+        }
+        ints = 0;
+        iterator_options.read_ahead = 2;
+        iterator_options.fill_cache = 1;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_iterator_create(&cryptodb, &iterator_options, &iterator);
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            for (cryptodb_iterator_seek_to_first(&iterator);
+                 cryptodb_iterator_valid(&iterator);
+                 cryptodb_iterator_next(&iterator))
+            {
+                entry = cryptodb_iterator_entry(&iterator);
+                if (entry->result != CRYPTODB_SUCCESS || entry->valtype != CRYPTODB_VAL_NUM_INT)
+                    ret = CRYPTODB_ERR_FAIL;
+                else if (entry->integer < 20 && entry->key != NULL)
+                    ret = CRYPTODB_ERR_FAIL;
+                else if (entry->integer >= 20)
+                {
+                    snprintf(iter_key, sizeof(iter_key), "iter_token_%d", entry->integer);
+                    if (entry->key == NULL || entry->keylen != strlen(iter_key) + 1 ||
+                        strcmp(entry->key, iter_key))
+                        ret = CRYPTODB_ERR_FAIL;
+                }
+                ++ints;
+            }
+            cryptodb_iterator_destroy(&iterator);
+        }
+        cryptodb_close(&cryptodb);
+
+        options.key_mode = CRYPTODB_KEY_MODE_AES_256_CBC;
+        options.value_cipher = CRYPTODB_CIPHER_AES_256_CBC;
+        options.keep_original_keys = 0;
+        if (CRYPTODB_SUCCESS != ret || ints != 40 ||
+            cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: cryptodb_iterator_next() key tokens\n");
+            return -1;
+        }
+    }
+
+    /**
+     * Range scan test: plaintext keys are iterated in their order within
+     * the bounds, only the entries within the bounds are decrypted
+     */
+
+    {
+        cryptodb_stats_t stats;
+        cryptodb_iterator_t iterator;
+        cryptodb_iterator_options_t iterator_options;
+        const cryptodb_entry_t *entry = NULL;
+        char range_key[32], prev_key[32];
+        uint64_t gets = 0;
+        int count = 0;
+
+        memset(&iterator_options, 0, sizeof(iterator_options));
+
+        options.disable_keys_encryption = 1;
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        for (int b = 0; b < 10 && ret == CRYPTODB_SUCCESS; ++b)
+        {
+            for (int i = 0; i < 20 && ret == CRYPTODB_SUCCESS; ++i)
+            {
+                snprintf(range_key, sizeof(range_key), "bucket_%02d_%03d", b, i);
+                ret = cryptodb_put_integer(&cryptodb, range_key, strlen(range_key) + 1, b * 100 + i);
+            }
+        }
+        // The greatest possible keys don't have the prefix successor
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_integer(&cryptodb, "\xff\xff", 2, -1);
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            cryptodb_close(&cryptodb);
+            fprintf(stderr, "ERROR: cryptodb_put() range scan\n");
+            return -1;
+        }
+
+        // [bucket_03, bucket_05) forward, then bucket_07_ backward
+        for (int pass = 0; pass < 2 && ret == CRYPTODB_SUCCESS; ++pass)
+        {
+            memset(&iterator_options, 0, sizeof(iterator_options));
+            iterator_options.read_ahead = pass ? 4 : 0;
+            if (!pass)
+            {
+                iterator_options.lower_bound = "bucket_03";
+                iterator_options.lower_bound_len = strlen("bucket_03");
+                iterator_options.upper_bound = "bucket_05";
+                iterator_options.upper_bound_len = strlen("bucket_05");
+            }
+            else
+            {
+                iterator_options.prefix = "bucket_07_";
+                iterator_options.prefix_len = strlen("bucket_07_");
+                iterator_options.reverse = 1;
+            }
+
+            ret = cryptodb_get_stats(&cryptodb, &stats);
+            gets = stats.gets;
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_iterator_create(&cryptodb, &iterator_options, &iterator);
+            if (CRYPTODB_SUCCESS != ret)
+                break;
+
+            count = 0;
+            for (cryptodb_iterator_seek_to_first(&iterator);
+                 cryptodb_iterator_valid(&iterator) && ret == CRYPTODB_SUCCESS;
+                 cryptodb_iterator_next(&iterator), ++count)
+            {
+                entry = cryptodb_iterator_entry(&iterator);
+                if (pass)
+                    snprintf(range_key, sizeof(range_key), "bucket_07_%03d", 19 - count);
+                else
+                    snprintf(range_key, sizeof(range_key), "bucket_%02d_%03d", 3 + count / 20, count % 20);
+                if (entry->result != CRYPTODB_SUCCESS || entry->keylen != strlen(range_key) + 1 ||
+                    strcmp(entry->key, range_key) || entry->valtype != CRYPTODB_VAL_NUM_INT ||
+                    entry->integer != atoi(range_key + 7) * 100 + atoi(range_key + 10))
+                    ret = CRYPTODB_ERR_FAIL;
+            }
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_get_stats(&cryptodb, &stats);
+            if (CRYPTODB_SUCCESS == ret &&
+                (count != (pass ? 20 : 40) || stats.gets - gets != (uint64_t)count))
+                ret = CRYPTODB_ERR_FAIL;
+
+            // Seek within the bounds
+            count = 0;
+            if (CRYPTODB_SUCCESS == ret)
+            {
+                snprintf(range_key, sizeof(range_key), pass ? "bucket_07_%03d" : "bucket_04_%03d", 10);
+                ret = cryptodb_iterator_seek(&iterator, range_key, strlen(range_key) + 1);
+                entry = cryptodb_iterator_entry(&iterator);
+                if (CRYPTODB_SUCCESS == ret && (entry == NULL || strcmp(entry->key, range_key)))
+                    ret = CRYPTODB_ERR_FAIL;
+                for (; cryptodb_iterator_valid(&iterator); cryptodb_iterator_next(&iterator))
+                    ++count;
+                if (CRYPTODB_SUCCESS == ret && count != (pass ? 11 : 10))
+                    ret = CRYPTODB_ERR_FAIL;
+            }
+            // Seek out of the bounds starts from the bound
+            if (CRYPTODB_SUCCESS == ret)
+            {
+                ret = cryptodb_iterator_seek(&iterator, pass ? "c" : "a", 1);
+                entry = cryptodb_iterator_entry(&iterator);
+                if (CRYPTODB_SUCCESS == ret &&
+                    (entry == NULL || strcmp(entry->key, pass ? "bucket_07_019" : "bucket_03_000")))
+                    ret = CRYPTODB_ERR_FAIL;
+            }
+            cryptodb_iterator_destroy(&iterator);
+        }
+
+        // Prefix without successor, forward and backward
+        for (int pass = 0; pass < 2 && ret == CRYPTODB_SUCCESS; ++pass)
+        {
+            memset(&iterator_options, 0, sizeof(iterator_options));
+            iterator_options.prefix = "\xff";
+            iterator_options.prefix_len = 1;
+            iterator_options.reverse = pass;
+            ret = cryptodb_iterator_create(&cryptodb, &iterator_options, &iterator);
+            if (CRYPTODB_SUCCESS != ret)
+                break;
+            count = 0;
+            for (cryptodb_iterator_seek_to_first(&iterator);
+                 cryptodb_iterator_valid(&iterator);
+                 cryptodb_iterator_next(&iterator), ++count)
+                if (cryptodb_iterator_entry(&iterator)->integer != -1)
+                    ret = CRYPTODB_ERR_FAIL;
+            cryptodb_iterator_destroy(&iterator);
+            if (CRYPTODB_SUCCESS == ret && count != 1)
+                ret = CRYPTODB_ERR_FAIL;
+        }
+
+        // Reverse over everything
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            memset(&iterator_options, 0, sizeof(iterator_options));
+            iterator_options.reverse = 1;
+            ret = cryptodb_iterator_create(&cryptodb, &iterator_options, &iterator);
+        }
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            count = 0;
+            prev_key[0] = '\0';
+            for (cryptodb_iterator_seek_to_first(&iterator);
+                 cryptodb_iterator_valid(&iterator);
+                 cryptodb_iterator_next(&iterator), ++count)
+            {
+                entry = cryptodb_iterator_entry(&iterator);
+                if (count == 1)
+                    strcpy(prev_key, entry->key);
+                else if (count > 1 && strcmp(entry->key, prev_key) >= 0)
+                    ret = CRYPTODB_ERR_FAIL;
+                else if (count > 1)
+                    strcpy(prev_key, entry->key);
+            }
+            cryptodb_iterator_destroy(&iterator);
+            if (CRYPTODB_SUCCESS == ret && (count != 201 || strcmp(prev_key, "bucket_00_000")))
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        cryptodb_close(&cryptodb);
+        options.disable_keys_encryption = 0;
+        if (CRYPTODB_SUCCESS != ret || cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: cryptodb_iterator_seek() range scan\n");
+            return -1;
+        }
+
+        // Encrypted keys aren't ordered
+        memset(&iterator_options, 0, sizeof(iterator_options));
+        iterator_options.prefix = "bucket_";
+        iterator_options.prefix_len = strlen("bucket_");
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret &&
+            CRYPTODB_ERR_WRONG_ARGUMENT != cryptodb_iterator_create(&cryptodb, &iterator_options, &iterator))
+            ret = CRYPTODB_ERR_FAIL;
+        iterator_options.prefix = NULL;
+        iterator_options.reverse = 1;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_iterator_create(&cryptodb, &iterator_options, &iterator);
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            if (CRYPTODB_ERR_WRONG_ARGUMENT != cryptodb_iterator_seek(&iterator, "bucket_", 7))
+                ret = CRYPTODB_ERR_FAIL;
+            cryptodb_iterator_destroy(&iterator);
+        }
+        cryptodb_close(&cryptodb);
+        if (CRYPTODB_SUCCESS != ret || cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: cryptodb_iterator_create() bounds of encrypted keys\n");
+            return -1;
+        }
+    }
+
+    /**
+     * Snapshot test: gets, multi-gets and iterators of a snapshot don't
+     * see the writes done after the snapshot was created
+     */
+
+    {
+        cryptodb_snapshot_t snapshot;
+        cryptodb_iterator_t iterator;
+        cryptodb_iterator_options_t iterator_options;
+        cryptodb_get_item_t items[3];
+        const cryptodb_entry_t *entry = NULL;
+        char snapshot_key[16];
+        int values[3] = {0};
+        int count = 0, sum = 0;
+
+        memset(&snapshot, 0, sizeof(snapshot));
+        memset(&iterator_options, 0, sizeof(iterator_options));
+
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        for (int i = 0; i < 3 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(snapshot_key, sizeof(snapshot_key), "account_%d", i);
+            ret = cryptodb_put_integer(&cryptodb, snapshot_key, strlen(snapshot_key) + 1, 100);
+        }
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_snapshot_create(&cryptodb, &snapshot);
+
+        // Move money between accounts and add an account after the snapshot
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_integer(&cryptodb, "account_0", strlen("account_0") + 1, 50);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_integer(&cryptodb, "account_1", strlen("account_1") + 1, 150);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_delete(&cryptodb, "account_2", strlen("account_2") + 1);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_integer(&cryptodb, "account_3", strlen("account_3") + 1, 100);
+
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_snapshot_get(&snapshot, "account_0", strlen("account_0") + 1,
+                                        CRYPTODB_VAL_NUM_INT, &values[0]);
+        if (CRYPTODB_SUCCESS == ret && values[0] != 100)
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret &&
+            CRYPTODB_ERR_FAIL != cryptodb_snapshot_get(&snapshot, "account_3", strlen("account_3") + 1,
+                                                       CRYPTODB_VAL_NUM_INT, &values[0]))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get(&cryptodb, "account_0", strlen("account_0") + 1,
+                               CRYPTODB_VAL_NUM_INT, &values[0]);
+        if (CRYPTODB_SUCCESS == ret && values[0] != 50)
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            cryptodb_snapshot_release(&snapshot);
+            cryptodb_close(&cryptodb);
+            cryptodb_destroy(TEST_DB_FOLDER, &options);
+            fprintf(stderr, "ERROR: cryptodb_snapshot_get(), error = %d\n", ret);
+            return -1;
+        }
+
+        memset(items, 0, sizeof(items));
+        for (int i = 0; i < 3; ++i)
+        {
+            items[i].key = i == 0 ? "account_0" : (i == 1 ? "account_1" : "account_2");
+            items[i].keylen = strlen(items[i].key) + 1;
+            items[i].valtype = CRYPTODB_VAL_NUM_INT;
+            items[i].val = &values[i];
+        }
+        ret = cryptodb_snapshot_multi_get(&snapshot, items, 3);
+        for (int i = 0; i < 3 && CRYPTODB_SUCCESS == ret; ++i)
+            if (items[i].result != CRYPTODB_SUCCESS || values[i] != 100)
+                ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            cryptodb_snapshot_release(&snapshot);
+            cryptodb_close(&cryptodb);
+            cryptodb_destroy(TEST_DB_FOLDER, &options);
+            fprintf(stderr, "ERROR: cryptodb_snapshot_multi_get()\n");
+            return -1;
+        }
+
+        // The iterator of the snapshot sees the same total balance
+        iterator_options.snapshot = &snapshot;
+        ret = cryptodb_iterator_create(&cryptodb, &iterator_options, &iterator);
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            for (cryptodb_iterator_seek_to_first(&iterator);
+                 cryptodb_iterator_valid(&iterator);
+                 cryptodb_iterator_next(&iterator), ++count)
+            {
+                entry = cryptodb_iterator_entry(&iterator);
+                if (entry->result != CRYPTODB_SUCCESS || entry->valtype != CRYPTODB_VAL_NUM_INT)
+                    ret = CRYPTODB_ERR_FAIL;
+                else
+                    sum += entry->integer;
+            }
+            cryptodb_iterator_destroy(&iterator);
+            if (CRYPTODB_SUCCESS == ret && (count != 3 || sum != 300))
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        cryptodb_snapshot_release(&snapshot);
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            cryptodb_close(&cryptodb);
+            cryptodb_destroy(TEST_DB_FOLDER, &options);
+            fprintf(stderr, "ERROR: snapshot iterator, count = %d, sum = %d\n", count, sum);
+            return -1;
+        }
+
+        // A released snapshot can't be read
+        if (CRYPTODB_ERR_NULL_POINTER != cryptodb_snapshot_get(&snapshot, "account_0", strlen("account_0") + 1,
+                                                               CRYPTODB_VAL_NUM_INT, &values[0]))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret &&
+            CRYPTODB_ERR_WRONG_ARGUMENT != cryptodb_iterator_create(&cryptodb, &iterator_options, &iterator))
+            ret = CRYPTODB_ERR_FAIL;
+        cryptodb_close(&cryptodb);
+        if (CRYPTODB_SUCCESS != ret || cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: released snapshot\n");
+            return -1;
+        }
+    }
+
+    /**
+     * Bloom filter test: lookups of missing keys are answered by the
+     * filter, existing keys are always found
+     */
+
+    {
+        cryptodb_stats_t stats;
+        char bloom_key[32];
+        int value = 0;
+
+        options.bloom_bits_per_key = -1;
+        if (CRYPTODB_ERR_WRONG_ARGUMENT != cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN,
+                                                         &options, NULL, NULL, &cryptodb))
+        {
+            cryptodb_close(&cryptodb);
+            cryptodb_destroy(TEST_DB_FOLDER, &options);
+            fprintf(stderr, "ERROR: cryptodb_open() negative bloom_bits_per_key\n");
+            return -1;
+        }
+
+        options.bloom_bits_per_key = 10;
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        for (int i = 0; i < 200 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(bloom_key, sizeof(bloom_key), "device_%d", i);
+            ret = cryptodb_put_integer(&cryptodb, bloom_key, strlen(bloom_key) + 1, i);
+        }
+        // Filters are built for disk tables only
+        if (CRYPTODB_SUCCESS == ret)
+            leveldb_compact_range(cryptodb.db, NULL, 0, NULL, 0);
+        for (int i = 0; i < 200 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(bloom_key, sizeof(bloom_key), "device_%d", i);
+            ret = cryptodb_get(&cryptodb, bloom_key, strlen(bloom_key) + 1, CRYPTODB_VAL_NUM_INT, &value);
+            if (CRYPTODB_SUCCESS == ret && value != i)
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        for (int i = 200; i < 400 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(bloom_key, sizeof(bloom_key), "device_%d", i);
+            if (CRYPTODB_ERR_FAIL != cryptodb_get(&cryptodb, bloom_key, strlen(bloom_key) + 1,
+                                                  CRYPTODB_VAL_NUM_INT, &value))
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_stats(&cryptodb, &stats);
+        cryptodb_close(&cryptodb);
+        options.bloom_bits_per_key = 0;
+        if (CRYPTODB_SUCCESS != ret ||
+            !stats.filter_avoided_reads || stats.filter_avoided_reads > stats.filter_checks)
+        {
+            cryptodb_destroy(TEST_DB_FOLDER, &options);
+            fprintf(stderr, "ERROR: bloom filter, error = %d\n", ret);
+            return -1;
+        }
+
+        // The tables with filters are readable without the filter
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get(&cryptodb, "device_7", strlen("device_7") + 1, CRYPTODB_VAL_NUM_INT, &value);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_stats(&cryptodb, &stats);
+        cryptodb_close(&cryptodb);
+        if (CRYPTODB_SUCCESS != ret || value != 7 || stats.filter_checks || stats.filter_avoided_reads ||
+            cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: bloom filter disabled, error = %d\n", ret);
+            return -1;
+        }
+    }
+
+    /**
+     * Compression test: values are compressed before encryption only if
+     * it saves enough, compressed values are readable with any options
+     */
+
+    {
+        char *raw = NULL, *err = NULL, *text = NULL, *out = NULL;
+        size_t raw_len[2] = {0}, text_len = 0;
+        cryptodb_iterator_t iterator;
+        const cryptodb_entry_t *entry = NULL;
+        cryptodb_get_item_t item;
+        int count = 0;
+
+        // JSON-like text compresses well, random digits don't save 10%
+        text = (char *)calloc(4096, sizeof(char));
+        out = (char *)calloc(4096, sizeof(char));
+        if (text == NULL || out == NULL)
+        {
+            free(text);
+            free(out);
+            fprintf(stderr, "ERROR: compression test allocation\n");
+            return -1;
+        }
+        while (text_len < 3900)
+            text_len += snprintf(text + text_len, 4096 - text_len,
+                                 "{\"device\":\"sensor-%03d\",\"online\":true},", (int)(text_len % 7));
+
+        options.compression = CRYPTODB_COMPRESSION_UNKNOWN;
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_ERR_WRONG_ARGUMENT == ret)
+        {
+            options.compression = CRYPTODB_COMPRESSION_LZ4;
+            options.compression_min_saving = 100;
+            ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        }
+        if (CRYPTODB_ERR_WRONG_ARGUMENT != ret)
+        {
+            cryptodb_close(&cryptodb);
+            cryptodb_destroy(TEST_DB_FOLDER, &options);
+            free(text);
+            free(out);
+            fprintf(stderr, "ERROR: cryptodb_open() wrong compression options\n");
+            return -1;
+        }
+
+        // The same value with and without compression
+        ret = CRYPTODB_SUCCESS;
+        options.compression_min_saving = 0;
+        options.disable_keys_encryption = 1;
+        for (int c = 0; c < 2 && CRYPTODB_SUCCESS == ret; ++c)
+        {
+            options.compression = c ? CRYPTODB_COMPRESSION_LZ4 : CRYPTODB_COMPRESSION_NONE;
+            ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_put_string(&cryptodb, c ? "lz4" : "none", c ? 4 : 5, text);
+            if (CRYPTODB_SUCCESS == ret)
+                raw = leveldb_get(cryptodb.db, cryptodb.roptions, c ? "lz4" : "none", c ? 4 : 5, &raw_len[c], &err);
+            if (raw == NULL || err)
+                ret = CRYPTODB_ERR_FAIL;
+            if (raw)
+                leveldb_free(raw);
+            if (err)
+                leveldb_free(err);
+            raw = NULL;
+            err = NULL;
+            cryptodb_close(&cryptodb);
+        }
+        if (CRYPTODB_SUCCESS != ret || raw_len[0] < text_len || raw_len[1] * 3 > text_len)
+        {
+            cryptodb_destroy(TEST_DB_FOLDER, &options);
+            free(text);
+            free(out);
+            fprintf(stderr, "ERROR: compressed value length %zu, uncompressed %zu\n", raw_len[1], raw_len[0]);
+            return -1;
+        }
+
+        // Incompressible values are stored as they are
+        for (uint32_t i = 0, x = 2463534242u; i < 256; ++i)
+        {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            out[i] = (char)('0' + x % 10);
+        }
+        out[256] = '\0';
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_string(&cryptodb, "digits", 7, out);
+        if (CRYPTODB_SUCCESS == ret)
+            raw = leveldb_get(cryptodb.db, cryptodb.roptions, "digits", 7, &raw_len[0], &err);
+        if (raw == NULL || err || raw_len[0] < 256)
+            ret = CRYPTODB_ERR_FAIL;
+        if (raw)
+            leveldb_free(raw);
+        if (err)
+            leveldb_free(err);
+        raw = NULL;
+        err = NULL;
+        cryptodb_close(&cryptodb);
+        options.disable_keys_encryption = 0;
+        cryptodb_destroy(TEST_DB_FOLDER, &options);
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            free(text);
+            free(out);
+            fprintf(stderr, "ERROR: incompressible value length %zu\n", raw_len[0]);
+            return -1;
+        }
+
+        // AES-256-GCM values with original keys, read with get, multi-get,
+        // iterator and without compression
+        options.compression = CRYPTODB_COMPRESSION_LZ4;
+        options.value_cipher = CRYPTODB_CIPHER_AES_256_GCM;
+        options.key_mode = CRYPTODB_KEY_MODE_TOKEN_128;
+        options.keep_original_keys = 1;
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_string(&cryptodb, "text", 5, text);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_integer(&cryptodb, "int", 4, 7);
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            memset(out, 0, 4096);
+            ret = cryptodb_get(&cryptodb, "text", 5, CRYPTODB_VAL_STRING, out);
+        }
+        if (CRYPTODB_SUCCESS == ret && strcmp(out, text))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret && CRYPTODB_VAL_STRING != cryptodb_get(&cryptodb, "text", 5,
+                                                                            CRYPTODB_VAL_NUM_INT, &count))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            memset(out, 0, 4096);
+            memset(&item, 0, sizeof(item));
+            item.key = "text";
+            item.keylen = 5;
+            item.valtype = CRYPTODB_VAL_STRING;
+            item.val = out;
+            ret = cryptodb_multi_get(&cryptodb, &item, 1);
+            if (CRYPTODB_SUCCESS == ret && (item.result != CRYPTODB_SUCCESS || strcmp(out, text)))
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_iterator_create(&cryptodb, NULL, &iterator);
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            count = 0;
+            for (cryptodb_iterator_seek_to_first(&iterator);
+                 cryptodb_iterator_valid(&iterator);
+                 cryptodb_iterator_next(&iterator), ++count)
+            {
+                entry = cryptodb_iterator_entry(&iterator);
+                if (entry->result != CRYPTODB_SUCCESS || entry->key == NULL)
+                    ret = CRYPTODB_ERR_FAIL;
+                else if (!strcmp(entry->key, "text") &&
+                         (entry->valtype != CRYPTODB_VAL_STRING || entry->str_len != text_len ||
+                          strcmp(entry->str, text)))
+                    ret = CRYPTODB_ERR_FAIL;
+                else if (!strcmp(entry->key, "int") && entry->integer != 7)
+                    ret = CRYPTODB_ERR_FAIL;
+            }
+            cryptodb_iterator_destroy(&iterator);
+            if (CRYPTODB_SUCCESS == ret && count != 2)
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        cryptodb_close(&cryptodb);
+        options.compression = CRYPTODB_COMPRESSION_NONE;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            memset(out, 0, 4096);
+            ret = cryptodb_get(&cryptodb, "text", 5, CRYPTODB_VAL_STRING, out);
+        }
+        if (CRYPTODB_SUCCESS == ret && strcmp(out, text))
+            ret = CRYPTODB_ERR_FAIL;
+        cryptodb_close(&cryptodb);
+        options.value_cipher = CRYPTODB_CIPHER_AES_256_CBC;
+        options.key_mode = CRYPTODB_KEY_MODE_AES_256_CBC;
+        options.keep_original_keys = 0;
+        free(text);
+        free(out);
+        if (CRYPTODB_SUCCESS != ret || cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: compressed values, error = %d\n", ret);
+            return -1;
+        }
+    }
+
+    /**
+     * Comparator migration test: databases created with the legacy callback
+     * comparator are opened with it and migrated to the built-in one
+     */
+
+    {
+        char *err = NULL;
+        char migrate_key[32];
+        int value = 0;
+        leveldb_t *db = NULL;
+        leveldb_options_t *dboptions = leveldb_options_create();
+        leveldb_comparator_t *cmp = leveldb_comparator_create(NULL,
+                                                              _test_legacy_comparator_destroy,
+                                                              _test_legacy_comparator_compare,
+                                                              _test_legacy_comparator_name);
+
+        leveldb_options_set_create_if_missing(dboptions, 1);
+        leveldb_options_set_comparator(dboptions, cmp);
+        db = leveldb_open(dboptions, TEST_DB_FOLDER, &err);
+        if (db)
+            leveldb_close(db);
+        leveldb_comparator_destroy(cmp);
+        ret = (db == NULL || err) ? CRYPTODB_ERR_FAIL : CRYPTODB_SUCCESS;
+        if (err)
+            leveldb_free(err);
+        err = NULL;
+
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret && cryptodb.cmp == NULL)
+            ret = CRYPTODB_ERR_FAIL;
+        for (int i = 0; i < 100 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(migrate_key, sizeof(migrate_key), "legacy_%d", i);
+            ret = cryptodb_put_integer(&cryptodb, migrate_key, strlen(migrate_key) + 1, i);
+        }
+        // Can't be migrated while it's open
+        if (CRYPTODB_SUCCESS == ret && cryptodb_migrate(TEST_DB_FOLDER, &options) == CRYPTODB_SUCCESS)
+            ret = CRYPTODB_ERR_FAIL;
+        cryptodb_close(&cryptodb);
+
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_migrate(TEST_DB_FOLDER, &options);
+        // Already migrated
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_migrate(TEST_DB_FOLDER "/", &options);
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            // Now it's opened with the built-in comparator
+            leveldb_options_t *builtin_options = leveldb_options_create();
+
+            db = leveldb_open(builtin_options, TEST_DB_FOLDER, &err);
+            if (db == NULL || err)
+                ret = CRYPTODB_ERR_FAIL;
+            if (db)
+                leveldb_close(db);
+            if (err)
+                leveldb_free(err);
+            leveldb_options_destroy(builtin_options);
+        }
+        leveldb_options_destroy(dboptions);
+
+        // Swap interrupted after the original database was moved away:
+        // there's no migrated one, so the original is moved back
+        if (CRYPTODB_SUCCESS == ret && rename(TEST_DB_FOLDER, TEST_DB_FOLDER ".legacy"))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_migrate(TEST_DB_FOLDER, &options);
+        // The same, but the migrated database is complete and takes the place
+        if (CRYPTODB_SUCCESS == ret && rename(TEST_DB_FOLDER, TEST_DB_FOLDER ".migrate"))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_open(TEST_DB_FOLDER ".legacy", uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        cryptodb_close(&cryptodb);
+
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret && cryptodb.cmp != NULL)
+            ret = CRYPTODB_ERR_FAIL;
+        for (int i = 0; i < 100 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            snprintf(migrate_key, sizeof(migrate_key), "legacy_%d", i);
+            ret = cryptodb_get(&cryptodb, migrate_key, strlen(migrate_key) + 1, CRYPTODB_VAL_NUM_INT, &value);
+            if (CRYPTODB_SUCCESS == ret && value != i)
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        cryptodb_close(&cryptodb);
+        // The original database is removed after the swap
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            FILE *legacy = fopen(TEST_DB_FOLDER ".legacy/CURRENT", "rb");
+
+            if (legacy)
+            {
+                fclose(legacy);
+                ret = CRYPTODB_ERR_FAIL;
+            }
+        }
+        if (CRYPTODB_SUCCESS != ret || cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS ||
+            cryptodb_migrate(NULL, &options) != CRYPTODB_ERR_NULL_POINTER ||
+            cryptodb_migrate(TEST_DB_FOLDER, &options) == CRYPTODB_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: comparator migration, error = %d\n", ret);
+            return -1;
+        }
+    }
+
+    /**
+     * Bulk load test: the database appears only after the commit,
+     * aborted and interrupted loads are discarded
+     */
+
+    {
+        cryptodb_bulk_t bulk;
+        char bulk_key[32];
+        char *text = NULL;
+        int value = 0;
+        DIR *dir = NULL;
+
+        text = (char *)calloc(1024, sizeof(char));
+        if (text == NULL ||
+            cryptodb_bulk_begin(NULL, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &bulk) != CRYPTODB_ERR_NULL_POINTER ||
+            cryptodb_bulk_begin(TEST_DB_FOLDER, uniq_data, 0, &options, NULL, NULL, &bulk) != CRYPTODB_ERR_WRONG_ARGUMENT ||
+            cryptodb_bulk_put_integer(NULL, "key", 4, 1) != CRYPTODB_ERR_NULL_POINTER)
+        {
+            free(text);
+            fprintf(stderr, "ERROR: cryptodb_bulk_begin() wrong arguments\n");
+            return -1;
+        }
+
+        // Leftover of an interrupted load
+        ret = cryptodb_open(TEST_DB_FOLDER ".bulk", uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_integer(&cryptodb, "stale", strlen("stale") + 1, 1);
+        cryptodb_close(&cryptodb);
+
+        // More than one window of entries, encrypted by the workers
+        options.worker_threads = 2;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_bulk_begin(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &bulk);
+        for (int i = 0; i < 6000 && ret == CRYPTODB_SUCCESS; ++i)
+        {
+            memset(text, 'a' + i % 26, 1000);
+            snprintf(bulk_key, sizeof(bulk_key), "bulk_str_%d", i);
+            ret = cryptodb_bulk_put_string(&bulk, bulk_key, strlen(bulk_key) + 1, text);
+            snprintf(bulk_key, sizeof(bulk_key), "bulk_int_%d", i);
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_bulk_put_integer(&bulk, bulk_key, strlen(bulk_key) + 1, i);
+        }
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_bulk_put_integer(&bulk, "dup", strlen("dup") + 1, 1);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_bulk_put_double(&bulk, "dup", strlen("dup") + 1, 2.5);
+        if (CRYPTODB_SUCCESS == ret && (!bulk.puts || (dir = opendir(TEST_DB_FOLDER)) != NULL))
+            ret = CRYPTODB_ERR_FAIL;
+        if (dir)
+            (void)closedir(dir);
+        dir = NULL;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_bulk_commit(&bulk);
+        else
+            cryptodb_bulk_abort(&bulk);
+        if (CRYPTODB_SUCCESS == ret && (bulk.state || (dir = opendir(TEST_DB_FOLDER ".bulk")) != NULL))
+            ret = CRYPTODB_ERR_FAIL;
+        if (dir)
+            (void)closedir(dir);
+        dir = NULL;
+        options.worker_threads = 0;
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            free(text);
+            cryptodb_destroy(TEST_DB_FOLDER, &options);
+            cryptodb_destroy(TEST_DB_FOLDER ".bulk", &options);
+            fprintf(stderr, "ERROR: cryptodb_bulk_commit(), error = %d\n", ret);
+            return -1;
+        }
+
+        // Only a new database can be loaded
+        if (cryptodb_bulk_begin(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN,
+                                &options, NULL, NULL, &bulk) != CRYPTODB_ERR_WRONG_ARGUMENT)
+            ret = CRYPTODB_ERR_FAIL;
+
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        for (int i = 0; i < 6000 && ret == CRYPTODB_SUCCESS; i += 7)
+        {
+            snprintf(bulk_key, sizeof(bulk_key), "bulk_str_%d", i);
+            memset(text, 0, 1024);
+            ret = cryptodb_get(&cryptodb, bulk_key, strlen(bulk_key) + 1, CRYPTODB_VAL_STRING, text);
+            if (CRYPTODB_SUCCESS == ret && (strlen(text) != 1000 || text[999] != 'a' + i % 26))
+                ret = CRYPTODB_ERR_FAIL;
+            snprintf(bulk_key, sizeof(bulk_key), "bulk_int_%d", i);
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_get(&cryptodb, bulk_key, strlen(bulk_key) + 1, CRYPTODB_VAL_NUM_INT, &value);
+            if (CRYPTODB_SUCCESS == ret && value != i)
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            double dup = 0;
+            ret = cryptodb_get(&cryptodb, "dup", strlen("dup") + 1, CRYPTODB_VAL_NUM_DOUBLE, &dup);
+            if (CRYPTODB_SUCCESS == ret && !compare_double(dup, 2.5))
+                ret = CRYPTODB_ERR_FAIL;
+        }
+        if (CRYPTODB_SUCCESS == ret &&
+            cryptodb_get(&cryptodb, "stale", strlen("stale") + 1, CRYPTODB_VAL_NUM_INT, &value) != CRYPTODB_ERR_FAIL)
+            ret = CRYPTODB_ERR_FAIL;
+        cryptodb_close(&cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_destroy(TEST_DB_FOLDER, &options);
+
+        // Only the move failed, a file is in the way: the staging database
+        // and the session are kept until the retry
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_bulk_begin(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &bulk);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_bulk_put_integer(&bulk, "retried", strlen("retried") + 1, 1);
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            FILE *blocker = fopen(TEST_DB_FOLDER, "wb");
+
+            if (blocker == NULL)
+                ret = CRYPTODB_ERR_FAIL;
+            else
+                fclose(blocker);
+        }
+        if (CRYPTODB_SUCCESS == ret && cryptodb_bulk_commit(&bulk) != CRYPTODB_ERR_MOVE_FAIL)
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret && (bulk.state == NULL || (dir = opendir(TEST_DB_FOLDER ".bulk")) == NULL))
+            ret = CRYPTODB_ERR_FAIL;
+        if (dir)
+            (void)closedir(dir);
+        dir = NULL;
+        remove(TEST_DB_FOLDER);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_bulk_commit(&bulk);
+        else
+            cryptodb_bulk_abort(&bulk);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get(&cryptodb, "retried", strlen("retried") + 1, CRYPTODB_VAL_NUM_INT, &value);
+        if (CRYPTODB_SUCCESS == ret && value != 1)
+            ret = CRYPTODB_ERR_FAIL;
+        cryptodb_close(&cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_destroy(TEST_DB_FOLDER, &options);
+
+        // Aborted load leaves nothing
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_bulk_begin(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &bulk);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_bulk_put_integer(&bulk, "aborted", strlen("aborted") + 1, 1);
+        cryptodb_bulk_abort(&bulk);
+        cryptodb_bulk_abort(&bulk);
+        if (CRYPTODB_SUCCESS == ret &&
+            ((dir = opendir(TEST_DB_FOLDER)) != NULL || (dir = opendir(TEST_DB_FOLDER ".bulk")) != NULL))
+            ret = CRYPTODB_ERR_FAIL;
+        if (dir)
+            (void)closedir(dir);
+        free(text);
+        if (CRYPTODB_SUCCESS != ret)
+        {
+            cryptodb_destroy(TEST_DB_FOLDER, &options);
+            cryptodb_destroy(TEST_DB_FOLDER ".bulk", &options);
+            fprintf(stderr, "ERROR: bulk load, error = %d\n", ret);
+            return -1;
+        }
+    }
+
+    /**
+     * Caller buffer get test: the value of any type is written only if
+     * it fits, its length and type are reported anyway
+     */
+
+    {
+        char *err = NULL;
+        char long_val[101];
+        char buf[128];
+        size_t len = 0;
+        cryptodb_val_t type = CRYPTODB_VAL_UNKNOWN;
+        cryptodb_snapshot_t snapshot;
+        uint8_t zero_key[32] = {0}, zero_iv[16] = {0};
+
+        memset(long_val, 'x', sizeof(long_val) - 1);
+        long_val[sizeof(long_val) - 1] = '\0';
+
+        // Compressed records report the uncompressed length, legacy
+        // records are put with plaintext keys
+        options.compression = CRYPTODB_COMPRESSION_LZ4;
+        options.disable_keys_encryption = 1;
+        ret = cryptodb_open_with_keys(TEST_DB_FOLDER, zero_key, zero_iv, &options, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_string(&cryptodb, "buf_str", strlen("buf_str") + 1, long_val);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_integer(&cryptodb, "buf_int", strlen("buf_int") + 1, 42);
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            leveldb_put(cryptodb.db, cryptodb.woptions, "legacy_string", strlen("legacy_string") + 1,
+                        (const char *)LEGACY_RECORD_STRING, sizeof(LEGACY_RECORD_STRING), &err);
+            if (err)
+            {
+                leveldb_free(err);
+                ret = CRYPTODB_ERR_FAIL;
+            }
+        }
+
+        memset(buf, 0, sizeof(buf));
+        if (CRYPTODB_SUCCESS == ret &&
+            (cryptodb_get_buf(&cryptodb, "buf_str", strlen("buf_str") + 1, buf, 16, &len, &type) != CRYPTODB_ERR_BUFFER_TOO_SMALL ||
+             len != sizeof(long_val) || type != CRYPTODB_VAL_STRING || buf[0] != '\0'))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret &&
+            (cryptodb_get_buf(&cryptodb, "buf_str", strlen("buf_str") + 1, NULL, 0, &len, NULL) != CRYPTODB_ERR_BUFFER_TOO_SMALL ||
+             len != sizeof(long_val)))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_buf(&cryptodb, "buf_str", strlen("buf_str") + 1, buf, len, &len, &type);
+        if (CRYPTODB_SUCCESS == ret && (len != sizeof(long_val) || strcmp(buf, long_val)))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_buf(&cryptodb, "buf_int", strlen("buf_int") + 1, buf, sizeof(buf), &len, &type);
+        if (CRYPTODB_SUCCESS == ret &&
+            (len != sizeof(int) || type != CRYPTODB_VAL_NUM_INT || memcmp(buf, &(int){42}, sizeof(int))))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_buf(&cryptodb, "legacy_string", strlen("legacy_string") + 1, buf, sizeof(buf), &len, &type);
+        if (CRYPTODB_SUCCESS == ret &&
+            (len != strlen("legacy value") + 1 || type != CRYPTODB_VAL_STRING || strcmp(buf, "legacy value")))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret &&
+            (cryptodb_get_buf(&cryptodb, "missing", strlen("missing") + 1, buf, sizeof(buf), &len, &type) != CRYPTODB_ERR_FAIL ||
+             len || type != CRYPTODB_VAL_UNKNOWN))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret &&
+            cryptodb_get_buf(&cryptodb, "buf_int", strlen("buf_int") + 1, NULL, sizeof(buf), &len, &type) != CRYPTODB_ERR_NULL_POINTER)
+            ret = CRYPTODB_ERR_FAIL;
+
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_snapshot_create(&cryptodb, &snapshot);
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            ret = cryptodb_put_integer(&cryptodb, "buf_int", strlen("buf_int") + 1, 43);
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_snapshot_get_buf(&snapshot, "buf_int", strlen("buf_int") + 1, buf, sizeof(buf), &len, &type);
+            if (CRYPTODB_SUCCESS == ret && (type != CRYPTODB_VAL_NUM_INT || memcmp(buf, &(int){42}, sizeof(int))))
+                ret = CRYPTODB_ERR_FAIL;
+            cryptodb_snapshot_release(&snapshot);
+        }
+
+        cryptodb_close(&cryptodb);
+        options.compression = CRYPTODB_COMPRESSION_NONE;
+        options.disable_keys_encryption = 0;
+        if (CRYPTODB_SUCCESS != ret || cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            cryptodb_destroy(TEST_DB_FOLDER, &options);
+            fprintf(stderr, "ERROR: cryptodb_get_buf(), error = %d\n", ret);
+            return -1;
+        }
+    }
+
+    /**
+     * Blob test: binary data with zeros is stored with its length, it's
+     * read by cryptodb_get_buf() and the iterator
+     */
+
+    {
+        uint8_t data[300], buf[512];
+        size_t len = 0;
+        int value = 0, blobs = 0;
+        cryptodb_val_t type = CRYPTODB_VAL_UNKNOWN;
+        cryptodb_bulk_t bulk;
+        cryptodb_batch_t batch;
+        cryptodb_get_item_t item;
+        cryptodb_iterator_t iterator;
+        const cryptodb_entry_t *entry = NULL;
+
+        for (size_t i = 0; i < sizeof(data); ++i)
+            data[i] = (uint8_t)(i % 5);
+
+        // The original keys are put after the blob by the iterator
+        options.keep_original_keys = 1;
+        ret = cryptodb_bulk_begin(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &bulk);
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            ret = cryptodb_bulk_put_blob(&bulk, "bulk_blob", strlen("bulk_blob") + 1, data, sizeof(data));
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_bulk_put_blob(&bulk, "bulk_empty", strlen("bulk_empty") + 1, NULL, 0);
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_bulk_commit(&bulk);
+            else
+                cryptodb_bulk_abort(&bulk);
+        }
+
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_blob(&cryptodb, "blob", strlen("blob") + 1, data, sizeof(data));
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_blob(&cryptodb, "empty", strlen("empty") + 1, NULL, 0);
+        if (CRYPTODB_SUCCESS == ret &&
+            cryptodb_put_blob(&cryptodb, "null", strlen("null") + 1, NULL, 1) != CRYPTODB_ERR_NULL_POINTER)
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            ret = cryptodb_batch_create(&cryptodb, &batch);
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_batch_put_blob(&batch, "batch_blob", strlen("batch_blob") + 1, data, 17);
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_batch_commit(&batch);
+            cryptodb_batch_destroy(&batch);
+        }
+
+        if (CRYPTODB_SUCCESS == ret &&
+            (cryptodb_get_buf(&cryptodb, "blob", strlen("blob") + 1, buf, 16, &len, &type) != CRYPTODB_ERR_BUFFER_TOO_SMALL ||
+             len != sizeof(data) || type != CRYPTODB_VAL_BLOB))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_buf(&cryptodb, "blob", strlen("blob") + 1, buf, sizeof(buf), &len, &type);
+        if (CRYPTODB_SUCCESS == ret && (len != sizeof(data) || memcmp(buf, data, sizeof(data))))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_buf(&cryptodb, "bulk_blob", strlen("bulk_blob") + 1, buf, sizeof(buf), &len, &type);
+        if (CRYPTODB_SUCCESS == ret && (len != sizeof(data) || type != CRYPTODB_VAL_BLOB || memcmp(buf, data, sizeof(data))))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_buf(&cryptodb, "batch_blob", strlen("batch_blob") + 1, buf, sizeof(buf), &len, &type);
+        if (CRYPTODB_SUCCESS == ret && (len != 17 || type != CRYPTODB_VAL_BLOB || memcmp(buf, data, 17)))
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_buf(&cryptodb, "empty", strlen("empty") + 1, NULL, 0, &len, &type);
+        if (CRYPTODB_SUCCESS == ret && (len || type != CRYPTODB_VAL_BLOB))
+            ret = CRYPTODB_ERR_FAIL;
+
+        // The blob length isn't known to cryptodb_get()
+        if (CRYPTODB_SUCCESS == ret &&
+            (cryptodb_get(&cryptodb, "blob", strlen("blob") + 1, CRYPTODB_VAL_BLOB, buf) != CRYPTODB_ERR_WRONG_ARGUMENT ||
+             cryptodb_get(&cryptodb, "blob", strlen("blob") + 1, CRYPTODB_VAL_NUM_INT, &value) != CRYPTODB_VAL_BLOB))
+            ret = CRYPTODB_ERR_FAIL;
+        memset(&item, 0, sizeof(item));
+        item.key = "blob";
+        item.keylen = strlen("blob") + 1;
+        item.valtype = CRYPTODB_VAL_BLOB;
+        item.val = buf;
+        if (CRYPTODB_SUCCESS == ret &&
+            (cryptodb_multi_get(&cryptodb, &item, 1) != CRYPTODB_SUCCESS ||
+             item.result != CRYPTODB_ERR_WRONG_ARGUMENT))
+            ret = CRYPTODB_ERR_FAIL;
+
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_iterator_create(&cryptodb, NULL, &iterator);
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            for (cryptodb_iterator_seek_to_first(&iterator);
+                 cryptodb_iterator_valid(&iterator) && ret == CRYPTODB_SUCCESS;
+                 cryptodb_iterator_next(&iterator))
+            {
+                entry = cryptodb_iterator_entry(&iterator);
+                if (entry->result != CRYPTODB_SUCCESS || entry->valtype != CRYPTODB_VAL_BLOB ||
+                    entry->key == NULL || entry->str == NULL)
+                    ret = CRYPTODB_ERR_FAIL;
+                else if (!strcmp(entry->key, "blob") &&
+                         (entry->str_len != sizeof(data) || memcmp(entry->str, data, sizeof(data))))
+                    ret = CRYPTODB_ERR_FAIL;
+                else if (!strcmp(entry->key, "empty") && entry->str_len)
+                    ret = CRYPTODB_ERR_FAIL;
+                ++blobs;
+            }
+            cryptodb_iterator_destroy(&iterator);
+        }
+
+        cryptodb_close(&cryptodb);
+        options.keep_original_keys = 0;
+        if (CRYPTODB_SUCCESS != ret || blobs != 5 ||
+            cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            cryptodb_destroy(TEST_DB_FOLDER, &options);
+            fprintf(stderr, "ERROR: cryptodb_put_blob(), error = %d\n", ret);
+            return -1;
+        }
+    }
+
+    /**
+     * 64-bit integer test: int64 and uint64 values are stored exactly,
+     * also the ones that a double can't hold
+     */
+
+    {
+        int64_t i64 = 0;
+        uint64_t u64 = 0;
+        uint8_t buf[16];
+        size_t len = 0;
+        int ints = 0;
+        cryptodb_val_t type = CRYPTODB_VAL_UNKNOWN;
+        cryptodb_batch_t batch;
+        cryptodb_get_item_t items[2];
+        cryptodb_iterator_t iterator;
+        const cryptodb_entry_t *entry = NULL;
+        const int64_t big = ((int64_t)1 << 53) + 1;
+
+        ret = cryptodb_open(TEST_DB_FOLDER, uniq_data, CRYPTODB_UNIQ_DATA_MAX_LEN, &options, NULL, NULL, &cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_int64(&cryptodb, "int64_min", strlen("int64_min") + 1, INT64_MIN);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_uint64(&cryptodb, "uint64_max", strlen("uint64_max") + 1, UINT64_MAX);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_int64_async(&cryptodb, "int64_big", strlen("int64_big") + 1, big, NULL, NULL);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_flush(&cryptodb);
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_put_integer(&cryptodb, "int32", strlen("int32") + 1, -1);
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            ret = cryptodb_batch_create(&cryptodb, &batch);
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_batch_put_uint64(&batch, "uint64_batch", strlen("uint64_batch") + 1, (uint64_t)big);
+            if (CRYPTODB_SUCCESS == ret)
+                ret = cryptodb_batch_commit(&batch);
+            cryptodb_batch_destroy(&batch);
+        }
+
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_int64(&cryptodb, "int64_min", strlen("int64_min") + 1, &i64);
+        if (CRYPTODB_SUCCESS == ret && i64 != INT64_MIN)
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_int64(&cryptodb, "int64_big", strlen("int64_big") + 1, &i64);
+        if (CRYPTODB_SUCCESS == ret && i64 != big)
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_uint64(&cryptodb, "uint64_max", strlen("uint64_max") + 1, &u64);
+        if (CRYPTODB_SUCCESS == ret && u64 != UINT64_MAX)
+            ret = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_uint64(&cryptodb, "uint64_batch", strlen("uint64_batch") + 1, &u64);
+        if (CRYPTODB_SUCCESS == ret && u64 != (uint64_t)big)
+            ret = CRYPTODB_ERR_FAIL;
+
+        // The types aren't converted into each other
+        if (CRYPTODB_SUCCESS == ret &&
+            (cryptodb_get_int64(&cryptodb, "int32", strlen("int32") + 1, &i64) != CRYPTODB_VAL_NUM_INT ||
+             cryptodb_get_int64(&cryptodb, "uint64_max", strlen("uint64_max") + 1, &i64) != CRYPTODB_VAL_NUM_UINT64 ||
+             cryptodb_get_uint64(&cryptodb, "int64_min", strlen("int64_min") + 1, &u64) != CRYPTODB_VAL_NUM_INT64))
+            ret = CRYPTODB_ERR_FAIL;
+
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_get_buf(&cryptodb, "int64_min", strlen("int64_min") + 1, buf, sizeof(buf), &len, &type);
+        if (CRYPTODB_SUCCESS == ret && (len != sizeof(int64_t) || type != CRYPTODB_VAL_NUM_INT64))
+            ret = CRYPTODB_ERR_FAIL;
+
+        memset(items, 0, sizeof(items));
+        items[0].key = "int64_big";
+        items[0].keylen = strlen("int64_big") + 1;
+        items[0].valtype = CRYPTODB_VAL_NUM_INT64;
+        items[0].val = &i64;
+        items[1].key = "uint64_max";
+        items[1].keylen = strlen("uint64_max") + 1;
+        items[1].valtype = CRYPTODB_VAL_NUM_UINT64;
+        items[1].val = &u64;
+        i64 = 0;
+        u64 = 0;
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_multi_get(&cryptodb, items, 2);
+        if (CRYPTODB_SUCCESS == ret &&
+            (items[0].result != CRYPTODB_SUCCESS || items[1].result != CRYPTODB_SUCCESS ||
+             i64 != big || u64 != UINT64_MAX))
+            ret = CRYPTODB_ERR_FAIL;
+
+        if (CRYPTODB_SUCCESS == ret)
+            ret = cryptodb_iterator_create(&cryptodb, NULL, &iterator);
+        if (CRYPTODB_SUCCESS == ret)
+        {
+            for (cryptodb_iterator_seek_to_first(&iterator);
+                 cryptodb_iterator_valid(&iterator) && ret == CRYPTODB_SUCCESS;
+                 cryptodb_iterator_next(&iterator))
+            {
+                entry = cryptodb_iterator_entry(&iterator);
+                if (entry->result != CRYPTODB_SUCCESS)
+                    ret = entry->result;
+                else if (entry->valtype == CRYPTODB_VAL_NUM_INT64 &&
+                         entry->integer64 != INT64_MIN && entry->integer64 != big)
+                    ret = CRYPTODB_ERR_FAIL;
+                else if (entry->valtype == CRYPTODB_VAL_NUM_UINT64 &&
+                         entry->uinteger64 != UINT64_MAX && entry->uinteger64 != (uint64_t)big)
+                    ret = CRYPTODB_ERR_FAIL;
+                if (entry->valtype == CRYPTODB_VAL_NUM_INT64 || entry->valtype == CRYPTODB_VAL_NUM_UINT64)
+                    ++ints;
+            }
+            cryptodb_iterator_destroy(&iterator);
+        }
+
+        cryptodb_close(&cryptodb);
+        if (CRYPTODB_SUCCESS != ret || ints != 4 ||
+            cryptodb_destroy(TEST_DB_FOLDER, &options) != CRYPTODB_SUCCESS)
+        {
+            cryptodb_destroy(TEST_DB_FOLDER, &options);
+            fprintf(stderr, "ERROR: cryptodb_put_int64(), error = %d\n", ret);
+            return -1;
+        }
+    }
+
     fprintf(stdout, "PASS\n");
 
     return 0;
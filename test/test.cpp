@@ -22,7 +22,10 @@
 
 #include <cmath>
 #include <cfloat>
+#include <array>
 #include <cstring>
+#include <future>
+#include <vector>
 #include <iostream>
 
 #include "cryptodb.hpp"
@@ -32,6 +35,21 @@ using namespace cryptodb;
 
 #define TEST_DB_FOLDER "db"
 
+// Stored by Codec as binary data
+struct TestPoint
+{
+    int32_t x;
+    int32_t y;
+    double weight;
+};
+
+static_assert(Codec<TestPoint>::can_decode, "POD structs have a codec");
+static_assert(Codec<uint32_t>::can_decode && Codec<uint16_t>::can_decode &&
+              Codec<uint8_t>::can_decode && Codec<int16_t>::can_decode &&
+              Codec<int8_t>::can_decode && Codec<float>::can_decode &&
+              Codec<bool>::can_decode, "narrow numbers have a codec");
+static_assert(!Codec<long double>::can_encode, "long double has no codec");
+
 static bool compare_double(double a, double b)
 {
     double maxVal = fabs(a) > fabs(b) ? fabs(a) : fabs(b);
@@ -272,6 +290,808 @@ int main(int argc, char **argv)
         return -1;
     }
 
+    /**
+     * Write batch
+     */
+
+    err = CryptoDB::OpenWithKeys(TEST_DB_FOLDER,
+                                 key, iv, NULL, &db);
+    if (CRYPTODB_SUCCESS != err || db == nullptr)
+    {
+        if (db != nullptr)
+            delete db;
+        cerr << "ERROR: OpenWithKeys() #2" << endl;
+        return -1;
+    }
+
+    {
+        CryptoDBBatch *batch = nullptr;
+        string *test_string = nullptr, *deleted_string = nullptr;
+        int *test_int = nullptr;
+
+        test_double = nullptr;
+
+        err = db->PutString("batch_deleted", "deleted");
+        if (CRYPTODB_SUCCESS == err)
+            err = db->CreateBatch(&batch);
+        if (CRYPTODB_SUCCESS == err)
+            err = batch->PutString("batch_string", "batch value");
+        if (CRYPTODB_SUCCESS == err)
+            err = batch->PutInteger("batch_int", 7);
+        if (CRYPTODB_SUCCESS == err)
+            err = batch->PutDouble("batch_double", 1.5);
+        if (CRYPTODB_SUCCESS == err)
+            err = batch->Delete("batch_deleted");
+        if (CRYPTODB_SUCCESS == err)
+            err = batch->Commit();
+        if (CRYPTODB_SUCCESS == err)
+            err = batch->PutInteger("batch_int", 8);
+        if (batch != nullptr)
+        {
+            batch->Clear();
+            delete batch;
+        }
+        if (CRYPTODB_SUCCESS == err)
+            err = db->GetString("batch_string", 64, &test_string);
+        if (CRYPTODB_SUCCESS == err)
+            err = db->GetInteger("batch_int", &test_int);
+        if (CRYPTODB_SUCCESS == err)
+            err = db->GetDouble("batch_double", &test_double);
+        if (CRYPTODB_SUCCESS != err ||
+            *test_string != "batch value" || *test_int != 7 || !compare_double(*test_double, 1.5) ||
+            CRYPTODB_SUCCESS == db->GetString("batch_deleted", 64, &deleted_string))
+        {
+            delete deleted_string;
+            delete test_string;
+            delete test_int;
+            delete test_double;
+            db->Close();
+            delete db;
+            cerr << "ERROR: CryptoDBBatch" << endl;
+            return -1;
+        }
+
+        delete test_string;
+        delete test_int;
+        delete test_double;
+    }
+
+    db->Close();
+    delete db;
+    db = nullptr;
+
+    err = CryptoDB::Destroy(TEST_DB_FOLDER, NULL);
+    if (CRYPTODB_SUCCESS != err)
+    {
+        cerr << "ERROR: Destroy() #3" << endl;
+        return -1;
+    }
+
+    /**
+     * Asynchronous writes
+     */
+
+    err = CryptoDB::OpenWithKeys(TEST_DB_FOLDER,
+                                 key, iv, NULL, &db);
+    if (CRYPTODB_SUCCESS != err || db == nullptr)
+    {
+        if (db != nullptr)
+            delete db;
+        cerr << "ERROR: OpenWithKeys() #3" << endl;
+        return -1;
+    }
+
+    {
+        string *test_string = nullptr, *deleted_string = nullptr;
+        int *test_int = nullptr;
+
+        test_double = nullptr;
+
+        future<int> put_string = db->PutStringAsync("async_string", "async value");
+        future<int> put_int = db->PutIntegerAsync("async_int", 9);
+        future<int> put_double = db->PutDoubleAsync("async_double", 2.5);
+        future<int> put_deleted = db->PutStringAsync("async_deleted", "deleted");
+        future<int> deleted = db->DeleteAsync("async_deleted");
+
+        err = put_string.get();
+        if (CRYPTODB_SUCCESS == err)
+            err = put_int.get();
+        if (CRYPTODB_SUCCESS == err)
+            err = put_double.get();
+        if (CRYPTODB_SUCCESS == err)
+            err = put_deleted.get();
+        if (CRYPTODB_SUCCESS == err)
+            err = deleted.get();
+        if (CRYPTODB_SUCCESS == err)
+            err = db->Flush();
+        if (CRYPTODB_SUCCESS == err)
+            err = db->GetString("async_string", 64, &test_string);
+        if (CRYPTODB_SUCCESS == err)
+            err = db->GetInteger("async_int", &test_int);
+        if (CRYPTODB_SUCCESS == err)
+            err = db->GetDouble("async_double", &test_double);
+        if (CRYPTODB_SUCCESS != err ||
+            *test_string != "async value" || *test_int != 9 || !compare_double(*test_double, 2.5) ||
+            CRYPTODB_SUCCESS == db->GetString("async_deleted", 64, &deleted_string))
+        {
+            delete deleted_string;
+            delete test_string;
+            delete test_int;
+            delete test_double;
+            db->Close();
+            delete db;
+            cerr << "ERROR: PutStringAsync()" << endl;
+            return -1;
+        }
+
+        delete test_string;
+        delete test_int;
+        delete test_double;
+    }
+
+    /**
+     * Multi-get
+     */
+
+    {
+        vector<CryptoDBGetItem> items(4);
+
+        items[0].key = "async_string";
+        items[0].type = CRYPTODB_VAL_STRING;
+        items[0].expected_max_length = 64;
+        items[1].key = "async_int";
+        items[1].type = CRYPTODB_VAL_NUM_INT;
+        items[2].key = "async_double";
+        items[2].type = CRYPTODB_VAL_NUM_DOUBLE;
+        items[3].key = "async_deleted";
+        items[3].type = CRYPTODB_VAL_STRING;
+        items[3].expected_max_length = 64;
+
+        err = db->MultiGet(items);
+        if (CRYPTODB_SUCCESS != err ||
+            CRYPTODB_SUCCESS != items[0].result || items[0].str != "async value" ||
+            CRYPTODB_SUCCESS != items[1].result || items[1].integer != 9 ||
+            CRYPTODB_SUCCESS != items[2].result || !compare_double(items[2].number, 2.5) ||
+            CRYPTODB_SUCCESS == items[3].result)
+        {
+            db->Close();
+            delete db;
+            cerr << "ERROR: MultiGet()" << endl;
+            return -1;
+        }
+    }
+
+    /**
+     * Iterator
+     */
+
+    {
+        size_t entries = 0;
+        CryptoDBIterator *iterator = nullptr;
+        cryptodb_iterator_options_t iterator_options;
+
+        memset(&iterator_options, 0, sizeof(iterator_options));
+        iterator_options.read_ahead = 2;
+
+        err = db->CreateIterator(&iterator_options, &iterator);
+        if (CRYPTODB_SUCCESS == err)
+        {
+            for (const CryptoDBEntry &entry : *iterator)
+            {
+                ++entries;
+                if (CRYPTODB_SUCCESS != entry.result)
+                    err = entry.result;
+                else if (entry.key == "async_string")
+                    err = (entry.type == CRYPTODB_VAL_STRING && entry.str == "async value") ?
+                          CRYPTODB_SUCCESS : CRYPTODB_ERR_FAIL;
+                else if (entry.key == "async_int")
+                    err = (entry.type == CRYPTODB_VAL_NUM_INT && entry.integer == 9) ?
+                          CRYPTODB_SUCCESS : CRYPTODB_ERR_FAIL;
+                else if (entry.key == "async_double")
+                    err = (entry.type == CRYPTODB_VAL_NUM_DOUBLE && compare_double(entry.number, 2.5)) ?
+                          CRYPTODB_SUCCESS : CRYPTODB_ERR_FAIL;
+                else
+                    err = CRYPTODB_ERR_FAIL;
+                if (CRYPTODB_SUCCESS != err)
+                    break;
+            }
+        }
+        if (CRYPTODB_SUCCESS == err && iterator->begin() == iterator->end())
+            err = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == err)
+            err = iterator->Status();
+        delete iterator;
+        if (CRYPTODB_SUCCESS != err || entries != 3)
+        {
+            db->Close();
+            delete db;
+            cerr << "ERROR: CreateIterator()" << endl;
+            return -1;
+        }
+    }
+
+    db->Close();
+    delete db;
+    db = nullptr;
+
+    err = CryptoDB::Destroy(TEST_DB_FOLDER, NULL);
+    if (CRYPTODB_SUCCESS != err)
+    {
+        cerr << "ERROR: Destroy() #4" << endl;
+        return -1;
+    }
+
+    /**
+     * Range scan of plaintext keys
+     */
+
+    cryptodb_options_t options;
+
+    memset(&options, 0, sizeof(options));
+    options.block_size = CRYPTODB_OPT_DEFAULT_BLOCK_SIZE;
+    options.max_open_files = CRYPTODB_OPT_DEFAULT_MAX_FILES;
+    options.cache_capacity = CRYPTODB_OPT_DEFAULT_CACHE_SIZE;
+    options.max_file_size = CRYPTODB_OPT_DEFAULT_MAX_FILE_SIZE;
+    options.write_buffer_size = CRYPTODB_OPT_DEFAULT_WR_BUF_SIZE;
+    options.block_restart_interval = CRYPTODB_OPT_DEFAULT_BLOCK_RE_INT;
+    options.disable_keys_encryption = 1;
+    err = CryptoDB::OpenWithKeys(TEST_DB_FOLDER,
+                                 key, iv, &options, &db);
+    if (CRYPTODB_SUCCESS != err || db == nullptr)
+    {
+        if (db != nullptr)
+            delete db;
+        cerr << "ERROR: OpenWithKeys() #4" << endl;
+        return -1;
+    }
+
+    {
+        vector<string> keys, expected;
+        CryptoDBIterator *iterator = nullptr;
+        cryptodb_iterator_options_t iterator_options;
+        int value = 0;
+
+        for (int i = 0; i < 10 && CRYPTODB_SUCCESS == err; ++i)
+            err = db->PutInteger("day_" + to_string(i), i);
+        if (CRYPTODB_SUCCESS == err)
+            err = db->PutInteger("week_0", 0);
+
+        memset(&iterator_options, 0, sizeof(iterator_options));
+        iterator_options.prefix = "day_";
+        iterator_options.prefix_len = strlen("day_");
+        iterator_options.reverse = 1;
+        if (CRYPTODB_SUCCESS == err)
+            err = db->CreateIterator(&iterator_options, &iterator);
+        if (CRYPTODB_SUCCESS == err)
+            err = iterator->Seek("day_5");
+        for (; CRYPTODB_SUCCESS == err && iterator->Valid(); iterator->Next())
+            keys.push_back(iterator->Entry().key);
+        delete iterator;
+
+        // Plaintext keys aren't padded, they come back exactly as written,
+        // with the terminating zero of the std::string API
+        for (int i = 5; i >= 0; --i)
+            expected.push_back("day_" + to_string(i) + '\0');
+        if (CRYPTODB_SUCCESS == err && keys == expected)
+            err = db->Get(keys.front(), value);
+        if (CRYPTODB_SUCCESS != err || keys != expected || value != 5)
+        {
+            db->Close();
+            delete db;
+            cerr << "ERROR: Seek()" << endl;
+            return -1;
+        }
+    }
+
+    /**
+     * Snapshot
+     */
+
+    {
+        int *value = nullptr;
+        int sum = 0;
+        CryptoDBSnapshot *snapshot = nullptr;
+        CryptoDBIterator *iterator = nullptr;
+        cryptodb_iterator_options_t iterator_options;
+        vector<CryptoDBGetItem> items(2);
+
+        err = db->CreateSnapshot(&snapshot);
+        if (CRYPTODB_SUCCESS == err)
+            err = db->PutInteger("day_0", 100);
+        if (CRYPTODB_SUCCESS == err)
+            err = db->Delete("day_9");
+        if (CRYPTODB_SUCCESS == err)
+            err = snapshot->GetInteger("day_0", &value);
+        if (CRYPTODB_SUCCESS == err && *value != 0)
+            err = CRYPTODB_ERR_FAIL;
+        delete value;
+
+        items[0].key = "day_0";
+        items[0].type = CRYPTODB_VAL_NUM_INT;
+        items[1].key = "day_9";
+        items[1].type = CRYPTODB_VAL_NUM_INT;
+        if (CRYPTODB_SUCCESS == err)
+            err = snapshot->MultiGet(items);
+        if (CRYPTODB_SUCCESS == err &&
+            (items[0].result != CRYPTODB_SUCCESS || items[0].integer != 0 ||
+             items[1].result != CRYPTODB_SUCCESS || items[1].integer != 9))
+            err = CRYPTODB_ERR_FAIL;
+
+        memset(&iterator_options, 0, sizeof(iterator_options));
+        iterator_options.prefix = "day_";
+        iterator_options.prefix_len = strlen("day_");
+        if (CRYPTODB_SUCCESS == err)
+            err = snapshot->CreateIterator(&iterator_options, &iterator);
+        if (CRYPTODB_SUCCESS == err)
+        {
+            for (const CryptoDBEntry &entry : *iterator)
+                sum += entry.integer;
+        }
+        delete iterator;
+        delete snapshot;
+        if (CRYPTODB_SUCCESS != err || sum != 45)
+        {
+            db->Close();
+            delete db;
+            cerr << "ERROR: CreateSnapshot()" << endl;
+            return -1;
+        }
+    }
+
+    db->Close();
+    delete db;
+    db = nullptr;
+
+    /**
+     * Migrate
+     */
+
+    // The database already uses the built-in comparator
+    err = CryptoDB::Migrate(TEST_DB_FOLDER, NULL);
+    if (CRYPTODB_SUCCESS != err)
+    {
+        cerr << "ERROR: Migrate()" << endl;
+        return -1;
+    }
+
+    err = CryptoDB::Destroy(TEST_DB_FOLDER, NULL);
+    if (CRYPTODB_SUCCESS != err)
+    {
+        cerr << "ERROR: Destroy() #5" << endl;
+        return -1;
+    }
+
+    /**
+     * Bulk load
+     */
+
+    {
+        CryptoDBBulkLoad *bulk = nullptr;
+        int *value = nullptr;
+
+        err = CryptoDBBulkLoad::Begin(TEST_DB_FOLDER,
+                                      uniq_data,
+                                      CRYPTODB_UNIQ_DATA_MAX_LEN,
+                                      NULL, NULL, NULL, &bulk);
+        for (int i = 0; i < 100 && CRYPTODB_SUCCESS == err; ++i)
+            err = bulk->PutInteger("bulk_" + std::to_string(i), i);
+        if (CRYPTODB_SUCCESS == err)
+            err = bulk->Commit();
+        delete bulk;
+        if (CRYPTODB_SUCCESS == err)
+            err = CryptoDB::Open(TEST_DB_FOLDER,
+                                 uniq_data,
+                                 CRYPTODB_UNIQ_DATA_MAX_LEN,
+                                 NULL, NULL, NULL, &db);
+        if (CRYPTODB_SUCCESS == err)
+        {
+            err = db->GetInteger("bulk_42", &value);
+            if (CRYPTODB_SUCCESS == err && (value == nullptr || *value != 42))
+                err = CRYPTODB_ERR_FAIL;
+            delete value;
+            db->Close();
+            delete db;
+            db = nullptr;
+        }
+        if (CRYPTODB_SUCCESS != err || CRYPTODB_SUCCESS != CryptoDB::Destroy(TEST_DB_FOLDER, NULL))
+        {
+            cerr << "ERROR: CryptoDBBulkLoad" << endl;
+            return -1;
+        }
+    }
+
+    /**
+     * std::string_view API
+     */
+
+    {
+        CryptoDB opened;
+        const char binary_key[] = {'b', 'i', 'n', '\0', 'k', 'e', 'y'};
+        const std::string_view key(binary_key, sizeof(binary_key));
+        const std::string_view other_key(binary_key, 3);
+        std::string str;
+        int integer = 0;
+        double number = 0.0;
+
+        err = CryptoDB::Open(TEST_DB_FOLDER,
+                             uniq_data,
+                             CRYPTODB_UNIQ_DATA_MAX_LEN,
+                             NULL, NULL, NULL, opened);
+        CryptoDB moved(std::move(opened));
+
+        // Keys with zeros inside are different keys
+        if (CRYPTODB_SUCCESS == err)
+            err = moved.Put(key, 42);
+        if (CRYPTODB_SUCCESS == err)
+            err = moved.Put(other_key, 4.2);
+        if (CRYPTODB_SUCCESS == err)
+            err = moved.Get(key, integer);
+        if (CRYPTODB_SUCCESS == err && integer != 42)
+            err = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == err)
+            err = moved.Get(other_key, number);
+        if (CRYPTODB_SUCCESS == err && number != 4.2)
+            err = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == err && moved.Get(key, number) != CRYPTODB_VAL_NUM_INT)
+            err = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == err &&
+            (moved.GetInteger(key) != 42 || moved.GetDouble(key) || moved.GetInteger("missing")))
+            err = CRYPTODB_ERR_FAIL;
+
+        // The string is reused, and the std::string API writes the key
+        // with the terminating zero
+        str.reserve(64);
+        const char *data = str.data();
+        if (CRYPTODB_SUCCESS == err)
+            err = moved.PutString("view", "value");
+        if (CRYPTODB_SUCCESS == err)
+            err = moved.Get(std::string_view("view", 5), str);
+        if (CRYPTODB_SUCCESS == err && (str != "value" || str.data() != data))
+            err = CRYPTODB_ERR_FAIL;
+        // Longer than the capacity
+        if (CRYPTODB_SUCCESS == err)
+            err = moved.Put(key, std::string(1000, 'v'));
+        if (CRYPTODB_SUCCESS == err)
+            err = moved.Get(key, str);
+        if (CRYPTODB_SUCCESS == err && str != std::string(1000, 'v'))
+            err = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == err && moved.Get(other_key, str) != CRYPTODB_VAL_NUM_DOUBLE)
+            err = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == err && moved.Put("view", std::string_view("a\0b", 3)) != CRYPTODB_ERR_WRONG_ARGUMENT)
+            err = CRYPTODB_ERR_FAIL;
+
+        // The iterator strips only the terminating and padding zeros
+        if (CRYPTODB_SUCCESS == err)
+        {
+            CryptoDBIterator *iterator = NULL;
+            size_t found = 0;
+
+            err = moved.CreateIterator(NULL, &iterator);
+            if (CRYPTODB_SUCCESS == err)
+            {
+                for (const CryptoDBEntry &entry : *iterator)
+                {
+                    if (CRYPTODB_SUCCESS != entry.result)
+                        err = entry.result;
+                    else if ((entry.key == key && entry.type == CRYPTODB_VAL_STRING) ||
+                             (entry.key == other_key && entry.type == CRYPTODB_VAL_NUM_DOUBLE) ||
+                             (entry.key == "view" && entry.str == "value"))
+                        ++found;
+                }
+            }
+            delete iterator;
+            if (CRYPTODB_SUCCESS == err && found != 3)
+                err = CRYPTODB_ERR_FAIL;
+        }
+
+        if (CRYPTODB_SUCCESS == err)
+            err = moved.Remove(key);
+        if (CRYPTODB_SUCCESS == err && moved.GetInteger(key))
+            err = CRYPTODB_ERR_FAIL;
+
+        // Move assignment closes the database
+        moved = CryptoDB();
+        if (CRYPTODB_SUCCESS != err || CRYPTODB_SUCCESS != CryptoDB::Destroy(TEST_DB_FOLDER, NULL))
+        {
+            cerr << "ERROR: std::string_view API" << endl;
+            return -1;
+        }
+    }
+
+    /**
+     * Iterator keys of the token key modes
+     */
+
+    {
+        CryptoDB tokens;
+        CryptoDBIterator *iterator = nullptr;
+        const string binary_key("bin\0key", 7);
+        size_t found = 0;
+        int value = 0;
+
+        memset(&options, 0, sizeof(options));
+        options.key_mode = CRYPTODB_KEY_MODE_TOKEN_128;
+        options.keep_original_keys = 1;
+        err = CryptoDB::Open(TEST_DB_FOLDER,
+                             uniq_data,
+                             CRYPTODB_UNIQ_DATA_MAX_LEN,
+                             &options, NULL, NULL, tokens);
+        if (CRYPTODB_SUCCESS == err)
+            err = tokens.Put(binary_key, 1);
+        if (CRYPTODB_SUCCESS == err)
+            err = tokens.PutInteger("key", 2);
+        if (CRYPTODB_SUCCESS == err)
+            err = tokens.CreateIterator(NULL, &iterator);
+        if (CRYPTODB_SUCCESS == err)
+        {
+            // Original keys are returned exactly as they were written
+            for (const CryptoDBEntry &entry : *iterator)
+            {
+                if (CRYPTODB_SUCCESS != entry.result)
+                    err = entry.result;
+                else if (CRYPTODB_SUCCESS == tokens.Get(entry.key, value) &&
+                         ((entry.key == binary_key && value == 1) ||
+                          (entry.key == string("key", 4) && value == 2)))
+                    ++found;
+            }
+        }
+        delete iterator;
+
+        tokens.Close();
+        if (CRYPTODB_SUCCESS != err || found != 2 || CRYPTODB_SUCCESS != CryptoDB::Destroy(TEST_DB_FOLDER, NULL))
+        {
+            cerr << "ERROR: token key mode iterator" << endl;
+            return -1;
+        }
+    }
+
+    /**
+     * Blob values
+     */
+
+    {
+        CryptoDB blobs;
+        CryptoDBSnapshot *snapshot = nullptr;
+        CryptoDBIterator *iterator = nullptr;
+        const vector<uint8_t> data = {0, 1, 0, 2, 0xff, 0};
+        vector<uint8_t> blob;
+        size_t entries = 0;
+
+        err = CryptoDB::Open(TEST_DB_FOLDER,
+                             uniq_data,
+                             CRYPTODB_UNIQ_DATA_MAX_LEN,
+                             NULL, NULL, NULL, blobs);
+        if (CRYPTODB_SUCCESS == err)
+            err = blobs.Put("blob", data);
+        if (CRYPTODB_SUCCESS == err)
+            err = blobs.Put("empty", nullptr, 0);
+        if (CRYPTODB_SUCCESS == err)
+            err = blobs.Put("int", 1);
+        if (CRYPTODB_SUCCESS == err)
+            err = blobs.Get("blob", blob);
+        if (CRYPTODB_SUCCESS == err && blob != data)
+            err = CRYPTODB_ERR_FAIL;
+        // Longer than the capacity
+        if (CRYPTODB_SUCCESS == err)
+            err = blobs.Put("blob", vector<uint8_t>(1000, 0));
+        if (CRYPTODB_SUCCESS == err)
+            err = blobs.CreateSnapshot(&snapshot);
+        if (CRYPTODB_SUCCESS == err)
+            err = snapshot->Get("blob", blob);
+        if (CRYPTODB_SUCCESS == err && blob != vector<uint8_t>(1000, 0))
+            err = CRYPTODB_ERR_FAIL;
+        delete snapshot;
+        if (CRYPTODB_SUCCESS == err)
+            err = blobs.Get("empty", blob);
+        if (CRYPTODB_SUCCESS == err && !blob.empty())
+            err = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == err && blobs.Get("int", blob) != CRYPTODB_VAL_NUM_INT)
+            err = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == err && blobs.GetInteger("blob"))
+            err = CRYPTODB_ERR_FAIL;
+
+        if (CRYPTODB_SUCCESS == err)
+            err = blobs.CreateIterator(NULL, &iterator);
+        if (CRYPTODB_SUCCESS == err)
+        {
+            for (const CryptoDBEntry &entry : *iterator)
+            {
+                ++entries;
+                if (CRYPTODB_SUCCESS != entry.result)
+                    err = entry.result;
+                else if (entry.key == "blob" &&
+                         (entry.type != CRYPTODB_VAL_BLOB || entry.blob.size() != 1000 || !entry.str.empty()))
+                    err = CRYPTODB_ERR_FAIL;
+            }
+        }
+        delete iterator;
+
+        blobs.Close();
+        if (CRYPTODB_SUCCESS != err || entries != 3 || CRYPTODB_SUCCESS != CryptoDB::Destroy(TEST_DB_FOLDER, NULL))
+        {
+            cerr << "ERROR: blob values" << endl;
+            return -1;
+        }
+    }
+
+    /**
+     * 64-bit integer values
+     */
+
+    {
+        CryptoDB numbers;
+        CryptoDBBatch *batch = nullptr;
+        const int64_t big = (int64_t(1) << 53) + 1;
+        int64_t i64 = 0;
+        uint64_t u64 = 0;
+        vector<CryptoDBGetItem> items(1);
+
+        err = CryptoDB::Open(TEST_DB_FOLDER,
+                             uniq_data,
+                             CRYPTODB_UNIQ_DATA_MAX_LEN,
+                             NULL, NULL, NULL, numbers);
+        if (CRYPTODB_SUCCESS == err)
+            err = numbers.Put("i64", big);
+        if (CRYPTODB_SUCCESS == err)
+            err = numbers.Put("u64", UINT64_MAX);
+        if (CRYPTODB_SUCCESS == err)
+            err = numbers.Put("int", 1);
+        if (CRYPTODB_SUCCESS == err)
+            err = numbers.CreateBatch(&batch);
+        if (CRYPTODB_SUCCESS == err)
+            err = batch->Put("batch_i64", INT64_MIN);
+        if (CRYPTODB_SUCCESS == err)
+            err = batch->Commit();
+        delete batch;
+        if (CRYPTODB_SUCCESS == err)
+            err = numbers.Get("i64", i64);
+        if (CRYPTODB_SUCCESS == err && i64 != big)
+            err = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == err)
+            err = numbers.Get("u64", u64);
+        if (CRYPTODB_SUCCESS == err && u64 != UINT64_MAX)
+            err = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == err &&
+            (numbers.GetInt64("batch_i64") != INT64_MIN || numbers.GetUInt64("i64") ||
+             numbers.Get("int", i64) != CRYPTODB_VAL_NUM_INT))
+            err = CRYPTODB_ERR_FAIL;
+
+        items[0].key = "u64";
+        items[0].type = CRYPTODB_VAL_NUM_UINT64;
+        if (CRYPTODB_SUCCESS == err)
+            err = numbers.MultiGet(items);
+        if (CRYPTODB_SUCCESS == err && (items[0].result != CRYPTODB_SUCCESS || items[0].uinteger64 != UINT64_MAX))
+            err = CRYPTODB_ERR_FAIL;
+
+        numbers.Close();
+        if (CRYPTODB_SUCCESS != err || CRYPTODB_SUCCESS != CryptoDB::Destroy(TEST_DB_FOLDER, NULL))
+        {
+            cerr << "ERROR: 64-bit integer values" << endl;
+            return -1;
+        }
+    }
+
+    /**
+     * Put<T>/Get<T> templates
+     */
+
+    {
+        CryptoDB typed;
+        CryptoDBBatch *batch = nullptr;
+        CryptoDBSnapshot *snapshot = nullptr;
+        const TestPoint point = {1, -2, 0.5};
+        const array<uint8_t, 3> bytes = {{0, 7, 0}};
+        TestPoint read_point = {0, 0, 0.0};
+        array<uint8_t, 3> read_bytes = {{0, 0, 0}};
+        const uint8_t raw[] = {1, 2};
+        long long big = 0;
+        uint32_t u32 = 0;
+        uint16_t u16 = 0;
+        uint8_t u8 = 0;
+        int16_t i16 = 0;
+        int8_t i8 = 0;
+        float f = 0.0f;
+        bool flag = false;
+        string str;
+
+        err = CryptoDB::Open(TEST_DB_FOLDER,
+                             uniq_data,
+                             CRYPTODB_UNIQ_DATA_MAX_LEN,
+                             NULL, NULL, NULL, typed);
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Put("point", point);
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Put("bytes", bytes);
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Put("big", -5LL);
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Put("str", string("typed"));
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Put("raw", cryptodb_blob_t{raw, sizeof(raw)});
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Put("u32", uint32_t(70000));
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Put("u16", uint16_t(600));
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Put("u8", uint8_t(200));
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Put("i16", int16_t(-600));
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Put("i8", int8_t(-100));
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Put("f", 0.25f);
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Put("flag", true);
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.CreateBatch(&batch);
+        if (CRYPTODB_SUCCESS == err)
+            err = batch->Put("batch_point", point);
+        if (CRYPTODB_SUCCESS == err)
+            err = batch->Commit();
+        delete batch;
+
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Get("point", read_point);
+        if (CRYPTODB_SUCCESS == err &&
+            (read_point.x != 1 || read_point.y != -2 || read_point.weight != 0.5))
+            err = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Get("bytes", read_bytes);
+        if (CRYPTODB_SUCCESS == err && read_bytes != bytes)
+            err = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Get("big", big);
+        if (CRYPTODB_SUCCESS == err && big != -5)
+            err = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == err &&
+            (typed.Get<string>("str") != string("typed") || typed.Get<int64_t>("big") != -5 ||
+             typed.Get<vector<uint8_t>>("raw") != vector<uint8_t>(raw, raw + sizeof(raw))))
+            err = CRYPTODB_ERR_FAIL;
+
+        // Narrow numbers are stored as the wider value types
+        if (CRYPTODB_SUCCESS == err &&
+            (typed.Get("u32", u32) != CRYPTODB_SUCCESS || u32 != 70000 ||
+             typed.Get("u16", u16) != CRYPTODB_SUCCESS || u16 != 600 ||
+             typed.Get("u8", u8) != CRYPTODB_SUCCESS || u8 != 200 ||
+             typed.Get("i16", i16) != CRYPTODB_SUCCESS || i16 != -600 ||
+             typed.Get("i8", i8) != CRYPTODB_SUCCESS || i8 != -100 ||
+             typed.Get("f", f) != CRYPTODB_SUCCESS || f != 0.25f ||
+             typed.Get("flag", flag) != CRYPTODB_SUCCESS || !flag ||
+             typed.Get<uint64_t>("u8") != 200u || typed.Get<double>("f") != 0.25))
+            err = CRYPTODB_ERR_FAIL;
+        if (CRYPTODB_SUCCESS == err &&
+            (typed.Get("u32", u16) != CRYPTODB_ERR_WRONG_ARGUMENT || u16 != 600 ||
+             typed.Get("i16", i8) != CRYPTODB_ERR_WRONG_ARGUMENT || i8 != -100 ||
+             typed.Get("u8", flag) != CRYPTODB_ERR_WRONG_ARGUMENT))
+            err = CRYPTODB_ERR_FAIL;
+
+        // Values of another type or length aren't T
+        if (CRYPTODB_SUCCESS == err &&
+            (typed.Get("raw", read_point) != CRYPTODB_ERR_WRONG_ARGUMENT ||
+             typed.Get("str", read_point) != CRYPTODB_VAL_STRING ||
+             typed.Get<TestPoint>("big") || read_point.x != 1))
+            err = CRYPTODB_ERR_FAIL;
+
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.CreateSnapshot(&snapshot);
+        if (CRYPTODB_SUCCESS == err)
+            err = typed.Put("batch_point", TestPoint{3, 4, 1.5});
+        if (CRYPTODB_SUCCESS == err)
+        {
+            optional<TestPoint> snapshot_point = snapshot->Get<TestPoint>("batch_point");
+            if (!snapshot_point || snapshot_point->x != 1 || snapshot_point->weight != 0.5)
+                err = CRYPTODB_ERR_FAIL;
+        }
+        delete snapshot;
+
+        typed.Close();
+        if (CRYPTODB_SUCCESS != err || CRYPTODB_SUCCESS != CryptoDB::Destroy(TEST_DB_FOLDER, NULL))
+        {
+            cerr << "ERROR: Put<T>/Get<T> templates" << endl;
+            return -1;
+        }
+    }
+
     cout << "PASS" << endl;
 
     return 0;
@@ -45,11 +45,11 @@ if [[ ! -z $(type valgrind 2>&1 | grep "not found") ]]; then
 fi
 
 echo "Pre-commit hook: Perform static analysis"
-if [[ ! -z $(cppcheck $CRYPTO_DB_PATH/cryptodb.h $CRYPTO_DB_PATH/cryptodb.c $CRYPTO_DB_PATH/test/test.c 2>&1 | grep error) ]]; then
+if [[ ! -z $(cppcheck $CRYPTO_DB_PATH/cryptodb.h $CRYPTO_DB_PATH/cryptodb.c $CRYPTO_DB_PATH/cryptodb_aes.h $CRYPTO_DB_PATH/cryptodb_aes.c $CRYPTO_DB_PATH/cryptodb_aes_hw.c $CRYPTO_DB_PATH/cryptodb_filter.h $CRYPTO_DB_PATH/cryptodb_filter.c $CRYPTO_DB_PATH/cryptodb_lz4.h $CRYPTO_DB_PATH/cryptodb_lz4.c $CRYPTO_DB_PATH/cryptodb_pool.h $CRYPTO_DB_PATH/cryptodb_pool.c $CRYPTO_DB_PATH/cryptodb_readahead.h $CRYPTO_DB_PATH/cryptodb_readahead.c $CRYPTO_DB_PATH/cryptodb_sync.h $CRYPTO_DB_PATH/cryptodb_sync.c $CRYPTO_DB_PATH/cryptodb_writer.h $CRYPTO_DB_PATH/cryptodb_writer.c $CRYPTO_DB_PATH/test/test.c 2>&1 | grep error) ]]; then
     echo "ERROR: Source code static analysis was failed"
     exit 1
 fi
-if [[ ! -z $(cppcheck $CRYPTO_DB_PATH/cryptodb.h $CRYPTO_DB_PATH/cryptodb.c $CRYPTO_DB_PATH/test/test.c 2>&1 | grep warning) ]]; then
+if [[ ! -z $(cppcheck $CRYPTO_DB_PATH/cryptodb.h $CRYPTO_DB_PATH/cryptodb.c $CRYPTO_DB_PATH/cryptodb_aes.h $CRYPTO_DB_PATH/cryptodb_aes.c $CRYPTO_DB_PATH/cryptodb_aes_hw.c $CRYPTO_DB_PATH/cryptodb_filter.h $CRYPTO_DB_PATH/cryptodb_filter.c $CRYPTO_DB_PATH/cryptodb_lz4.h $CRYPTO_DB_PATH/cryptodb_lz4.c $CRYPTO_DB_PATH/cryptodb_pool.h $CRYPTO_DB_PATH/cryptodb_pool.c $CRYPTO_DB_PATH/cryptodb_readahead.h $CRYPTO_DB_PATH/cryptodb_readahead.c $CRYPTO_DB_PATH/cryptodb_sync.h $CRYPTO_DB_PATH/cryptodb_sync.c $CRYPTO_DB_PATH/cryptodb_writer.h $CRYPTO_DB_PATH/cryptodb_writer.c $CRYPTO_DB_PATH/test/test.c 2>&1 | grep warning) ]]; then
     echo "ERROR: Source code static analysis was failed"
     exit 1
 fi